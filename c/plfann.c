@@ -23,9 +23,19 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdarg.h>
+#include <stdint.h>
 #include <string.h>
 #include <time.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <pthread.h>
+#include <stdatomic.h>
 #include <math.h>
+#include <limits.h>
+#include <locale.h>
 #include <SWI-Prolog.h>
 #include <SWI-Stream.h>
 #include "plfann.h"
@@ -163,6 +173,56 @@ static int domain_error ( term_t actual, const char *expected ) {
 }
 
 
+static int existence_error ( term_t actual, const char *type ) {
+
+	term_t ex;
+
+	if ( ( ex = PL_new_term_ref() ) &&
+		PL_unify_term( ex,
+			PL_FUNCTOR_CHARS, "error", 2,
+				PL_FUNCTOR_CHARS, "existence_error", 2,
+					PL_CHARS, type,
+					PL_TERM, actual,
+				PL_VARIABLE ) )
+
+    return PL_raise_exception(ex);
+
+  return FALSE;
+}
+
+
+// A limit of the system, such as max_path_length, was exceeded.
+
+static int representation_error ( const char *limit ) {
+
+	term_t ex;
+
+	if ( ( ex = PL_new_term_ref() ) &&
+		PL_unify_term( ex,
+			PL_FUNCTOR_CHARS, "error", 2,
+				PL_FUNCTOR_CHARS, "representation_error", 1,
+					PL_CHARS, limit,
+				PL_VARIABLE ) )
+
+    return PL_raise_exception(ex);
+
+  return FALSE;
+}
+
+
+static int time_limit_exceeded ( void ) {
+
+	term_t ex;
+
+	if ( ( ex = PL_new_term_ref() ) &&
+		PL_put_atom_chars ( ex, "time_limit_exceeded" ) )
+
+    return PL_raise_exception(ex);
+
+  return FALSE;
+}
+
+
 enum fann_activationfunc_enum lookup_activationfunc_enum ( char *type ) {
 
 	if ( !strcmp ( "FANN_ELLIOT", type ) ) return FANN_ELLIOT;
@@ -188,6 +248,17 @@ enum fann_activationfunc_enum lookup_activationfunc_enum ( char *type ) {
 }
 
 
+enum fann_train_enum lookup_train_enum ( char *type ) {
+
+	if ( !strcmp ( "FANN_TRAIN_INCREMENTAL", type ) ) return FANN_TRAIN_INCREMENTAL;
+	if ( !strcmp ( "FANN_TRAIN_BATCH", type ) ) return FANN_TRAIN_BATCH;
+	if ( !strcmp ( "FANN_TRAIN_RPROP", type ) ) return FANN_TRAIN_RPROP;
+	if ( !strcmp ( "FANN_TRAIN_QUICKPROP", type ) ) return FANN_TRAIN_QUICKPROP;
+
+	return FANN_UNDEFINED;
+}
+
+
 #ifndef VERSION220
 static char const *const FANN_ERROR_CODES[19] = {
 #else
@@ -252,1488 +323,8628 @@ static char const *const FANN_ERROR_STRING[21] = {
 };
 
 
-foreign_t swi_fann_type ( term_t type_pt ) {
-
-#ifdef FIXEDFANN
-	return PL_unify_atom_chars ( type_pt, "FANN_FIXED" );
-#elif defined FLOATFANN
-	return PL_unify_atom_chars ( type_pt, "FANN_FLOAT" );
-#else
-	return PL_unify_atom_chars ( type_pt, "FANN_DOUBLE" );
-#endif
-}
-
+                        /* Random numbers */
 
-/* In module plfann.pl: fann_create_standard */
 
+// xoshiro256** with splitmix64 seeding. Every network and every training
+// data has its own generator, drawn from on first use and reseeded with
+// fann_set_random_seed/2 and fann_set_train_data_random_seed/2, so that
+// runs do not depend on rand () and parallel runs are reproducible.
 
-foreign_t swi_fann_create_standard_array ( term_t layers_pt, term_t ann_pt ) {
+typedef struct rng {
 
-	term_t layer_pt = PL_new_term_ref ();
-	unsigned int nl = 2;
-	int *l = ( int* ) PL_malloc ( sizeof( unsigned int ) << 2 );
+	uint64_t s[4];
+} rng;
 
-	if ( !PL_get_list (layers_pt, layer_pt, layers_pt) )
-	    return type_error ( layers_pt, "list" );
-	if ( !PL_get_integer ( layer_pt, l ) )
-        return type_error ( layer_pt, "integer" );
-	if ( l[0] < 1 )
-		return domain_error ( layer_pt, "positive_integer" );
 
-	if ( !PL_get_list (layers_pt, layer_pt, layers_pt) )
-		return type_error ( layers_pt, "list" );
-	if ( !PL_get_integer ( layer_pt, l+1 ) )
-		return type_error ( layer_pt, "integer" );
-	if ( l[1] < 1 )
-		return domain_error ( layer_pt, "positive_integer" );
+static uint64_t splitmix64 ( uint64_t *x ) {
 
-	while ( PL_get_list (layers_pt, layer_pt, layers_pt) ) {
+	uint64_t z = ( *x += 0x9e3779b97f4a7c15ULL );
 
-		l = PL_realloc ( l, ( nl + 1 ) * sizeof( unsigned int ) );
+	z = ( z ^ ( z >> 30 ) ) * 0xbf58476d1ce4e5b9ULL;
+	z = ( z ^ ( z >> 27 ) ) * 0x94d049bb133111ebULL;
 
-		if ( !PL_get_integer ( layer_pt, l+nl ) )
-		    return type_error ( layer_pt, "integer" );
-		if ( l[nl++] < 1 )
-			return domain_error ( layer_pt, "positive_integer" );
-		}
+	return z ^ ( z >> 31 );
+}
 
-	if ( !PL_is_variable ( ann_pt ) )
-		return type_error ( ann_pt, "var" );
 
-	PL_unify_pointer ( ann_pt, fann_create_standard_array ( nl, l ) );
+static void rng_seed ( rng *r, uint64_t seed ) {
 
-    PL_free ( l );
+	int i;
 
-	PL_succeed;
+	for ( i = 0; i < 4; i++ )
+		r->s[i] = splitmix64 ( &seed );
 }
 
 
-/* In module plfann.pl: fann_create_sparse */
+static uint64_t rotl ( uint64_t x, int k ) {
 
+	return ( x << k ) | ( x >> ( 64 - k ) );
+}
 
-foreign_t swi_fann_create_sparse_array ( term_t connection_rate_pt, term_t layers_pt, term_t ann_pt ) {
 
-	double connection_rate;
-	term_t layer_pt = PL_new_term_ref ();
-	unsigned int nl = 2;
-	int *l = ( int* ) PL_malloc ( sizeof( unsigned int ) << 2 );
+static uint64_t rng_next ( rng *r ) {
 
-	if ( !PL_get_float ( connection_rate_pt, &connection_rate ) )
-		return type_error ( connection_rate_pt, "float" );
+	uint64_t *s = r->s;
+	uint64_t result = rotl ( s[1] * 5, 7 ) * 9;
+	uint64_t t = s[1] << 17;
 
-	if ( !PL_get_list (layers_pt, layer_pt, layers_pt) )
-		return type_error ( layers_pt, "list" );
-	if ( !PL_get_integer ( layer_pt, l ) )
-        return type_error ( layer_pt, "integer" );
-	if ( l[0] < 1 )
-		return domain_error ( layer_pt, "positive_integer" );
+	s[2] ^= s[0];
+	s[3] ^= s[1];
+	s[1] ^= s[2];
+	s[0] ^= s[3];
+	s[2] ^= t;
+	s[3] = rotl ( s[3], 45 );
 
-	if ( !PL_get_list (layers_pt, layer_pt, layers_pt) )
-		return type_error ( layers_pt, "list" );
-	if ( !PL_get_integer ( layer_pt, l+1 ) )
-        return type_error ( layer_pt, "integer" );
-	if ( l[1] < 1 )
-		return domain_error ( layer_pt, "positive_integer" );
+	return result;
+}
 
-	while ( PL_get_list (layers_pt, layer_pt, layers_pt) ) {
 
-		l = PL_realloc ( l, ( nl + 1 ) * sizeof( unsigned int ) );
+// Uniform in [0, n).
 
-		if ( !PL_get_integer ( layer_pt, l+nl ) )
-	        return type_error ( layer_pt, "integer" );
-    	if ( l[nl++] < 1 )
-		    return domain_error ( layer_pt, "positive_integer" );
-		}
+static unsigned int rng_below ( rng *r, unsigned int n ) {
 
-	if ( !PL_is_variable ( ann_pt ) )
-		return type_error ( ann_pt, "var" );
+	return ( unsigned int ) ( ( ( rng_next ( r ) >> 32 ) * n ) >> 32 );
+}
 
-	PL_unify_pointer ( ann_pt, fann_create_sparse_array( ( float ) connection_rate, nl, l ) );
 
-    PL_free ( l );
+// Uniform in [0, 1).
 
-	PL_succeed;
+static double rng_double ( rng *r ) {
+
+	return ( rng_next ( r ) >> 11 ) * ( 1.0 / 9007199254740992.0 );
 }
 
 
-/* In module plfann.pl: create_shortcut */
+// Seeds a generator nobody seeded, differently for every call.
 
+static void rng_seed_fresh ( rng *r, const void *handle ) {
 
-foreign_t swi_fann_create_shortcut_array ( term_t layers_pt, term_t ann_pt ) {
+	static uint64_t counter = 0;
+	struct timeval tv;
 
-	term_t layer_pt = PL_new_term_ref ();
-	unsigned int nl = 2;
-	int *l = ( int* ) PL_malloc ( sizeof( unsigned int ) << 2 );
+	gettimeofday ( &tv, NULL );
 
-	if ( !PL_get_list (layers_pt, layer_pt, layers_pt) )
-		return type_error ( layers_pt, "list" );
-	if ( !PL_get_integer ( layer_pt, l ) )
-        return type_error ( layer_pt, "integer" );
-	if ( l[0] < 1 )
-		return domain_error ( layer_pt, "positive_integer" );
+	rng_seed ( r, ( ( uint64_t ) tv.tv_sec * 1000000 + tv.tv_usec ) ^
+		( ( uint64_t ) ( uintptr_t ) handle << 16 ) ^
+		( __sync_add_and_fetch ( &counter, 1 ) * 0x9e3779b97f4a7c15ULL ) );
+}
 
-	if ( !PL_get_list (layers_pt, layer_pt, layers_pt) )
-		return type_error ( layers_pt, "list" );
-	if ( !PL_get_integer ( layer_pt, l+1 ) )
-        return type_error ( layer_pt, "integer" );
-	if ( l[1] < 1 )
-		return domain_error ( layer_pt, "positive_integer" );
 
-	while ( PL_get_list (layers_pt, layer_pt, layers_pt) ) {
+// Handles are hashed into the registries of networks and training data.
 
-		l = PL_realloc ( l, ( nl + 1 ) * sizeof( unsigned int ) );
+#define REGISTRY_SIZE 256
 
-		if ( !PL_get_integer ( layer_pt, l+nl ) )
-	        return type_error ( layer_pt, "integer" );
-    	if ( l[nl++] < 1 )
-		    return domain_error ( layer_pt, "positive_integer" );
-		}
+static unsigned int registry_hash ( const void *handle ) {
 
-	if ( !PL_is_variable ( ann_pt ) )
-		return type_error ( ann_pt, "var" );
+	return ( unsigned int ) ( ( ( uintptr_t ) handle >> 4 ) % REGISTRY_SIZE );
+}
 
-	PL_unify_pointer ( ann_pt, fann_create_shortcut_array( nl, l ) );
 
-    PL_free ( l );
+// A schedule of the learning rate or momentum of a network (see Schedules).
 
-	PL_succeed;
-}
+enum schedule_kind {
 
+	SCHEDULE_NONE = 0,
+	SCHEDULE_STEP,
+	SCHEDULE_EXPONENTIAL,
+	SCHEDULE_COSINE,
+	SCHEDULE_WARM_RESTARTS,
+	SCHEDULE_PLATEAU
+};
 
-foreign_t swi_fann_destroy ( term_t ann_pt ) {
+typedef struct schedule {
 
-	void *ann;
+	enum schedule_kind kind;
+	double arg[3];			// The arguments of the schedule term.
+	double base;			// The value of the parameter when attached.
+	double current;			// The value of a plateau schedule.
+	double best;			// The lowest MSE seen by a plateau schedule.
+	unsigned int stale;		// Epochs since best.
+	unsigned int epoch;		// Epochs trained under the schedule.
+} schedule;
 
-	if ( !PL_get_pointer ( ann_pt, &ann ) )
-		return type_error ( ann_pt, "pointer" );
+enum schedule_parameter {
 
-    fann_destroy ( ann );
+	SCHEDULE_LEARNING_RATE = 0,
+	SCHEDULE_LEARNING_MOMENTUM,
+	SCHEDULE_PARAMETERS
+};
 
-	PL_succeed;
-}
+typedef struct ann_info {
 
+	struct fann *ann;
+	struct ann_info *next;	// hash chain
+	rng rng;
+	schedule schedules[SCHEDULE_PARAMETERS];
+	void *map;			// The model file the weights are mapped from,
+	size_t map_size;		// see fann_map/2.
+} ann_info;
 
-#ifdef VERSION220
-foreign_t swi_fann_copy ( term_t ann1_pt, term_t ann2_pt ) {
+static ann_info *ann_registry[REGISTRY_SIZE];
+static pthread_mutex_t ann_registry_lock = PTHREAD_MUTEX_INITIALIZER;
 
-	void *ann1;
 
-	if ( !PL_get_pointer ( ann1_pt, &ann ) )
-		return type_error ( ann1_pt, "pointer" );
-	if ( !PL_is_variable ( ann2_pt ) )
-		return type_error ( ann2_pt, "var" );
+#ifndef FIXEDFANN
 
-	return PL_unify_pointer ( ann2_pt, fann_copy ( ann1 ) );
-}
-#endif
+static ann_info *lookup_ann_info ( struct fann *ann ) {
 
+	ann_info *info;
 
-foreign_t swi_fann_run ( term_t ann_pt, term_t input_pt, term_t output_pt ) {
+	pthread_mutex_lock ( &ann_registry_lock );
 
-	unsigned int i, num_input;
-	fann_type *input, *output;
-	term_t temp_pt = PL_new_term_ref ();
-	void *ann;
+	for ( info = ann_registry[registry_hash ( ann )]; info && info->ann != ann; info = info->next )
+		;
 
-	if ( !PL_get_pointer ( ann_pt, &ann ) )
-		return type_error ( ann_pt, "pointer" );
+	pthread_mutex_unlock ( &ann_registry_lock );
 
-	num_input = fann_get_num_input ( ann );
-	input = ( fann_type* ) PL_malloc ( num_input * sizeof ( fann_type ) );
+	return info;
+}
 
-	for ( i = 0; i < num_input; i++ ) {
+#endif
 
-		if ( !PL_unify_list ( input_pt, temp_pt, input_pt ) )
-			return type_error ( input_pt, "list" );
-		if ( !PL_FANN_GET_FANNTYPE(temp_pt,input+i) )
-			return type_error ( temp_pt, PL_FANN_FANNTYPE );
-	}
 
-	if ( !PL_unify_nil ( input_pt ) )
-		return type_error ( input_pt, "list" );
+// Returns the entry of ann, creating it if ann is not registered yet.
 
-	output = fann_run ( ann, ( fann_type* ) input );
+static ann_info *get_ann_info ( struct fann *ann ) {
 
-	PL_free ( input );
+	ann_info *info;
+	unsigned int h = registry_hash ( ann );
 
-	if ( !PL_is_variable ( output_pt ) )
-		return type_error ( output_pt, "var" );
+	pthread_mutex_lock ( &ann_registry_lock );
 
-	for ( i = 0; i < fann_get_num_output ( ann ); i++ ) {
+	for ( info = ann_registry[h]; info && info->ann != ann; info = info->next )
+		;
 
-		PL_unify_list ( output_pt, temp_pt, output_pt );
-		PL_FANN_UNIFY_FANNTYPE(temp_pt,output[i]);
+	if ( !info && ( info = calloc ( 1, sizeof ( ann_info ) ) ) != NULL ) {
+
+		info->ann = ann;
+		rng_seed_fresh ( &info->rng, ann );
+		info->next = ann_registry[h];
+		ann_registry[h] = info;
 	}
 
-	return PL_unify_nil ( output_pt );
+	pthread_mutex_unlock ( &ann_registry_lock );
+
+	return info;
 }
 
 
-foreign_t swi_fann_run_unsafe ( term_t ann_pt, term_t input_pt, term_t output_pt ) {
+static void destroy_ann ( struct fann *ann ) {
 
-	unsigned int i, num_input;
-	fann_type *input, *output;
-	term_t temp_pt = PL_new_term_ref ();
-	void *ann;
+	ann_info **prev, *info = NULL;
 
-	PL_get_pointer ( ann_pt, &ann );
+	pthread_mutex_lock ( &ann_registry_lock );
 
-	num_input = fann_get_num_input ( ann );
-	input = ( fann_type* ) PL_malloc ( num_input * sizeof ( fann_type ) );
+	for ( prev = ann_registry + registry_hash ( ann ); *prev && ( *prev )->ann != ann; prev = &( *prev )->next )
+		;
 
-	for ( i = 0; i < num_input; i++ ) {
+	if ( ( info = *prev ) != NULL )
+		*prev = info->next;
 
-		PL_unify_list ( input_pt, temp_pt, input_pt );
-		PL_FANN_GET_FANNTYPE(temp_pt,input+i);
-	}
+	pthread_mutex_unlock ( &ann_registry_lock );
 
-	PL_unify_nil ( input_pt );
+	// Mapped weights are not fann_destroy ()'s to free.
+	if ( info && info->map )
+		ann->weights = NULL;
 
-	output = fann_run ( ann, ( fann_type* ) input );
+	fann_destroy ( ann );
 
-	PL_free ( input );
+	if ( info && info->map )
+		munmap ( info->map, info->map_size );
+	free ( info );
+}
+
+#ifndef FIXEDFANN
 
-	PL_is_variable ( output_pt );
+// Gives ann weights of its own in place of weights mapped by fann_map/2,
+// before cascade training reallocates them. Fails if out of memory.
 
-	for ( i = 0; i < fann_get_num_output ( ann ); i++ ) {
+static int unmap_ann ( struct fann *ann ) {
 
-		PL_unify_list ( output_pt, temp_pt, output_pt );
-		PL_FANN_UNIFY_FANNTYPE(temp_pt,output[i]);
-	}
+	ann_info *info = lookup_ann_info ( ann );
+	fann_type *weights;
 
-	return PL_unify_nil ( output_pt );
+	if ( !info || !info->map )
+		return TRUE;
+	if ( ( weights = malloc ( ann->total_connections_allocated * sizeof ( fann_type ) ) ) == NULL )
+		return FALSE;
+
+	memcpy ( weights, ann->weights, ann->total_connections * sizeof ( fann_type ) );
+	ann->weights = weights;
+	munmap ( info->map, info->map_size );
+	info->map = NULL;
+
+	return TRUE;
 }
 
+#endif
 
-foreign_t swi_fann_randomize_weights ( term_t ann_pt, term_t min_weight_pt, term_t max_weight_pt ) {
 
-	fann_type min_weight, max_weight;
-	void *ann;
+// As fann_randomize_weights (), drawing from the generator r.
 
-	if ( !PL_get_pointer ( ann_pt, &ann ) )
-		return type_error ( ann_pt, "pointer" );
-	if ( !PL_FANN_GET_FANNTYPE(min_weight_pt,&min_weight) )
-		return type_error ( min_weight_pt, PL_FANN_FANNTYPE );
-	if ( !PL_FANN_GET_FANNTYPE(max_weight_pt,&max_weight) )
-		return type_error ( max_weight_pt, PL_FANN_FANNTYPE );
+static void randomize_weights ( struct fann *ann, fann_type min_weight, fann_type max_weight, rng *r ) {
 
-    fann_randomize_weights ( ann, min_weight, max_weight );
+	fann_type *weights = ann->weights, *last_weight = ann->weights + ann->total_connections;
 
-	PL_succeed;
+	for ( ; weights != last_weight; weights++ )
+		*weights = ( fann_type ) ( ( float ) min_weight + ( ( float ) max_weight - ( float ) min_weight ) * rng_double ( r ) );
+
+#ifndef FIXEDFANN
+	if ( ann->prev_train_slopes != NULL )
+		fann_clear_train_arrays ( ann );
+#endif
 }
 
 
-foreign_t swi_fann_init_weights ( term_t ann_pt, term_t train_data_pt ) {
+                        /* Handles */
 
-	void *ann, *train_data;
 
-	if ( !PL_get_pointer ( ann_pt, &ann ) )
-		return type_error ( ann_pt, "pointer" );
-	if ( !PL_get_pointer ( train_data_pt, &train_data ) )
-		return type_error ( train_data_pt, "pointer" );
+// Networks, training data, compact training data and matrices are handed
+// to Prolog as blobs, each pointing at a handle that points at the object. Each
+// object gets its blob once, when it is created. Destroying the object
+// through its predicate clears the handle, so a destroyed handle raises an
+// existence error instead of crashing. A handle that is garbage collected
+// while it still holds its object frees it. The blob types are per engine,
+// so a handle of one engine is a type error to another.
+//
+// Training may run for a long time while other threads call Prolog, so the
+// training predicates count themselves as users of the objects they train
+// with use_handle (). Destroying an object that has users only clears its
+// handle, and the last user frees it when it is done. Since a handle
+// changes when it is destroyed the blobs are not unique, which they need
+// not be: no two handles hold the same object.
 
-	fann_init_weights ( ann, train_data );
+typedef struct fann_handle {
 
-	PL_succeed;
-}
+	_Atomic ( void * ) ptr;		// NULL once destroyed
+	_Atomic ( void * ) destroyed;	// destroyed while in use, freed by the last user
+	atomic_uint users;		// calls using the object
+	PL_blob_t *type;
+} fann_handle;
 
+// Values kept in C between calls, rows x cols of them, row after row. A
+// vector is a matrix of one row.
 
-foreign_t swi_fann_print_connections ( term_t ann_pt ) {
+typedef struct fann_matrix {
 
-	void *ann;
+	unsigned int rows, cols;
+	fann_type values[];
+} fann_matrix;
 
-	if ( !PL_get_pointer ( ann_pt, &ann ) )
-		return type_error ( ann_pt, "pointer" );
+struct compact_train;
 
-	fann_print_connections ( ann );
+static void destroy_train_data ( struct fann_train_data *data );
+#ifndef FIXEDFANN
+static void destroy_compact_train ( struct compact_train *c );
+#endif
 
-	PL_succeed;
-}
 
+static int release_handle ( atom_t a );
 
-foreign_t swi_fann_print_parameters ( term_t ann_pt ) {
+static PL_blob_t ann_blob = {
 
-	void *ann;
-	term_t params_pt = PL_new_term_ref ();
+	.magic = PL_BLOB_MAGIC,
+	.flags = PL_BLOB_NOCOPY,
+	.name = "fann",
+	.release = release_handle,
+	.compare = NULL,
+	.write = NULL,
+	.acquire = NULL
+};
 
-	if ( !PL_get_pointer ( ann_pt, &ann ) )
-    	return type_error ( ann_pt, "pointer" );
+static PL_blob_t train_blob = {
 
-	fann_print_parameters ( ann );
+	.magic = PL_BLOB_MAGIC,
+	.flags = PL_BLOB_NOCOPY,
+	.name = "fann_train_data",
+	.release = release_handle,
+	.compare = NULL,
+	.write = NULL,
+	.acquire = NULL
+};
 
-	PL_succeed;
-}
+static PL_blob_t matrix_blob = {
 
+	.magic = PL_BLOB_MAGIC,
+	.flags = PL_BLOB_NOCOPY,
+	.name = "fann_matrix",
+	.release = release_handle,
+	.compare = NULL,
+	.write = NULL,
+	.acquire = NULL
+};
 
-foreign_t swi_fann_get_num_input ( term_t ann_pt, term_t put_pt ) {
+#ifndef FIXEDFANN
+static PL_blob_t compact_blob = {
+
+	.magic = PL_BLOB_MAGIC,
+	.flags = PL_BLOB_NOCOPY,
+	.name = "fann_compact_train",
+	.release = release_handle,
+	.compare = NULL,
+	.write = NULL,
+	.acquire = NULL
+};
+#endif
 
-	void *ann;
 
-	if ( !PL_get_pointer ( ann_pt, &ann ) )
-		return type_error ( ann_pt, "pointer" );
+static void destroy_handle_object ( PL_blob_t *type, void *ptr ) {
 
-	return PL_unify_integer ( put_pt, fann_get_num_input ( ann ) );
+	if ( type == &ann_blob )
+		destroy_ann ( ptr );
+	else if ( type == &train_blob )
+		destroy_train_data ( ptr );
+	else if ( type == &matrix_blob )
+		free ( ptr );
+#ifndef FIXEDFANN
+	else if ( type == &compact_blob )
+		destroy_compact_train ( ptr );
+#endif
 }
 
 
-foreign_t swi_fann_get_num_output ( term_t ann_pt, term_t put_pt ) {
+// Frees the object of a destroyed handle unless another caller already
+// has. Whoever swaps it out frees it, so it is freed once.
 
-	void *ann;
+static void free_destroyed ( fann_handle *h ) {
 
-	if ( !PL_get_pointer ( ann_pt, &ann ) )
-		return type_error ( ann_pt, "pointer" );
+	void *ptr = atomic_exchange ( &h->destroyed, NULL );
 
-	return PL_unify_integer ( put_pt, fann_get_num_output ( ann ) );
+	if ( ptr )
+		destroy_handle_object ( h->type, ptr );
 }
 
 
-foreign_t swi_fann_get_total_neurons ( term_t ann_pt, term_t tn_pt ) {
+// Called by the atom garbage collector. No call can be using the object:
+// a running predicate references the blob.
 
-	void *ann;
+static int release_handle ( atom_t a ) {
 
-	if ( !PL_get_pointer ( ann_pt, &ann ) )
-		return type_error ( ann_pt, "pointer" );
+	fann_handle *h = PL_blob_data ( a, NULL, NULL );
+	void *ptr = atomic_exchange ( &h->ptr, NULL );
 
-	return PL_unify_integer ( tn_pt, fann_get_total_neurons ( ann ) );
-}
+	if ( ptr )
+		destroy_handle_object ( h->type, ptr );
+	free_destroyed ( h );
+	free ( h );
 
+	return TRUE;
+}
 
-foreign_t swi_fann_get_total_connections ( term_t ann_pt, term_t tn_pt ) {
 
-	void *ann;
+static fann_handle *get_handle ( term_t t, PL_blob_t *type ) {
 
-	if ( !PL_get_pointer ( ann_pt, &ann ) )
-		return type_error ( ann_pt, "pointer" );
+	PL_blob_t *actual;
+	void *h;
 
-	return PL_unify_integer ( tn_pt, fann_get_total_connections ( ann ) );
+	return PL_get_blob ( t, &h, NULL, &actual ) && actual == type ? h : NULL;
 }
 
 
-foreign_t swi_fann_get_network_type ( term_t ann_pt, term_t type_pt ) {
+static int get_handle_object ( term_t t, PL_blob_t *type, void **ptr ) {
 
-	void *ann;
+	fann_handle *h;
 
-	if ( !PL_get_pointer ( ann_pt, &ann ) )
-		return type_error ( ann_pt, "pointer" );
+	if ( ( h = get_handle ( t, type ) ) == NULL )
+		return type_error ( t, type->name );
+	if ( ( *ptr = atomic_load ( &h->ptr ) ) == NULL )
+		return existence_error ( t, type->name );
 
-	return PL_unify_atom_chars ( type_pt, FANN_NETTYPE_NAMES[ fann_get_network_type ( ann ) ] );
+	PL_succeed;
 }
 
 
-foreign_t swi_fann_get_connection_rate ( term_t ann_pt, term_t cr_pt ) {
+#ifndef FIXEDFANN
 
-	void *ann;
+// The handles a training predicate uses, given back by unuse_handles ().
 
-	if ( !PL_get_pointer ( ann_pt, &ann ) )
-		return type_error ( ann_pt, "pointer" );
-	if ( !PL_is_variable ( cr_pt ) )
-		return type_error ( cr_pt, "var" );
+typedef struct handle_uses {
 
-	return PL_unify_float ( cr_pt, fann_get_connection_rate( ann ) );
-}
+	fann_handle *handles[3];
+	unsigned int count;
+} handle_uses;
 
 
-foreign_t swi_fann_get_num_layers ( term_t ann_pt, term_t nl_pt ) {
+static void unuse_handles ( handle_uses *u ) {
 
-	void *ann;
+	fann_handle *h;
 
-	if ( !PL_get_pointer ( ann_pt, &ann ) )
-		return type_error ( ann_pt, "pointer" );
+	while ( u->count ) {
 
-	return PL_unify_integer ( nl_pt, fann_get_num_layers( ann ) );
+		h = u->handles[--u->count];
+		if ( atomic_fetch_sub ( &h->users, 1 ) == 1 )
+			free_destroyed ( h );
+	}
 }
 
 
-foreign_t swi_fann_get_layer_array ( term_t ann_pt, term_t lay_arr_pt ) {
+// Counts a use of the object of t, got before. The use is counted before
+// the handle is read again, and destroy_handle () clears the handle before
+// it reads the count, so either the object is still there and its
+// destroyer sees this use, or t was destroyed meanwhile and this raises an
+// existence error, giving back the uses counted in u so far.
 
-	unsigned int i, nl;
-	unsigned int *temp;
+static int use_handle ( handle_uses *u, term_t t, PL_blob_t *type ) {
 
-	term_t temp_pt = PL_new_term_ref ();
-	void *ann;
+	fann_handle *h = get_handle ( t, type );
 
-	if ( !PL_get_pointer ( ann_pt, &ann ) )
-		return type_error ( ann_pt, "pointer" );
+	atomic_fetch_add ( &h->users, 1 );
+	u->handles[u->count++] = h;
 
-	nl = fann_get_num_layers( ann );
+	if ( atomic_load ( &h->ptr ) == NULL ) {
 
-	temp = ( unsigned int* ) PL_malloc ( sizeof ( unsigned int ) * nl );
+		unuse_handles ( u );
+		return existence_error ( t, type->name );
+	}
 
-	fann_get_layer_array ( ann, temp );
+	PL_succeed;
+}
 
-	if ( !PL_is_variable ( lay_arr_pt ) )
-		return type_error ( lay_arr_pt, "var" );
+#endif
 
-	for ( i = 0; i < nl; i++ ) {
 
-		PL_unify_list ( lay_arr_pt, temp_pt, lay_arr_pt );
-		PL_unify_integer ( temp_pt, temp[i] );
-	}
+// Clears the handle of t and frees its object, for the destroy predicates.
+// An object still in use is freed by its last user.
 
-	PL_unify_nil ( lay_arr_pt );
+static int destroy_handle ( term_t t, PL_blob_t *type ) {
+
+	fann_handle *h;
+	void *ptr;
 
-	PL_free ( temp );
+	if ( ( h = get_handle ( t, type ) ) == NULL )
+		return type_error ( t, type->name );
+	if ( ( ptr = atomic_exchange ( &h->ptr, NULL ) ) == NULL )
+		return existence_error ( t, type->name );
+
+	atomic_store ( &h->destroyed, ptr );
+
+	if ( atomic_load ( &h->users ) == 0 )
+		free_destroyed ( h );
 
 	PL_succeed;
 }
 
 
-foreign_t swi_fann_get_bias_array ( term_t ann_pt, term_t lay_arr_pt ) {
+// Hands ptr over to a new blob unified with t. If t does not unify the
+// blob is garbage and ptr is freed with it. NULL, a failed creation, is
+// reported as an error of the library.
 
-	unsigned int i, nb;
-	unsigned int *temp;
-	term_t temp_pt = PL_new_term_ref ();
-	void *ann;
+static int unify_handle ( term_t t, PL_blob_t *type, void *ptr ) {
 
-	if ( !PL_get_pointer ( ann_pt, &ann ) )
-		return type_error ( ann_pt, "pointer" );
+	fann_handle *h;
 
-	nb = fann_get_num_layers( ann ) - 1;
+	if ( ptr == NULL )
+		return type_error ( t, "fann_error" );
 
-	temp = ( unsigned int* ) PL_malloc ( sizeof ( unsigned int ) * nb );
+	if ( ( h = malloc ( sizeof ( fann_handle ) ) ) == NULL ) {
 
-	fann_get_bias_array ( ann, temp );
+		destroy_handle_object ( type, ptr );
+		return type_error ( t, "fann_error" );
+	}
 
-	if ( !PL_is_variable ( lay_arr_pt ) )
-		return type_error ( lay_arr_pt, "var" );
+	atomic_init ( &h->ptr, ptr );
+	atomic_init ( &h->destroyed, NULL );
+	atomic_init ( &h->users, 0 );
+	h->type = type;
 
-	for ( i = 0; i < nb; i++ ) {
+	return PL_unify_blob ( t, h, sizeof ( fann_handle ), type );
+}
 
-		PL_unify_list ( lay_arr_pt, temp_pt, lay_arr_pt );
-		PL_unify_integer ( temp_pt, temp[i] );
-	}
 
-	PL_unify_nil ( lay_arr_pt );
+static int get_ann ( term_t t, struct fann **ann ) {
+
+	void *ptr;
+
+	if ( !get_handle_object ( t, &ann_blob, &ptr ) )
+		PL_fail;
 
-	PL_free ( temp );
+	*ann = ptr;
 
 	PL_succeed;
 }
 
 
-foreign_t swi_fann_get_connection_array ( term_t ann_pt, term_t connections_pt ) {
-
-    unsigned int total_connections, i;
-	term_t connection_pt, temp_pt = PL_new_term_ref ();
-	void *ann;
-	struct fann_connection *connections;
+static int get_train_data ( term_t t, struct fann_train_data **data ) {
 
-	if ( !PL_get_pointer ( ann_pt, &ann ) )
-		return type_error ( ann_pt, "pointer" );
+	void *ptr;
 
-	total_connections = fann_get_total_connections ( ann );
+	if ( !get_handle_object ( t, &train_blob, &ptr ) )
+		PL_fail;
 
-	connections = PL_malloc ( sizeof ( struct fann_connection ) * total_connections );
+	*data = ptr;
 
-	fann_get_connection_array ( ann, connections );
+	PL_succeed;
+}
 
-	if ( !PL_is_variable ( connections_pt ) )
-		return type_error ( connections_pt, "var" );
 
-	for ( i = 0; i < total_connections; i++ ) {
+// The error functions of the library take a network or training data.
 
-		PL_unify_list ( connections_pt, connection_pt, connections_pt );
+static int get_error_data ( term_t t, struct fann_error **error_data ) {
 
-			PL_unify_list ( connection_pt, temp_pt, connection_pt );
-			PL_unify_integer ( temp_pt, (connections+i)->from_neuron );
+	void *ptr;
 
-			PL_unify_list ( connection_pt, temp_pt, connection_pt );
-			PL_unify_integer ( temp_pt, (connections+i)->to_neuron );
+	if ( !get_handle_object ( t, get_handle ( t, &train_blob ) ? &train_blob : &ann_blob, &ptr ) )
+		PL_fail;
 
-			PL_unify_list ( connection_pt, temp_pt, connection_pt );
-			PL_FANN_UNIFY_FANNTYPE( temp_pt, (connections+i)->weight );
+	*error_data = ptr;
 
-			PL_unify_nil ( connection_pt );
-	}
+	PL_succeed;
+}
 
-	PL_unify_nil ( connections_pt );
 
-	PL_free ( connections );
+static int unify_ann ( term_t t, struct fann *ann ) {
 
-	PL_succeed;
+	return unify_handle ( t, &ann_blob, ann );
 }
 
 
-foreign_t swi_fann_set_weight_array ( term_t ann_pt, term_t connections_pt ) {
+static int unify_train_data ( term_t t, struct fann_train_data *data ) {
 
-    unsigned int i;
-	term_t connection_pt = PL_new_term_ref ();
+	return unify_handle ( t, &train_blob, data );
+}
+
+
+static int get_matrix ( term_t t, fann_matrix **m ) {
+
+	void *ptr;
+
+	if ( !get_handle_object ( t, &matrix_blob, &ptr ) )
+		PL_fail;
+
+	*m = ptr;
+
+	PL_succeed;
+}
+
+
+static int unify_matrix ( term_t t, fann_matrix *m ) {
+
+	return unify_handle ( t, &matrix_blob, m );
+}
+
+
+// Returns an uninitialised rows x cols matrix, or NULL if it is empty or
+// too large.
+
+static fann_matrix *create_matrix ( unsigned int rows, unsigned int cols ) {
+
+	fann_matrix *m;
+
+	if ( !rows || !cols || cols > ( SIZE_MAX - sizeof ( fann_matrix ) ) / sizeof ( fann_type ) / rows )
+		return NULL;
+	if ( ( m = malloc ( sizeof ( fann_matrix ) + ( size_t ) rows * cols * sizeof ( fann_type ) ) ) == NULL )
+		return NULL;
+
+	m->rows = rows;
+	m->cols = cols;
+
+	return m;
+}
+
+#ifndef FIXEDFANN
+
+static int get_compact_train ( term_t t, struct compact_train **c ) {
+
+	void *ptr;
+
+	if ( !get_handle_object ( t, &compact_blob, &ptr ) )
+		PL_fail;
+
+	*c = ptr;
+
+	PL_succeed;
+}
+
+
+static int unify_compact_train ( term_t t, struct compact_train *c ) {
+
+	return unify_handle ( t, &compact_blob, c );
+}
+
+#endif
+
+
+                        /* Scratch buffers */
+
+
+// Predicates that copy lists to and from C arrays share one buffer per
+// thread instead of allocating on each call. The buffer grows to the
+// largest size asked for and lives until its thread exits, so an error
+// return part way through a list leaks nothing. A buffer holds one call's
+// arrays at a time. Callers that need several arrays request them
+// together and split the space.
+
+typedef struct scratch {
+
+	void *buf;
+	size_t size;
+} scratch;
+
+static pthread_key_t scratch_key;
+static pthread_once_t scratch_once = PTHREAD_ONCE_INIT;
+
+
+static void free_scratch ( void *ptr ) {
+
+	scratch *s = ptr;
+
+	free ( s->buf );
+	free ( s );
+}
+
+
+static void create_scratch_key ( void ) {
+
+	pthread_key_create ( &scratch_key, free_scratch );
+}
+
+
+// Returns the calling thread's buffer, at least size bytes long, or NULL
+// if it cannot be grown. Its previous contents are not kept.
+
+static void *get_scratch ( size_t size ) {
+
+	scratch *s;
+	void *buf;
+
+	pthread_once ( &scratch_once, create_scratch_key );
+
+	if ( ( s = pthread_getspecific ( scratch_key ) ) == NULL ) {
+
+		if ( ( s = calloc ( 1, sizeof ( scratch ) ) ) == NULL )
+			return NULL;
+		if ( pthread_setspecific ( scratch_key, s ) ) {
+
+			free ( s );
+			return NULL;
+		}
+	}
+
+	if ( size > s->size ) {
+
+		if ( ( buf = malloc ( size ) ) == NULL )
+			return NULL;
+		free ( s->buf );
+		s->buf = buf;
+		s->size = size;
+	}
+
+	return s->buf;
+}
+
+
+// Reads count values into values, from a list, from a compound term such
+// as v(X1,...,Xn) of arity count or from a matrix of count values. The
+// compound's arguments are read in place, without walking cons cells, and
+// the matrix's values are copied as they are. If name is not NULL it is set to the
+// compound's name, or to 0 for a list, so results can be given back in the
+// same form.
+
+static int get_fanntype_array ( term_t array_pt, fann_type *values, unsigned int count, atom_t *name ) {
+
+	term_t tail_pt = PL_copy_term_ref ( array_pt );
 	term_t temp_pt = PL_new_term_ref ();
-	void *ann;
-	struct fann_connection *connections;
+	unsigned int i;
+	atom_t functor;
+	size_t arity;
+	fann_matrix *m;
 
-	if ( !PL_get_pointer ( ann_pt, &ann ) )
-		return type_error ( ann_pt, "pointer" );
+	if ( name )
+		*name = 0;
 
-	connections = ( struct fann_connection* ) PL_malloc ( sizeof ( struct fann_connection ) * fann_get_total_connections ( ann ) );
+	if ( get_handle ( array_pt, &matrix_blob ) ) {
 
-	if ( !PL_is_list ( connections_pt ) )
-		return type_error ( connections_pt, "list" );
+		if ( !get_matrix ( array_pt, &m ) )
+			PL_fail;
+		if ( ( size_t ) m->rows * m->cols != count )
+			return domain_error ( array_pt, "array_length" );
 
-	for ( i = 0; PL_unify_list ( connections_pt, connection_pt, connections_pt ); i++ ) {
+		memcpy ( values, m->values, count * sizeof ( fann_type ) );
 
-			if ( !PL_unify_list ( connection_pt, temp_pt, connection_pt ) )
-				return type_error ( connection_pt, "list" );
-			if ( !PL_get_integer ( temp_pt, &connections[i].from_neuron ) )
-				return type_error ( temp_pt, "integer" );
-			if ( connections[i].from_neuron < 0 )
-				return domain_error ( temp_pt, "nonneg" );
+		PL_succeed;
+	}
 
-			if ( !PL_unify_list ( connection_pt, temp_pt, connection_pt ) )
-				return type_error ( connection_pt, "list" );
-			if ( !PL_get_integer ( temp_pt, &connections[i].to_neuron ) )
-				return type_error ( temp_pt, "integer" );
-			if ( connections[i].to_neuron < 0 )
-				return domain_error ( temp_pt, "nonneg" );
+	if ( PL_is_compound ( array_pt ) && !PL_is_list ( array_pt ) ) {
 
-			if ( !PL_unify_list ( connection_pt, temp_pt, connection_pt ) )
-				return type_error ( connection_pt, "list" );
-			if ( !PL_FANN_GET_FANNTYPE(temp_pt,&connections[i].weight) )
+		PL_get_name_arity ( array_pt, &functor, &arity );
+		if ( arity != count )
+			return domain_error ( array_pt, "array_length" );
+
+		for ( i = 0; i < count; i++ ) {
+
+			PL_get_arg ( i + 1, array_pt, temp_pt );
+			if ( !PL_FANN_GET_FANNTYPE(temp_pt,values+i) )
 				return type_error ( temp_pt, PL_FANN_FANNTYPE );
+		}
 
-			if ( !PL_unify_nil ( connection_pt ) )
-				return type_error ( connection_pt, "list" );
+		if ( name )
+			*name = functor;
+
+		PL_succeed;
 	}
 
-	if ( !PL_unify_nil ( connections_pt ) )
-		return type_error ( connections_pt, "list" );
+	for ( i = 0; i < count; i++ ) {
 
-	fann_set_weight_array ( ann, connections, i );
+		if ( !PL_unify_list ( tail_pt, temp_pt, tail_pt ) )
+			return type_error ( tail_pt, "list" );
+		if ( !PL_FANN_GET_FANNTYPE(temp_pt,values+i) )
+			return type_error ( temp_pt, PL_FANN_FANNTYPE );
+	}
 
-	PL_free ( connections );
+	if ( !PL_unify_nil ( tail_pt ) )
+		return type_error ( tail_pt, "list" );
 
 	PL_succeed;
 }
 
 
-foreign_t swi_fann_set_weight ( term_t ann_pt, term_t from_neuron_pt, term_t to_neuron_pt, term_t weight_pt ) {
+// Unifies array_pt with the count values in values, as a list if name is 0
+// and otherwise as one compound term name(X1,...,Xn).
 
-	void *ann;
-    unsigned int from_neuron, to_neuron;
-	fann_type weight;
+static int unify_fanntype_array ( term_t array_pt, const fann_type *values, unsigned int count, atom_t name ) {
+
+	term_t tail_pt, temp_pt, args;
+	unsigned int i;
 
-    if ( !PL_get_pointer ( ann_pt, &ann ) )
-		return type_error ( ann_pt, "pointer" );
+	if ( name ) {
 
-	if ( !PL_get_integer ( from_neuron_pt, &from_neuron ) )
-		return type_error ( from_neuron_pt, "integer" );
-	if ( from_neuron < 0 )
-		return domain_error ( from_neuron_pt, "nonneg" );
+		args = PL_new_term_refs ( count );
+		for ( i = 0; i < count; i++ ) {
 
-    if ( !PL_get_integer ( to_neuron_pt, &to_neuron ) )
-		return type_error ( to_neuron_pt, "integer" );
-	if ( to_neuron < 0 )
-		return domain_error ( to_neuron_pt, "nonneg" );
+			if ( !PL_FANN_PUT_FANNTYPE(args+i,values[i]) )
+				PL_fail;
+		}
 
-	if ( !PL_FANN_GET_FANNTYPE(weight_pt,&weight) )
-		return type_error ( weight_pt, PL_FANN_FANNTYPE );
+		temp_pt = PL_new_term_ref ();
+		if ( !PL_cons_functor_v ( temp_pt, PL_new_functor ( name, count ), args ) )
+			PL_fail;
 
-	fann_set_weight ( ann, from_neuron, to_neuron, weight );
+		return PL_unify ( array_pt, temp_pt );
+	}
 
-	PL_succeed;
+	tail_pt = PL_copy_term_ref ( array_pt );
+	temp_pt = PL_new_term_ref ();
+
+	for ( i = 0; i < count; i++ ) {
+
+		if ( !PL_unify_list ( tail_pt, temp_pt, tail_pt ) ||
+			 !PL_FANN_UNIFY_FANNTYPE(temp_pt,values[i]) )
+			PL_fail;
+	}
+
+	return PL_unify_nil ( tail_pt );
 }
 
 
-foreign_t swi_fann_set_user_data ( term_t ann_pt, term_t user_data_pt ) {
+// Reads the list of layer sizes layers_pt, at least two positive integers,
+// into the scratch buffer.
 
-	void *ann, *user_data;
+static int get_layer_list ( term_t layers_pt, unsigned int *num_layers, unsigned int **layers ) {
 
-    if ( !PL_get_pointer ( ann_pt, &ann ) )
-		return type_error ( ann_pt, "pointer" );
-	if ( !PL_get_pointer ( user_data_pt, &user_data ) )
-		return type_error ( user_data_pt, "pointer" );
+	term_t list_pt = PL_copy_term_ref ( layers_pt );
+	term_t layer_pt = PL_new_term_ref ();
+	unsigned int i;
+	size_t len;
+	int *l;
 
-    fann_set_user_data ( ann, user_data );
+	if ( PL_skip_list ( layers_pt, 0, &len ) != PL_LIST || len < 2 || len > UINT_MAX )
+		return type_error ( layers_pt, "list" );
+	if ( ( l = get_scratch ( len * sizeof ( int ) ) ) == NULL )
+		return type_error ( layers_pt, "fann_error" );
+
+	for ( i = 0; i < len; i++ ) {
+
+		PL_get_list ( list_pt, layer_pt, list_pt );
+		if ( !PL_get_integer ( layer_pt, l+i ) )
+			return type_error ( layer_pt, "integer" );
+		if ( l[i] < 1 )
+			return domain_error ( layer_pt, "positive_integer" );
+	}
+
+	*num_layers = ( unsigned int ) len;
+	*layers = ( unsigned int* ) l;
 
 	PL_succeed;
 }
 
 
-foreign_t swi_fann_get_user_data ( term_t ann_pt, term_t user_data_pt ) {
+foreign_t swi_fann_type ( term_t type_pt ) {
+
+#ifdef FIXEDFANN
+	return PL_unify_atom_chars ( type_pt, "FANN_FIXED" );
+#elif defined FLOATFANN
+	return PL_unify_atom_chars ( type_pt, "FANN_FLOAT" );
+#else
+	return PL_unify_atom_chars ( type_pt, "FANN_DOUBLE" );
+#endif
+}
 
-	void *ann, *user_data;
 
-	if ( !PL_get_pointer ( ann_pt, &ann ) )
-		return type_error ( ann_pt, "pointer" );
-	if ( !PL_is_variable ( user_data_pt ) )
-		return type_error ( user_data_pt, "var" );
+/* In module plfann.pl: fann_create_standard */
 
-    return PL_unify_pointer ( user_data_pt, fann_get_user_data ( ann ) );
+
+foreign_t swi_fann_create_standard_array ( term_t layers_pt, term_t ann_pt ) {
+
+	unsigned int nl, *l;
+
+	if ( !get_layer_list ( layers_pt, &nl, &l ) )
+		PL_fail;
+
+	if ( !PL_is_variable ( ann_pt ) )
+		return type_error ( ann_pt, "var" );
+
+	return unify_ann ( ann_pt, fann_create_standard_array ( nl, l ) );
 }
 
 
-foreign_t swi_fann_get_decimal_point ( term_t ann_pt, term_t decp_pt ) {
+/* In module plfann.pl: fann_create_sparse */
 
-#ifdef FIXEDFANN
-	void *ann;
 
-	if ( !PL_get_pointer ( ann_pt, &ann ) )
-		return type_error ( ann_pt, "pointer" );
+foreign_t swi_fann_create_sparse_array ( term_t connection_rate_pt, term_t layers_pt, term_t ann_pt ) {
 
-    return PL_unify_integer ( decp_pt, fann_get_decimal_point ( ann ) );
-#else
-	return type_error ( ann_pt, "fixedfann_only" );
-#endif
+	double connection_rate;
+	unsigned int nl, *l;
+
+	if ( !PL_get_float ( connection_rate_pt, &connection_rate ) )
+		return type_error ( connection_rate_pt, "float" );
+
+	if ( !get_layer_list ( layers_pt, &nl, &l ) )
+		PL_fail;
+
+	if ( !PL_is_variable ( ann_pt ) )
+		return type_error ( ann_pt, "var" );
+
+	return unify_ann ( ann_pt, fann_create_sparse_array( ( float ) connection_rate, nl, l ) );
 }
 
 
-foreign_t swi_fann_get_multiplier ( term_t ann_pt, term_t mul_pt ) {
+/* In module plfann.pl: create_shortcut */
 
-#ifdef FIXEDFANN
-	void *ann;
 
-	if ( !PL_get_pointer ( ann_pt, &ann ) )
-		return type_error ( ann_pt, "pointer" );
+foreign_t swi_fann_create_shortcut_array ( term_t layers_pt, term_t ann_pt ) {
 
-    return PL_unify_integer ( mul_pt, fann_get_multiplier ( ann ) );
-#else
-	return type_error ( ann_pt, "fixedfann_only" );
+	unsigned int nl, *l;
+
+	if ( !get_layer_list ( layers_pt, &nl, &l ) )
+		PL_fail;
+
+	if ( !PL_is_variable ( ann_pt ) )
+		return type_error ( ann_pt, "var" );
+
+	return unify_ann ( ann_pt, fann_create_shortcut_array( nl, l ) );
+}
+
+
+foreign_t swi_fann_destroy ( term_t ann_pt ) {
+
+	return destroy_handle ( ann_pt, &ann_blob );
+}
+
+
+#ifdef VERSION220
+foreign_t swi_fann_copy ( term_t ann1_pt, term_t ann2_pt ) {
+
+	struct fann *ann1;
+
+	if ( !get_ann ( ann1_pt, &ann1 ) )
+		PL_fail;
+	if ( !PL_is_variable ( ann2_pt ) )
+		return type_error ( ann2_pt, "var" );
+
+	return unify_ann ( ann2_pt, fann_copy ( ann1 ) );
+}
 #endif
+
+
+// Reads the matrices input_pt and output_pt of a batch for ann. Both must
+// have one row per pattern, the inputs and outputs of ann as columns.
+
+static int get_batch_matrices ( struct fann *ann, term_t input_pt, term_t output_pt, fann_matrix **input, fann_matrix **output ) {
+
+	if ( !get_matrix ( input_pt, input ) || !get_matrix ( output_pt, output ) )
+		PL_fail;
+	if ( ( *input )->cols != fann_get_num_input ( ann ) )
+		return domain_error ( input_pt, "array_length" );
+	if ( ( *output )->cols != fann_get_num_output ( ann ) )
+		return domain_error ( output_pt, "array_length" );
+	if ( ( *output )->rows != ( *input )->rows )
+		return domain_error ( output_pt, "same_rows_as_inputs" );
+
+	PL_succeed;
 }
 
 
-foreign_t swi_fann_train ( term_t ann_pt, term_t input_pt, term_t output_pt ) {
+// Runs ann on each row of the matrix input_pt, giving a matrix of as many
+// rows of outputs.
 
-#ifndef FIXEDFANN
+static int run_matrix ( struct fann *ann, term_t input_pt, term_t output_pt ) {
+
+	unsigned int i, num_output = fann_get_num_output ( ann );
+	fann_matrix *input, *output;
+
+	if ( !get_matrix ( input_pt, &input ) )
+		PL_fail;
+	if ( input->cols != fann_get_num_input ( ann ) )
+		return domain_error ( input_pt, "array_length" );
+	if ( !PL_is_variable ( output_pt ) )
+		return type_error ( output_pt, "var" );
+	if ( ( output = create_matrix ( input->rows, num_output ) ) == NULL )
+		return type_error ( output_pt, "fann_error" );
+
+	for ( i = 0; i < input->rows; i++ )
+		memcpy ( output->values + ( size_t ) i * num_output,
+			 fann_run ( ann, input->values + ( size_t ) i * input->cols ),
+			 num_output * sizeof ( fann_type ) );
+
+	return unify_matrix ( output_pt, output );
+}
+
+
+foreign_t swi_fann_run ( term_t ann_pt, term_t input_pt, term_t output_pt ) {
 
-	unsigned int i, num_input, num_output;
 	fann_type *input, *output;
-	term_t temp_pt = PL_new_term_ref ();
-	void *ann;
+	struct fann *ann;
+	atom_t name;
+
+	if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
+
+	if ( get_handle ( input_pt, &matrix_blob ) )
+		return run_matrix ( ann, input_pt, output_pt );
 
-	if ( !PL_get_pointer ( ann_pt, &ann ) )
-		return type_error ( ann_pt, "pointer" );
+	if ( ( input = get_scratch ( fann_get_num_input ( ann ) * sizeof ( fann_type ) ) ) == NULL )
+		return type_error ( ann_pt, "fann_error" );
+	if ( !get_fanntype_array ( input_pt, input, fann_get_num_input ( ann ), &name ) )
+		PL_fail;
 
-	num_input = fann_get_num_input( ann );
-	input = PL_malloc ( num_input * sizeof ( fann_type ) );
+	output = fann_run ( ann, input );
+
+	if ( !PL_is_variable ( output_pt ) )
+		return type_error ( output_pt, "var" );
 
-	num_output = fann_get_num_output( ann );
-	output = PL_malloc ( num_output * sizeof ( fann_type ) );
+	// The outputs come back in the form the inputs were given in.
+	return unify_fanntype_array ( output_pt, output, fann_get_num_output ( ann ), name );
+}
 
-	for ( i = 0; i < num_input; i++ ) {
 
-		if ( !PL_unify_list ( input_pt, temp_pt, input_pt ) )
-			return type_error ( input_pt, "list" );
-	    if ( !PL_FANN_GET_FANNTYPE(temp_pt,input+i) )
-			return type_error ( temp_pt, PL_FANN_FANNTYPE );
-	}
+foreign_t swi_fann_run_unsafe ( term_t ann_pt, term_t input_pt, term_t output_pt ) {
+
+	unsigned int i, num_input;
+	fann_type *input, *output;
+	term_t temp_pt = PL_new_term_ref ();
+	struct fann *ann;
+	atom_t name = 0;
+	size_t arity;
+
+	// The handle is checked even here, a destroyed one would crash.
+	if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
+
+	if ( get_handle ( input_pt, &matrix_blob ) )
+		return run_matrix ( ann, input_pt, output_pt );
+
+	num_input = fann_get_num_input ( ann );
+	if ( ( input = get_scratch ( num_input * sizeof ( fann_type ) ) ) == NULL )
+		return type_error ( ann_pt, "fann_error" );
+
+	if ( PL_is_compound ( input_pt ) && !PL_is_list ( input_pt ) ) {
+
+		PL_get_name_arity ( input_pt, &name, &arity );
+
+		for ( i = 0; i < num_input; i++ ) {
+
+			PL_get_arg ( i + 1, input_pt, temp_pt );
+			PL_FANN_GET_FANNTYPE(temp_pt,input+i);
+		}
+	}
+	else {
+
+		for ( i = 0; i < num_input; i++ ) {
+
+			PL_unify_list ( input_pt, temp_pt, input_pt );
+			PL_FANN_GET_FANNTYPE(temp_pt,input+i);
+		}
+
+		PL_unify_nil ( input_pt );
+	}
+
+	output = fann_run ( ann, input );
+
+	return unify_fanntype_array ( output_pt, output, fann_get_num_output ( ann ), name );
+}
+
+
+foreign_t swi_fann_randomize_weights ( term_t ann_pt, term_t min_weight_pt, term_t max_weight_pt ) {
+
+	fann_type min_weight, max_weight;
+	struct fann *ann;
+
+	if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
+	if ( !PL_FANN_GET_FANNTYPE(min_weight_pt,&min_weight) )
+		return type_error ( min_weight_pt, PL_FANN_FANNTYPE );
+	if ( !PL_FANN_GET_FANNTYPE(max_weight_pt,&max_weight) )
+		return type_error ( max_weight_pt, PL_FANN_FANNTYPE );
+
+	randomize_weights ( ann, min_weight, max_weight, &get_ann_info ( ann )->rng );
+
+	PL_succeed;
+}
+
+
+foreign_t swi_fann_set_random_seed ( term_t ann_pt, term_t seed_pt ) {
+
+	ann_info *info;
+	int64_t seed;
+	struct fann *ann;
+
+	if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
+	if ( !PL_get_int64 ( seed_pt, &seed ) )
+		return type_error ( seed_pt, "integer" );
+
+	if ( ( info = get_ann_info ( ann ) ) == NULL )
+		return type_error ( ann_pt, "fann_error" );
+
+	rng_seed ( &info->rng, ( uint64_t ) seed );
+
+	PL_succeed;
+}
+
+
+foreign_t swi_fann_init_weights ( term_t ann_pt, term_t train_data_pt ) {
+
+	struct fann *ann;
+	struct fann_train_data *train_data;
+
+	if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
+	if ( !get_train_data ( train_data_pt, &train_data ) )
+		PL_fail;
+
+	fann_init_weights ( ann, train_data );
+
+	PL_succeed;
+}
+
+
+foreign_t swi_fann_print_connections ( term_t ann_pt ) {
+
+	struct fann *ann;
+
+	if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
+
+	fann_print_connections ( ann );
+
+	PL_succeed;
+}
+
+
+foreign_t swi_fann_print_parameters ( term_t ann_pt ) {
+
+	struct fann *ann;
+	term_t params_pt = PL_new_term_ref ();
+
+	if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
+
+	fann_print_parameters ( ann );
+
+	PL_succeed;
+}
+
+
+foreign_t swi_fann_get_num_input ( term_t ann_pt, term_t put_pt ) {
+
+	struct fann *ann;
+
+	if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
+
+	return PL_unify_integer ( put_pt, fann_get_num_input ( ann ) );
+}
+
+
+foreign_t swi_fann_get_num_output ( term_t ann_pt, term_t put_pt ) {
+
+	struct fann *ann;
+
+	if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
+
+	return PL_unify_integer ( put_pt, fann_get_num_output ( ann ) );
+}
+
+
+foreign_t swi_fann_get_total_neurons ( term_t ann_pt, term_t tn_pt ) {
+
+	struct fann *ann;
+
+	if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
+
+	return PL_unify_integer ( tn_pt, fann_get_total_neurons ( ann ) );
+}
+
+
+foreign_t swi_fann_get_total_connections ( term_t ann_pt, term_t tn_pt ) {
+
+	struct fann *ann;
+
+	if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
+
+	return PL_unify_integer ( tn_pt, fann_get_total_connections ( ann ) );
+}
+
+
+foreign_t swi_fann_get_network_type ( term_t ann_pt, term_t type_pt ) {
+
+	struct fann *ann;
+
+	if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
+
+	return PL_unify_atom_chars ( type_pt, FANN_NETTYPE_NAMES[ fann_get_network_type ( ann ) ] );
+}
+
+
+foreign_t swi_fann_get_connection_rate ( term_t ann_pt, term_t cr_pt ) {
+
+	struct fann *ann;
+
+	if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
+	if ( !PL_is_variable ( cr_pt ) )
+		return type_error ( cr_pt, "var" );
+
+	return PL_unify_float ( cr_pt, fann_get_connection_rate( ann ) );
+}
+
+
+foreign_t swi_fann_get_num_layers ( term_t ann_pt, term_t nl_pt ) {
+
+	struct fann *ann;
+
+	if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
+
+	return PL_unify_integer ( nl_pt, fann_get_num_layers( ann ) );
+}
+
+
+foreign_t swi_fann_get_layer_array ( term_t ann_pt, term_t lay_arr_pt ) {
+
+	unsigned int i, nl;
+	unsigned int *temp;
+
+	term_t temp_pt = PL_new_term_ref ();
+	struct fann *ann;
+
+	if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
+
+	nl = fann_get_num_layers( ann );
+
+	if ( ( temp = get_scratch ( sizeof ( unsigned int ) * nl ) ) == NULL )
+		return type_error ( ann_pt, "fann_error" );
+
+	fann_get_layer_array ( ann, temp );
+
+	if ( !PL_is_variable ( lay_arr_pt ) )
+		return type_error ( lay_arr_pt, "var" );
+
+	for ( i = 0; i < nl; i++ ) {
+
+		PL_unify_list ( lay_arr_pt, temp_pt, lay_arr_pt );
+		PL_unify_integer ( temp_pt, temp[i] );
+	}
+
+	PL_unify_nil ( lay_arr_pt );
+
+	PL_succeed;
+}
+
+
+foreign_t swi_fann_get_bias_array ( term_t ann_pt, term_t lay_arr_pt ) {
+
+	unsigned int i, nb;
+	unsigned int *temp;
+	term_t temp_pt = PL_new_term_ref ();
+	struct fann *ann;
+
+	if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
+
+	nb = fann_get_num_layers( ann ) - 1;
+
+	if ( ( temp = get_scratch ( sizeof ( unsigned int ) * nb ) ) == NULL )
+		return type_error ( ann_pt, "fann_error" );
+
+	fann_get_bias_array ( ann, temp );
+
+	if ( !PL_is_variable ( lay_arr_pt ) )
+		return type_error ( lay_arr_pt, "var" );
+
+	for ( i = 0; i < nb; i++ ) {
+
+		PL_unify_list ( lay_arr_pt, temp_pt, lay_arr_pt );
+		PL_unify_integer ( temp_pt, temp[i] );
+	}
+
+	PL_unify_nil ( lay_arr_pt );
+
+	PL_succeed;
+}
+
+
+foreign_t swi_fann_get_connection_array ( term_t ann_pt, term_t connections_pt ) {
+
+    unsigned int total_connections, i;
+	term_t connection_pt, temp_pt = PL_new_term_ref ();
+	struct fann *ann;
+	struct fann_connection *connections;
+
+	if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
+
+	total_connections = fann_get_total_connections ( ann );
+
+	if ( ( connections = get_scratch ( sizeof ( struct fann_connection ) * total_connections ) ) == NULL )
+		return type_error ( ann_pt, "fann_error" );
+
+	fann_get_connection_array ( ann, connections );
+
+	if ( !PL_is_variable ( connections_pt ) )
+		return type_error ( connections_pt, "var" );
+
+	for ( i = 0; i < total_connections; i++ ) {
+
+		PL_unify_list ( connections_pt, connection_pt, connections_pt );
+
+			PL_unify_list ( connection_pt, temp_pt, connection_pt );
+			PL_unify_integer ( temp_pt, (connections+i)->from_neuron );
+
+			PL_unify_list ( connection_pt, temp_pt, connection_pt );
+			PL_unify_integer ( temp_pt, (connections+i)->to_neuron );
+
+			PL_unify_list ( connection_pt, temp_pt, connection_pt );
+			PL_FANN_UNIFY_FANNTYPE( temp_pt, (connections+i)->weight );
+
+			PL_unify_nil ( connection_pt );
+	}
+
+	PL_unify_nil ( connections_pt );
+
+	PL_succeed;
+}
+
+
+foreign_t swi_fann_set_weight_array ( term_t ann_pt, term_t connections_pt ) {
+
+    unsigned int i, total_connections;
+	term_t connection_pt = PL_new_term_ref ();
+	term_t temp_pt = PL_new_term_ref ();
+	struct fann *ann;
+	struct fann_connection *connections;
+
+	if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
+
+	total_connections = fann_get_total_connections ( ann );
+	if ( ( connections = get_scratch ( sizeof ( struct fann_connection ) * total_connections ) ) == NULL )
+		return type_error ( ann_pt, "fann_error" );
+
+	if ( !PL_is_list ( connections_pt ) )
+		return type_error ( connections_pt, "list" );
+
+	for ( i = 0; PL_unify_list ( connections_pt, connection_pt, connections_pt ); i++ ) {
+
+			// The network has no more connections than this to set.
+			if ( i == total_connections )
+				return domain_error ( connections_pt, "connection_list" );
+
+			if ( !PL_unify_list ( connection_pt, temp_pt, connection_pt ) )
+				return type_error ( connection_pt, "list" );
+			if ( !PL_get_integer ( temp_pt, &connections[i].from_neuron ) )
+				return type_error ( temp_pt, "integer" );
+			if ( connections[i].from_neuron < 0 )
+				return domain_error ( temp_pt, "nonneg" );
+
+			if ( !PL_unify_list ( connection_pt, temp_pt, connection_pt ) )
+				return type_error ( connection_pt, "list" );
+			if ( !PL_get_integer ( temp_pt, &connections[i].to_neuron ) )
+				return type_error ( temp_pt, "integer" );
+			if ( connections[i].to_neuron < 0 )
+				return domain_error ( temp_pt, "nonneg" );
+
+			if ( !PL_unify_list ( connection_pt, temp_pt, connection_pt ) )
+				return type_error ( connection_pt, "list" );
+			if ( !PL_FANN_GET_FANNTYPE(temp_pt,&connections[i].weight) )
+				return type_error ( temp_pt, PL_FANN_FANNTYPE );
+
+			if ( !PL_unify_nil ( connection_pt ) )
+				return type_error ( connection_pt, "list" );
+	}
+
+	if ( !PL_unify_nil ( connections_pt ) )
+		return type_error ( connections_pt, "list" );
+
+	fann_set_weight_array ( ann, connections, i );
+
+	PL_succeed;
+}
+
+
+foreign_t swi_fann_set_weight ( term_t ann_pt, term_t from_neuron_pt, term_t to_neuron_pt, term_t weight_pt ) {
+
+	struct fann *ann;
+    unsigned int from_neuron, to_neuron;
+	fann_type weight;
+
+    if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
+
+	if ( !PL_get_integer ( from_neuron_pt, &from_neuron ) )
+		return type_error ( from_neuron_pt, "integer" );
+	if ( from_neuron < 0 )
+		return domain_error ( from_neuron_pt, "nonneg" );
+
+    if ( !PL_get_integer ( to_neuron_pt, &to_neuron ) )
+		return type_error ( to_neuron_pt, "integer" );
+	if ( to_neuron < 0 )
+		return domain_error ( to_neuron_pt, "nonneg" );
+
+	if ( !PL_FANN_GET_FANNTYPE(weight_pt,&weight) )
+		return type_error ( weight_pt, PL_FANN_FANNTYPE );
+
+	fann_set_weight ( ann, from_neuron, to_neuron, weight );
+
+	PL_succeed;
+}
+
+// Packed weights are the weights of the network in the order of
+// fann_get_connection_array/2, in the native representation of fann_type.
+// They are copied in one go, without a list cell per connection.
+
+static int unify_weights_packed ( struct fann *ann, unsigned int first, unsigned int count, term_t packed_pt ) {
+
+	if ( !PL_is_variable ( packed_pt ) )
+		return type_error ( packed_pt, "var" );
+
+	return PL_unify_chars ( packed_pt, PL_STRING|REP_ISO_LATIN_1, ( size_t ) count * sizeof ( fann_type ), ( char* ) ( ann->weights + first ) );
+}
+
+
+// Sets the weights from first on. With all set they must be all weights,
+// a shorter string is most likely those of another network.
+
+static int set_weights_packed ( struct fann *ann, unsigned int first, term_t packed_pt, int all ) {
+
+	size_t len;
+	char *packed;
+
+	if ( !PL_get_nchars ( packed_pt, &len, &packed, CVT_ATOM|CVT_STRING|REP_ISO_LATIN_1 ) )
+		return type_error ( packed_pt, "bytes" );
+	if ( len % sizeof ( fann_type ) || len / sizeof ( fann_type ) > ann->total_connections - first ||
+		 ( all && len != ann->total_connections * sizeof ( fann_type ) ) )
+		return domain_error ( packed_pt, "packed_weights" );
+
+	memcpy ( ann->weights + first, packed, len );
+
+	PL_succeed;
+}
+
+
+// Reads the range of count weights starting at first.
+
+static int get_weight_range ( struct fann *ann, term_t first_pt, term_t count_pt, unsigned int *first, unsigned int *count ) {
+
+	int f, c;
+
+	if ( !PL_get_integer ( first_pt, &f ) )
+		return type_error ( first_pt, "integer" );
+	if ( f < 0 || ( unsigned int ) f > ann->total_connections )
+		return domain_error ( first_pt, "weight_index" );
+	if ( count_pt ) {
+
+		if ( !PL_get_integer ( count_pt, &c ) )
+			return type_error ( count_pt, "integer" );
+		if ( c < 0 || ( unsigned int ) c > ann->total_connections - f )
+			return domain_error ( count_pt, "weight_count" );
+
+		*count = ( unsigned int ) c;
+	}
+
+	*first = ( unsigned int ) f;
+
+	PL_succeed;
+}
+
+
+foreign_t swi_fann_get_weights_packed ( term_t ann_pt, term_t packed_pt ) {
+
+	struct fann *ann;
+
+	if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
+
+	return unify_weights_packed ( ann, 0, ann->total_connections, packed_pt );
+}
+
+
+foreign_t swi_fann_get_weights_packed_4 ( term_t ann_pt, term_t first_pt, term_t count_pt, term_t packed_pt ) {
+
+	struct fann *ann;
+	unsigned int first, count;
+
+	if ( !get_ann ( ann_pt, &ann ) || !get_weight_range ( ann, first_pt, count_pt, &first, &count ) )
+		PL_fail;
+
+	return unify_weights_packed ( ann, first, count, packed_pt );
+}
+
+
+foreign_t swi_fann_set_weights_packed ( term_t ann_pt, term_t packed_pt ) {
+
+	struct fann *ann;
+
+	if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
+
+	return set_weights_packed ( ann, 0, packed_pt, TRUE );
+}
+
+
+foreign_t swi_fann_set_weights_packed_3 ( term_t ann_pt, term_t first_pt, term_t packed_pt ) {
+
+	struct fann *ann;
+	unsigned int first;
+
+	if ( !get_ann ( ann_pt, &ann ) || !get_weight_range ( ann, first_pt, 0, &first, NULL ) )
+		PL_fail;
+
+	return set_weights_packed ( ann, first, packed_pt, FALSE );
+}
+
+
+
+foreign_t swi_fann_set_user_data ( term_t ann_pt, term_t user_data_pt ) {
+
+	struct fann *ann;
+	void *user_data;
+
+    if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
+	if ( !PL_get_pointer ( user_data_pt, &user_data ) )
+		return type_error ( user_data_pt, "pointer" );
+
+    fann_set_user_data ( ann, user_data );
+
+	PL_succeed;
+}
+
+
+foreign_t swi_fann_get_user_data ( term_t ann_pt, term_t user_data_pt ) {
+
+	struct fann *ann;
+	void *user_data;
+
+	if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
+	if ( !PL_is_variable ( user_data_pt ) )
+		return type_error ( user_data_pt, "var" );
+
+    return PL_unify_pointer ( user_data_pt, fann_get_user_data ( ann ) );
+}
+
+
+foreign_t swi_fann_get_decimal_point ( term_t ann_pt, term_t decp_pt ) {
+
+#ifdef FIXEDFANN
+	struct fann *ann;
+
+	if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
+
+    return PL_unify_integer ( decp_pt, fann_get_decimal_point ( ann ) );
+#else
+	return type_error ( ann_pt, "fixedfann_only" );
+#endif
+}
+
+
+foreign_t swi_fann_get_multiplier ( term_t ann_pt, term_t mul_pt ) {
+
+#ifdef FIXEDFANN
+	struct fann *ann;
+
+	if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
+
+    return PL_unify_integer ( mul_pt, fann_get_multiplier ( ann ) );
+#else
+	return type_error ( ann_pt, "fixedfann_only" );
+#endif
+}
+
+
+foreign_t swi_fann_train ( term_t ann_pt, term_t input_pt, term_t output_pt ) {
+
+#ifndef FIXEDFANN
+
+	unsigned int i, num_input, num_output;
+	fann_type *input, *output;
+	fann_matrix *in, *out;
+	struct fann *ann;
+
+	if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
+
+	// Two matrices are a batch, trained on row by row.
+	if ( get_handle ( input_pt, &matrix_blob ) && get_handle ( output_pt, &matrix_blob ) ) {
+
+		if ( !get_batch_matrices ( ann, input_pt, output_pt, &in, &out ) )
+			PL_fail;
+		for ( i = 0; i < in->rows; i++ )
+			fann_train ( ann, in->values + ( size_t ) i * in->cols, out->values + ( size_t ) i * out->cols );
+
+		PL_succeed;
+	}
+
+	num_input = fann_get_num_input ( ann );
+	num_output = fann_get_num_output ( ann );
+
+	// One scratch request holds the inputs followed by the outputs.
+	if ( ( input = get_scratch ( ( num_input + num_output ) * sizeof ( fann_type ) ) ) == NULL )
+		return type_error ( ann_pt, "fann_error" );
+	output = input + num_input;
+
+	if ( !get_fanntype_array ( input_pt, input, num_input, NULL ) ||
+		 !get_fanntype_array ( output_pt, output, num_output, NULL ) )
+		PL_fail;
+
+	fann_train ( ann, input, output );
+
+	PL_succeed;
+
+#else
+
+	return type_error ( ann_pt, "not available fixedfann" );
+
+#endif
+
+}
+
+
+foreign_t swi_fann_test ( term_t ann_pt, term_t input_pt, term_t output_pt ) {
+
+	unsigned int i, num_input, num_output;
+	fann_type *input, *output;
+	fann_matrix *in, *out;
+	struct fann *ann;
+
+	if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
+
+	// Two matrices are a batch, tested on row by row.
+	if ( get_handle ( input_pt, &matrix_blob ) && get_handle ( output_pt, &matrix_blob ) ) {
+
+		if ( !get_batch_matrices ( ann, input_pt, output_pt, &in, &out ) )
+			PL_fail;
+		for ( i = 0; i < in->rows; i++ )
+			fann_test ( ann, in->values + ( size_t ) i * in->cols, out->values + ( size_t ) i * out->cols );
+
+		PL_succeed;
+	}
+
+	num_input = fann_get_num_input ( ann );
+	num_output = fann_get_num_output ( ann );
+
+	// One scratch request holds the inputs followed by the outputs.
+	if ( ( input = get_scratch ( ( num_input + num_output ) * sizeof ( fann_type ) ) ) == NULL )
+		return type_error ( ann_pt, "fann_error" );
+	output = input + num_input;
+
+	if ( !get_fanntype_array ( input_pt, input, num_input, NULL ) ||
+		 !get_fanntype_array ( output_pt, output, num_output, NULL ) )
+		PL_fail;
+
+	fann_test ( ann, input, output );
+
+	PL_succeed;
+}
+
+
+foreign_t swi_fann_get_MSE ( term_t ann_pt, term_t MSE_pt ) {
+
+	struct fann *ann;
+
+	if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
+	if ( !PL_is_variable ( MSE_pt ) )
+		return type_error ( MSE_pt, "var" );
+
+	return PL_unify_float ( MSE_pt, fann_get_MSE ( ann ) );
+}
+
+
+foreign_t swi_fann_get_bit_fail ( term_t ann_pt, term_t bf_pt ) {
+
+	struct fann *ann;
+
+	if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
+
+	return PL_unify_integer ( bf_pt, fann_get_bit_fail ( ann ) );
+}
+
+
+foreign_t swi_fann_reset_MSE ( term_t ann_pt ) {
+
+	struct fann *ann;
+
+	if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
+
+	fann_reset_MSE ( ann );
+
+	PL_succeed;
+}
+
+
+                        /* Training data views */
+
+
+// A view is a fann_train_data whose input and output arrays point at rows
+// of another training data, its parent, so creating one copies no rows.
+// Views and their parents are tracked in a registry keyed by the handle:
+// a parent destroyed by fann_destroy_train/1 stays alive until its last
+// view is destroyed. Training data that never had a view is not registered,
+// except data mapped by fann_map_train/2, whose entry holds the mapping.
+
+typedef struct train_info {
+
+	struct fann_train_data *data;
+	struct train_info *parent;	// NULL unless data is a view
+	struct train_info *next;	// hash chain
+	unsigned int refs;		// the handle plus one per view
+	int duplicates;			// a view that may hold a row more than once
+	void *map;			// the file mapping the rows point into
+	size_t map_size;
+	unsigned int capacity;		// rows the blocks have room for, once grown
+	unsigned long version;		// of the rows, bumped on the root entry
+	struct train_stats *stats;	// cached by fann_train_stats/2
+	rng rng;
+} train_info;
+
+static train_info *train_registry[REGISTRY_SIZE];
+static pthread_mutex_t train_registry_lock = PTHREAD_MUTEX_INITIALIZER;
+
+
+static train_info *lookup_train_info ( struct fann_train_data *data ) {
+
+	train_info *info;
+
+	pthread_mutex_lock ( &train_registry_lock );
+
+	for ( info = train_registry[registry_hash ( data )]; info && info->data != data; info = info->next )
+		;
+
+	pthread_mutex_unlock ( &train_registry_lock );
+
+	return info;
+}
+
+
+// Returns the entry of data, creating it if data is not registered yet.
+
+static train_info *register_train_data ( struct fann_train_data *data, train_info *parent ) {
+
+	train_info *info;
+	unsigned int h = registry_hash ( data );
+
+	pthread_mutex_lock ( &train_registry_lock );
+
+	for ( info = train_registry[h]; info && info->data != data; info = info->next )
+		;
+
+	if ( !info && ( info = calloc ( 1, sizeof ( train_info ) ) ) != NULL ) {
+
+		info->data = data;
+		info->parent = parent;
+		info->refs = 1;
+		rng_seed_fresh ( &info->rng, data );
+		info->next = train_registry[h];
+		train_registry[h] = info;
+	}
+
+	pthread_mutex_unlock ( &train_registry_lock );
+
+	return info;
+}
+
+
+static void init_view ( struct fann_train_data *view, struct fann_train_data *data, unsigned int num_data ) {
+
+	memset ( view, 0, sizeof ( struct fann_train_data ) );
+	view->error_log = data->error_log;
+	view->num_data = num_data;
+	view->num_input = data->num_input;
+	view->num_output = data->num_output;
+	view->input = malloc ( num_data * sizeof ( fann_type* ) );
+	view->output = malloc ( num_data * sizeof ( fann_type* ) );
+}
+
+
+static void free_view ( struct fann_train_data *view ) {
+
+	free ( view->input );
+	free ( view->output );
+	free ( view->errstr );
+}
+
+
+// Drops one reference. The last one frees the data and, for a view, drops
+// the reference it holds on its parent.
+
+static void release_train_info ( train_info *info ) {
+
+	train_info **prev, *parent;
+
+	while ( info ) {
+
+		pthread_mutex_lock ( &train_registry_lock );
+
+		if ( --info->refs > 0 ) {
+
+			pthread_mutex_unlock ( &train_registry_lock );
+			return;
+		}
+
+		for ( prev = train_registry + registry_hash ( info->data ); *prev != info; prev = &( *prev )->next )
+			;
+		*prev = info->next;
+
+		pthread_mutex_unlock ( &train_registry_lock );
+
+		if ( ( parent = info->parent ) != NULL || info->map ) {
+
+			free_view ( info->data );
+			free ( info->data );
+			if ( info->map )
+				munmap ( info->map, info->map_size );
+		}
+		else
+			fann_destroy_train ( info->data );
+
+		free ( info->stats );
+		free ( info );
+		info = parent;
+	}
+}
+
+
+static void destroy_train_data ( struct fann_train_data *data ) {
+
+	train_info *info = lookup_train_info ( data );
+
+	if ( info )
+		release_train_info ( info );
+	else
+		fann_destroy_train ( data );
+}
+
+
+static int is_train_view ( struct fann_train_data *data ) {
+
+	train_info *info = lookup_train_info ( data );
+
+	return info && info->parent;
+}
+
+
+// True if views refer to the rows of data, whose handle holds one reference.
+
+static int has_train_views ( struct fann_train_data *data ) {
+
+	train_info *info = lookup_train_info ( data );
+
+	return info && info->refs > 1;
+}
+
+
+static int has_duplicate_rows ( struct fann_train_data *data ) {
+
+	train_info *info = lookup_train_info ( data );
+
+	return info && info->duplicates;
+}
+
+
+static rng *get_train_rng ( struct fann_train_data *data ) {
+
+	train_info *info = register_train_data ( data, NULL );
+
+	return info ? &info->rng : NULL;
+}
+
+
+// A view shares the rows of its parent, so changing the rows of any data
+// bumps the version of the root of its family, which drops the statistics
+// cached on all of them.
+
+static train_info *root_train_info ( train_info *info ) {
+
+	while ( info->parent )
+		info = info->parent;
+
+	return info;
+}
+
+
+static void touch_train_data ( struct fann_train_data *data ) {
+
+	train_info *info = lookup_train_info ( data );
+
+	if ( info == NULL )
+		return;
+
+	info = root_train_info ( info );
+
+	pthread_mutex_lock ( &train_registry_lock );
+	info->version++;
+	pthread_mutex_unlock ( &train_registry_lock );
+}
+
+
+// Fisher-Yates on the row pointers of a view.
+
+static void shuffle_rows ( struct fann_train_data *view, rng *r ) {
+
+	unsigned int i, j;
+	fann_type *row;
+
+	for ( i = view->num_data; i > 1; i-- ) {
+
+		j = rng_below ( r, i );
+		row = view->input[i - 1]; view->input[i - 1] = view->input[j]; view->input[j] = row;
+		row = view->output[i - 1]; view->output[i - 1] = view->output[j]; view->output[j] = row;
+	}
+}
+
+
+#ifndef FIXEDFANN
+
+// A temporary, unregistered view on all rows of data, through which an
+// epoch can visit the rows in a shuffled order without moving them.
+
+static int init_order ( struct fann_train_data *order, struct fann_train_data *data ) {
+
+	init_view ( order, data, data->num_data );
+
+	if ( data->num_data && ( !order->input || !order->output ) ) {
+
+		free_view ( order );
+		return FALSE;
+	}
+
+	memcpy ( order->input, data->input, data->num_data * sizeof ( fann_type* ) );
+	memcpy ( order->output, data->output, data->num_data * sizeof ( fann_type* ) );
+
+	return TRUE;
+}
+
+#endif
+
+
+// Creates a view of num_data rows on data, the caller fills in the rows.
+// The view refers to the rows of data, so a view of a view has the same
+// parent as the view.
+
+static struct fann_train_data *create_view ( struct fann_train_data *data, unsigned int num_data, int duplicates ) {
+
+	struct fann_train_data *view;
+	train_info *parent, *info;
+
+	if ( ( parent = register_train_data ( data, NULL ) ) == NULL )
+		return NULL;
+	if ( parent->parent )
+		parent = parent->parent;
+
+	if ( ( view = malloc ( sizeof ( struct fann_train_data ) ) ) == NULL )
+		return NULL;
+
+	init_view ( view, data, num_data );
+
+	if ( ( num_data && ( !view->input || !view->output ) ) ||
+		( info = register_train_data ( view, parent ) ) == NULL ) {
+
+		free_view ( view );
+		free ( view );
+		return NULL;
+	}
+
+	pthread_mutex_lock ( &train_registry_lock );
+	parent->refs++;
+	pthread_mutex_unlock ( &train_registry_lock );
+
+	info->duplicates = duplicates;
+
+	return view;
+}
+
+
+// Allocates training data laid out as by fann_read_train_from_file (), one
+// block for all inputs and one for all outputs, so that
+// fann_destroy_train () frees it.
+
+static struct fann_train_data *create_owned_train_data ( unsigned int num_data, unsigned int num_input, unsigned int num_output ) {
+
+	struct fann_train_data *data;
+	fann_type *input, *output;
+	unsigned int i;
+
+	if ( ( data = calloc ( 1, sizeof ( struct fann_train_data ) ) ) == NULL )
+		return NULL;
+
+	fann_set_error_log ( ( struct fann_error* ) data, stderr );
+	data->num_data = num_data;
+	data->num_input = num_input;
+	data->num_output = num_output;
+	data->input = calloc ( num_data ? num_data : 1, sizeof ( fann_type* ) );
+	data->output = calloc ( num_data ? num_data : 1, sizeof ( fann_type* ) );
+	input = calloc ( ( size_t ) ( num_data ? num_data : 1 ) * num_input, sizeof ( fann_type ) );
+	output = calloc ( ( size_t ) ( num_data ? num_data : 1 ) * num_output, sizeof ( fann_type ) );
+
+	if ( !data->input || !data->output || !input || !output ) {
+
+		free ( input );
+		free ( output );
+		free ( data->input );
+		free ( data->output );
+		free ( data );
+		return NULL;
+	}
+
+	for ( i = 0; i < num_data; i++ ) {
+
+		data->input[i] = input + ( size_t ) i * num_input;
+		data->output[i] = output + ( size_t ) i * num_output;
+	}
+
+	// fann_destroy_train () frees the blocks through the first row.
+	data->input[0] = input;
+	data->output[0] = output;
+
+	return data;
+}
+
+
+// Copies count rows of data from first on into new owned training data,
+// data may be a view.
+
+static struct fann_train_data *copy_train_rows ( struct fann_train_data *data, unsigned int first, unsigned int count ) {
+
+	struct fann_train_data *copy;
+	unsigned int i;
+
+	if ( ( copy = create_owned_train_data ( count, data->num_input, data->num_output ) ) == NULL )
+		return NULL;
+
+	for ( i = 0; i < count; i++ ) {
+
+		memcpy ( copy->input[i], data->input[first + i], data->num_input * sizeof ( fann_type ) );
+		memcpy ( copy->output[i], data->output[first + i], data->num_output * sizeof ( fann_type ) );
+	}
+
+	return copy;
+}
+
+
+static struct fann_train_data *merge_train_rows ( struct fann_train_data *data1, struct fann_train_data *data2 ) {
+
+	struct fann_train_data *merged, *data;
+	unsigned int i, j = 0;
+
+	if ( data1->num_input != data2->num_input || data1->num_output != data2->num_output )
+		return NULL;
+
+	if ( ( merged = create_owned_train_data ( data1->num_data + data2->num_data, data1->num_input, data1->num_output ) ) == NULL )
+		return NULL;
+
+	for ( data = data1; data; data = data == data1 ? data2 : NULL )
+		for ( i = 0; i < data->num_data; i++, j++ ) {
+
+			memcpy ( merged->input[j], data->input[i], data->num_input * sizeof ( fann_type ) );
+			memcpy ( merged->output[j], data->output[i], data->num_output * sizeof ( fann_type ) );
+		}
+
+	return merged;
+}
+
+
+static int check_scalable ( term_t data_pt, struct fann_train_data *data ) {
+
+	if ( has_duplicate_rows ( data ) )
+		return domain_error ( data_pt, "view_without_duplicates" );
+
+	PL_succeed;
+}
+
+
+static int compare_rows ( const void *a, const void *b ) {
+
+	const fann_type *r1 = *( fann_type* const* ) a, *r2 = *( fann_type* const* ) b;
+
+	return r1 < r2 ? -1 : r1 > r2 ? 1 : 0;
+}
+
+
+foreign_t swi_fann_subset_train_data_view ( term_t data_pt, term_t pos_pt, term_t len_pt, term_t view_pt ) {
+
+	struct fann_train_data *data, *view;
+	int pos, len;
+
+	if ( !get_train_data ( data_pt, &data ) )
+		PL_fail;
+	if ( !PL_get_integer ( pos_pt, &pos ) )
+		return type_error ( pos_pt, "integer" );
+	if ( pos < 0 )
+		return domain_error ( pos_pt, "nonneg" );
+	if ( !PL_get_integer ( len_pt, &len ) )
+		return type_error ( len_pt, "integer" );
+	if ( len < 1 )
+		return domain_error ( len_pt, "positive_integer" );
+	if ( !PL_is_variable ( view_pt ) )
+		return type_error ( view_pt, "var" );
+
+	if ( ( unsigned int ) pos + ( unsigned int ) len > data->num_data )
+		return domain_error ( len_pt, "subset_of_train_data" );
+
+	if ( ( view = create_view ( data, len, has_duplicate_rows ( data ) ) ) == NULL )
+		return type_error ( data_pt, "fann_error" );
+
+	memcpy ( view->input, data->input + pos, len * sizeof ( fann_type* ) );
+	memcpy ( view->output, data->output + pos, len * sizeof ( fann_type* ) );
+
+	return unify_train_data ( view_pt, view );
+}
+
+
+foreign_t swi_fann_index_train_data_view ( term_t data_pt, term_t indices_pt, term_t view_pt ) {
+
+	struct fann_train_data *data, *view;
+	term_t list_pt = PL_copy_term_ref ( indices_pt );
+	term_t index_pt = PL_new_term_ref ();
+	fann_type **rows;
+	size_t len;
+	unsigned int i;
+	int index, duplicates = FALSE;
+
+	if ( !get_train_data ( data_pt, &data ) )
+		PL_fail;
+	if ( PL_skip_list ( indices_pt, 0, &len ) != PL_LIST )
+		return type_error ( indices_pt, "list" );
+	if ( !len || len > UINT_MAX )
+		return domain_error ( indices_pt, "non_empty_list" );
+	if ( !PL_is_variable ( view_pt ) )
+		return type_error ( view_pt, "var" );
+
+	if ( ( view = create_view ( data, len, FALSE ) ) == NULL )
+		return type_error ( data_pt, "fann_error" );
+
+	for ( i = 0; i < len && PL_get_list ( list_pt, index_pt, list_pt ); i++ ) {
+
+		if ( !PL_get_integer ( index_pt, &index ) ) {
+
+			destroy_train_data ( view );
+			return type_error ( index_pt, "integer" );
+		}
+		if ( index < 0 || ( unsigned int ) index >= data->num_data ) {
+
+			destroy_train_data ( view );
+			return domain_error ( index_pt, "train_data_index" );
+		}
+
+		view->input[i] = data->input[index];
+		view->output[i] = data->output[index];
+	}
+
+	// Scaling a view with repeated rows would scale those rows repeatedly.
+	if ( ( rows = malloc ( len * sizeof ( fann_type* ) ) ) != NULL ) {
+
+		memcpy ( rows, view->input, len * sizeof ( fann_type* ) );
+		qsort ( rows, len, sizeof ( fann_type* ), compare_rows );
+
+		for ( i = 1; i < len && !duplicates; i++ )
+			duplicates = rows[i] == rows[i - 1];
+
+		free ( rows );
+	}
+	else
+		duplicates = TRUE;
+
+	lookup_train_info ( view )->duplicates = duplicates;
+
+	return unify_train_data ( view_pt, view );
+}
+
+
+foreign_t swi_fann_bootstrap_train_data_view ( term_t data_pt, term_t len_pt, term_t view_pt ) {
+
+	struct fann_train_data *data, *view;
+	unsigned int i, row;
+	int len;
+	rng *r;
+
+	if ( !get_train_data ( data_pt, &data ) )
+		PL_fail;
+	if ( !PL_get_integer ( len_pt, &len ) )
+		return type_error ( len_pt, "integer" );
+	if ( len < 1 )
+		return domain_error ( len_pt, "positive_integer" );
+	if ( !PL_is_variable ( view_pt ) )
+		return type_error ( view_pt, "var" );
+
+	if ( !data->num_data )
+		return domain_error ( data_pt, "non_empty_train_data" );
+
+	if ( ( view = create_view ( data, len, TRUE ) ) == NULL )
+		return type_error ( data_pt, "fann_error" );
+
+	r = get_train_rng ( data );
+
+	for ( i = 0; i < ( unsigned int ) len; i++ ) {
+
+		row = r ? rng_below ( r, data->num_data ) : ( unsigned int ) rand () % data->num_data;
+		view->input[i] = data->input[row];
+		view->output[i] = data->output[row];
+	}
+
+	return unify_train_data ( view_pt, view );
+}
+
+
+foreign_t swi_fann_is_train_data_view ( term_t data_pt ) {
+
+	struct fann_train_data *data;
+
+	if ( !get_train_data ( data_pt, &data ) )
+		PL_fail;
+
+	return is_train_view ( data );
+}
+
+
+foreign_t swi_fann_set_train_data_random_seed ( term_t data_pt, term_t seed_pt ) {
+
+	int64_t seed;
+	struct fann_train_data *data;
+	rng *r;
+
+	if ( !get_train_data ( data_pt, &data ) )
+		PL_fail;
+	if ( !PL_get_int64 ( seed_pt, &seed ) )
+		return type_error ( seed_pt, "integer" );
+
+	if ( ( r = get_train_rng ( data ) ) == NULL )
+		return type_error ( data_pt, "fann_error" );
+
+	rng_seed ( r, ( uint64_t ) seed );
+
+	PL_succeed;
+}
+
+
+                        /* Training control */
+
+
+// Native training polls Prolog for signals (call_with_time_limit/2,
+// thread_signal/2, Ctrl-C) after every epoch and honours a wall-clock
+// budget. Unless restore_best(false) is given the weights of the best
+// epoch seen are restored on interrupt.
+
+enum train_stop {
+
+	TRAIN_RUNNING = 0,
+	TRAIN_STOP_SIGNAL,
+	TRAIN_STOP_TIMEOUT
+};
+
+typedef struct train_ctl {
+
+	double deadline;                  // Absolute wall-clock time, 0.0 if none.
+	enum train_stop stop;
+	int shuffle;                      // Visit the rows in a new order every epoch.
+	int restore_best;                 // Put the best weights back when stopped.
+	unsigned int first_epoch;         // Above 1 when resuming from a checkpoint.
+	char checkpoint[PATH_MAX];        // Checkpoint file, empty if none.
+	unsigned int checkpoint_every;    // Epochs (neurons for cascade) between checkpoints.
+	double checkpoint_interval;       // Seconds between checkpoints.
+} train_ctl;
+
+
+static double wall_time ( void ) {
+
+	struct timeval tv;
+
+	gettimeofday ( &tv, NULL );
+
+	return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+
+#ifndef FIXEDFANN
+
+static int get_train_options ( term_t options_pt, train_ctl *ctl ) {
+
+	term_t head_pt = PL_new_term_ref ();
+	term_t arg_pt = PL_new_term_ref ();
+	term_t list_pt = PL_copy_term_ref ( options_pt );
+	atom_t name;
+	size_t arity;
+	double value;
+
+	memset ( ctl, 0, sizeof ( *ctl ) );
+	ctl->first_epoch = 1;
+	ctl->restore_best = TRUE;
+
+	while ( PL_get_list ( list_pt, head_pt, list_pt ) ) {
+
+		if ( !PL_get_name_arity ( head_pt, &name, &arity ) || arity != 1 )
+			return type_error ( head_pt, "option" );
+
+		PL_get_arg ( 1, head_pt, arg_pt );
+
+		if ( !strcmp ( "max_time", PL_atom_chars ( name ) ) ) {
+
+			if ( !PL_get_float ( arg_pt, &value ) )
+				return type_error ( arg_pt, "float" );
+			if ( value < 0.0 )
+				return domain_error ( arg_pt, "nonneg" );
+
+			value += wall_time ();
+			if ( ctl->deadline == 0.0 || value < ctl->deadline )
+				ctl->deadline = value;
+		}
+
+		else if ( !strcmp ( "deadline", PL_atom_chars ( name ) ) ) {
+
+			if ( !PL_get_float ( arg_pt, &value ) )
+				return type_error ( arg_pt, "float" );
+
+			if ( ctl->deadline == 0.0 || value < ctl->deadline )
+				ctl->deadline = value;
+		}
+
+		else if ( !strcmp ( "shuffle", PL_atom_chars ( name ) ) ) {
+
+			if ( !PL_get_bool ( arg_pt, &ctl->shuffle ) )
+				return type_error ( arg_pt, "bool" );
+		}
+
+		else if ( !strcmp ( "restore_best", PL_atom_chars ( name ) ) ) {
+
+			if ( !PL_get_bool ( arg_pt, &ctl->restore_best ) )
+				return type_error ( arg_pt, "bool" );
+		}
+
+		else if ( !strcmp ( "checkpoint", PL_atom_chars ( name ) ) ) {
+
+			char *file;
+
+			if ( !PL_get_file_name ( arg_pt, &file, PL_FILE_ABSOLUTE | PL_FILE_OSPATH ) )
+				return type_error ( arg_pt, "file" );
+			if ( strlen ( file ) >= sizeof ( ctl->checkpoint ) - 4 )
+				return domain_error ( arg_pt, "file" );
+
+			strcpy ( ctl->checkpoint, file );
+		}
+
+		else if ( !strcmp ( "checkpoint_every", PL_atom_chars ( name ) ) ) {
+
+			int every;
+
+			if ( !PL_get_integer ( arg_pt, &every ) )
+				return type_error ( arg_pt, "integer" );
+			if ( every < 1 )
+				return domain_error ( arg_pt, "positive_integer" );
+
+			ctl->checkpoint_every = every;
+		}
+
+		else if ( !strcmp ( "checkpoint_interval", PL_atom_chars ( name ) ) ) {
+
+			if ( !PL_get_float ( arg_pt, &value ) )
+				return type_error ( arg_pt, "float" );
+			if ( value <= 0.0 )
+				return domain_error ( arg_pt, "positive" );
+
+			ctl->checkpoint_interval = value;
+		}
+	}
+
+	if ( !PL_get_nil ( list_pt ) )
+		return type_error ( options_pt, "list" );
+
+	// A checkpoint file alone asks for a checkpoint every 100 epochs.
+	if ( ctl->checkpoint[0] && !ctl->checkpoint_every && ctl->checkpoint_interval == 0.0 )
+		ctl->checkpoint_every = 100;
+
+	PL_succeed;
+}
+
+#endif
+
+
+// Called from the training loop on the Prolog thread, FALSE means stop.
+
+static int train_ctl_poll ( train_ctl *ctl ) {
+
+	if ( PL_handle_signals () < 0 ) {
+
+		ctl->stop = TRAIN_STOP_SIGNAL;
+		return FALSE;
+	}
+
+	if ( ctl->deadline > 0.0 && wall_time () >= ctl->deadline ) {
+
+		ctl->stop = TRAIN_STOP_TIMEOUT;
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+
+static foreign_t train_ctl_result ( train_ctl *ctl ) {
+
+	if ( ctl->stop == TRAIN_STOP_SIGNAL )
+		PL_fail; // The exception is pending from PL_handle_signals ().
+	if ( ctl->stop == TRAIN_STOP_TIMEOUT )
+		return time_limit_exceeded ();
+
+	PL_succeed;
+}
+
+
+                        /* Thread pool */
+
+
+// Runs batches of independent tasks on a set of worker threads. Workers
+// never call Prolog; the calling thread waits and polls for signals and the
+// deadline, and on either sets cancel, which tasks are expected to check.
+// cancel is atomic, as it is set while workers read it. The workers wait
+// for the next batch between batches, so a pool can be kept for many
+// batches, e.g. all candidate epochs of cascade training.
+
+typedef void ( *task_fn ) ( void *arg, unsigned int index, atomic_int *cancel );
+
+typedef struct task_pool {
+
+	pthread_mutex_t lock;
+	pthread_cond_t work;		// Signalled when a batch starts or the pool stops.
+	pthread_cond_t idle;		// Signalled when the last worker is done with a batch.
+	unsigned int next, count;	// Tasks of the current batch.
+	unsigned int running;		// Workers not done with the current batch.
+	unsigned int threads;		// Workers started, 0 if none could be.
+	unsigned long batch;		// Bumped for every batch.
+	int quit;
+	atomic_int cancel;
+	task_fn fn;
+	void *arg;
+	pthread_t *workers;
+} task_pool;
+
+
+static unsigned int default_threads ( void ) {
+
+	long n = sysconf ( _SC_NPROCESSORS_ONLN );
+
+	return n > 0 ? ( unsigned int ) n : 1;
+}
+
+
+static int get_threads_option ( term_t arg_pt, unsigned int *threads ) {
+
+	int value;
+
+	if ( !PL_get_integer ( arg_pt, &value ) )
+		return type_error ( arg_pt, "integer" );
+	if ( value < 1 )
+		return domain_error ( arg_pt, "positive_integer" );
+
+	*threads = value;
+
+	PL_succeed;
+}
+
+
+static void *task_worker ( void *arg ) {
+
+	task_pool *pool = arg;
+	unsigned long batch = 0;
+	unsigned int index;
+
+	pthread_mutex_lock ( &pool->lock );
+
+	for ( ;; ) {
+
+		while ( !pool->quit && pool->batch == batch )
+			pthread_cond_wait ( &pool->work, &pool->lock );
+
+		if ( pool->quit )
+			break;
+
+		batch = pool->batch;
+
+		while ( !atomic_load ( &pool->cancel ) && pool->next < pool->count ) {
+
+			index = pool->next++;
+			pthread_mutex_unlock ( &pool->lock );
+
+			pool->fn ( pool->arg, index, &pool->cancel );
+
+			pthread_mutex_lock ( &pool->lock );
+		}
+
+		if ( --pool->running == 0 )
+			pthread_cond_signal ( &pool->idle );
+	}
+
+	pthread_mutex_unlock ( &pool->lock );
+
+	return NULL;
+}
+
+
+// Starts up to threads workers. If none can be started the batches are run
+// on the calling thread.
+
+static void pool_start ( task_pool *pool, unsigned int threads ) {
+
+	memset ( pool, 0, sizeof ( *pool ) );
+	atomic_init ( &pool->cancel, 0 );
+	pthread_mutex_init ( &pool->lock, NULL );
+	pthread_cond_init ( &pool->work, NULL );
+	pthread_cond_init ( &pool->idle, NULL );
+
+	if ( ( pool->workers = malloc ( threads * sizeof ( pthread_t ) ) ) == NULL )
+		return;
+
+	for ( ; pool->threads < threads; pool->threads++ )
+		if ( pthread_create ( pool->workers + pool->threads, NULL, task_worker, pool ) )
+			break;
+}
+
+
+static void pool_stop ( task_pool *pool ) {
+
+	unsigned int i;
+
+	pthread_mutex_lock ( &pool->lock );
+	pool->quit = TRUE;
+	pthread_cond_broadcast ( &pool->work );
+	pthread_mutex_unlock ( &pool->lock );
+
+	for ( i = 0; i < pool->threads; i++ )
+		pthread_join ( pool->workers[i], NULL );
+
+	free ( pool->workers );
+	pthread_cond_destroy ( &pool->idle );
+	pthread_cond_destroy ( &pool->work );
+	pthread_mutex_destroy ( &pool->lock );
+}
+
+
+// Runs count tasks as one batch and waits for them. Returns FALSE if
+// stopped by ctl.
+
+static int pool_run ( task_pool *pool, unsigned int count, task_fn fn, void *arg, train_ctl *ctl ) {
+
+	struct timespec until;
+
+	pthread_mutex_lock ( &pool->lock );
+
+	atomic_store ( &pool->cancel, 0 );
+	pool->fn = fn;
+	pool->arg = arg;
+	pool->next = 0;
+	pool->count = count;
+
+	if ( pool->threads ) {
+
+		pool->running = pool->threads;
+		pool->batch++;
+		pthread_cond_broadcast ( &pool->work );
+	}
+
+	while ( pool->running > 0 ) {
+
+		clock_gettime ( CLOCK_REALTIME, &until );
+		until.tv_nsec += 50000000;
+		if ( until.tv_nsec >= 1000000000 ) {
+
+			until.tv_sec++;
+			until.tv_nsec -= 1000000000;
+		}
+
+		pthread_cond_timedwait ( &pool->idle, &pool->lock, &until );
+
+		if ( !atomic_load ( &pool->cancel ) ) {
+
+			pthread_mutex_unlock ( &pool->lock );
+			if ( !train_ctl_poll ( ctl ) )
+				atomic_store ( &pool->cancel, 1 );
+			pthread_mutex_lock ( &pool->lock );
+		}
+	}
+
+	pthread_mutex_unlock ( &pool->lock );
+
+	// No worker could be started, do the work on this thread.
+	for ( ; !atomic_load ( &pool->cancel ) && pool->next < pool->count; pool->next++ ) {
+
+		fn ( arg, pool->next, &pool->cancel );
+		if ( !train_ctl_poll ( ctl ) )
+			atomic_store ( &pool->cancel, 1 );
+	}
+
+	return !atomic_load ( &pool->cancel );
+}
+
+
+// Runs one batch of count tasks on up to threads workers started for it.
+
+static int run_tasks ( unsigned int count, unsigned int threads, task_fn fn, void *arg, train_ctl *ctl ) {
+
+	task_pool pool;
+	int ok;
+
+	pool_start ( &pool, threads < count ? threads : count );
+	ok = pool_run ( &pool, count, fn, arg, ctl );
+	pool_stop ( &pool );
+
+	return ok;
+}
+
+
+#ifndef FIXEDFANN
+
+                        /* Schedules */
+
+
+// The learning rate and the momentum of a network can follow a schedule,
+// driven by a count of the epochs trained natively since the schedule was
+// attached. The value of the parameter at that moment is the base value.
+// Before every epoch the parameter is set from the schedule, and after it
+// the count advances and a plateau schedule looks at the MSE.
+
+static double schedule_value ( schedule *sc ) {
+
+	double period, t;
+
+	switch ( sc->kind ) {
+
+		case SCHEDULE_STEP:
+			return sc->base * pow ( sc->arg[1], floor ( sc->epoch / sc->arg[0] ) );
+
+		case SCHEDULE_EXPONENTIAL:
+			return sc->base * pow ( sc->arg[0], sc->epoch );
+
+		case SCHEDULE_COSINE:
+			t = sc->epoch < sc->arg[0] ? sc->epoch : sc->arg[0];
+			return sc->arg[1] + ( sc->base - sc->arg[1] ) * 0.5 * ( 1.0 + cos ( M_PI * t / sc->arg[0] ) );
+
+		case SCHEDULE_WARM_RESTARTS:
+			period = sc->arg[0];
+			t = sc->epoch;
+			if ( sc->arg[1] == 1.0 )
+				t = fmod ( t, period );
+			else
+				while ( t >= period ) {
+
+					t -= period;
+					period *= sc->arg[1];
+				}
+			return sc->arg[2] + ( sc->base - sc->arg[2] ) * 0.5 * ( 1.0 + cos ( M_PI * t / period ) );
+
+		case SCHEDULE_PLATEAU:
+			return sc->current;
+
+		default:
+			return sc->base;
+	}
+}
+
+
+static void schedule_epoch_done ( schedule *sc, float mse ) {
+
+	sc->epoch++;
+
+	if ( sc->kind != SCHEDULE_PLATEAU )
+		return;
+
+	// An improvement is a decrease of more than 1e-4 of the best MSE.
+	if ( sc->epoch == 1 || mse < sc->best * ( 1.0 - 1e-4 ) ) {
+
+		sc->best = mse;
+		sc->stale = 0;
+	}
+	else if ( ++sc->stale >= sc->arg[1] ) {
+
+		sc->current *= sc->arg[0];
+		if ( sc->current < sc->arg[2] )
+			sc->current = sc->arg[2];
+		sc->stale = 0;
+	}
+}
+
+
+// Sets the scheduled parameters of ann for the next epoch. Returns the
+// registry entry if ann has a schedule, for apply_schedules_after ().
+
+static ann_info *apply_schedules ( struct fann *ann ) {
+
+	ann_info *info = lookup_ann_info ( ann );
+
+	if ( !info || ( !info->schedules[SCHEDULE_LEARNING_RATE].kind && !info->schedules[SCHEDULE_LEARNING_MOMENTUM].kind ) )
+		return NULL;
+
+	if ( info->schedules[SCHEDULE_LEARNING_RATE].kind )
+		fann_set_learning_rate ( ann, ( float ) schedule_value ( info->schedules + SCHEDULE_LEARNING_RATE ) );
+	if ( info->schedules[SCHEDULE_LEARNING_MOMENTUM].kind )
+		fann_set_learning_momentum ( ann, ( float ) schedule_value ( info->schedules + SCHEDULE_LEARNING_MOMENTUM ) );
+
+	return info;
+}
+
+
+static void apply_schedules_after ( ann_info *info, float mse ) {
+
+	int i;
+
+	if ( info )
+		for ( i = 0; i < SCHEDULE_PARAMETERS; i++ )
+			if ( info->schedules[i].kind )
+				schedule_epoch_done ( info->schedules + i, mse );
+}
+
+
+// fann_train_epoch () under the schedules of ann.
+
+static float train_epoch_scheduled ( struct fann *ann, struct fann_train_data *data ) {
+
+	ann_info *info = apply_schedules ( ann );
+	float mse = fann_train_epoch ( ann, data );
+
+	apply_schedules_after ( info, mse );
+
+	return mse;
+}
+
+
+static int get_schedule ( term_t schedule_pt, schedule *sc ) {
+
+	static const struct {
+
+		const char *name;
+		size_t arity;
+		enum schedule_kind kind;
+	} kinds[] = {
+
+		{ "none", 0, SCHEDULE_NONE },
+		{ "step", 2, SCHEDULE_STEP },
+		{ "exponential", 1, SCHEDULE_EXPONENTIAL },
+		{ "cosine", 2, SCHEDULE_COSINE },
+		{ "warm_restarts", 3, SCHEDULE_WARM_RESTARTS },
+		{ "plateau", 3, SCHEDULE_PLATEAU }
+	};
+	term_t arg_pt = PL_new_term_ref ();
+	atom_t name;
+	size_t arity, i, k;
+
+	if ( !PL_get_name_arity ( schedule_pt, &name, &arity ) )
+		return type_error ( schedule_pt, "schedule" );
+
+	for ( k = 0; k < sizeof ( kinds ) / sizeof ( kinds[0] ); k++ )
+		if ( kinds[k].arity == arity && !strcmp ( kinds[k].name, PL_atom_chars ( name ) ) )
+			break;
+
+	if ( k == sizeof ( kinds ) / sizeof ( kinds[0] ) )
+		return domain_error ( schedule_pt, "schedule" );
+
+	memset ( sc, 0, sizeof ( *sc ) );
+	sc->kind = kinds[k].kind;
+
+	for ( i = 0; i < arity; i++ ) {
+
+		PL_get_arg ( i + 1, schedule_pt, arg_pt );
+		if ( !PL_get_float ( arg_pt, sc->arg + i ) )
+			return type_error ( arg_pt, "float" );
+	}
+
+	// Periods and patience are counted in epochs, factors are positive.
+	switch ( sc->kind ) {
+
+		case SCHEDULE_STEP:
+		case SCHEDULE_COSINE:
+		case SCHEDULE_WARM_RESTARTS:
+			if ( sc->arg[0] < 1.0 )
+				return domain_error ( schedule_pt, "schedule" );
+			if ( sc->kind == SCHEDULE_WARM_RESTARTS && sc->arg[1] < 1.0 )
+				return domain_error ( schedule_pt, "schedule" );
+			break;
+
+		case SCHEDULE_EXPONENTIAL:
+			if ( sc->arg[0] <= 0.0 )
+				return domain_error ( schedule_pt, "schedule" );
+			break;
+
+		case SCHEDULE_PLATEAU:
+			if ( sc->arg[0] <= 0.0 || sc->arg[1] < 1.0 )
+				return domain_error ( schedule_pt, "schedule" );
+			break;
+
+		default:
+			break;
+	}
+
+	PL_succeed;
+}
+
+
+                        /* Checkpoints */
+
+
+// A checkpoint holds everything fann_train_epoch () carries from one epoch
+// to the next: the weights, the slopes and steps of RPROP, quickprop and
+// SARPROP, the momentum deltas, the learning and SARPROP parameters, the
+// SARPROP epoch, the generator of the epoch order and the schedules, with
+// the number of epochs done. The state is copied on the training thread and
+// written by a writer thread to File.tmp, which is then renamed to File. A
+// checkpoint due while the previous one is still being written is skipped,
+// so training never waits on the disk.
+//
+// The file is the header below followed by the arrays, in the byte order
+// and fann_type of the engine that wrote it. The SARPROP fields are zero
+// unless the library is 2.2.
+
+#define CHECKPOINT_MAGIC "PLFANNCK"
+#define CHECKPOINT_VERSION 2
+
+enum checkpoint_array {
+
+	CHECKPOINT_TRAIN_SLOPES = 1,
+	CHECKPOINT_PREV_STEPS = 2,
+	CHECKPOINT_PREV_TRAIN_SLOPES = 4,
+	CHECKPOINT_PREV_WEIGHTS_DELTAS = 8,
+	CHECKPOINT_SCHEDULES = 16
+};
+
+typedef struct checkpoint_header {
+
+	char magic[8];
+	uint64_t rng[4];
+	uint32_t version;
+	uint32_t type_size;
+	uint32_t total_connections;
+	uint32_t num_input;
+	uint32_t num_output;
+	uint32_t epoch;
+	uint32_t max_epochs;
+	uint32_t epochs_between_reports;
+	uint32_t shuffle;
+	uint32_t arrays;
+	uint32_t training_algorithm;
+	float desired_error;
+	float learning_rate;
+	float learning_momentum;
+	float rprop_increase_factor;
+	float rprop_decrease_factor;
+	float rprop_delta_min;
+	float rprop_delta_max;
+	float rprop_delta_zero;
+	float quickprop_decay;
+	float quickprop_mu;
+	uint32_t sarprop_epoch;
+	float sarprop_weight_decay_shift;
+	float sarprop_step_error_threshold_factor;
+	float sarprop_step_error_shift;
+	float sarprop_temperature;
+} checkpoint_header;
+
+
+typedef struct checkpoint_writer {
+
+	pthread_t thread;
+	int running;
+	volatile int done;
+	const char *file;
+	void *buf;			// A checkpoint file image, or
+	int network;			// the bytes of a network to fann_save ().
+	size_t size;
+	double last;			// Wall-clock time of the last checkpoint.
+} checkpoint_writer;
+
+
+static unsigned char *network_to_bytes ( struct fann *ann, int weights, size_t *size );
+static struct fann *network_from_bytes ( const unsigned char *p, size_t len, int weights, int *valid );
+
+
+static void *checkpoint_write_thread ( void *arg ) {
+
+	checkpoint_writer *w = arg;
+	char tmp[PATH_MAX];
+	struct fann *ann;
+	FILE *fd;
+	int ok = FALSE, valid;
+
+	snprintf ( tmp, sizeof ( tmp ), "%s.tmp", w->file );
+
+	if ( w->network ) {
+
+		if ( ( ann = network_from_bytes ( w->buf, w->size, TRUE, &valid ) ) != NULL ) {
+
+			ok = fann_save ( ann, tmp ) == 0;
+			destroy_ann ( ann );
+		}
+	}
+	else if ( ( fd = fopen ( tmp, "wb" ) ) != NULL ) {
+
+		ok = fwrite ( w->buf, 1, w->size, fd ) == w->size;
+		ok = fclose ( fd ) == 0 && ok;
+	}
+
+	if ( ok )
+		rename ( tmp, w->file );
+
+	free ( w->buf );
+	w->buf = NULL;
+	w->done = TRUE;
+
+	return NULL;
+}
+
+
+static void checkpoint_finish ( checkpoint_writer *w ) {
+
+	if ( w->running ) {
+
+		pthread_join ( w->thread, NULL );
+		w->running = FALSE;
+	}
+}
+
+
+// Hands buf over to the writer, a file image or, if network is set, the
+// bytes of a network. Unless wait is set the checkpoint is dropped if the
+// writer is still busy.
+
+static void checkpoint_submit ( checkpoint_writer *w, void *buf, size_t size, int network, int wait ) {
+
+	if ( !buf )
+		return;
+
+	if ( w->running && !w->done && !wait ) {
+
+		free ( buf );
+		return;
+	}
+
+	checkpoint_finish ( w );
+
+	w->buf = buf;
+	w->size = size;
+	w->network = network;
+	w->done = FALSE;
+	w->last = wall_time ();
+
+	if ( !wait && pthread_create ( &w->thread, NULL, checkpoint_write_thread, w ) == 0 )
+		w->running = TRUE;
+	else
+		checkpoint_write_thread ( w );
+}
+
+
+// Cascade training changes the layout of the network, so its checkpoints
+// are the network itself, saved by fann_save (). The training thread only
+// copies it to bytes, as fann_serialize/2 does, and the writer builds the
+// network from them and saves it. The connections are only set at the end
+// of cascade training, but the copy needs them.
+
+static void checkpoint_network ( checkpoint_writer *w, struct fann *ann, int wait ) {
+
+	unsigned char *buf;
+	size_t size = 0;
+
+	fann_set_shortcut_connections ( ann );
+
+	buf = network_to_bytes ( ann, TRUE, &size );
+	checkpoint_submit ( w, buf, size, TRUE, wait );
+}
+
+
+static int checkpoint_due ( checkpoint_writer *w, train_ctl *ctl, unsigned int i ) {
+
+	if ( !ctl->checkpoint[0] )
+		return FALSE;
+
+	return ( ctl->checkpoint_every && i % ctl->checkpoint_every == 0 ) ||
+		( ctl->checkpoint_interval > 0.0 && wall_time () - w->last >= ctl->checkpoint_interval );
+}
+
+
+static size_t checkpoint_array_size ( struct fann *ann ) {
+
+	return ann->total_connections * sizeof ( fann_type );
+}
+
+
+// Copies the training state of ann after epoch into a new file image. The
+// schedules of ann, if any, follow the arrays.
+
+static void *checkpoint_image ( struct fann *ann, struct fann_train_data *data, unsigned int epoch, unsigned int max_epochs, unsigned int epochs_between_reports, float desired_error, int shuffle, rng *r, size_t *size ) {
+
+	fann_type *arrays[4];
+	checkpoint_header h;
+	size_t n = checkpoint_array_size ( ann );
+	unsigned char *buf, *p;
+	ann_info *info = lookup_ann_info ( ann );
+	int i;
+
+	arrays[0] = ann->train_slopes;
+	arrays[1] = ann->prev_steps;
+	arrays[2] = ann->prev_train_slopes;
+	arrays[3] = ann->prev_weights_deltas;
+
+	memset ( &h, 0, sizeof ( h ) );
+	memcpy ( h.magic, CHECKPOINT_MAGIC, 8 );
+	h.version = CHECKPOINT_VERSION;
+	h.type_size = sizeof ( fann_type );
+	h.total_connections = ann->total_connections;
+	h.num_input = data->num_input;
+	h.num_output = data->num_output;
+	h.epoch = epoch;
+	h.max_epochs = max_epochs;
+	h.epochs_between_reports = epochs_between_reports;
+	h.desired_error = desired_error;
+	h.shuffle = shuffle && r;
+	if ( r )
+		memcpy ( h.rng, r->s, sizeof ( h.rng ) );
+	h.training_algorithm = ann->training_algorithm;
+	h.learning_rate = ann->learning_rate;
+	h.learning_momentum = ann->learning_momentum;
+	h.rprop_increase_factor = ann->rprop_increase_factor;
+	h.rprop_decrease_factor = ann->rprop_decrease_factor;
+	h.rprop_delta_min = ann->rprop_delta_min;
+	h.rprop_delta_max = ann->rprop_delta_max;
+	h.rprop_delta_zero = ann->rprop_delta_zero;
+	h.quickprop_decay = ann->quickprop_decay;
+	h.quickprop_mu = ann->quickprop_mu;
+#ifdef VERSION220
+	h.sarprop_epoch = ann->sarprop_epoch;
+	h.sarprop_weight_decay_shift = ann->sarprop_weight_decay_shift;
+	h.sarprop_step_error_threshold_factor = ann->sarprop_step_error_threshold_factor;
+	h.sarprop_step_error_shift = ann->sarprop_step_error_shift;
+	h.sarprop_temperature = ann->sarprop_temperature;
+#endif
+
+	*size = sizeof ( h ) + n;
+	for ( i = 0; i < 4; i++ )
+		if ( arrays[i] ) {
+
+			h.arrays |= 1 << i;
+			*size += n;
+		}
+
+	if ( info ) {
+
+		h.arrays |= CHECKPOINT_SCHEDULES;
+		*size += sizeof ( info->schedules );
+	}
+
+	if ( ( buf = malloc ( *size ) ) == NULL )
+		return NULL;
+
+	memcpy ( buf, &h, sizeof ( h ) );
+	memcpy ( p = buf + sizeof ( h ), ann->weights, n );
+
+	for ( i = 0; i < 4; i++ )
+		if ( arrays[i] )
+			memcpy ( p += n, arrays[i], n );
+
+	if ( info )
+		memcpy ( p + n, info->schedules, sizeof ( info->schedules ) );
+
+	return buf;
+}
+
+
+// Restores a checkpoint written for ann and data, or returns an error term.
+
+static int read_checkpoint ( const char *file, struct fann *ann, struct fann_train_data *data, checkpoint_header *h, rng *r ) {
+
+	fann_type **arrays[4];
+	size_t n = checkpoint_array_size ( ann );
+	schedule schedules[SCHEDULE_PARAMETERS];
+	ann_info *info;
+	FILE *fd;
+	int i, ok;
+
+	arrays[0] = &ann->train_slopes;
+	arrays[1] = &ann->prev_steps;
+	arrays[2] = &ann->prev_train_slopes;
+	arrays[3] = &ann->prev_weights_deltas;
+
+	if ( ( fd = fopen ( file, "rb" ) ) == NULL )
+		return FALSE;
+
+	ok = fread ( h, sizeof ( *h ), 1, fd ) == 1 &&
+		!memcmp ( h->magic, CHECKPOINT_MAGIC, 8 ) &&
+		h->version == CHECKPOINT_VERSION &&
+		h->type_size == sizeof ( fann_type ) &&
+		h->total_connections == ann->total_connections &&
+		h->num_input == data->num_input &&
+		h->num_output == data->num_output &&
+		fread ( ann->weights, 1, n, fd ) == n;
+
+	for ( i = 0; ok && i < 4; i++ ) {
+
+		if ( !( h->arrays & ( 1 << i ) ) )
+			continue;
+
+		if ( *arrays[i] == NULL &&
+			( *arrays[i] = calloc ( ann->total_connections_allocated, sizeof ( fann_type ) ) ) == NULL )
+			ok = FALSE;
+		else
+			ok = fread ( *arrays[i], 1, n, fd ) == n;
+	}
+
+	if ( ok && ( h->arrays & CHECKPOINT_SCHEDULES ) ) {
+
+		ok = fread ( schedules, sizeof ( schedules ), 1, fd ) == 1 && ( info = get_ann_info ( ann ) ) != NULL;
+		if ( ok )
+			memcpy ( info->schedules, schedules, sizeof ( schedules ) );
+	}
+
+	fclose ( fd );
+
+	if ( !ok )
+		return FALSE;
+
+	ann->training_algorithm = h->training_algorithm;
+	ann->learning_rate = h->learning_rate;
+	ann->learning_momentum = h->learning_momentum;
+	ann->rprop_increase_factor = h->rprop_increase_factor;
+	ann->rprop_decrease_factor = h->rprop_decrease_factor;
+	ann->rprop_delta_min = h->rprop_delta_min;
+	ann->rprop_delta_max = h->rprop_delta_max;
+	ann->rprop_delta_zero = h->rprop_delta_zero;
+	ann->quickprop_decay = h->quickprop_decay;
+	ann->quickprop_mu = h->quickprop_mu;
+#ifdef VERSION220
+	ann->sarprop_epoch = h->sarprop_epoch;
+	ann->sarprop_weight_decay_shift = h->sarprop_weight_decay_shift;
+	ann->sarprop_step_error_threshold_factor = h->sarprop_step_error_threshold_factor;
+	ann->sarprop_step_error_shift = h->sarprop_step_error_shift;
+	ann->sarprop_temperature = h->sarprop_temperature;
+#endif
+
+	if ( h->shuffle && r )
+		memcpy ( r->s, h->rng, sizeof ( h->rng ) );
+
+	return TRUE;
+}
+
+
+static int desired_error_reached ( struct fann *ann, float desired_error ) {
+
+	if ( fann_get_train_stop_function ( ann ) == FANN_STOPFUNC_BIT )
+		return fann_get_bit_fail ( ann ) <= desired_error;
+
+	return fann_get_MSE ( ann ) <= desired_error;
+}
+
+
+// Unless restore_best(false) is given the weights every epoch starts from
+// are copied, and those of the epoch with the lowest error are put back
+// when training is stopped. The epoch error belongs to the weights the
+// epoch started from. With restore_best(false) nothing is copied.
+
+typedef struct best_weights {
+
+	fann_type *buffer;		// Both copies, NULL if not tracking.
+	fann_type *best, *before;
+	unsigned int count;
+	float error;
+	int valid;
+} best_weights;
+
+
+static void best_weights_init ( best_weights *b, struct fann *ann, train_ctl *ctl ) {
+
+	b->count = ann->total_connections;
+	b->valid = FALSE;
+	b->buffer = ctl->restore_best ? malloc ( 2 * ( size_t ) b->count * sizeof ( fann_type ) ) : NULL;
+	b->best = b->buffer;
+	b->before = b->buffer ? b->buffer + b->count : NULL;
+}
+
+
+static void best_weights_before ( best_weights *b, struct fann *ann ) {
+
+	if ( b->buffer )
+		memcpy ( b->before, ann->weights, b->count * sizeof ( fann_type ) );
+}
+
+
+static void best_weights_after ( best_weights *b, float error ) {
+
+	fann_type *swap;
+
+	if ( b->buffer && ( !b->valid || error < b->error ) ) {
+
+		swap = b->best;
+		b->best = b->before;
+		b->before = swap;
+		b->error = error;
+		b->valid = TRUE;
+	}
+}
+
+
+static void best_weights_finish ( best_weights *b, struct fann *ann, train_ctl *ctl ) {
+
+	if ( ctl->stop != TRAIN_RUNNING && b->valid )
+		memcpy ( ann->weights, b->best, b->count * sizeof ( fann_type ) );
+
+	free ( b->buffer );
+}
+
+
+// Same loop and reports as fann_train_on_data (), polling in between epochs.
+
+static void train_on_data_ctl ( struct fann *ann, struct fann_train_data *data, unsigned int max_epochs, unsigned int epochs_between_reports, float desired_error, train_ctl *ctl ) {
+
+	unsigned int i;
+	float error;
+	int reached;
+	best_weights best;
+	struct fann_train_data order;
+	rng *r = ctl->shuffle ? get_train_rng ( data ) : NULL;
+	checkpoint_writer writer;
+	void *image;
+	size_t size;
+
+	if ( r && !init_order ( &order, data ) )
+		r = NULL;
+
+	memset ( &writer, 0, sizeof ( writer ) );
+	writer.file = ctl->checkpoint;
+	writer.last = wall_time ();
+	best_weights_init ( &best, ann, ctl );
+
+	if ( epochs_between_reports )
+		printf ( "Max epochs %8d. Desired error: %.10f.\n", max_epochs, desired_error );
+
+	for ( i = ctl->first_epoch; i <= max_epochs; i++ ) {
+
+		best_weights_before ( &best, ann );
+
+		// The order only depends on the generator, so a checkpoint resumes it.
+		if ( r ) {
+
+			memcpy ( order.input, data->input, data->num_data * sizeof ( fann_type* ) );
+			memcpy ( order.output, data->output, data->num_data * sizeof ( fann_type* ) );
+			shuffle_rows ( &order, r );
+		}
+
+		error = train_epoch_scheduled ( ann, r ? &order : data );
+		reached = desired_error_reached ( ann, desired_error );
+		best_weights_after ( &best, error );
+
+		if ( epochs_between_reports &&
+			( i % epochs_between_reports == 0 || i == max_epochs || i == 1 || reached ) )
+			printf ( "Epochs     %8d. Current error: %.10f. Bit fail %d.\n", i, error, fann_get_bit_fail ( ann ) );
+
+		if ( reached || !train_ctl_poll ( ctl ) || i == max_epochs )
+			break;
+
+		if ( checkpoint_due ( &writer, ctl, i ) &&
+			( image = checkpoint_image ( ann, data, i, max_epochs, epochs_between_reports, desired_error, ctl->shuffle, r, &size ) ) != NULL )
+			checkpoint_submit ( &writer, image, size, FALSE, FALSE );
+	}
+
+	// When stopped the state after the last epoch is kept, before the best
+	// weights are put back.
+	if ( ctl->stop != TRAIN_RUNNING && ctl->checkpoint[0] && i <= max_epochs &&
+		( image = checkpoint_image ( ann, data, i, max_epochs, epochs_between_reports, desired_error, ctl->shuffle, r, &size ) ) != NULL )
+		checkpoint_submit ( &writer, image, size, FALSE, TRUE );
+
+	checkpoint_finish ( &writer );
+	best_weights_finish ( &best, ann, ctl );
+
+	if ( r )
+		free_view ( &order );
+}
+
+
+// Early stopping: the validation set is tested every validate_every epochs
+// and a copy of the best weights is kept. Training stops when patience
+// validations in a row brought no improvement of more than min_delta, and
+// the best weights are put back.
+
+typedef struct validate_opts {
+
+	unsigned int max_epochs;
+	unsigned int validate_every;
+	unsigned int patience;
+	unsigned int epochs_between_reports;
+	double desired_error;
+	double min_delta;
+} validate_opts;
+
+
+static int get_validate_options ( term_t options_pt, validate_opts *opts ) {
+
+	term_t head_pt = PL_new_term_ref ();
+	term_t arg_pt = PL_new_term_ref ();
+	term_t list_pt = PL_copy_term_ref ( options_pt );
+	atom_t name;
+	size_t arity;
+	const char *option;
+	int value;
+
+	opts->max_epochs = 1000;
+	opts->validate_every = 1;
+	opts->patience = 10;
+	opts->epochs_between_reports = 0;
+	opts->desired_error = 0.0;
+	opts->min_delta = 0.0;
+
+	while ( PL_get_list ( list_pt, head_pt, list_pt ) ) {
+
+		if ( !PL_get_name_arity ( head_pt, &name, &arity ) || arity != 1 )
+			return type_error ( head_pt, "option" );
+
+		PL_get_arg ( 1, head_pt, arg_pt );
+		option = PL_atom_chars ( name );
+
+		if ( !strcmp ( "desired_error", option ) ) {
+
+			if ( !PL_get_float ( arg_pt, &opts->desired_error ) )
+				return type_error ( arg_pt, "float" );
+		}
+
+		else if ( !strcmp ( "min_delta", option ) ) {
+
+			if ( !PL_get_float ( arg_pt, &opts->min_delta ) )
+				return type_error ( arg_pt, "float" );
+			if ( opts->min_delta < 0.0 )
+				return domain_error ( arg_pt, "nonneg" );
+		}
+
+		else if ( !strcmp ( "max_epochs", option ) ||
+			!strcmp ( "validate_every", option ) ||
+			!strcmp ( "patience", option ) ||
+			!strcmp ( "epochs_between_reports", option ) ) {
+
+			if ( !PL_get_integer ( arg_pt, &value ) )
+				return type_error ( arg_pt, "integer" );
+
+			if ( !strcmp ( "epochs_between_reports", option ) ) {
+
+				if ( value < 0 )
+					return domain_error ( arg_pt, "nonneg" );
+				opts->epochs_between_reports = value;
+			}
+
+			else {
+
+				if ( value < 1 )
+					return domain_error ( arg_pt, "positive_integer" );
+
+				if ( !strcmp ( "max_epochs", option ) )
+					opts->max_epochs = value;
+				else if ( !strcmp ( "validate_every", option ) )
+					opts->validate_every = value;
+				else
+					opts->patience = value;
+			}
+		}
+	}
+
+	if ( !PL_get_nil ( list_pt ) )
+		return type_error ( options_pt, "list" );
+
+	PL_succeed;
+}
+
+
+static int train_on_data_validated_ctl ( struct fann *ann, struct fann_train_data *train, struct fann_train_data *validation, validate_opts *opts, train_ctl *ctl ) {
+
+	unsigned int i, stale = 0, num_weights = ann->total_connections;
+	float error, mse, best_mse;
+	fann_type *best = malloc ( num_weights * sizeof ( fann_type ) );
+	struct fann_train_data order;
+	rng *r = ctl->shuffle ? get_train_rng ( train ) : NULL;
+
+	if ( best == NULL )
+		return FALSE;
+
+	if ( r && !init_order ( &order, train ) )
+		r = NULL;
+
+	memcpy ( best, ann->weights, num_weights * sizeof ( fann_type ) );
+	best_mse = fann_test_data ( ann, validation );
+
+	for ( i = 1; i <= opts->max_epochs; i++ ) {
+
+		if ( r )
+			shuffle_rows ( &order, r );
+
+		error = train_epoch_scheduled ( ann, r ? &order : train );
+
+		if ( i % opts->validate_every == 0 || i == opts->max_epochs ) {
+
+			mse = fann_test_data ( ann, validation );
+
+			if ( mse < best_mse - opts->min_delta ) {
+
+				best_mse = mse;
+				stale = 0;
+				memcpy ( best, ann->weights, num_weights * sizeof ( fann_type ) );
+			}
+			else
+				stale++;
+
+			if ( opts->epochs_between_reports &&
+				( i % opts->epochs_between_reports == 0 || i == opts->max_epochs || i == 1 ) )
+				printf ( "Epochs     %8d. Current error: %.10f. Validation error: %.10f. Best %.10f.\n", i, error, mse, best_mse );
+
+			if ( stale >= opts->patience || best_mse <= opts->desired_error )
+				break;
+		}
+
+		if ( !train_ctl_poll ( ctl ) )
+			break;
+	}
+
+	memcpy ( ann->weights, best, num_weights * sizeof ( fann_type ) );
+
+	if ( r )
+		free_view ( &order );
+
+	free ( best );
+
+	return TRUE;
+}
+
+
+// Cascade training, as fann_cascadetrain_on_data (), with the candidates
+// trained in parallel. The network is run on the calling thread for a chunk
+// of rows at a time, keeping the neuron values and output errors of every
+// row. The candidates are then split in slices, one task per slice, and
+// every candidate goes through the rows of the chunk in order. Candidates
+// share nothing, so the scores, and so the best candidate, do not depend on
+// the number of threads.
+
+#define CANDIDATE_CHUNK_VALUES ( 1 << 20 )
+
+typedef struct candidate_chunk {
+
+	struct fann *ann;
+	unsigned int num_cand;
+	unsigned int num_values;	// Connections into a candidate.
+	unsigned int slices;
+	unsigned int rows;		// Rows in the current chunk.
+	fann_type *values;		// rows x num_values neuron values.
+	fann_type *errors;		// rows x num_output output errors.
+} candidate_chunk;
+
+
+// fann_update_candidate_slopes () for one candidate and one row, with the
+// neuron values taken from the chunk. Every candidate is trained: the loop
+// of FANN 2.1 stops one short ( cand_it < last_cand, last_cand being the
+// last candidate ), leaving the last candidate untrained with the initial
+// score, which no trained candidate can beat as scores only decrease.
+
+static void update_candidate_slopes ( struct fann *ann, struct fann_neuron *cand, fann_type *score, const fann_type *values, const fann_type *errors ) {
+
+	unsigned int i, j, num_connections = cand->last_con - cand->first_con;
+	fann_type max_sum, cand_sum = 0, activation, derived, diff, error_value = 0;
+	fann_type *weights = ann->weights + cand->first_con;
+	fann_type *cand_out_weights = weights + num_connections;
+	fann_type *cand_slopes = ann->train_slopes + cand->first_con;
+	fann_type *cand_out_slopes = cand_slopes + num_connections;
+
+	// Summed in the same order as the unrolled loop of the library.
+	i = num_connections & 3;
+	switch ( i ) {
+
+		case 3:
+			cand_sum += weights[2] * values[2];
+			/* fall through */
+		case 2:
+			cand_sum += weights[1] * values[1];
+			/* fall through */
+		case 1:
+			cand_sum += weights[0] * values[0];
+		case 0:
+			break;
+	}
+
+	for ( ; i != num_connections; i += 4 )
+		cand_sum +=
+			weights[i] * values[i] +
+			weights[i + 1] * values[i + 1] +
+			weights[i + 2] * values[i + 2] + weights[i + 3] * values[i + 3];
+
+	max_sum = 150 / cand->activation_steepness;
+	if ( cand_sum > max_sum )
+		cand_sum = max_sum;
+	else if ( cand_sum < -max_sum )
+		cand_sum = -max_sum;
+
+	activation = fann_activation ( ann, cand->activation_function, cand->activation_steepness, cand_sum );
+	cand->sum = cand_sum;
+	cand->value = activation;
+
+	derived = fann_activation_derived ( cand->activation_function, cand->activation_steepness, activation, cand_sum );
+
+	for ( j = 0; j < ann->num_output; j++ ) {
+
+		diff = ( activation * cand_out_weights[j] ) - errors[j];
+		cand_out_slopes[j] -= 2.0f * diff * activation;
+		error_value += diff * cand_out_weights[j];
+		*score -= ( diff * diff );
+	}
+
+	error_value *= derived;
+
+	for ( i = 0; i < num_connections; i++ )
+		cand_slopes[i] -= error_value * values[i];
+}
+
+
+static void candidate_slice_task ( void *arg, unsigned int index, atomic_int *cancel ) {
+
+	candidate_chunk *chunk = arg;
+	struct fann *ann = chunk->ann;
+	struct fann_neuron *first_cand = ann->first_layer->first_neuron + ann->total_neurons + 1;
+	unsigned int c, row;
+	unsigned int first = index * chunk->num_cand / chunk->slices;
+	unsigned int last = ( index + 1 ) * chunk->num_cand / chunk->slices;
+
+	for ( c = first; c < last && !atomic_load ( cancel ); c++ )
+		for ( row = 0; row < chunk->rows; row++ )
+			update_candidate_slopes ( ann, first_cand + c, ann->cascade_candidate_scores + c,
+				chunk->values + ( size_t ) row * chunk->num_values,
+				chunk->errors + ( size_t ) row * ann->num_output );
+}
+
+
+// The output errors of a candidate epoch, halved for symmetric functions.
+
+static void candidate_errors ( struct fann *ann, const fann_type *desired, fann_type *errors ) {
+
+	struct fann_neuron *output_neurons = ( ann->last_layer - 1 )->first_neuron;
+	unsigned int j;
+
+	for ( j = 0; j < ann->num_output; j++ ) {
+
+		errors[j] = desired[j] - ann->output[j];
+
+		switch ( output_neurons[j].activation_function ) {
+
+			case FANN_LINEAR_PIECE_SYMMETRIC:
+			case FANN_SIGMOID_SYMMETRIC:
+			case FANN_SIGMOID_SYMMETRIC_STEPWISE:
+			case FANN_THRESHOLD_SYMMETRIC:
+			case FANN_ELLIOT_SYMMETRIC:
+			case FANN_GAUSSIAN_SYMMETRIC:
+			case FANN_SIN_SYMMETRIC:
+			case FANN_COS_SYMMETRIC:
+				errors[j] /= 2.0;
+				break;
+			default:
+				break;
+		}
+	}
+}
+
+
+// fann_train_candidates_epoch (). Returns FALSE if stopped by ctl.
+
+static int train_candidates_epoch ( struct fann *ann, struct fann_train_data *data, candidate_chunk *chunk, task_pool *pool, train_ctl *ctl, fann_type *best_score ) {
+
+	struct fann_neuron *neurons = ann->first_layer->first_neuron;
+	unsigned int i, c, row, max_rows = CANDIDATE_CHUNK_VALUES / ( chunk->num_values + ann->num_output );
+	unsigned int best_candidate = 0;
+
+	if ( max_rows < 1 )
+		max_rows = 1;
+
+	for ( c = 0; c < chunk->num_cand; c++ )
+		ann->cascade_candidate_scores[c] = ann->MSE_value;
+
+	for ( i = 0; i < data->num_data; i += chunk->rows ) {
+
+		chunk->rows = data->num_data - i < max_rows ? data->num_data - i : max_rows;
+
+		for ( row = 0; row < chunk->rows; row++ ) {
+
+			fann_type *values = chunk->values + ( size_t ) row * chunk->num_values;
+			unsigned int v;
+
+			fann_run ( ann, data->input[i + row] );
+
+			for ( v = 0; v < chunk->num_values; v++ )
+				values[v] = neurons[v].value;
+
+			candidate_errors ( ann, data->output[i + row], chunk->errors + ( size_t ) row * ann->num_output );
+		}
+
+		if ( pool ) {
+
+			if ( !pool_run ( pool, chunk->slices, candidate_slice_task, chunk, ctl ) )
+				return FALSE;
+		}
+		else
+			for ( c = 0; c < chunk->slices; c++ )
+				candidate_slice_task ( chunk, c, NULL );
+	}
+
+	fann_update_candidate_weights ( ann, data->num_data );
+
+	for ( c = 1; c < chunk->num_cand; c++ )
+		if ( ann->cascade_candidate_scores[c] > ann->cascade_candidate_scores[best_candidate] )
+			best_candidate = c;
+
+	ann->cascade_best_candidate = ann->total_neurons + best_candidate + 1;
+	*best_score = ann->cascade_candidate_scores[best_candidate];
+
+	return TRUE;
+}
+
+
+// fann_train_candidates (). Returns the epochs used, 0 if stopped by ctl.
+// The candidates are split in up to threads slices, run on pool, or on the
+// calling thread if pool is NULL.
+
+static unsigned int train_candidates ( struct fann *ann, struct fann_train_data *data, unsigned int threads, task_pool *pool, train_ctl *ctl ) {
+
+	fann_type best_cand_score = 0.0;
+	fann_type target_cand_score = 0.0;
+	fann_type backslide_cand_score = -1.0e20f;
+	unsigned int i, max_epochs = ann->cascade_max_cand_epochs, stagnation = max_epochs;
+	struct fann_neuron *first_cand = ann->first_layer->first_neuron + ann->total_neurons + 1;
+	candidate_chunk chunk;
+	unsigned int max_rows;
+
+	chunk.ann = ann;
+	chunk.num_cand = fann_get_cascade_num_candidates ( ann );
+	chunk.num_values = first_cand->last_con - first_cand->first_con;
+	chunk.slices = threads < chunk.num_cand ? threads : chunk.num_cand;
+	chunk.rows = 0;
+
+	max_rows = CANDIDATE_CHUNK_VALUES / ( chunk.num_values + ann->num_output );
+	if ( max_rows < 1 )
+		max_rows = 1;
+	if ( max_rows > data->num_data )
+		max_rows = data->num_data;
+
+	if ( ann->cascade_candidate_scores == NULL &&
+		( ann->cascade_candidate_scores = malloc ( chunk.num_cand * sizeof ( fann_type ) ) ) == NULL )
+		return 0;
+
+	chunk.values = malloc ( ( size_t ) max_rows * chunk.num_values * sizeof ( fann_type ) );
+	chunk.errors = malloc ( ( size_t ) max_rows * ann->num_output * sizeof ( fann_type ) );
+
+	if ( !chunk.values || !chunk.errors ) {
+
+		free ( chunk.values );
+		free ( chunk.errors );
+		return 0;
+	}
+
+	for ( i = 0; i < max_epochs; i++ ) {
+
+		if ( !train_candidates_epoch ( ann, data, &chunk, pool, ctl, &best_cand_score ) ||
+			!train_ctl_poll ( ctl ) ) {
+
+			i = 0;
+			break;
+		}
+
+		if ( best_cand_score / ann->MSE_value > ann->cascade_candidate_limit ) {
+
+			i++;
+			break;
+		}
+
+		if ( ( best_cand_score > target_cand_score ) || ( best_cand_score < backslide_cand_score ) ) {
+
+			target_cand_score = best_cand_score * ( 1.0f + ann->cascade_candidate_change_fraction );
+			backslide_cand_score = best_cand_score * ( 1.0f - ann->cascade_candidate_change_fraction );
+			stagnation = i + ann->cascade_candidate_stagnation_epochs;
+		}
+
+		if ( i >= stagnation ) {
+
+			i++;
+			break;
+		}
+	}
+
+	free ( chunk.values );
+	free ( chunk.errors );
+
+	return i;
+}
+
+
+// fann_train_outputs (), polling after every epoch. When stopped the output
+// weights of its best epoch are put back, unless restore_best(false) is
+// given, as by train_on_data_ctl (). Returns the epochs trained.
+
+static unsigned int train_outputs_ctl ( struct fann *ann, struct fann_train_data *data, float desired_error, train_ctl *ctl ) {
+
+	float error, initial_error, error_improvement;
+	float target_improvement = 0.0f;
+	float backslide_improvement = -1.0e20f;
+	unsigned int i, max_epochs = ann->cascade_max_out_epochs, stagnation = max_epochs;
+	best_weights best;
+
+	fann_clear_train_arrays ( ann );
+	best_weights_init ( &best, ann, ctl );
+
+	best_weights_before ( &best, ann );
+	initial_error = fann_train_outputs_epoch ( ann, data );
+	best_weights_after ( &best, initial_error );
+
+	for ( i = 1; i < max_epochs; i++ ) {
+
+		if ( desired_error_reached ( ann, desired_error ) || !train_ctl_poll ( ctl ) )
+			break;
+
+		best_weights_before ( &best, ann );
+		error = fann_train_outputs_epoch ( ann, data );
+		best_weights_after ( &best, error );
+
+		// After any significant change allow a new quota of epochs.
+		error_improvement = initial_error - error;
+
+		if ( ( error_improvement > target_improvement ) || ( error_improvement < backslide_improvement ) ) {
+
+			target_improvement = error_improvement * ( 1.0f + ann->cascade_output_change_fraction );
+			backslide_improvement = error_improvement * ( 1.0f - ann->cascade_output_change_fraction );
+			stagnation = i + ann->cascade_output_stagnation_epochs;
+		}
+
+		if ( i >= stagnation ) {
+
+			i++;
+			break;
+		}
+	}
+
+	best_weights_finish ( &best, ann, ctl );
+
+	return i;
+}
+
+
+// The loop and reports of fann_cascadetrain_on_data (), polling after every
+// output and candidate epoch. When stopped the candidate being trained is
+// dropped and the outputs are not trained again. Checkpoints of cascade
+// training are networks saved by fann_save (), taken between neurons.
+
+static void cascadetrain_on_data_ctl ( struct fann *ann, struct fann_train_data *data, unsigned int max_neurons, unsigned int neurons_between_reports, float desired_error, unsigned int threads, train_ctl *ctl ) {
+
+	unsigned int i, epochs, total_epochs = 0, num_cand = fann_get_cascade_num_candidates ( ann );
+	int reached;
+	checkpoint_writer writer;
+	task_pool pool;
+
+	memset ( &writer, 0, sizeof ( writer ) );
+	writer.file = ctl->checkpoint;
+	writer.last = wall_time ();
+
+	// One pool serves every candidate epoch; its workers sleep in between.
+	if ( threads > 1 )
+		pool_start ( &pool, threads < num_cand ? threads : num_cand );
+
+	if ( neurons_between_reports )
+		printf ( "Max neurons %3d. Desired error: %.6f\n", max_neurons, desired_error );
+
+	for ( i = 1; i <= max_neurons; i++ ) {
+
+		total_epochs += train_outputs_ctl ( ann, data, desired_error, ctl );
+		reached = desired_error_reached ( ann, desired_error );
+
+		if ( neurons_between_reports &&
+			( i % neurons_between_reports == 0 || i == max_neurons || i == 1 || reached ) ) {
+
+			printf ( "Neurons     %3d. Current error: %.6f. Total error:%8.4f. Epochs %5d. Bit fail %3d",
+				i, fann_get_MSE ( ann ), ann->MSE_value, total_epochs, fann_get_bit_fail ( ann ) );
+
+			if ( ( ann->last_layer - 2 ) != ann->first_layer )
+				printf ( ". candidate steepness %.2f. function %s",
+					( double ) ( ann->last_layer - 2 )->first_neuron->activation_steepness,
+					FANN_ACTIVATIONFUNC_NAMES[ ( ann->last_layer - 2 )->first_neuron->activation_function ] );
+
+			printf ( "\n" );
+		}
+
+		if ( reached || ctl->stop != TRAIN_RUNNING || !train_ctl_poll ( ctl ) )
+			break;
+
+		if ( fann_initialize_candidates ( ann ) == -1 )
+			break;
+
+		epochs = train_candidates ( ann, data, threads, threads > 1 ? &pool : NULL, ctl );
+
+		if ( ctl->stop != TRAIN_RUNNING )
+			break;
+
+		total_epochs += epochs;
+		fann_install_candidate ( ann );
+
+		if ( checkpoint_due ( &writer, ctl, i ) )
+			checkpoint_network ( &writer, ann, FALSE );
+	}
+
+	if ( threads > 1 )
+		pool_stop ( &pool );
+
+	if ( ctl->stop == TRAIN_RUNNING ) {
+
+		total_epochs += train_outputs_ctl ( ann, data, 0.0, ctl );
+
+		if ( neurons_between_reports )
+			printf ( "Train outputs    Current error: %.6f. Epochs %6d\n", fann_get_MSE ( ann ), total_epochs );
+	}
+
+	fann_set_shortcut_connections ( ann );
+
+	if ( ctl->stop != TRAIN_RUNNING && ctl->checkpoint[0] )
+		checkpoint_network ( &writer, ann, TRUE );
+
+	checkpoint_finish ( &writer );
+}
+
+#endif
+
+
+static foreign_t train_on_data_options ( term_t ann_pt, term_t data_pt, term_t max_epochs_pt, term_t epochs_between_reports_pt, term_t desired_error_pt, term_t options_pt ) {
+
+#ifndef FIXEDFANN
+
+	struct fann *ann;
+	struct fann_train_data *data;
+	unsigned int max_epochs, epochs_between_reports;
+	double desired_error;
+	handle_uses uses = { { NULL }, 0 };
+	train_ctl ctl;
+
+	if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
+	if ( !get_train_data ( data_pt, &data ) )
+		PL_fail;
+
+	if ( !PL_get_integer ( max_epochs_pt, &max_epochs ) )
+		return type_error ( max_epochs_pt, "integer" );
+	if ( max_epochs < 1 )
+		return domain_error ( max_epochs_pt, "positive_integer" );
+
+	if ( !PL_get_integer ( epochs_between_reports_pt, &epochs_between_reports ) )
+		return type_error ( epochs_between_reports_pt, "integer" );
+	if ( epochs_between_reports < 0 )
+		return domain_error ( epochs_between_reports_pt, "nonneg" );
+
+	if ( !PL_get_float ( desired_error_pt, &desired_error ) )
+		return type_error ( desired_error_pt, "float" );
+
+	if ( !get_train_options ( options_pt, &ctl ) )
+		PL_fail;
+
+	if ( !use_handle ( &uses, ann_pt, &ann_blob ) || !use_handle ( &uses, data_pt, &train_blob ) )
+		PL_fail;
+
+	train_on_data_ctl ( ann, data, max_epochs, epochs_between_reports, (float) desired_error, &ctl );
+
+	unuse_handles ( &uses );
+
+	return train_ctl_result ( &ctl );
+
+#else
+
+	return type_error ( ann_pt, "not available fixedfann" );
+
+#endif
+}
+
+
+foreign_t swi_fann_train_on_data ( term_t ann_pt, term_t data_pt, term_t max_epochs_pt, term_t epochs_between_reports_pt, term_t desired_error_pt ) {
+
+	term_t options_pt = PL_new_term_ref ();
+
+	PL_put_nil ( options_pt );
+
+	return train_on_data_options ( ann_pt, data_pt, max_epochs_pt, epochs_between_reports_pt, desired_error_pt, options_pt );
+}
+
+
+foreign_t swi_fann_train_on_data_6 ( term_t ann_pt, term_t data_pt, term_t max_epochs_pt, term_t epochs_between_reports_pt, term_t desired_error_pt, term_t options_pt ) {
+
+	return train_on_data_options ( ann_pt, data_pt, max_epochs_pt, epochs_between_reports_pt, desired_error_pt, options_pt );
+}
+
+
+foreign_t swi_fann_train_on_data_resume ( term_t ann_pt, term_t data_pt, term_t file_pt, term_t options_pt ) {
+
+#ifndef FIXEDFANN
+
+	struct fann *ann;
+	struct fann_train_data *data;
+	char *file;
+	checkpoint_header h;
+	handle_uses uses = { { NULL }, 0 };
+	train_ctl ctl;
+
+	if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
+	if ( !get_train_data ( data_pt, &data ) )
+		PL_fail;
+
+	if ( !get_train_options ( options_pt, &ctl ) )
+		PL_fail;
+
+	if ( !PL_get_file_name ( file_pt, &file, PL_FILE_ABSOLUTE | PL_FILE_OSPATH ) )
+		return type_error ( file_pt, "file" );
+
+	if ( !use_handle ( &uses, ann_pt, &ann_blob ) || !use_handle ( &uses, data_pt, &train_blob ) )
+		PL_fail;
+
+	if ( !read_checkpoint ( file, ann, data, &h, get_train_rng ( data ) ) ) {
+
+		unuse_handles ( &uses );
+		return domain_error ( file_pt, "checkpoint" );
+	}
+
+	ctl.first_epoch = h.epoch + 1;
+	ctl.shuffle = h.shuffle;
+
+	train_on_data_ctl ( ann, data, h.max_epochs, h.epochs_between_reports, h.desired_error, &ctl );
+
+	unuse_handles ( &uses );
+
+	return train_ctl_result ( &ctl );
+
+#else
+
+	return type_error ( ann_pt, "not available fixedfann" );
+
+#endif
+}
+
+
+foreign_t swi_fann_train_on_data_validated ( term_t ann_pt, term_t train_pt, term_t validation_pt, term_t options_pt ) {
+
+#ifndef FIXEDFANN
+
+	struct fann *ann;
+	struct fann_train_data *train, *validation;
+	validate_opts opts;
+	handle_uses uses = { { NULL }, 0 };
+	train_ctl ctl;
+	int ok;
+
+	if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
+	if ( !get_train_data ( train_pt, &train ) )
+		PL_fail;
+	if ( !get_train_data ( validation_pt, &validation ) )
+		PL_fail;
+
+	if ( !get_validate_options ( options_pt, &opts ) )
+		PL_fail;
+	if ( !get_train_options ( options_pt, &ctl ) )
+		PL_fail;
+
+	if ( !use_handle ( &uses, ann_pt, &ann_blob ) || !use_handle ( &uses, train_pt, &train_blob ) ||
+		 !use_handle ( &uses, validation_pt, &train_blob ) )
+		PL_fail;
+
+	ok = train_on_data_validated_ctl ( ann, train, validation, &opts, &ctl );
+
+	unuse_handles ( &uses );
+
+	if ( !ok )
+		return type_error ( ann_pt, "fann_error" );
+
+	return train_ctl_result ( &ctl );
+
+#else
+
+	return type_error ( ann_pt, "not available fixedfann" );
+
+#endif
+}
+
+
+                        /* Hyperparameter search */
+
+
+#ifndef FIXEDFANN
+
+// A candidate is described by a list of options. layers/1 is required, the
+// others set the parameter of the same name on the network:
+// layers(+List), connection_rate(+Float), algorithm(+Atom), learning_rate,
+// learning_momentum, activation_hidden(+Atom), activation_output(+Atom),
+// steepness_hidden, steepness_output, rprop_increase_factor,
+// rprop_decrease_factor, rprop_delta_min, rprop_delta_max, rprop_delta_zero,
+// quickprop_decay, quickprop_mu, max_epochs(+N), desired_error(+Float),
+// seed(+Int) and shuffle(+Bool).
+
+typedef struct candidate {
+
+	struct fann *ann;
+	unsigned int max_epochs;
+	float desired_error;
+	float mse;
+	int shuffle;
+	rng rng;			// Epoch order, and the weights if seeded.
+} candidate;
+
+
+// Returns 1 if the option was applied, 0 if it is not a network parameter
+// and -1 if an exception was raised.
+
+static int apply_ann_option ( struct fann *ann, const char *option, term_t arg_pt ) {
+
+	double value;
+	fann_type steepness;
+	char *type;
+	enum fann_activationfunc_enum activation_function;
+	enum fann_train_enum training_algorithm;
+
+	if ( !strcmp ( "algorithm", option ) ) {
+
+		if ( !PL_get_chars ( arg_pt, &type, CVT_ATOM ) )
+			return type_error ( arg_pt, "atom" ) ? 1 : -1;
+		if ( ( int ) ( training_algorithm = lookup_train_enum ( type ) ) == FANN_UNDEFINED )
+			return domain_error ( arg_pt, "oneof" ) ? 1 : -1;
+
+		fann_set_training_algorithm ( ann, training_algorithm );
+		return 1;
+	}
+
+	if ( !strcmp ( "activation_hidden", option ) || !strcmp ( "activation_output", option ) ) {
+
+		if ( !PL_get_chars ( arg_pt, &type, CVT_ATOM ) )
+			return type_error ( arg_pt, "atom" ) ? 1 : -1;
+		if ( ( int ) ( activation_function = lookup_activationfunc_enum ( type ) ) == FANN_UNDEFINED )
+			return domain_error ( arg_pt, "oneof" ) ? 1 : -1;
+
+		if ( !strcmp ( "activation_hidden", option ) )
+			fann_set_activation_function_hidden ( ann, activation_function );
+		else
+			fann_set_activation_function_output ( ann, activation_function );
+		return 1;
+	}
+
+	if ( !strcmp ( "steepness_hidden", option ) || !strcmp ( "steepness_output", option ) ) {
+
+		if ( !PL_FANN_GET_FANNTYPE ( arg_pt, &steepness ) )
+			return type_error ( arg_pt, PL_FANN_FANNTYPE ) ? 1 : -1;
+
+		if ( !strcmp ( "steepness_hidden", option ) )
+			fann_set_activation_steepness_hidden ( ann, steepness );
+		else
+			fann_set_activation_steepness_output ( ann, steepness );
+		return 1;
+	}
+
+	if ( !strcmp ( "learning_rate", option ) ) {
+
+		if ( !PL_get_float ( arg_pt, &value ) )
+			return type_error ( arg_pt, "float" ) ? 1 : -1;
+		fann_set_learning_rate ( ann, ( float ) value );
+		return 1;
+	}
+
+	if ( !strcmp ( "learning_momentum", option ) ) {
+
+		if ( !PL_get_float ( arg_pt, &value ) )
+			return type_error ( arg_pt, "float" ) ? 1 : -1;
+		fann_set_learning_momentum ( ann, ( float ) value );
+		return 1;
+	}
+
+	if ( !strcmp ( "rprop_increase_factor", option ) ) {
+
+		if ( !PL_get_float ( arg_pt, &value ) )
+			return type_error ( arg_pt, "float" ) ? 1 : -1;
+		fann_set_rprop_increase_factor ( ann, ( float ) value );
+		return 1;
+	}
+
+	if ( !strcmp ( "rprop_decrease_factor", option ) ) {
+
+		if ( !PL_get_float ( arg_pt, &value ) )
+			return type_error ( arg_pt, "float" ) ? 1 : -1;
+		fann_set_rprop_decrease_factor ( ann, ( float ) value );
+		return 1;
+	}
+
+	if ( !strcmp ( "rprop_delta_min", option ) ) {
+
+		if ( !PL_get_float ( arg_pt, &value ) )
+			return type_error ( arg_pt, "float" ) ? 1 : -1;
+		fann_set_rprop_delta_min ( ann, ( float ) value );
+		return 1;
+	}
+
+	if ( !strcmp ( "rprop_delta_max", option ) ) {
+
+		if ( !PL_get_float ( arg_pt, &value ) )
+			return type_error ( arg_pt, "float" ) ? 1 : -1;
+		fann_set_rprop_delta_max ( ann, ( float ) value );
+		return 1;
+	}
+
+	if ( !strcmp ( "rprop_delta_zero", option ) ) {
+
+		if ( !PL_get_float ( arg_pt, &value ) )
+			return type_error ( arg_pt, "float" ) ? 1 : -1;
+		fann_set_rprop_delta_zero ( ann, ( float ) value );
+		return 1;
+	}
+
+	if ( !strcmp ( "quickprop_decay", option ) ) {
+
+		if ( !PL_get_float ( arg_pt, &value ) )
+			return type_error ( arg_pt, "float" ) ? 1 : -1;
+		fann_set_quickprop_decay ( ann, ( float ) value );
+		return 1;
+	}
+
+	if ( !strcmp ( "quickprop_mu", option ) ) {
+
+		if ( !PL_get_float ( arg_pt, &value ) )
+			return type_error ( arg_pt, "float" ) ? 1 : -1;
+		fann_set_quickprop_mu ( ann, ( float ) value );
+		return 1;
+	}
+
+	return 0;
+}
+
+
+// The options of fann_cross_validate/5 that are not candidate options.
+
+static int is_cross_validate_option ( const char *option ) {
+
+	return !strcmp ( "threads", option ) || !strcmp ( "max_time", option ) ||
+		!strcmp ( "deadline", option ) || !strcmp ( "restore_best", option ) ||
+		!strcmp ( "checkpoint", option ) || !strcmp ( "checkpoint_every", option ) ||
+		!strcmp ( "checkpoint_interval", option );
+}
+
+
+// Creates the network of a candidate on the calling thread (weights are
+// randomised with rand ()) and applies its options. If layers_pt is 0 the
+// layers are taken from the layers/1 option, otherwise config_pt is the
+// option list of fann_cross_validate/5. Unknown options raise a domain
+// error.
+
+static int create_candidate ( term_t layers_pt, term_t config_pt, struct fann_train_data *data, candidate *cand ) {
+
+	term_t list_pt = PL_copy_term_ref ( config_pt );
+	term_t head_pt = PL_new_term_ref ();
+	term_t arg_pt = PL_new_term_ref ();
+	int cross_validate = layers_pt != 0;
+	unsigned int *layers, num_layers;
+	double connection_rate = 1.0, value;
+	atom_t name;
+	size_t arity;
+	const char *option;
+	int max_epochs;
+	int64_t seed;
+	rng *r;
+
+	cand->ann = NULL;
+	cand->max_epochs = 1000;
+	cand->desired_error = 0.0f;
+	cand->mse = 0.0f;
+	cand->shuffle = FALSE;
+
+	// Unseeded candidates follow the generator of the data.
+	if ( ( r = get_train_rng ( data ) ) != NULL )
+		rng_seed ( &cand->rng, rng_next ( r ) );
+	else
+		rng_seed_fresh ( &cand->rng, cand );
+
+	while ( PL_get_list ( list_pt, head_pt, list_pt ) ) {
+
+		if ( !PL_get_name_arity ( head_pt, &name, &arity ) || arity != 1 )
+			return type_error ( head_pt, "option" );
+
+		option = PL_atom_chars ( name );
+
+		if ( !strcmp ( "layers", option ) && !layers_pt ) {
+
+			layers_pt = PL_new_term_ref ();
+			PL_get_arg ( 1, head_pt, layers_pt );
+		}
+
+		else if ( !strcmp ( "connection_rate", option ) ) {
+
+			PL_get_arg ( 1, head_pt, arg_pt );
+			if ( !PL_get_float ( arg_pt, &connection_rate ) )
+				return type_error ( arg_pt, "float" );
+		}
+	}
+
+	if ( !PL_get_nil ( list_pt ) )
+		return type_error ( config_pt, "list" );
+	if ( !layers_pt )
+		return domain_error ( config_pt, "layers" );
+
+	if ( !get_layer_list ( layers_pt, &num_layers, &layers ) )
+		PL_fail;
+
+	if ( layers[0] != data->num_input || layers[num_layers - 1] != data->num_output )
+		return domain_error ( layers_pt, "layers_matching_data" );
+
+	if ( connection_rate < 1.0 )
+		cand->ann = fann_create_sparse_array ( ( float ) connection_rate, num_layers, layers );
+	else
+		cand->ann = fann_create_standard_array ( num_layers, layers );
+
+	if ( cand->ann == NULL )
+		return type_error ( config_pt, "fann_error" );
+
+	list_pt = PL_copy_term_ref ( config_pt );
+
+	while ( PL_get_list ( list_pt, head_pt, list_pt ) ) {
+
+		PL_get_name_arity ( head_pt, &name, &arity );
+		PL_get_arg ( 1, head_pt, arg_pt );
+		option = PL_atom_chars ( name );
+
+		switch ( apply_ann_option ( cand->ann, option, arg_pt ) ) {
+
+			case -1:
+				return FALSE;
+			case 1:
+				continue;
+		}
+
+		if ( !strcmp ( "max_epochs", option ) ) {
+
+			if ( !PL_get_integer ( arg_pt, &max_epochs ) )
+				return type_error ( arg_pt, "integer" );
+			if ( max_epochs < 1 )
+				return domain_error ( arg_pt, "positive_integer" );
+			cand->max_epochs = max_epochs;
+		}
+
+		else if ( !strcmp ( "desired_error", option ) ) {
+
+			if ( !PL_get_float ( arg_pt, &value ) )
+				return type_error ( arg_pt, "float" );
+			cand->desired_error = ( float ) value;
+		}
+
+		else if ( !strcmp ( "shuffle", option ) ) {
+
+			if ( !PL_get_bool ( arg_pt, &cand->shuffle ) )
+				return type_error ( arg_pt, "bool" );
+		}
+
+		// The initial weights are redrawn like fann_create_standard () does.
+		else if ( !strcmp ( "seed", option ) ) {
+
+			if ( !PL_get_int64 ( arg_pt, &seed ) )
+				return type_error ( arg_pt, "integer" );
+
+			rng_seed ( &cand->rng, ( uint64_t ) seed );
+			randomize_weights ( cand->ann, ( fann_type ) -0.1, ( fann_type ) 0.1, &cand->rng );
+		}
+
+		else if ( strcmp ( "connection_rate", option ) &&
+				  ( cross_validate ? !is_cross_validate_option ( option ) : strcmp ( "layers", option ) != 0 ) )
+			return domain_error ( head_pt, "option" );
+	}
+
+	PL_succeed;
+}
+
+
+// fann_train_epoch () and fann_test_data () only read the training data, so
+// all workers share the same fann_train_data.
+
+static void train_epochs ( struct fann *ann, struct fann_train_data *data, unsigned int max_epochs, float desired_error, rng *r, atomic_int *cancel ) {
+
+	unsigned int i;
+	struct fann_train_data order;
+
+	if ( r && !init_order ( &order, data ) )
+		r = NULL;
+
+	for ( i = 1; i <= max_epochs && !atomic_load ( cancel ); i++ ) {
+
+		if ( r )
+			shuffle_rows ( &order, r );
+
+		fann_train_epoch ( ann, r ? &order : data );
+
+		if ( desired_error_reached ( ann, desired_error ) )
+			break;
+	}
+
+	if ( r )
+		free_view ( &order );
+}
+
+
+typedef struct hyper_search {
+
+	candidate *candidates;
+	struct fann_train_data *train;
+	struct fann_train_data *validation;
+} hyper_search;
+
+
+static void hyper_search_task ( void *arg, unsigned int index, atomic_int *cancel ) {
+
+	hyper_search *search = arg;
+	candidate *cand = search->candidates + index;
+
+	train_epochs ( cand->ann, search->train, cand->max_epochs, cand->desired_error, cand->shuffle ? &cand->rng : NULL, cancel );
+
+	if ( !atomic_load ( cancel ) )
+		cand->mse = fann_test_data ( cand->ann, search->validation );
+}
+
+
+static int compare_candidates ( const void *a, const void *b ) {
+
+	const candidate *c1 = *( const candidate** ) a, *c2 = *( const candidate** ) b;
+
+	return c1->mse < c2->mse ? -1 : c1->mse > c2->mse ? 1 : 0;
+}
+
+#endif
+
+
+foreign_t swi_fann_hyper_search ( term_t train_pt, term_t validation_pt, term_t configs_pt, term_t options_pt, term_t results_pt ) {
+
+#ifndef FIXEDFANN
+
+	term_t list_pt, head_pt = PL_new_term_ref ();
+	term_t arg_pt = PL_new_term_ref ();
+	term_t ann_pt = PL_new_term_ref ();
+	term_t configs;
+	struct fann_train_data *train, *validation;
+	unsigned int i, count = 0, keep = 1, threads = default_threads ();
+	candidate *candidates, **order;
+	hyper_search search;
+	handle_uses uses = { { NULL }, 0 };
+	train_ctl ctl;
+	atom_t name;
+	size_t arity;
+	int value, ok = TRUE;
+
+	if ( !get_train_data ( train_pt, &train ) )
+		PL_fail;
+	if ( !get_train_data ( validation_pt, &validation ) )
+		PL_fail;
+	if ( !PL_is_variable ( results_pt ) )
+		return type_error ( results_pt, "var" );
+
+	if ( !get_train_options ( options_pt, &ctl ) )
+		PL_fail;
+
+	list_pt = PL_copy_term_ref ( options_pt );
+	while ( PL_get_list ( list_pt, head_pt, list_pt ) ) {
+
+		PL_get_name_arity ( head_pt, &name, &arity );
+		PL_get_arg ( 1, head_pt, arg_pt );
+
+		if ( !strcmp ( "threads", PL_atom_chars ( name ) ) ) {
+
+			if ( !get_threads_option ( arg_pt, &threads ) )
+				PL_fail;
+		}
+
+		else if ( !strcmp ( "keep", PL_atom_chars ( name ) ) ) {
+
+			if ( !PL_get_integer ( arg_pt, &value ) )
+				return type_error ( arg_pt, "integer" );
+			if ( value < 0 )
+				return domain_error ( arg_pt, "nonneg" );
+			keep = value;
+		}
+	}
+
+	list_pt = PL_copy_term_ref ( configs_pt );
+	while ( PL_get_list ( list_pt, head_pt, list_pt ) )
+		count++;
+	if ( !PL_get_nil ( list_pt ) )
+		return type_error ( configs_pt, "list" );
+
+	configs = PL_new_term_refs ( count );
+	candidates = calloc ( count, sizeof ( candidate ) );
+	order = malloc ( count * sizeof ( candidate* ) );
+
+	if ( count && ( candidates == NULL || order == NULL ) ) {
+
+		free ( candidates );
+		free ( order );
+		return type_error ( configs_pt, "fann_error" );
+	}
+
+	list_pt = PL_copy_term_ref ( configs_pt );
+	for ( i = 0; ok && PL_get_list ( list_pt, configs + i, list_pt ); i++ ) {
+
+		order[i] = candidates + i;
+		ok = create_candidate ( 0, configs + i, train, candidates + i );
+	}
+
+	if ( ok ) {
+
+		search.candidates = candidates;
+		search.train = train;
+		search.validation = validation;
+
+		ok = use_handle ( &uses, train_pt, &train_blob ) && use_handle ( &uses, validation_pt, &train_blob ) &&
+			 run_tasks ( count, threads, hyper_search_task, &search, &ctl );
+		unuse_handles ( &uses );
+	}
+
+	if ( ok ) {
+
+		qsort ( order, count, sizeof ( candidate* ), compare_candidates );
+
+		list_pt = PL_copy_term_ref ( results_pt );
+		for ( i = 0; ok && i < count; i++ ) {
+
+			ok = PL_unify_list ( list_pt, head_pt, list_pt );
+
+			if ( ok && i < keep ) {
+
+				// The handle owns the network from here on.
+				ok = PL_put_variable ( ann_pt ) && unify_ann ( ann_pt, order[i]->ann );
+				order[i]->ann = NULL;
+				ok = ok && PL_unify_term ( head_pt,
+					PL_FUNCTOR_CHARS, "result", 3,
+						PL_FLOAT, ( double ) order[i]->mse,
+						PL_TERM, configs + ( order[i] - candidates ),
+						PL_TERM, ann_pt );
+			}
+			else
+				ok = ok && PL_unify_term ( head_pt,
+					PL_FUNCTOR_CHARS, "result", 3,
+						PL_FLOAT, ( double ) order[i]->mse,
+						PL_TERM, configs + ( order[i] - candidates ),
+						PL_CHARS, "none" );
+		}
+
+		ok = ok && PL_unify_nil ( list_pt );
+	}
+
+	// Networks not handed to Prolog are destroyed.
+	for ( i = 0; i < count; i++ ) {
+
+		if ( !ok && candidates[i].ann )
+			destroy_ann ( candidates[i].ann );
+		else if ( ok && i >= keep )
+			destroy_ann ( order[i]->ann );
+	}
+
+	free ( candidates );
+	free ( order );
+
+	if ( ctl.stop != TRAIN_RUNNING )
+		return train_ctl_result ( &ctl );
+
+	return ok;
+
+#else
+
+	return type_error ( train_pt, "not available fixedfann" );
+
+#endif
+}
+
+
+                        /* Cross-validation */
+
+
+#ifndef FIXEDFANN
+
+// Folds are views on the rows of the data (see Training data views) that
+// live only for the call, so they are not registered. Fold k tests on the
+// rows [k * n / K, (k + 1) * n / K) and trains on the others.
+
+typedef struct fold {
+
+	candidate cand;
+	struct fann_train_data train;
+	struct fann_train_data test;
+} fold;
+
+
+static int create_fold_views ( struct fann_train_data *data, unsigned int k, unsigned int folds, fold *f ) {
+
+	unsigned int first = ( unsigned int ) ( ( size_t ) data->num_data * k / folds );
+	unsigned int last = ( unsigned int ) ( ( size_t ) data->num_data * ( k + 1 ) / folds );
+	unsigned int i, j = 0;
+
+	init_view ( &f->test, data, last - first );
+	init_view ( &f->train, data, data->num_data - ( last - first ) );
+
+	if ( !f->test.input || !f->test.output || !f->train.input || !f->train.output )
+		return FALSE;
+
+	memcpy ( f->test.input, data->input + first, ( last - first ) * sizeof ( fann_type* ) );
+	memcpy ( f->test.output, data->output + first, ( last - first ) * sizeof ( fann_type* ) );
+
+	for ( i = 0; i < data->num_data; i++ ) {
+
+		if ( i >= first && i < last )
+			continue;
+
+		f->train.input[j] = data->input[i];
+		f->train.output[j++] = data->output[i];
+	}
+
+	return TRUE;
+}
+
+
+static void cross_validate_task ( void *arg, unsigned int index, atomic_int *cancel ) {
+
+	fold *f = ( fold* ) arg + index;
+
+	train_epochs ( f->cand.ann, &f->train, f->cand.max_epochs, f->cand.desired_error, f->cand.shuffle ? &f->cand.rng : NULL, cancel );
+
+	if ( !atomic_load ( cancel ) )
+		f->cand.mse = fann_test_data ( f->cand.ann, &f->test );
+}
+
+#endif
+
+
+foreign_t swi_fann_cross_validate ( term_t layers_pt, term_t data_pt, term_t folds_pt, term_t options_pt, term_t scores_pt ) {
+
+#ifndef FIXEDFANN
+
+	term_t list_pt, head_pt = PL_new_term_ref ();
+	term_t arg_pt = PL_new_term_ref ();
+	struct fann_train_data *data;
+	unsigned int i, threads = default_threads ();
+	int folds, ok = TRUE;
+	fold *f;
+	handle_uses uses = { { NULL }, 0 };
+	train_ctl ctl;
+	atom_t name;
+	size_t arity;
+
+	if ( !get_train_data ( data_pt, &data ) )
+		PL_fail;
+	if ( !PL_get_integer ( folds_pt, &folds ) )
+		return type_error ( folds_pt, "integer" );
+	if ( !PL_is_variable ( scores_pt ) )
+		return type_error ( scores_pt, "var" );
+
+	if ( folds < 2 || ( unsigned int ) folds > data->num_data )
+		return domain_error ( folds_pt, "fold_count" );
+
+	if ( !get_train_options ( options_pt, &ctl ) )
+		PL_fail;
+
+	list_pt = PL_copy_term_ref ( options_pt );
+	while ( PL_get_list ( list_pt, head_pt, list_pt ) ) {
+
+		PL_get_name_arity ( head_pt, &name, &arity );
+		PL_get_arg ( 1, head_pt, arg_pt );
+
+		if ( !strcmp ( "threads", PL_atom_chars ( name ) ) && !get_threads_option ( arg_pt, &threads ) )
+			PL_fail;
+	}
+
+	if ( ( f = calloc ( folds, sizeof ( fold ) ) ) == NULL )
+		return type_error ( data_pt, "fann_error" );
+
+	// All networks are created here, so the weights only depend on rand ().
+	for ( i = 0; ok && i < ( unsigned int ) folds; i++ ) {
+
+		ok = create_candidate ( layers_pt, options_pt, data, &f[i].cand );
+
+		if ( ok && !create_fold_views ( data, i, folds, f + i ) )
+			ok = type_error ( data_pt, "fann_error" );
+	}
+
+	if ( ok ) {
+
+		ok = use_handle ( &uses, data_pt, &train_blob ) && run_tasks ( folds, threads, cross_validate_task, f, &ctl );
+		unuse_handles ( &uses );
+	}
+
+	if ( ok ) {
+
+		list_pt = PL_copy_term_ref ( scores_pt );
+		for ( i = 0; ok && i < ( unsigned int ) folds; i++ )
+			ok = PL_unify_list ( list_pt, head_pt, list_pt ) &&
+				PL_unify_float ( head_pt, f[i].cand.mse );
+
+		ok = ok && PL_unify_nil ( list_pt );
+	}
+
+	for ( i = 0; i < ( unsigned int ) folds; i++ ) {
+
+		if ( f[i].cand.ann )
+			destroy_ann ( f[i].cand.ann );
+		free_view ( &f[i].train );
+		free_view ( &f[i].test );
+	}
+
+	free ( f );
+
+	if ( ctl.stop != TRAIN_RUNNING )
+		return train_ctl_result ( &ctl );
+
+	return ok;
+
+#else
+
+	return type_error ( data_pt, "not available fixedfann" );
+
+#endif
+}
+
+
+foreign_t swi_fann_train_on_file ( term_t ann_pt, term_t file_pt, term_t max_epochs_pt, term_t epochs_between_reports_pt, term_t desired_error_pt ) {
+
+#ifndef FIXEDFANN
+
+	struct fann *ann;
+	char *file;
+	unsigned int max_epochs, epochs_between_reports;
+	double desired_error;
+	struct fann_train_data *data;
+	train_ctl ctl;
+
+	if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
+
+	if ( !PL_get_file_name ( file_pt, &file, PL_FILE_ABSOLUTE || PL_FILE_SEARCH || PL_FILE_EXIST ) )
+		return type_error ( file_pt, "file" );
+
+    if ( !PL_get_integer ( max_epochs_pt, &max_epochs ) )
+		return type_error ( max_epochs_pt, "integer" );
+	if ( max_epochs < 1 )
+		return domain_error ( max_epochs_pt, "positive_integer" );
+
+    if ( !PL_get_integer ( epochs_between_reports_pt, &epochs_between_reports ) )
+		return type_error ( epochs_between_reports_pt, "integer" );
+	if ( epochs_between_reports < 0 )
+		return domain_error ( epochs_between_reports_pt, "nonneg" );
+
+    if ( !PL_get_float ( desired_error_pt, &desired_error ) )
+		return type_error ( desired_error_pt, "float" );
+
+	memset ( &ctl, 0, sizeof ( ctl ) );
+	ctl.restore_best = TRUE;
+
+	if ( ( data = fann_read_train_from_file ( file ) ) == NULL )
+		PL_succeed; // As fann_train_on_file (), the error is in the error log.
+
+	train_on_data_ctl ( ann, data, max_epochs, epochs_between_reports, (float) desired_error, &ctl );
+
+	fann_destroy_train ( data );
+
+	return train_ctl_result ( &ctl );
+
+#else
+
+	return type_error ( ann_pt, "not available fixedfann" );
+
+#endif
+
+}
+
+
+foreign_t swi_fann_set_schedule ( term_t ann_pt, term_t parameter_pt, term_t schedule_pt ) {
+
+#ifndef FIXEDFANN
+
+	struct fann *ann;
+	ann_info *info;
+	schedule sc;
+	char *parameter;
+	int p;
+
+	if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
+	if ( !PL_get_chars ( parameter_pt, &parameter, CVT_ATOM ) )
+		return type_error ( parameter_pt, "atom" );
+
+	if ( !strcmp ( "learning_rate", parameter ) )
+		p = SCHEDULE_LEARNING_RATE;
+	else if ( !strcmp ( "learning_momentum", parameter ) )
+		p = SCHEDULE_LEARNING_MOMENTUM;
+	else
+		return domain_error ( parameter_pt, "schedule_parameter" );
+
+	if ( !get_schedule ( schedule_pt, &sc ) )
+		PL_fail;
+
+	if ( ( info = get_ann_info ( ann ) ) == NULL )
+		return type_error ( ann_pt, "fann_error" );
+
+	sc.base = p == SCHEDULE_LEARNING_RATE ? fann_get_learning_rate ( ann ) : fann_get_learning_momentum ( ann );
+	sc.current = sc.base;
+	info->schedules[p] = sc;
+
+	PL_succeed;
+
+#else
+
+	return type_error ( ann_pt, "not available fixedfann" );
+
+#endif
+}
+
+
+foreign_t swi_fann_train_epoch ( term_t ann_pt, term_t data_pt ) {
+
+#ifndef FIXEDFANN
+
+	struct fann *ann;
+	struct fann_train_data *data;
+	double MSE;
+
+	if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
+	if ( !get_train_data ( data_pt, &data ) )
+		PL_fail;
+
+	train_epoch_scheduled ( ann, data );
+
+	PL_succeed;
+
+#else
+
+	return type_error ( ann_pt, "not available fixedfann" );
+
+#endif
+
+}
+
+
+foreign_t swi_fann_test_data  ( term_t ann_pt, term_t data_pt, term_t MSE_pt ) {
+
+	struct fann *ann;
+	struct fann_train_data *data;
+
+	if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
+	if ( !get_train_data ( data_pt, &data ) )
+		PL_fail;
+	if ( !PL_is_variable ( MSE_pt ) )
+		return type_error ( MSE_pt, "var" );
+
+	return PL_unify_float ( MSE_pt, fann_test_data ( ann, data ) );
+}
+
+
+                        /* Text training data */
+
+
+// fann_read_train_from_file/2,3 map the file and split the text after the
+// header line into chunks ending at line ends, parsed as tasks. A first pass
+// counts the values of every chunk, which gives the index of the first
+// value of each, and a second pass parses the values straight into their
+// rows. As with fscanf () in the library, only the order of the values
+// matters, not how they are split over lines, and values after the last
+// row are ignored. Numbers are read independent of the locale.
+
+#define TEXT_CHUNK_SIZE ( 1 << 20 )
+#define TEXT_TOKEN_MAX 128
+
+typedef struct text_chunk {
+
+	const char *begin, *end;
+	size_t first;			// Index of the first value of the chunk.
+	size_t count;
+	int ok;
+} text_chunk;
+
+typedef struct text_parse {
+
+	text_chunk *chunks;
+	struct fann_train_data *data;
+	size_t values;			// Values of all rows.
+	int pass;
+	locale_t c_locale;
+} text_parse;
+
+static int is_text_space ( char c ) {
+
+	return c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+
+// Reads a decimal integer taking all of [p, end).
+
+static int parse_text_integer ( const char *p, const char *end, long long max, long long *value ) {
+
+	int negative = FALSE;
+	long long v = 0;
+
+	if ( p < end && ( *p == '-' || *p == '+' ) )
+		negative = *p++ == '-';
+
+	if ( p == end )
+		return FALSE;
+
+	for ( ; p < end; p++ ) {
+
+		if ( *p < '0' || *p > '9' || v > ( max - ( *p - '0' ) ) / 10 )
+			return FALSE;
+		v = v * 10 + ( *p - '0' );
+	}
+
+	*value = negative ? -v : v;
+
+	return TRUE;
+}
+
+
+#ifdef FIXEDFANN
+
+static int parse_text_value ( const char *p, const char *end, fann_type *value, locale_t c_locale ) {
+
+	long long v;
+
+	if ( !parse_text_integer ( p, end, INT_MAX, &v ) )
+		return FALSE;
+
+	*value = ( fann_type ) v;
+
+	return TRUE;
+}
+
+#else
+
+// Values of few digits are converted exactly as by strtod () with one
+// multiplication or division, others are left to strtod () in the C locale.
+// The float engine does the arithmetic in float, which is exact for up to
+// 2^24 and 10^10.
+
+#ifdef DOUBLEFANN
+#define TEXT_EXACT_MANTISSA ( ( uint64_t ) 1 << 53 )
+#define TEXT_EXACT_EXPONENT 22
+#else
+#define TEXT_EXACT_MANTISSA ( ( uint64_t ) 1 << 24 )
+#define TEXT_EXACT_EXPONENT 10
+#endif
+
+static const double powers_of_ten[] = {
+
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+static int parse_text_value ( const char *p, const char *end, fann_type *value, locale_t c_locale ) {
+
+	const char *q = p;
+	char buf[TEXT_TOKEN_MAX], *stop;
+	uint64_t mantissa = 0;
+	int negative = FALSE, digits = 0, exponent = 0, e = 0, e_negative = FALSE;
+	locale_t old = ( locale_t ) 0;
+
+	if ( q < end && ( *q == '-' || *q == '+' ) )
+		negative = *q++ == '-';
+
+	// Digits past 10^19 leave mantissa above the limit, so no fast path.
+	for ( ; q < end && *q >= '0' && *q <= '9'; q++, digits++ )
+		if ( mantissa <= TEXT_EXACT_MANTISSA )
+			mantissa = mantissa * 10 + ( *q - '0' );
+
+	if ( q < end && *q == '.' )
+		for ( q++; q < end && *q >= '0' && *q <= '9'; q++, digits++ )
+			if ( mantissa <= TEXT_EXACT_MANTISSA ) {
+
+				mantissa = mantissa * 10 + ( *q - '0' );
+				exponent--;
+			}
+
+	if ( digits && q < end && ( *q == 'e' || *q == 'E' ) ) {
+
+		q++;
+		if ( q < end && ( *q == '-' || *q == '+' ) )
+			e_negative = *q++ == '-';
+		if ( q == end || *q < '0' || *q > '9' )
+			q = NULL;
+		for ( ; q && q < end && *q >= '0' && *q <= '9'; q++ )
+			if ( e < 10000 )
+				e = e * 10 + ( *q - '0' );
+		exponent += e_negative ? -e : e;
+	}
+
+	if ( q == end && digits && mantissa <= TEXT_EXACT_MANTISSA &&
+		exponent >= -TEXT_EXACT_EXPONENT && exponent <= TEXT_EXACT_EXPONENT ) {
+
+#ifdef DOUBLEFANN
+		double v = exponent < 0 ? ( double ) mantissa / powers_of_ten[-exponent] : ( double ) mantissa * powers_of_ten[exponent];
+		*value = negative ? -v : v;
+#else
+		float f = exponent < 0 ? ( float ) mantissa / ( float ) powers_of_ten[-exponent] : ( float ) mantissa * ( float ) powers_of_ten[exponent];
+		*value = negative ? -f : f;
+#endif
+		return TRUE;
+	}
+
+	// Too many digits, a large exponent, inf, nan or hexadecimal.
+	if ( end - p >= TEXT_TOKEN_MAX )
+		return FALSE;
+
+	memcpy ( buf, p, end - p );
+	buf[end - p] = '\0';
+
+	if ( c_locale )
+		old = uselocale ( c_locale );
+#ifdef DOUBLEFANN
+	*value = strtod ( buf, &stop );
+#else
+	*value = strtof ( buf, &stop );
+#endif
+	if ( c_locale )
+		uselocale ( old );
+
+	return stop == buf + ( end - p );
+}
+
+#endif
+
+
+static void text_parse_task ( void *arg, unsigned int index, atomic_int *cancel ) {
+
+	text_parse *parse = arg;
+	text_chunk *chunk = parse->chunks + index;
+	struct fann_train_data *data = parse->data;
+	unsigned int row, column, width = data->num_input + data->num_output;
+	const char *p = chunk->begin, *token;
+	size_t k = chunk->first;
+
+	if ( parse->pass && k < parse->values ) {
+
+		row = k / width;
+		column = k % width;
+	}
+
+	for ( ;; ) {
+
+		while ( p < chunk->end && is_text_space ( *p ) )
+			p++;
+		if ( p == chunk->end )
+			break;
+
+		for ( token = p; p < chunk->end && !is_text_space ( *p ); p++ )
+			;
+
+		if ( !parse->pass ) {
+
+			chunk->count++;
+			continue;
+		}
+
+		if ( k++ >= parse->values || atomic_load ( cancel ) )
+			break;
+
+		if ( !parse_text_value ( token, p, column < data->num_input ?
+				data->input[row] + column : data->output[row] + column - data->num_input, parse->c_locale ) )
+			return;
+
+		if ( ++column == width ) {
+
+			column = 0;
+			row++;
+		}
+	}
+
+	chunk->ok = TRUE;
+}
+
+
+// Reads the header line "num_data num_input num_output", sets *body past it.
+
+static int parse_text_header ( const char *p, const char *end, unsigned int *counts, const char **body ) {
+
+	const char *token;
+	long long v;
+	int i;
+
+	for ( i = 0; i < 3; i++ ) {
+
+		while ( p < end && *p != '\n' && is_text_space ( *p ) )
+			p++;
+		for ( token = p; p < end && !is_text_space ( *p ); p++ )
+			;
+
+		if ( !parse_text_integer ( token, p, UINT_MAX, &v ) || v < 0 )
+			return FALSE;
+
+		counts[i] = ( unsigned int ) v;
+	}
+
+	*body = p;
+
+	return counts[1] && counts[2];
+}
+
+
+static foreign_t read_train_text ( term_t file_pt, term_t data_pt, unsigned int threads ) {
+
+	struct fann_train_data *data;
+	text_parse parse;
+	train_ctl ctl;
+	unsigned int counts[3], chunks, i;
+	const char *map, *body, *p;
+	struct stat st;
+	size_t first;
+	char *file;
+	int fd, ok;
+
+	if ( !PL_get_file_name ( file_pt, &file, PL_FILE_ABSOLUTE ) )
+		return type_error ( file_pt, "file" );
+	if ( !PL_is_variable ( data_pt ) )
+		return type_error ( data_pt, "var" );
+
+	if ( ( fd = open ( file, O_RDONLY ) ) < 0 )
+		return type_error ( file_pt, "file" );
+
+	if ( fstat ( fd, &st ) || st.st_size == 0 ||
+		( map = mmap ( NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0 ) ) == MAP_FAILED ) {
+
+		close ( fd );
+		return domain_error ( file_pt, "fann_train_file" );
+	}
+
+	close ( fd );
+
+	if ( !parse_text_header ( map, map + st.st_size, counts, &body ) ) {
+
+		munmap ( ( void* ) map, st.st_size );
+		return domain_error ( file_pt, "fann_train_file" );
+	}
+
+	chunks = ( unsigned int ) ( ( map + st.st_size - body ) / TEXT_CHUNK_SIZE ) + 1;
+	memset ( &parse, 0, sizeof ( parse ) );
+	memset ( &ctl, 0, sizeof ( ctl ) );
+
+	if ( ( parse.chunks = calloc ( chunks, sizeof ( text_chunk ) ) ) == NULL ||
+		( data = create_owned_train_data ( counts[0], counts[1], counts[2] ) ) == NULL ) {
+
+		free ( parse.chunks );
+		munmap ( ( void* ) map, st.st_size );
+		return type_error ( file_pt, "fann_error" );
+	}
+
+	// Chunks end after the first line end past their share of the text.
+	for ( i = 0, p = body; i < chunks; i++ ) {
+
+		parse.chunks[i].begin = p;
+		p = i + 1 < chunks ? body + ( size_t ) ( map + st.st_size - body ) / chunks * ( i + 1 ) : map + st.st_size;
+		if ( p < parse.chunks[i].begin )
+			p = parse.chunks[i].begin;
+		while ( p < map + st.st_size && p > body && p[-1] != '\n' )
+			p++;
+		parse.chunks[i].end = p;
+	}
+
+	parse.data = data;
+	parse.values = ( size_t ) counts[0] * ( counts[1] + counts[2] );
+	parse.c_locale = newlocale ( LC_NUMERIC_MASK, "C", ( locale_t ) 0 );
+
+	ok = run_tasks ( chunks, threads, text_parse_task, &parse, &ctl );
+
+	for ( i = 0, first = 0; ok && i < chunks; i++ ) {
+
+		parse.chunks[i].first = first;
+		parse.chunks[i].ok = FALSE;
+		first += parse.chunks[i].count;
+	}
+
+	if ( ok && first < parse.values )
+		ok = -1;
+
+	if ( ok > 0 ) {
+
+		parse.pass = 1;
+		ok = run_tasks ( chunks, threads, text_parse_task, &parse, &ctl );
+		for ( i = 0; ok && i < chunks; i++ )
+			if ( !parse.chunks[i].ok )
+				ok = -1;
+	}
+
+	if ( parse.c_locale )
+		freelocale ( parse.c_locale );
+	free ( parse.chunks );
+	munmap ( ( void* ) map, st.st_size );
+
+	if ( ok <= 0 ) {
+
+		fann_destroy_train ( data );
+		if ( ok < 0 )
+			return domain_error ( file_pt, "fann_train_file" );
+		return train_ctl_result ( &ctl );
+	}
+
+	return unify_train_data ( data_pt, data );
+}
+
+
+foreign_t swi_fann_read_train_from_file ( term_t file_pt, term_t data_pt ) {
+
+	return read_train_text ( file_pt, data_pt, default_threads ( ) );
+}
+
+
+foreign_t swi_fann_read_train_from_file_3 ( term_t file_pt, term_t data_pt, term_t options_pt ) {
+
+	term_t head_pt = PL_new_term_ref ();
+	term_t arg_pt = PL_new_term_ref ();
+	term_t list_pt = PL_copy_term_ref ( options_pt );
+	unsigned int threads = default_threads ( );
+	atom_t name;
+	size_t arity;
+
+	while ( PL_get_list ( list_pt, head_pt, list_pt ) ) {
+
+		if ( !PL_get_name_arity ( head_pt, &name, &arity ) || arity != 1 )
+			return type_error ( head_pt, "option" );
+
+		PL_get_arg ( 1, head_pt, arg_pt );
+
+		if ( !strcmp ( PL_atom_chars ( name ), "threads" ) ) {
+
+			if ( !get_threads_option ( arg_pt, &threads ) )
+				PL_fail;
+		}
+		else
+			return domain_error ( head_pt, "read_train_option" );
+	}
+
+	if ( !PL_get_nil ( list_pt ) )
+		return type_error ( options_pt, "list" );
+
+	return read_train_text ( file_pt, data_pt, threads );
+}
+
+                        /* CSV training data */
+
+
+// fann_read_train_csv/3 reads the whole source into memory, a file by
+// mapping it, and makes two passes over the records: one counting them and
+// one parsing the selected columns straight into the rows. Fields may be
+// quoted, quoted fields may hold separators and line ends. An empty field is
+// a missing value.
+
+enum csv_missing {
+
+	CSV_MISSING_ERROR = 0,
+	CSV_MISSING_SKIP,
+	CSV_MISSING_VALUE,
+	CSV_MISSING_MEAN
+};
+
+typedef struct csv_opts {
+
+	int separator;
+	int header;
+	enum csv_missing missing;
+	fann_type missing_value;
+	term_t inputs_pt;		// 0 for all columns but the last one.
+	term_t outputs_pt;		// 0 for the last column.
+} csv_opts;
+
+typedef struct csv_field {
+
+	const char *begin, *end;
+} csv_field;
+
+
+static int get_csv_options ( term_t options_pt, csv_opts *opts ) {
+
+	term_t head_pt = PL_new_term_ref ();
+	term_t arg_pt = PL_new_term_ref ();
+	term_t list_pt = PL_copy_term_ref ( options_pt );
+	atom_t name;
+	size_t arity, len;
+	char *s;
+
+	memset ( opts, 0, sizeof ( *opts ) );
+	opts->separator = ',';
+
+	while ( PL_get_list ( list_pt, head_pt, list_pt ) ) {
+
+		if ( !PL_get_name_arity ( head_pt, &name, &arity ) || arity != 1 )
+			return type_error ( head_pt, "option" );
+
+		PL_get_arg ( 1, head_pt, arg_pt );
+		s = ( char* ) PL_atom_chars ( name );
+
+		if ( !strcmp ( s, "inputs" ) )
+			opts->inputs_pt = PL_copy_term_ref ( arg_pt );
+		else if ( !strcmp ( s, "outputs" ) )
+			opts->outputs_pt = PL_copy_term_ref ( arg_pt );
+		else if ( !strcmp ( s, "header" ) ) {
+
+			if ( !PL_get_bool ( arg_pt, &opts->header ) )
+				return type_error ( arg_pt, "bool" );
+		}
+		else if ( !strcmp ( s, "separator" ) ) {
+
+			if ( PL_get_nchars ( arg_pt, &len, &s, CVT_ATOM ) && len == 1 )
+				opts->separator = ( unsigned char ) *s;
+			else if ( !PL_get_integer ( arg_pt, &opts->separator ) || opts->separator < 1 || opts->separator > 127 )
+				return type_error ( arg_pt, "char" );
+			if ( opts->separator == '"' || opts->separator == '\n' || opts->separator == '\r' )
+				return domain_error ( arg_pt, "separator" );
+		}
+		else if ( !strcmp ( s, "missing" ) ) {
+
+			if ( PL_get_chars ( arg_pt, &s, CVT_ATOM ) && !strcmp ( s, "error" ) )
+				opts->missing = CSV_MISSING_ERROR;
+			else if ( PL_get_chars ( arg_pt, &s, CVT_ATOM ) && !strcmp ( s, "skip" ) )
+				opts->missing = CSV_MISSING_SKIP;
+			else if ( PL_get_chars ( arg_pt, &s, CVT_ATOM ) && !strcmp ( s, "mean" ) )
+				opts->missing = CSV_MISSING_MEAN;
+			else if ( PL_FANN_GET_FANNTYPE(arg_pt,&opts->missing_value) )
+				opts->missing = CSV_MISSING_VALUE;
+			else
+				return domain_error ( arg_pt, "missing_policy" );
+		}
+		else
+			return domain_error ( head_pt, "csv_option" );
+	}
+
+	if ( !PL_get_nil ( list_pt ) )
+		return type_error ( options_pt, "list" );
+
+	PL_succeed;
+}
+
+
+// Reads the next field from *p, moves *p past it and its separator and sets
+// *last if the field ends the record.
+
+static void csv_next_field ( const char **p, const char *end, int separator, csv_field *field, int *last ) {
+
+	const char *q = *p;
+
+	if ( q < end && *q == '"' ) {
+
+		field->begin = ++q;
+		for ( ; q < end; q++ )
+			if ( *q == '"' ) {
+
+				if ( q + 1 < end && q[1] == '"' )
+					q++;
+				else
+					break;
+			}
+		field->end = q;
+		if ( q < end )
+			q++;
+		while ( q < end && *q != separator && *q != '\n' )
+			q++;
+	}
+	else {
+
+		for ( field->begin = q; q < end && *q != separator && *q != '\n'; q++ )
+			;
+		field->end = q;
+	}
+
+	// Trim blanks and the \r of \r\n.
+	while ( field->begin < field->end && ( *field->begin == ' ' || *field->begin == '\t' ) && separator != '\t' )
+		field->begin++;
+	while ( field->end > field->begin && ( field->end[-1] == '\r' || ( separator != '\t' && ( field->end[-1] == ' ' || field->end[-1] == '\t' ) ) ) )
+		field->end--;
+
+	*last = q >= end || *q == '\n';
+	*p = q < end ? q + 1 : q;
+}
+
+
+// Reads the fields of the record at *p into fields, up to max of them, and
+// returns their number, 0 for an empty line.
+
+static unsigned int csv_next_record ( const char **p, const char *end, int separator, csv_field *fields, unsigned int max ) {
+
+	unsigned int n = 0;
+	csv_field field;
+	int last = FALSE;
+
+	if ( *p < end && ( **p == '\n' || ( **p == '\r' && *p + 1 < end && ( *p )[1] == '\n' ) ) ) {
+
+		*p += **p == '\r' ? 2 : 1;
+		return 0;
+	}
+
+	while ( !last ) {
+
+		csv_next_field ( p, end, separator, &field, &last );
+		if ( fields && n < max )
+			fields[n] = field;
+		n++;
+	}
+
+	return n;
+}
+
+
+// Sets columns[0..count) from the list cols_pt of 1-based column numbers or,
+// with a header, column names.
+
+static int get_csv_columns ( term_t cols_pt, csv_field *names, unsigned int num_columns, unsigned int *columns, unsigned int *count ) {
+
+	term_t list_pt = PL_copy_term_ref ( cols_pt );
+	term_t col_pt = PL_new_term_ref ();
+	unsigned int n = 0, i;
+	size_t len;
+	char *name;
+	int col;
+
+	while ( PL_get_list ( list_pt, col_pt, list_pt ) ) {
+
+		if ( n == num_columns )
+			return domain_error ( cols_pt, "csv_columns" );
+
+		if ( PL_get_integer ( col_pt, &col ) ) {
+
+			if ( col < 1 || ( unsigned int ) col > num_columns )
+				return domain_error ( col_pt, "csv_column" );
+			columns[n++] = col - 1;
+		}
+		else if ( names && PL_get_nchars ( col_pt, &len, &name, CVT_ATOM|CVT_STRING|REP_UTF8 ) ) {
+
+			for ( i = 0; i < num_columns; i++ )
+				if ( ( size_t ) ( names[i].end - names[i].begin ) == len && !memcmp ( names[i].begin, name, len ) )
+					break;
+			if ( i == num_columns )
+				return domain_error ( col_pt, "csv_column" );
+			columns[n++] = i;
+		}
+		else
+			return type_error ( col_pt, names ? "csv_column" : "integer" );
+	}
+
+	if ( !PL_get_nil ( list_pt ) )
+		return type_error ( cols_pt, "list" );
+	if ( !n )
+		return domain_error ( cols_pt, "non_empty_list" );
+
+	*count = n;
+
+	PL_succeed;
+}
+
+
+// Raises a domain error for the text of field.
+
+// The fixed engine reads values already in fixed point, as integers, as
+// fann_read_train_from_file () does.
+
+#ifdef FIXEDFANN
+#define CSV_VALUE_TYPE "integer"
+#else
+#define CSV_VALUE_TYPE "number"
+#endif
+
+static int csv_field_error ( csv_field *field, const char *expected ) {
+
+	term_t field_pt = PL_new_term_ref ();
+
+	if ( !PL_put_atom_nchars ( field_pt, field->end - field->begin, field->begin ) )
+		PL_fail;
+
+	return domain_error ( field_pt, expected );
+}
+
+
+// Replaces the missing values, flagged in missing, by the mean of the values
+// present in their column.
+
+static void csv_fill_means ( struct fann_train_data *data, unsigned char *missing ) {
+
+	unsigned int i, j, n, width = data->num_input + data->num_output;
+	fann_type *v;
+	double sum;
+
+	for ( j = 0; j < width; j++ ) {
+
+		for ( i = 0, n = 0, sum = 0.0; i < data->num_data; i++ )
+			if ( !missing[( size_t ) i * width + j] ) {
+
+				sum += j < data->num_input ? data->input[i][j] : data->output[i][j - data->num_input];
+				n++;
+			}
+
+		for ( i = 0; i < data->num_data; i++ )
+			if ( missing[( size_t ) i * width + j] ) {
+
+				v = j < data->num_input ? data->input[i] + j : data->output[i] + j - data->num_input;
+#ifdef FIXEDFANN
+				*v = n ? ( fann_type ) lround ( sum / n ) : 0;
+#else
+				*v = n ? ( fann_type ) ( sum / n ) : 0;
+#endif
+			}
+	}
+}
+
+
+static foreign_t read_train_csv ( const char *text, size_t size, term_t source_pt, csv_opts *opts, term_t data_pt ) {
+
+	const char *p, *end = text + size, *body;
+	csv_field *fields = NULL, *names = NULL;
+	unsigned int *columns = NULL, num_columns = 0, records = 0, n, j, num_input, num_output, row;
+	struct fann_train_data *data = NULL;
+	unsigned char *missing = NULL;
+	fann_type *v;
+	foreign_t rc = FALSE;
+	locale_t c_locale = ( locale_t ) 0;
+
+	if ( size >= 3 && !memcmp ( text, "\xef\xbb\xbf", 3 ) ) {
+
+		text += 3;
+		end = text + ( size -= 3 );
+	}
+
+	// The first record gives the number of columns.
+	for ( p = text; p < end && !( num_columns = csv_next_record ( &p, end, opts->separator, NULL, 0 ) ); )
+		;
+
+	if ( !num_columns )
+		return domain_error ( source_pt, "csv_records" );
+
+	if ( ( fields = malloc ( num_columns * sizeof ( csv_field ) ) ) == NULL ||
+		( columns = malloc ( 2 * num_columns * sizeof ( unsigned int ) ) ) == NULL ) {
+
+		rc = type_error ( source_pt, "fann_error" );
+		goto out;
+	}
+
+	for ( p = text; csv_next_record ( &p, end, opts->separator, fields, num_columns ) == 0 && p < end; )
+		;
+
+	if ( opts->header ) {
+
+		names = fields;
+		if ( ( fields = malloc ( num_columns * sizeof ( csv_field ) ) ) == NULL ) {
+
+			rc = type_error ( source_pt, "fann_error" );
+			goto out;
+		}
+		body = p;
+	}
+	else
+		body = text;
+
+	if ( opts->inputs_pt ) {
+
+		if ( !get_csv_columns ( opts->inputs_pt, names, num_columns, columns, &num_input ) )
+			goto out;
+	}
+	else
+		for ( num_input = 0; num_input + 1 < num_columns; num_input++ )
+			columns[num_input] = num_input;
+
+	if ( opts->outputs_pt ) {
+
+		if ( !get_csv_columns ( opts->outputs_pt, names, num_columns, columns + num_input, &num_output ) )
+			goto out;
+	}
+	else {
+
+		columns[num_input] = num_columns - 1;
+		num_output = 1;
+	}
+
+	if ( !num_input ) {
+
+		rc = domain_error ( source_pt, "csv_columns" );
+		goto out;
+	}
+
+	for ( p = body; p < end; )
+		if ( csv_next_record ( &p, end, opts->separator, NULL, 0 ) )
+			records++;
+
+	if ( ( data = create_owned_train_data ( records, num_input, num_output ) ) == NULL ||
+		( opts->missing == CSV_MISSING_MEAN &&
+		( missing = calloc ( ( size_t ) ( records ? records : 1 ) * ( num_input + num_output ), 1 ) ) == NULL ) ) {
+
+		rc = type_error ( source_pt, "fann_error" );
+		goto out;
+	}
+
+	// Values strtod () has to parse must not depend on the process locale.
+	if ( ( c_locale = newlocale ( LC_NUMERIC_MASK, "C", ( locale_t ) 0 ) ) == ( locale_t ) 0 ) {
+
+		rc = type_error ( source_pt, "fann_error" );
+		goto out;
+	}
+
+	for ( p = body, row = 0; p < end; ) {
+
+		if ( ( n = csv_next_record ( &p, end, opts->separator, fields, num_columns ) ) == 0 )
+			continue;
+		if ( n != num_columns ) {
+
+			rc = domain_error ( source_pt, "csv_record_length" );
+			goto out;
+		}
+
+		for ( j = 0; j < num_input + num_output; j++ ) {
+
+			csv_field *field = fields + columns[j];
+
+			v = j < num_input ? data->input[row] + j : data->output[row] + j - num_input;
+
+			if ( field->begin < field->end ) {
+
+				if ( !parse_text_value ( field->begin, field->end, v, c_locale ) ) {
+
+					rc = csv_field_error ( field, CSV_VALUE_TYPE );
+					goto out;
+				}
+			}
+			else if ( opts->missing == CSV_MISSING_ERROR ) {
+
+				rc = domain_error ( source_pt, "csv_missing_value" );
+				goto out;
+			}
+			else if ( opts->missing == CSV_MISSING_SKIP )
+				break;
+			else if ( opts->missing == CSV_MISSING_VALUE )
+				*v = opts->missing_value;
+			else
+				missing[( size_t ) row * ( num_input + num_output ) + j] = 1;
+		}
+
+		if ( j == num_input + num_output )
+			row++;
+	}
+
+	// Skipped rows leave unused room at the end of the blocks.
+	data->num_data = row;
+
+	if ( missing )
+		csv_fill_means ( data, missing );
+
+	rc = unify_train_data ( data_pt, data );
+	data = NULL;
+
+out:
+	if ( c_locale )
+		freelocale ( c_locale );
+	if ( data )
+		fann_destroy_train ( data );
+	free ( missing );
+	free ( columns );
+	free ( fields );
+	free ( names );
+
+	return rc;
+}
+
+
+foreign_t swi_fann_read_train_csv ( term_t source_pt, term_t options_pt, term_t data_pt ) {
+
+	PL_blob_t *type;
+	IOSTREAM *in;
+	csv_opts opts;
+	struct stat st;
+	char *file, *buf = NULL, *grown;
+	size_t size = 0, allocated = 0, got;
+	void *map;
+	foreign_t rc;
+	int fd;
+
+	if ( !get_csv_options ( options_pt, &opts ) )
+		PL_fail;
+	if ( !PL_is_variable ( data_pt ) )
+		return type_error ( data_pt, "var" );
+
+	// A stream handle is read to its end, anything else names a file.
+	if ( PL_is_blob ( source_pt, &type ) && !( type->flags & PL_BLOB_TEXT ) ) {
+
+		if ( !PL_get_stream ( source_pt, &in, SIO_INPUT ) )
+			PL_fail;
+
+		do {
+
+			if ( allocated - size < 65536 ) {
+
+				allocated = allocated ? 2 * allocated : 1 << 20;
+				if ( ( grown = realloc ( buf, allocated ) ) == NULL ) {
+
+					free ( buf );
+					PL_release_stream ( in );
+					return type_error ( source_pt, "fann_error" );
+				}
+				buf = grown;
+			}
+
+			size += got = Sfread ( buf + size, 1, allocated - size, in );
+		}
+		while ( got > 0 );
+
+		if ( !PL_release_stream ( in ) ) {
+
+			free ( buf );
+			PL_fail;
+		}
+
+		rc = read_train_csv ( buf, size, source_pt, &opts, data_pt );
+		free ( buf );
+
+		return rc;
+	}
+
+	if ( !PL_get_file_name ( source_pt, &file, PL_FILE_ABSOLUTE ) )
+		return type_error ( source_pt, "file" );
+
+	if ( ( fd = open ( file, O_RDONLY ) ) < 0 )
+		return type_error ( source_pt, "file" );
+
+	if ( fstat ( fd, &st ) ) {
+
+		close ( fd );
+		return type_error ( source_pt, "file" );
+	}
+
+	if ( st.st_size == 0 ) {
+
+		close ( fd );
+		return domain_error ( source_pt, "csv_records" );
+	}
+
+	map = mmap ( NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+	close ( fd );
+
+	if ( map == MAP_FAILED )
+		return type_error ( source_pt, "file" );
+
+	rc = read_train_csv ( map, st.st_size, source_pt, &opts, data_pt );
+	munmap ( map, st.st_size );
+
+	return rc;
+}
+
+
+
+#ifdef VERSION220
+foreign_t swi_fann_create_train ( term_t num_data_pt, term_t num_input_pt, term_t num_output_pt, term_t data_pt ) {
+
+	int num_data, num_input, num_output;
+
+	if ( !PL_get_integer ( num_data_pt, &num_data ) )
+		return type_error ( num_data_pt, "integer" );
+	if ( num_data < 1 )
+		return domain_error ( num_data_pt, "positive_integer" );
+
+	if ( !PL_get_integer ( num_input_pt, &num_input ) )
+		return type_error ( num_input_pt, "integer" );
+	if ( num_input < 1 )
+		return domain_error ( num_input_pt, "positive_integer" );
+
+    if ( !PL_get_integer ( num_output_pt, &num_output ) )
+		return type_error ( num_output_pt, "integer" );
+	if ( num_output < 1 )
+		return domain_error ( num_output_pt, "positive_integer" );
+
+	if ( !PL_is_variable ( data_pt ) )
+		return type_error ( data_pt, "var" );
+
+    return unify_train_data ( data_pt, fann_create_train ( num_data, num_input, num_output ) );
+}
+#endif
+
+
+// Reads the list row_pt of exactly count values into row.
+
+static int get_train_row ( term_t row_pt, fann_type *row, unsigned int count ) {
+
+	term_t list_pt = PL_copy_term_ref ( row_pt );
+	term_t value_pt = PL_new_term_ref ();
+	unsigned int i;
+
+	for ( i = 0; i < count; i++ ) {
+
+		if ( !PL_get_list ( list_pt, value_pt, list_pt ) )
+			return domain_error ( row_pt, "row_length" );
+		if ( !PL_FANN_GET_FANNTYPE(value_pt,row+i) )
+			return type_error ( value_pt, PL_FANN_FANNTYPE );
+	}
+
+	if ( !PL_get_nil ( list_pt ) )
+		return domain_error ( row_pt, "row_length" );
+
+	PL_succeed;
+}
+
+
+// Reads the length of the list list_pt, which must be positive.
+
+static int get_list_length ( term_t list_pt, unsigned int *length ) {
+
+	size_t len;
+
+	if ( PL_skip_list ( list_pt, 0, &len ) != PL_LIST )
+		return type_error ( list_pt, "list" );
+	if ( !len || len > UINT_MAX )
+		return domain_error ( list_pt, "non_empty_list" );
+
+	*length = ( unsigned int ) len;
+
+	PL_succeed;
+}
+
+
+foreign_t swi_fann_create_train_from_lists ( term_t inputs_pt, term_t outputs_pt, term_t data_pt ) {
+
+	term_t inputs = PL_copy_term_ref ( inputs_pt ), outputs = PL_copy_term_ref ( outputs_pt );
+	term_t input_pt = PL_new_term_ref (), output_pt = PL_new_term_ref ();
+	unsigned int i, num_data, num_outputs, num_input, num_output;
+	struct fann_train_data *data;
+
+	if ( !get_list_length ( inputs_pt, &num_data ) || !get_list_length ( outputs_pt, &num_outputs ) )
+		PL_fail;
+	if ( num_outputs != num_data )
+		return domain_error ( outputs_pt, "same_length_as_inputs" );
+	if ( !PL_is_variable ( data_pt ) )
+		return type_error ( data_pt, "var" );
+
+	// The first row gives the number of inputs and outputs.
+	PL_get_list ( inputs, input_pt, inputs );
+	PL_get_list ( outputs, output_pt, outputs );
+	if ( !get_list_length ( input_pt, &num_input ) || !get_list_length ( output_pt, &num_output ) )
+		PL_fail;
+
+	if ( ( data = create_owned_train_data ( num_data, num_input, num_output ) ) == NULL )
+		return type_error ( inputs_pt, "fann_error" );
+
+	for ( i = 0; i < num_data; i++ ) {
+
+		if ( i ) {
+
+			PL_get_list ( inputs, input_pt, inputs );
+			PL_get_list ( outputs, output_pt, outputs );
+		}
+		if ( !get_train_row ( input_pt, data->input[i], num_input ) || !get_train_row ( output_pt, data->output[i], num_output ) ) {
+
+			fann_destroy_train ( data );
+			PL_fail;
+		}
+	}
+
+	return unify_train_data ( data_pt, data );
+}
+
+
+// Packed rows hold num_input and then num_output values in the native
+// representation of fann_type, as written by fann_get_train_packed/2.
+
+foreign_t swi_fann_create_train_from_packed ( term_t num_input_pt, term_t num_output_pt, term_t packed_pt, term_t data_pt ) {
+
+	int num_input, num_output;
+	unsigned int i, num_data;
+	struct fann_train_data *data;
+	size_t len, row;
+	char *packed;
+
+	if ( !PL_get_integer ( num_input_pt, &num_input ) )
+		return type_error ( num_input_pt, "integer" );
+	if ( num_input < 1 )
+		return domain_error ( num_input_pt, "positive_integer" );
+	if ( !PL_get_integer ( num_output_pt, &num_output ) )
+		return type_error ( num_output_pt, "integer" );
+	if ( num_output < 1 )
+		return domain_error ( num_output_pt, "positive_integer" );
+	if ( !PL_get_nchars ( packed_pt, &len, &packed, CVT_ATOM|CVT_STRING|REP_ISO_LATIN_1 ) )
+		return type_error ( packed_pt, "bytes" );
+	if ( !PL_is_variable ( data_pt ) )
+		return type_error ( data_pt, "var" );
+
+	row = ( size_t ) ( num_input + num_output ) * sizeof ( fann_type );
+
+	if ( !len || len % row || len / row > UINT_MAX )
+		return domain_error ( packed_pt, "packed_rows" );
+
+	num_data = ( unsigned int ) ( len / row );
+
+	if ( ( data = create_owned_train_data ( num_data, num_input, num_output ) ) == NULL )
+		return type_error ( packed_pt, "fann_error" );
+
+	for ( i = 0; i < num_data; i++, packed += row ) {
+
+		memcpy ( data->input[i], packed, num_input * sizeof ( fann_type ) );
+		memcpy ( data->output[i], packed + num_input * sizeof ( fann_type ), num_output * sizeof ( fann_type ) );
+	}
+
+	return unify_train_data ( data_pt, data );
+}
+
+
+foreign_t swi_fann_get_train_packed ( term_t data_pt, term_t packed_pt ) {
+
+	struct fann_train_data *data;
+	size_t input_size, row;
+	unsigned int i;
+	char *packed;
+	int rc;
+
+	if ( !get_train_data ( data_pt, &data ) )
+		PL_fail;
+	if ( !PL_is_variable ( packed_pt ) )
+		return type_error ( packed_pt, "var" );
+
+	input_size = data->num_input * sizeof ( fann_type );
+	row = input_size + data->num_output * sizeof ( fann_type );
+
+	if ( ( packed = malloc ( data->num_data * row ) ) == NULL && data->num_data && row )
+		return type_error ( data_pt, "fann_error" );
+
+	for ( i = 0; i < data->num_data; i++ ) {
+
+		memcpy ( packed + i * row, data->input[i], input_size );
+		memcpy ( packed + i * row + input_size, data->output[i], row - input_size );
+	}
+
+	rc = PL_unify_chars ( packed_pt, PL_STRING|REP_ISO_LATIN_1, data->num_data * row, packed );
+	free ( packed );
+
+	return rc;
+}
+
+                        /* Vectors and matrices */
+
+
+// Matrices keep values in C between calls, so that a vector run through
+// several networks, or the outputs of one network fed to another, are not
+// converted to and from Prolog numbers each time. fann_run/3, fann_train/3
+// and fann_test/3 take them as batches, one pattern per row.
+
+enum matrix_op { MATRIX_ADD, MATRIX_SUBTRACT, MATRIX_MULTIPLY, MATRIX_DIVIDE, MATRIX_MIN, MATRIX_MAX };
+
+static const char *MATRIX_OP_NAMES[] = { "add", "subtract", "multiply", "divide", "min", "max" };
+
+
+// Reads the length of the list or the arity of the compound term array_pt.
+
+static int get_array_length ( term_t array_pt, unsigned int *length ) {
+
+	atom_t name;
+	size_t arity;
+
+	if ( PL_is_compound ( array_pt ) && !PL_is_list ( array_pt ) ) {
+
+		PL_get_name_arity ( array_pt, &name, &arity );
+		if ( !arity || arity > UINT_MAX )
+			return domain_error ( array_pt, "array_length" );
+
+		*length = ( unsigned int ) arity;
+
+		PL_succeed;
+	}
+
+	return get_list_length ( array_pt, length );
+}
+
+
+// Reads the slice of len elements starting at pos, out of limit.
+
+static int get_slice ( term_t pos_pt, term_t len_pt, unsigned int limit, unsigned int *pos, unsigned int *len ) {
+
+	int p, l;
+
+	if ( !PL_get_integer ( pos_pt, &p ) )
+		return type_error ( pos_pt, "integer" );
+	if ( p < 0 )
+		return domain_error ( pos_pt, "nonneg" );
+	if ( !PL_get_integer ( len_pt, &l ) )
+		return type_error ( len_pt, "integer" );
+	if ( l < 1 )
+		return domain_error ( len_pt, "positive_integer" );
+	if ( ( unsigned int ) p + ( unsigned int ) l > limit )
+		return domain_error ( len_pt, "matrix_slice" );
+
+	*pos = ( unsigned int ) p;
+	*len = ( unsigned int ) l;
+
+	PL_succeed;
+}
+
+
+foreign_t swi_fann_create_vector ( term_t values_pt, term_t vector_pt ) {
+
+	unsigned int num_values;
+	fann_matrix *m;
+
+	if ( !get_array_length ( values_pt, &num_values ) )
+		PL_fail;
+	if ( !PL_is_variable ( vector_pt ) )
+		return type_error ( vector_pt, "var" );
+
+	if ( ( m = create_matrix ( 1, num_values ) ) == NULL )
+		return type_error ( values_pt, "fann_error" );
+
+	if ( !get_fanntype_array ( values_pt, m->values, num_values, NULL ) ) {
+
+		free ( m );
+		PL_fail;
+	}
+
+	return unify_matrix ( vector_pt, m );
+}
+
+
+foreign_t swi_fann_create_matrix ( term_t rows_pt, term_t matrix_pt ) {
+
+	term_t rows = PL_copy_term_ref ( rows_pt ), row_pt = PL_new_term_ref ();
+	unsigned int i, num_rows, num_cols;
+	fann_matrix *m;
+
+	// Raises a type error unless rows_pt is a list and a domain error if it
+	// is empty.
+	if ( !get_list_length ( rows_pt, &num_rows ) )
+		PL_fail;
+	if ( !PL_is_variable ( matrix_pt ) )
+		return type_error ( matrix_pt, "var" );
+
+	// The first row gives the number of columns.
+	if ( !PL_get_list ( rows_pt, row_pt, PL_new_term_ref () ) )
+		return domain_error ( rows_pt, "non_empty_list" );
+	if ( !get_array_length ( row_pt, &num_cols ) )
+		PL_fail;
+
+	if ( ( m = create_matrix ( num_rows, num_cols ) ) == NULL )
+		return type_error ( rows_pt, "fann_error" );
+
+	for ( i = 0; i < num_rows; i++ ) {
+
+		if ( !PL_get_list ( rows, row_pt, rows ) ) {
+
+			free ( m );
+			return type_error ( rows_pt, "list" );
+		}
+		if ( !get_fanntype_array ( row_pt, m->values + ( size_t ) i * num_cols, num_cols, NULL ) ) {
+
+			free ( m );
+			PL_fail;
+		}
+	}
+
+	return unify_matrix ( matrix_pt, m );
+}
+
+
+// Packed matrices hold their values row after row in the native
+// representation of fann_type, as written by fann_get_matrix_packed/2.
+
+foreign_t swi_fann_create_matrix_from_packed ( term_t cols_pt, term_t packed_pt, term_t matrix_pt ) {
+
+	int num_cols;
+	size_t len, row;
+	char *packed;
+	fann_matrix *m;
+
+	if ( !PL_get_integer ( cols_pt, &num_cols ) )
+		return type_error ( cols_pt, "integer" );
+	if ( num_cols < 1 )
+		return domain_error ( cols_pt, "positive_integer" );
+	if ( !PL_get_nchars ( packed_pt, &len, &packed, CVT_ATOM|CVT_STRING|REP_ISO_LATIN_1 ) )
+		return type_error ( packed_pt, "bytes" );
+	if ( !PL_is_variable ( matrix_pt ) )
+		return type_error ( matrix_pt, "var" );
+
+	row = ( size_t ) num_cols * sizeof ( fann_type );
+
+	if ( !len || len % row || len / row > UINT_MAX )
+		return domain_error ( packed_pt, "packed_rows" );
+
+	if ( ( m = create_matrix ( ( unsigned int ) ( len / row ), num_cols ) ) == NULL )
+		return type_error ( packed_pt, "fann_error" );
+
+	memcpy ( m->values, packed, len );
+
+	return unify_matrix ( matrix_pt, m );
+}
+
+
+foreign_t swi_fann_get_matrix_packed ( term_t matrix_pt, term_t packed_pt ) {
+
+	fann_matrix *m;
+
+	if ( !get_matrix ( matrix_pt, &m ) )
+		PL_fail;
+	if ( !PL_is_variable ( packed_pt ) )
+		return type_error ( packed_pt, "var" );
+
+	return PL_unify_chars ( packed_pt, PL_STRING|REP_ISO_LATIN_1, ( size_t ) m->rows * m->cols * sizeof ( fann_type ), ( char* ) m->values );
+}
+
+
+foreign_t swi_fann_matrix_size ( term_t matrix_pt, term_t rows_pt, term_t cols_pt ) {
+
+	fann_matrix *m;
+
+	if ( !get_matrix ( matrix_pt, &m ) )
+		PL_fail;
+
+	return PL_unify_integer ( rows_pt, m->rows ) && PL_unify_integer ( cols_pt, m->cols );
+}
+
+
+foreign_t swi_fann_vector_values ( term_t matrix_pt, term_t values_pt ) {
+
+	fann_matrix *m;
+
+	if ( !get_matrix ( matrix_pt, &m ) )
+		PL_fail;
+	if ( ( size_t ) m->rows * m->cols > UINT_MAX )
+		return domain_error ( matrix_pt, "array_length" );
+
+	return unify_fanntype_array ( values_pt, m->values, m->rows * m->cols, 0 );
+}
+
+
+foreign_t swi_fann_matrix_values ( term_t matrix_pt, term_t rows_pt ) {
+
+	term_t rows = PL_copy_term_ref ( rows_pt ), row_pt = PL_new_term_ref ();
+	unsigned int i;
+	fann_matrix *m;
+
+	if ( !get_matrix ( matrix_pt, &m ) )
+		PL_fail;
+
+	for ( i = 0; i < m->rows; i++ ) {
+
+		if ( !PL_unify_list ( rows, row_pt, rows ) ||
+			 !unify_fanntype_array ( row_pt, m->values + ( size_t ) i * m->cols, m->cols, 0 ) )
+			PL_fail;
+	}
+
+	return PL_unify_nil ( rows );
+}
+
+
+// Applies Op to the elements of A and B. B is a matrix of the same shape,
+// a single row applied to every row of A, or a number.
+
+foreign_t swi_fann_matrix_op ( term_t op_pt, term_t a_pt, term_t b_pt, term_t c_pt ) {
+
+	unsigned int i, j;
+	size_t b_row, b_col;
+	fann_matrix *a, *b_matrix, *c;
+	const fann_type *b;
+	fann_type x, y, scalar;
+	char *op_name;
+	int op;
+
+	if ( !PL_get_atom_chars ( op_pt, &op_name ) )
+		return type_error ( op_pt, "atom" );
+	for ( op = MATRIX_MAX; op >= 0 && strcmp ( MATRIX_OP_NAMES[op], op_name ); op-- )
+		;
+	if ( op < 0 )
+		return domain_error ( op_pt, "matrix_op" );
+
+	if ( !get_matrix ( a_pt, &a ) )
+		PL_fail;
+
+	if ( get_handle ( b_pt, &matrix_blob ) ) {
+
+		if ( !get_matrix ( b_pt, &b_matrix ) )
+			PL_fail;
+		if ( b_matrix->cols != a->cols || ( b_matrix->rows != a->rows && b_matrix->rows != 1 ) )
+			return domain_error ( b_pt, "matrix_shape" );
+
+		b = b_matrix->values;
+		b_row = b_matrix->rows == 1 ? 0 : b_matrix->cols;
+		b_col = 1;
+	}
+	else if ( PL_FANN_GET_FANNTYPE(b_pt,&scalar) ) {
+
+		b = &scalar;
+		b_row = b_col = 0;
+	}
+	else
+		return type_error ( b_pt, "fann_matrix" );
+
+	if ( !PL_is_variable ( c_pt ) )
+		return type_error ( c_pt, "var" );
+	if ( ( c = create_matrix ( a->rows, a->cols ) ) == NULL )
+		return type_error ( a_pt, "fann_error" );
+
+	for ( i = 0; i < a->rows; i++ )
+		for ( j = 0; j < a->cols; j++ ) {
+
+			x = a->values[( size_t ) i * a->cols + j];
+			y = b[i * b_row + j * b_col];
+
+			switch ( op ) {
+
+				case MATRIX_ADD: x += y; break;
+				case MATRIX_SUBTRACT: x -= y; break;
+				case MATRIX_MULTIPLY: x *= y; break;
+				case MATRIX_DIVIDE:
+#ifdef FIXEDFANN
+					if ( !y ) {
+
+						free ( c );
+						return domain_error ( b_pt, "nonzero" );
+					}
+#endif
+					x /= y;
+					break;
+				case MATRIX_MIN: x = y < x ? y : x; break;
+				case MATRIX_MAX: x = y > x ? y : x; break;
+			}
+
+			c->values[( size_t ) i * a->cols + j] = x;
+		}
+
+	return unify_matrix ( c_pt, c );
+}
+
+
+foreign_t swi_fann_slice_matrix ( term_t matrix_pt, term_t row_pt, term_t rows_pt, term_t col_pt, term_t cols_pt, term_t slice_pt ) {
+
+	unsigned int i, row, num_rows, col, num_cols;
+	fann_matrix *m, *slice;
+
+	if ( !get_matrix ( matrix_pt, &m ) )
+		PL_fail;
+	if ( !get_slice ( row_pt, rows_pt, m->rows, &row, &num_rows ) ||
+		 !get_slice ( col_pt, cols_pt, m->cols, &col, &num_cols ) )
+		PL_fail;
+	if ( !PL_is_variable ( slice_pt ) )
+		return type_error ( slice_pt, "var" );
+
+	if ( ( slice = create_matrix ( num_rows, num_cols ) ) == NULL )
+		return type_error ( matrix_pt, "fann_error" );
+
+	for ( i = 0; i < num_rows; i++ )
+		memcpy ( slice->values + ( size_t ) i * num_cols,
+			 m->values + ( size_t ) ( row + i ) * m->cols + col,
+			 num_cols * sizeof ( fann_type ) );
+
+	return unify_matrix ( slice_pt, slice );
+}
+
+
+foreign_t swi_fann_destroy_matrix ( term_t matrix_pt ) {
+
+	return destroy_handle ( matrix_pt, &matrix_blob );
+}
+
+
+// Training data grows in place: the rows stay in one block for the inputs
+// and one for the outputs, as made by fann_read_train_from_file (), whose
+// capacity doubles when full, so appending a row costs amortized O(1).
+// Mapped data is first copied into such blocks. Views and data that has
+// views cannot grow, since growing moves the rows.
+
+static int reserve_train_rows ( struct fann_train_data *data, unsigned int rows ) {
+
+	train_info *info = register_train_data ( data, NULL );
+	unsigned int capacity, i;
+	fann_type *input, *output, **input_rows, **output_rows;
+	size_t input_size = data->num_input * sizeof ( fann_type ), output_size = data->num_output * sizeof ( fann_type );
+
+	if ( !info )
+		return FALSE;
+
+	capacity = info->capacity > data->num_data ? info->capacity : data->num_data;
+
+	if ( rows <= capacity )
+		return TRUE;
+
+	capacity = capacity < 8 ? 16 : 2 * capacity;
+	if ( capacity < rows )
+		capacity = rows;
+
+	if ( info->map ) {
+
+		input = malloc ( capacity * input_size );
+		output = malloc ( capacity * output_size );
+		if ( input && output ) {
+
+			for ( i = 0; i < data->num_data; i++ ) {
+
+				memcpy ( input + ( size_t ) i * data->num_input, data->input[i], input_size );
+				memcpy ( output + ( size_t ) i * data->num_output, data->output[i], output_size );
+			}
+		}
+	}
+	else {
+
+		input = realloc ( data->input[0], capacity * input_size );
+		if ( input )
+			data->input[0] = input;
+		output = realloc ( data->output[0], capacity * output_size );
+		if ( output )
+			data->output[0] = output;
+	}
+
+	input_rows = realloc ( data->input, capacity * sizeof ( fann_type* ) );
+	if ( input_rows )
+		data->input = input_rows;
+	output_rows = realloc ( data->output, capacity * sizeof ( fann_type* ) );
+	if ( output_rows )
+		data->output = output_rows;
+
+	if ( !input || !output || !input_rows || !output_rows ) {
+
+		if ( info->map ) {
+
+			free ( input );
+			free ( output );
+		}
+		else
+			for ( i = 1; i < data->num_data; i++ ) {
+
+				data->input[i] = data->input[0] + ( size_t ) i * data->num_input;
+				data->output[i] = data->output[0] + ( size_t ) i * data->num_output;
+			}
+		return FALSE;
+	}
+
+	if ( info->map ) {
+
+		munmap ( info->map, info->map_size );
+		info->map = NULL;
+	}
+
+	for ( i = 0; i < capacity; i++ ) {
+
+		data->input[i] = input + ( size_t ) i * data->num_input;
+		data->output[i] = output + ( size_t ) i * data->num_output;
+	}
+
+	info->capacity = capacity;
+
+	return TRUE;
+}
+
+
+static int get_growable_train_data ( term_t data_pt, struct fann_train_data **data ) {
+
+	train_info *info;
+
+	if ( !get_train_data ( data_pt, data ) )
+		PL_fail;
+
+	if ( ( info = lookup_train_info ( *data ) ) != NULL && ( info->parent || info->refs > 1 ) )
+		return domain_error ( data_pt, "train_data_without_views" );
+
+	PL_succeed;
+}
+
+
+foreign_t swi_fann_append_train ( term_t data_pt, term_t input_pt, term_t output_pt ) {
+
+	struct fann_train_data *data;
+
+	if ( !get_growable_train_data ( data_pt, &data ) )
+		PL_fail;
+
+	if ( !reserve_train_rows ( data, data->num_data + 1 ) )
+		return type_error ( data_pt, "fann_error" );
+
+	if ( !get_train_row ( input_pt, data->input[data->num_data], data->num_input ) ||
+		!get_train_row ( output_pt, data->output[data->num_data], data->num_output ) )
+		PL_fail;
+
+	data->num_data++;
+	touch_train_data ( data );
+
+	PL_succeed;
+}
+
+
+foreign_t swi_fann_append_train_rows ( term_t data_pt, term_t inputs_pt, term_t outputs_pt ) {
+
+	term_t inputs = PL_copy_term_ref ( inputs_pt ), outputs = PL_copy_term_ref ( outputs_pt );
+	term_t input_pt = PL_new_term_ref (), output_pt = PL_new_term_ref ();
+	struct fann_train_data *data;
+	unsigned int rows, num_outputs, i;
+
+	if ( !get_growable_train_data ( data_pt, &data ) )
+		PL_fail;
+	if ( !get_list_length ( inputs_pt, &rows ) || !get_list_length ( outputs_pt, &num_outputs ) )
+		PL_fail;
+	if ( num_outputs != rows )
+		return domain_error ( outputs_pt, "same_length_as_inputs" );
+
+	if ( rows > UINT_MAX - data->num_data || !reserve_train_rows ( data, data->num_data + rows ) )
+		return type_error ( data_pt, "fann_error" );
+
+	// Nothing is appended unless all rows are read.
+	for ( i = 0; i < rows; i++ ) {
+
+		PL_get_list ( inputs, input_pt, inputs );
+		PL_get_list ( outputs, output_pt, outputs );
+
+		if ( !get_train_row ( input_pt, data->input[data->num_data + i], data->num_input ) ||
+			!get_train_row ( output_pt, data->output[data->num_data + i], data->num_output ) )
+			PL_fail;
+	}
+
+	data->num_data += rows;
+	touch_train_data ( data );
+
+	PL_succeed;
+}
+
+
+foreign_t swi_fann_append_train_data ( term_t data_pt, term_t other_pt ) {
+
+	struct fann_train_data *data, *other;
+	unsigned int rows, i;
+
+	if ( !get_growable_train_data ( data_pt, &data ) )
+		PL_fail;
+	if ( !get_train_data ( other_pt, &other ) )
+		PL_fail;
+	if ( other->num_input != data->num_input || other->num_output != data->num_output )
+		return domain_error ( other_pt, "same_layout_train_data" );
+
+	rows = other->num_data;
+
+	if ( rows > UINT_MAX - data->num_data || !reserve_train_rows ( data, data->num_data + rows ) )
+		return type_error ( data_pt, "fann_error" );
+
+	// Other may be data itself, whose rows have just been moved.
+	for ( i = 0; i < rows; i++ ) {
+
+		memcpy ( data->input[data->num_data + i], other->input[i], data->num_input * sizeof ( fann_type ) );
+		memcpy ( data->output[data->num_data + i], other->output[i], data->num_output * sizeof ( fann_type ) );
+	}
+
+	data->num_data += rows;
+	touch_train_data ( data );
+
+	PL_succeed;
+}
+
+
+
+/* Not Finished: doesn't seem to make much sense from Prolog, advise me if you see any use for it
+
+   swi_fann_create_train_from_callback
+*/
+
+
+foreign_t swi_fann_destroy_train ( term_t td_pt ) {
+
+	return destroy_handle ( td_pt, &train_blob );
+}
+
+
+foreign_t swi_fann_shuffle_train_data ( term_t td_pt ) {
+
+	struct fann_train_data *data;
+	fann_type *tmp;
+	unsigned int i, j, width;
+	struct fann_train_data *td;
+	rng *r;
+
+	if ( !get_train_data ( td_pt, &td ) )
+		PL_fail;
+
+	data = td;
+
+	// Moving the rows would reorder every view on them.
+	if ( !is_train_view ( data ) && has_train_views ( data ) )
+		return domain_error ( td_pt, "train_data_without_views" );
+
+	if ( ( r = get_train_rng ( data ) ) == NULL ) {
+
+		fann_shuffle_train_data ( data );
+		PL_succeed;
+	}
+
+	// A view shuffles its row pointers and leaves the rows of its parent alone.
+	if ( is_train_view ( data ) ) {
+
+		shuffle_rows ( data, r );
+		PL_succeed;
+	}
+
+	// Owned data keeps its rows in one block, so rows are swapped whole.
+	width = data->num_input > data->num_output ? data->num_input : data->num_output;
+
+	if ( ( tmp = malloc ( width * sizeof ( fann_type ) ) ) == NULL ) {
+
+		fann_shuffle_train_data ( data );
+		PL_succeed;
+	}
+
+	for ( i = data->num_data; i > 1; i-- ) {
+
+		if ( ( j = rng_below ( r, i ) ) == i - 1 )
+			continue;
+
+		memcpy ( tmp, data->input[i - 1], data->num_input * sizeof ( fann_type ) );
+		memcpy ( data->input[i - 1], data->input[j], data->num_input * sizeof ( fann_type ) );
+		memcpy ( data->input[j], tmp, data->num_input * sizeof ( fann_type ) );
+
+		memcpy ( tmp, data->output[i - 1], data->num_output * sizeof ( fann_type ) );
+		memcpy ( data->output[i - 1], data->output[j], data->num_output * sizeof ( fann_type ) );
+		memcpy ( data->output[j], tmp, data->num_output * sizeof ( fann_type ) );
+	}
+
+	free ( tmp );
+
+	PL_succeed;
+}
+
+
+                        /* Training data statistics */
+
+
+// fann_train_stats/2 computes the minimum, maximum, mean and variance of
+// every column in one pass: Welford's update over blocks of rows run as
+// tasks, the blocks then merged in order, so the result does not depend on
+// the number of threads. NaN values are counted and left out. The result
+// is cached on the entry of the data until its rows change.
+
+#define STATS_BLOCK_ROWS 65536
+
+typedef struct column_stats {
+
+	double min, max, mean, m2;
+	unsigned int count, nans;
+} column_stats;
+
+typedef struct train_stats {
+
+	unsigned long version;		// Of the root entry when computed.
+	unsigned int num_data, columns;	// The inputs, then the outputs.
+	column_stats col[];
+} train_stats;
+
+typedef struct stats_pass {
+
+	struct fann_train_data *data;
+	column_stats *blocks;		// columns per block
+} stats_pass;
+
+
+static void init_column_stats ( column_stats *s, unsigned int columns ) {
+
+	unsigned int j;
+
+	memset ( s, 0, columns * sizeof ( column_stats ) );
+
+	for ( j = 0; j < columns; j++ ) {
+
+		s[j].min = HUGE_VAL;
+		s[j].max = -HUGE_VAL;
+	}
+}
+
+
+static void add_column_values ( column_stats *s, const fann_type *row, unsigned int count ) {
+
+	unsigned int j;
+	double x, d;
+
+	for ( j = 0; j < count; j++ ) {
+
+		x = row[j];
+		if ( isnan ( x ) ) {
+
+			s[j].nans++;
+			continue;
+		}
+
+		if ( x < s[j].min )
+			s[j].min = x;
+		if ( x > s[j].max )
+			s[j].max = x;
+
+		d = x - s[j].mean;
+		s[j].mean += d / ++s[j].count;
+		s[j].m2 += d * ( x - s[j].mean );
+	}
+}
+
+
+static void stats_block_task ( void *arg, unsigned int index, atomic_int *cancel ) {
+
+	stats_pass *pass = arg;
+	struct fann_train_data *data = pass->data;
+	unsigned int i, width = data->num_input + data->num_output;
+	unsigned int last = data->num_data - index * STATS_BLOCK_ROWS < STATS_BLOCK_ROWS ? data->num_data : ( index + 1 ) * STATS_BLOCK_ROWS;
+	column_stats *s = pass->blocks + ( size_t ) index * width;
+
+	init_column_stats ( s, width );
+
+	for ( i = index * STATS_BLOCK_ROWS; i < last && !atomic_load ( cancel ); i++ ) {
+
+		add_column_values ( s, data->input[i], data->num_input );
+		add_column_values ( s + data->num_input, data->output[i], data->num_output );
+	}
+}
+
+
+// Chan's update, adding the values summed in b to a.
+
+static void merge_column_stats ( column_stats *a, const column_stats *b ) {
+
+	double n, d;
+
+	a->nans += b->nans;
+	if ( !b->count )
+		return;
+
+	if ( b->min < a->min )
+		a->min = b->min;
+	if ( b->max > a->max )
+		a->max = b->max;
+
+	n = ( double ) a->count + b->count;
+	d = b->mean - a->mean;
+	a->mean += d * b->count / n;
+	a->m2 += b->m2 + d * d * ( ( double ) a->count * b->count / n );
+	a->count += b->count;
+}
+
+
+static size_t train_stats_size ( unsigned int columns ) {
+
+	return sizeof ( train_stats ) + ( size_t ) columns * sizeof ( column_stats );
+}
+
+
+static train_stats *compute_train_stats ( struct fann_train_data *data, train_ctl *ctl ) {
+
+	unsigned int b, j, width = data->num_input + data->num_output;
+	unsigned int blocks = ( unsigned int ) ( ( ( size_t ) data->num_data + STATS_BLOCK_ROWS - 1 ) / STATS_BLOCK_ROWS );
+	train_stats *stats;
+	stats_pass pass;
+
+	if ( ( stats = malloc ( train_stats_size ( width ) ) ) == NULL )
+		return NULL;
+
+	stats->num_data = data->num_data;
+	stats->columns = width;
+	init_column_stats ( stats->col, width );
+
+	if ( !blocks )
+		return stats;
+
+	pass.data = data;
+	if ( ( pass.blocks = malloc ( ( size_t ) blocks * width * sizeof ( column_stats ) ) ) == NULL ||
+		!run_tasks ( blocks, default_threads (), stats_block_task, &pass, ctl ) ) {
+
+		free ( pass.blocks );
+		free ( stats );
+		return NULL;
+	}
+
+	for ( b = 0; b < blocks; b++ )
+		for ( j = 0; j < width; j++ )
+			merge_column_stats ( stats->col + j, pass.blocks + ( size_t ) b * width + j );
+
+	free ( pass.blocks );
+
+	return stats;
+}
+
+
+// Returns a copy of the statistics of data, computed unless cached, or
+// NULL if out of memory or interrupted, see ctl->stop.
+
+static train_stats *get_train_stats ( struct fann_train_data *data, train_ctl *ctl ) {
+
+	train_info *info = register_train_data ( data, NULL );
+	size_t size = train_stats_size ( data->num_input + data->num_output );
+	train_stats *stats, *copy;
+	unsigned long version;
+	int cached;
+
+	if ( info == NULL || ( copy = malloc ( size ) ) == NULL )
+		return NULL;
+
+	pthread_mutex_lock ( &train_registry_lock );
+	version = root_train_info ( info )->version;
+	if ( ( cached = ( stats = info->stats ) != NULL && stats->version == version && stats->num_data == data->num_data ) )
+		memcpy ( copy, stats, size );
+	pthread_mutex_unlock ( &train_registry_lock );
+
+	if ( cached )
+		return copy;
+
+	// Rows changed meanwhile leave the result with a stale version.
+	if ( ( stats = compute_train_stats ( data, ctl ) ) == NULL ) {
+
+		free ( copy );
+		return NULL;
+	}
+
+	stats->version = version;
+	memcpy ( copy, stats, size );
+
+	pthread_mutex_lock ( &train_registry_lock );
+	free ( info->stats );
+	info->stats = stats;
+	pthread_mutex_unlock ( &train_registry_lock );
+
+	return copy;
+}
+
+
+static double column_variance ( const column_stats *s ) {
+
+	return s->count ? s->m2 / s->count : 0.0;
+}
+
+
+static int unify_column_stats ( term_t list_pt, const column_stats *s, unsigned int count ) {
+
+	term_t head_pt = PL_new_term_ref ();
+	unsigned int j;
+
+	list_pt = PL_copy_term_ref ( list_pt );
+
+	for ( j = 0; j < count; j++ )
+		if ( !PL_unify_list ( list_pt, head_pt, list_pt ) ||
+			!PL_unify_term ( head_pt,
+				PL_FUNCTOR_CHARS, "column", 5,
+					PL_FLOAT, s[j].count ? s[j].min : 0.0,
+					PL_FLOAT, s[j].count ? s[j].max : 0.0,
+					PL_FLOAT, s[j].mean,
+					PL_FLOAT, column_variance ( s + j ),
+					PL_INT, ( int ) s[j].nans ) )
+			PL_fail;
+
+	return PL_unify_nil ( list_pt );
+}
+
+
+foreign_t swi_fann_train_stats ( term_t data_pt, term_t stats_pt ) {
+
+	term_t inputs_pt = PL_new_term_ref ();
+	term_t outputs_pt = PL_new_term_ref ();
+	struct fann_train_data *data;
+	train_stats *stats;
+	train_ctl ctl;
+	int ok;
+
+	if ( !get_train_data ( data_pt, &data ) )
+		PL_fail;
+
+	memset ( &ctl, 0, sizeof ( ctl ) );
+
+	if ( ( stats = get_train_stats ( data, &ctl ) ) == NULL )
+		return ctl.stop == TRAIN_STOP_SIGNAL ? FALSE : type_error ( data_pt, "fann_error" );
+
+	ok = PL_unify_term ( stats_pt,
+			PL_FUNCTOR_CHARS, "stats", 2,
+				PL_TERM, inputs_pt,
+				PL_TERM, outputs_pt ) &&
+		unify_column_stats ( inputs_pt, stats->col, data->num_input ) &&
+		unify_column_stats ( outputs_pt, stats->col + data->num_input, data->num_output );
+
+	free ( stats );
+
+	return ok;
+}
+
+
+#ifndef FIXEDFANN
+
+// Mean and deviation of each column as computed by the scaling functions of
+// the library, for fann_set_input_scaling_params/4 and friends. A column
+// without values gets mean 0 and deviation 1.
+
+static void set_scaling_from_stats ( float *mean, float *deviation, float *new_min, float *factor, const column_stats *s, unsigned int count, float min, float max ) {
+
+	unsigned int j;
+
+	for ( j = 0; j < count; j++ ) {
+
+		mean[j] = s[j].count ? ( float ) s[j].mean : 0.0f;
+		deviation[j] = s[j].count ? ( float ) sqrt ( column_variance ( s + j ) ) : 1.0f;
+		new_min[j] = min;
+		factor[j] = ( max - min ) / ( 1.0f - ( -1.0f ) );
+	}
+}
+
+
+// Sets the input (part 1), output (part 2) or both (part 3) scaling
+// parameters of ann from the statistics of data. Returns -1 as the library
+// does on failure, ctl->stop tells if interrupted.
+
+static int set_scaling_params ( struct fann *ann, struct fann_train_data *data, int part, float new_input_min, float new_input_max, float new_output_min, float new_output_max, train_ctl *ctl ) {
+
+	train_stats *stats;
+
+	if ( data->num_input != fann_get_num_input ( ann ) || data->num_output != fann_get_num_output ( ann ) || !data->num_data ||
+		( ann->scale_mean_in == NULL && fann_allocate_scale ( ann ) ) || ann->scale_mean_in == NULL )
+		return part == 1 ? fann_set_input_scaling_params ( ann, data, new_input_min, new_input_max ) :
+			part == 2 ? fann_set_output_scaling_params ( ann, data, new_output_min, new_output_max ) :
+			fann_set_scaling_params ( ann, data, new_input_min, new_input_max, new_output_min, new_output_max );
+
+	if ( ( stats = get_train_stats ( data, ctl ) ) == NULL )
+		return -1;
+
+	if ( part & 1 )
+		set_scaling_from_stats ( ann->scale_mean_in, ann->scale_deviation_in, ann->scale_new_min_in, ann->scale_factor_in,
+			stats->col, data->num_input, new_input_min, new_input_max );
+	if ( part & 2 )
+		set_scaling_from_stats ( ann->scale_mean_out, ann->scale_deviation_out, ann->scale_new_min_out, ann->scale_factor_out,
+			stats->col + data->num_input, data->num_output, new_output_min, new_output_max );
+
+	free ( stats );
+
+	return 0;
+}
+
+
+typedef struct zscore_pass {
+
+	struct fann_train_data *data;
+	train_stats *stats;
+	int part;
+} zscore_pass;
+
+
+static void zscore_values ( fann_type *row, const column_stats *s, unsigned int count ) {
+
+	unsigned int j;
+	double deviation;
+
+	for ( j = 0; j < count; j++ ) {
+
+		deviation = sqrt ( column_variance ( s + j ) );
+		row[j] = ( fann_type ) ( deviation > 0.0 ? ( row[j] - s[j].mean ) / deviation : row[j] - s[j].mean );
+	}
+}
+
+
+static void zscore_block_task ( void *arg, unsigned int index, atomic_int *cancel ) {
+
+	zscore_pass *pass = arg;
+	struct fann_train_data *data = pass->data;
+	unsigned int i, last = data->num_data - index * STATS_BLOCK_ROWS < STATS_BLOCK_ROWS ? data->num_data : ( index + 1 ) * STATS_BLOCK_ROWS;
+
+	for ( i = index * STATS_BLOCK_ROWS; i < last && !atomic_load ( cancel ); i++ ) {
+
+		if ( pass->part & 1 )
+			zscore_values ( data->input[i], pass->stats->col, data->num_input );
+		if ( pass->part & 2 )
+			zscore_values ( data->output[i], pass->stats->col + data->num_input, data->num_output );
+	}
+}
+
+
+// Scales the columns of a part of data to mean 0 and variance 1, a constant
+// column to 0.
+
+static foreign_t zscore_train_data ( term_t data_pt, int part ) {
+
+	unsigned int blocks;
+	struct fann_train_data *data;
+	zscore_pass pass;
+	train_ctl ctl;
+	int ok;
+
+	if ( !get_train_data ( data_pt, &data ) )
+		PL_fail;
+	if ( !check_scalable ( data_pt, data ) )
+		PL_fail;
+
+	memset ( &ctl, 0, sizeof ( ctl ) );
+
+	if ( ( pass.stats = get_train_stats ( data, &ctl ) ) == NULL )
+		return ctl.stop == TRAIN_STOP_SIGNAL ? FALSE : type_error ( data_pt, "fann_error" );
+
+	pass.data = data;
+	pass.part = part;
+	blocks = ( unsigned int ) ( ( ( size_t ) data->num_data + STATS_BLOCK_ROWS - 1 ) / STATS_BLOCK_ROWS );
+
+	// An interrupted pass leaves some rows scaled, the data is changed anyway.
+	ok = !blocks || run_tasks ( blocks, default_threads (), zscore_block_task, &pass, &ctl );
+	touch_train_data ( data );
+	free ( pass.stats );
+
+	return ok;
+}
+
+#endif
+
+
+foreign_t swi_fann_zscore_input_train_data ( term_t data_pt ) {
+
+#ifndef FIXEDFANN
+
+	return zscore_train_data ( data_pt, 1 );
+
+#else
+
+	return type_error ( data_pt, "not available fixedfann" );
+
+#endif
+}
+
+
+foreign_t swi_fann_zscore_output_train_data ( term_t data_pt ) {
+
+#ifndef FIXEDFANN
+
+	return zscore_train_data ( data_pt, 2 );
+
+#else
+
+	return type_error ( data_pt, "not available fixedfann" );
+
+#endif
+}
+
+
+foreign_t swi_fann_zscore_train_data ( term_t data_pt ) {
+
+#ifndef FIXEDFANN
+
+	return zscore_train_data ( data_pt, 3 );
+
+#else
+
+	return type_error ( data_pt, "not available fixedfann" );
+
+#endif
+}
+
+
+foreign_t swi_fann_scale_train ( term_t ann_pt, term_t data_pt ) {
+
+#ifndef FIXEDFANN
+
+	struct fann *ann;
+	struct fann_train_data *data;
+
+	if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
+	if ( !get_train_data ( data_pt, &data ) )
+		PL_fail;
+	if ( !check_scalable ( data_pt, data ) )
+		PL_fail;
+
+	fann_scale_train ( ann, data );
+	touch_train_data ( data );
+
+	PL_succeed;
+
+#else
+
+	return type_error ( ann_pt, "not available fixedfann" );
+
+#endif
+
+}
+
+
+foreign_t swi_fann_descale_train ( term_t ann_pt, term_t data_pt ) {
+
+#ifndef FIXEDFANN
+
+	struct fann *ann;
+	struct fann_train_data *data;
+
+	if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
+	if ( !get_train_data ( data_pt, &data ) )
+		PL_fail;
+	if ( !check_scalable ( data_pt, data ) )
+		PL_fail;
+
+	fann_descale_train ( ann, data );
+	touch_train_data ( data );
+
+	PL_succeed;
+
+#else
+
+	return type_error ( ann_pt, "not available fixedfann" );
+
+#endif
+
+}
+
+
+foreign_t swi_fann_set_input_scaling_params ( term_t ann_pt, term_t data_pt, term_t new_input_min_pt, term_t new_input_max_pt ) {
+
+#ifndef FIXEDFANN
+
+	struct fann *ann;
+	struct fann_train_data *data;
+	double new_input_min, new_input_max;
+	train_ctl ctl;
+
+	if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
+	if ( !get_train_data ( data_pt, &data ) )
+		PL_fail;
+	if ( !PL_get_float ( new_input_min_pt, &new_input_min ) )
+		return type_error ( new_input_min_pt, "float" );
+    if ( !PL_get_float ( new_input_max_pt, &new_input_max ) )
+		return type_error ( new_input_max_pt, "float" );
+
+	memset ( &ctl, 0, sizeof ( ctl ) );
+
+	if ( set_scaling_params ( ann, data, 1, new_input_min, new_input_max, 0.0f, 0.0f, &ctl ) )
+		return ctl.stop == TRAIN_STOP_SIGNAL ? FALSE : type_error ( ann_pt, "fann_error" );
+
+	PL_succeed;
+
+#else
+
+	return type_error ( ann_pt, "not available fixedfann" );
+
+#endif
+
+}
+
+
+foreign_t swi_fann_set_output_scaling_params ( term_t ann_pt, term_t data_pt, term_t new_output_min_pt, term_t new_output_max_pt ) {
+
+#ifndef FIXEDFANN
+
+	struct fann *ann;
+	struct fann_train_data *data;
+	double new_output_min, new_output_max;
+	train_ctl ctl;
+
+	if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
+	if ( !get_train_data ( data_pt, &data ) )
+		PL_fail;
+	if ( !PL_get_float ( new_output_min_pt, &new_output_min ) )
+		return type_error ( new_output_min_pt, "float" );
+    if ( !PL_get_float ( new_output_max_pt, &new_output_max ) )
+		return type_error ( new_output_max_pt, "float" );
+
+	memset ( &ctl, 0, sizeof ( ctl ) );
+
+	if ( set_scaling_params ( ann, data, 2, 0.0f, 0.0f, new_output_min, new_output_max, &ctl ) )
+		return ctl.stop == TRAIN_STOP_SIGNAL ? FALSE : type_error ( ann_pt, "fann_error" );
+
+	PL_succeed;
+
+#else
+
+	return type_error ( ann_pt, "not available fixedfann" );
+
+#endif
+
+}
+
+
+foreign_t swi_fann_set_scaling_params ( term_t ann_pt, term_t data_pt, term_t new_input_min_pt, term_t new_input_max_pt, term_t new_output_min_pt, term_t new_output_max_pt ) {
+
+#ifndef FIXEDFANN
+
+	struct fann *ann;
+	struct fann_train_data *data;
+	double new_input_min, new_input_max, new_output_min, new_output_max;
+	train_ctl ctl;
+
+	if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
+	if ( !get_train_data ( data_pt, &data ) )
+		PL_fail;
+	if ( !PL_get_float ( new_input_min_pt, &new_input_min ) )
+		return type_error ( new_input_min_pt, "float" );
+    if ( !PL_get_float ( new_input_max_pt, &new_input_max ) )
+		return type_error ( new_input_max_pt, "float" );
+	if ( !PL_get_float ( new_output_min_pt, &new_output_min ) )
+		return type_error ( new_output_min_pt, "float" );
+    if ( !PL_get_float ( new_output_max_pt, &new_output_max ) )
+		return type_error ( new_output_max_pt, "float" );
+
+	memset ( &ctl, 0, sizeof ( ctl ) );
+
+	if ( set_scaling_params ( ann, data, 3, new_input_min, new_input_max, new_output_min, new_output_max, &ctl ) )
+		return ctl.stop == TRAIN_STOP_SIGNAL ? FALSE : type_error ( ann_pt, "fann_error" );
+
+	PL_succeed;
+
+#else
+
+	return type_error ( ann_pt, "not available fixedfann" );
+
+#endif
+
+}
+
+
+foreign_t swi_fann_clear_scaling_params ( term_t ann_pt ) {
+
+#ifndef FIXEDFANN
+
+	struct fann *ann;
+
+	if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
+
+	fann_clear_scaling_params ( ann );
+
+	PL_succeed;
+
+#else
+
+	return type_error ( ann_pt, "not available fixedfann" );
+
+#endif
+
+}
+
+
+foreign_t swi_fann_scale_input ( term_t ann_pt, term_t input_pt ) {
+
+#ifndef FIXEDFANN
+
+	unsigned int num_input;
+	fann_type *input;
+	struct fann *ann;
+
+	if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
+
+	num_input = fann_get_num_input ( ann );
+	if ( ( input = get_scratch ( num_input * sizeof ( fann_type ) ) ) == NULL )
+		return type_error ( ann_pt, "fann_error" );
+	if ( !get_fanntype_array ( input_pt, input, num_input, NULL ) )
+		PL_fail;
+
+	fann_scale_input ( ann, input );
+
+	PL_succeed;
+
+#else
+
+	return type_error ( ann_pt, "not available fixedfann" );
+
+#endif
+
+}
+
+
+foreign_t swi_fann_scale_output ( term_t ann_pt, term_t output_pt ) {
+
+#ifndef FIXEDFANN
+
+	unsigned int num_output;
+	fann_type *output;
+	struct fann *ann;
+
+	if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
+
+	num_output = fann_get_num_output ( ann );
+	if ( ( output = get_scratch ( num_output * sizeof ( fann_type ) ) ) == NULL )
+		return type_error ( ann_pt, "fann_error" );
+	if ( !get_fanntype_array ( output_pt, output, num_output, NULL ) )
+		PL_fail;
+
+	fann_scale_output ( ann, output );
+
+	PL_succeed;
+
+#else
+
+	return type_error ( ann_pt, "not available fixedfann" );
+
+#endif
+
+}
+
+
+foreign_t swi_fann_descale_input ( term_t ann_pt, term_t input_pt ) {
+
+#ifndef FIXEDFANN
+
+	unsigned int num_input;
+	fann_type *input;
+	struct fann *ann;
+
+	if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
+
+	num_input = fann_get_num_input ( ann );
+	if ( ( input = get_scratch ( num_input * sizeof ( fann_type ) ) ) == NULL )
+		return type_error ( ann_pt, "fann_error" );
+	if ( !get_fanntype_array ( input_pt, input, num_input, NULL ) )
+		PL_fail;
+
+	fann_descale_input ( ann, input );
+
+	PL_succeed;
+
+#else
+
+	return type_error ( ann_pt, "not available fixedfann" );
+
+#endif
+
+}
+
+
+foreign_t swi_fann_descale_output ( term_t ann_pt, term_t output_pt ) {
+
+#ifndef FIXEDFANN
+
+	unsigned int num_output;
+	fann_type *output;
+	struct fann *ann;
+
+	if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
+
+	num_output = fann_get_num_output ( ann );
+	if ( ( output = get_scratch ( num_output * sizeof ( fann_type ) ) ) == NULL )
+		return type_error ( ann_pt, "fann_error" );
+	if ( !get_fanntype_array ( output_pt, output, num_output, NULL ) )
+		PL_fail;
+
+	fann_descale_output ( ann, output );
+
+	PL_succeed;
+
+#else
+
+	return type_error ( ann_pt, "not available fixedfann" );
+
+#endif
+
+}
+
+
+foreign_t swi_fann_scale_input_train_data ( term_t data_pt, term_t new_min_pt, term_t new_max_pt ) {
+
+	struct fann_train_data *data;
+	fann_type new_min, new_max;
+
+	if ( !get_train_data ( data_pt, &data ) )
+		PL_fail;
+	if ( !PL_FANN_GET_FANNTYPE(new_min_pt,&new_min) )
+		return type_error ( new_min_pt, PL_FANN_FANNTYPE );
+	if ( !PL_FANN_GET_FANNTYPE(new_max_pt,&new_max) )
+		return type_error ( new_max_pt, PL_FANN_FANNTYPE );
+	if ( !check_scalable ( data_pt, data ) )
+		PL_fail;
+
+	fann_scale_input_train_data ( data, new_min, new_max );
+	touch_train_data ( data );
+
+	PL_succeed;
+}
+
+
+foreign_t swi_fann_scale_output_train_data ( term_t data_pt, term_t new_min_pt, term_t new_max_pt ) {
+
+	struct fann_train_data *data;
+	fann_type new_min, new_max;
+
+	if ( !get_train_data ( data_pt, &data ) )
+		PL_fail;
+	if ( !PL_FANN_GET_FANNTYPE(new_min_pt,&new_min) )
+		return type_error ( new_min_pt, PL_FANN_FANNTYPE );
+	if ( !PL_FANN_GET_FANNTYPE(new_max_pt,&new_max) )
+		return type_error ( new_max_pt, PL_FANN_FANNTYPE );
+	if ( !check_scalable ( data_pt, data ) )
+		PL_fail;
+
+	fann_scale_output_train_data ( data, new_min, new_max );
+	touch_train_data ( data );
+
+	PL_succeed;
+}
+
+
+foreign_t swi_fann_scale_train_data ( term_t data_pt, term_t new_min_pt, term_t new_max_pt ) {
+
+	struct fann_train_data *data;
+	fann_type new_min, new_max;
+
+	if ( !get_train_data ( data_pt, &data ) )
+		PL_fail;
+	if ( !PL_FANN_GET_FANNTYPE(new_min_pt,&new_min) )
+		return type_error ( new_min_pt, PL_FANN_FANNTYPE );
+	if ( !PL_FANN_GET_FANNTYPE(new_max_pt,&new_max) )
+		return type_error ( new_max_pt, PL_FANN_FANNTYPE );
+	if ( !check_scalable ( data_pt, data ) )
+		PL_fail;
+
+	fann_scale_train_data ( data, new_min, new_max );
+	touch_train_data ( data );
+
+	PL_succeed;
+}
+
+
+foreign_t swi_fann_merge_train_data ( term_t data1_pt, term_t data2_pt, term_t data3_pt ) {
+
+	struct fann_train_data *data1, *data2;
+
+	if ( !get_train_data ( data1_pt, &data1 ) )
+		PL_fail;
+	if ( !get_train_data ( data2_pt, &data2 ) )
+		PL_fail;
+	if ( !PL_is_variable ( data3_pt ) )
+		return type_error ( data3_pt, "var" );
+
+	// fann_merge_train_data () copies the rows as one block, views are copied row by row.
+	if ( is_train_view ( data1 ) || is_train_view ( data2 ) )
+		return unify_train_data ( data3_pt, merge_train_rows ( data1, data2 ) );
+
+	return unify_train_data ( data3_pt, fann_merge_train_data ( data1, data2 ) );
+}
+
+
+foreign_t swi_fann_duplicate_train_data ( term_t data1_pt, term_t data2_pt ) {
+
+	struct fann_train_data *data1;
+
+	if ( !get_train_data ( data1_pt, &data1 ) )
+		PL_fail;
+	if ( !PL_is_variable ( data2_pt ) )
+		return type_error ( data2_pt, "var" );
+
+	if ( is_train_view ( data1 ) )
+		return unify_train_data ( data2_pt, copy_train_rows ( data1, 0, ( ( struct fann_train_data* ) data1 )->num_data ) );
+
+	return unify_train_data ( data2_pt, fann_duplicate_train_data ( data1 ) );
+}
+
+
+foreign_t swi_fann_subset_train_data ( term_t data1_pt, term_t pos_pt, term_t len_pt, term_t data2_pt ) {
+
+	struct fann_train_data *data1;
+	int pos, len;
+
+	if ( !get_train_data ( data1_pt, &data1 ) )
+		PL_fail;
+	if ( !PL_get_integer ( pos_pt, &pos ) )
+		return type_error ( pos_pt, "integer" );
+	if ( pos < 0 )
+		return domain_error ( pos_pt, "nonneg" );
+    if ( !PL_get_integer ( len_pt, &len ) )
+		return type_error ( len_pt, "integer" );
+	if ( len < 1 )
+		return domain_error ( len_pt, "positive_integer" );
+	if ( !PL_is_variable ( data2_pt ) )
+		return type_error ( data2_pt, "var" );
+
+	if ( is_train_view ( data1 ) ) {
+
+		if ( ( unsigned int ) pos + ( unsigned int ) len > ( ( struct fann_train_data* ) data1 )->num_data )
+			return domain_error ( len_pt, "subset_of_train_data" );
+
+		return unify_train_data ( data2_pt, copy_train_rows ( data1, pos, len ) );
+	}
+
+	return unify_train_data ( data2_pt, fann_subset_train_data ( data1, pos, len ) );
+}
+
+
+foreign_t swi_fann_length_train_data ( term_t data_pt, term_t len_pt ) {
+
+	struct fann_train_data *data;
+
+	if ( !get_train_data ( data_pt, &data ) )
+		PL_fail;
+
+	return PL_unify_integer ( len_pt, fann_length_train_data ( data ) );
+}
+
+
+foreign_t swi_fann_num_input_train_data ( term_t data_pt, term_t len_pt ) {
+
+	struct fann_train_data *data;
+
+	if ( !get_train_data ( data_pt, &data ) )
+		PL_fail;
+
+	return PL_unify_integer ( len_pt, fann_num_input_train_data ( data ) );
+}
+
+
+foreign_t swi_fann_num_output_train_data ( term_t data_pt, term_t len_pt ) {
+
+	struct fann_train_data *data;
+
+	if ( !get_train_data ( data_pt, &data ) )
+		PL_fail;
+
+	return PL_unify_integer ( len_pt, fann_num_output_train_data ( data ) );
+}
+
+
+foreign_t swi_fann_save_train ( term_t data_pt, term_t file_pt ) {
+
+	struct fann_train_data *data;
+	char *file;
+
+	if ( !get_train_data ( data_pt, &data ) )
+		PL_fail;
+	if ( !PL_get_file_name ( file_pt, &file, PL_FILE_ABSOLUTE ) )
+		return type_error ( file_pt, "file" );
+
+	if ( fann_save_train ( data, file ) )
+		return type_error ( data_pt, "fann_error" );
+
+	PL_succeed;
+}
+
+
+foreign_t swi_fann_save_train_to_fixed ( term_t data_pt, term_t file_pt, term_t dec_pt ) {
+
+	struct fann_train_data *data;
+	char *file;
+	int dec;
+
+	if ( !get_train_data ( data_pt, &data ) )
+		PL_fail;
+	if ( !PL_get_file_name ( file_pt, &file, PL_FILE_ABSOLUTE ) )
+		return type_error ( file_pt, "file" );
+	if ( !PL_get_integer ( dec_pt, &dec ) )
+		return type_error ( dec_pt, "integer" );
+	if ( dec < 0 )
+		return domain_error ( dec_pt, "nonneg" );
+
+	if ( fann_save_train_to_fixed ( data, file, dec ) )
+		return type_error ( data_pt, "fann_error" );
+
+	PL_succeed;
+}
+
+
+                        /* Binary training data */
+
+
+// A binary training data file is the header below, the inputs of all rows
+// and then the outputs of all rows, each block starting at a multiple of
+// TRAIN_FILE_ALIGN. All values are little-endian, the values of the rows
+// being of the fann_type of the engine that saved them. fann_map_train/2
+// maps the file privately and points the rows into the mapping, so pages
+// are shared with other processes mapping the same file until the data is
+// scaled or shuffled, which copies the pages written to.
+
+#define TRAIN_FILE_MAGIC "PLFANNTD"
+#define TRAIN_FILE_VERSION 1
+#define TRAIN_FILE_ALIGN 64
+
+#ifdef FIXEDFANN
+#define TRAIN_FILE_TYPE 2
+#elif defined DOUBLEFANN
+#define TRAIN_FILE_TYPE 1
+#else
+#define TRAIN_FILE_TYPE 0
+#endif
+
+typedef struct train_file_header {
+
+	char magic[8];
+	uint32_t version;
+	uint32_t type;			// 0 float, 1 double, 2 fixed
+	uint32_t type_size;
+	uint32_t num_data;
+	uint32_t num_input;
+	uint32_t num_output;
+	uint64_t input_offset;
+	uint64_t output_offset;
+} train_file_header;
+
+
+static int little_endian ( void ) {
+
+	const uint16_t one = 1;
+
+	return *( const uint8_t* ) &one;
+}
+
+
+// Reverses the bytes of each of the count values of size bytes at p, on
+// big-endian machines only.
+
+static void to_little_endian ( void *p, size_t size, size_t count ) {
+
+	uint8_t *b = p, t;
+	size_t i, j;
+
+	if ( little_endian ( ) )
+		return;
+
+	for ( ; count--; b += size )
+		for ( i = 0, j = size - 1; i < j; i++, j-- ) {
+
+			t = b[i];
+			b[i] = b[j];
+			b[j] = t;
+		}
+}
+
+
+static void train_file_header_to_little_endian ( train_file_header *h ) {
+
+	to_little_endian ( &h->version, sizeof ( uint32_t ), 6 );
+	to_little_endian ( &h->input_offset, sizeof ( uint64_t ), 2 );
+}
+
+
+static uint64_t train_file_align ( uint64_t offset ) {
+
+	return ( offset + TRAIN_FILE_ALIGN - 1 ) & ~( uint64_t ) ( TRAIN_FILE_ALIGN - 1 );
+}
+
+
+// Writes count rows of values values each, padded up to the offset end.
+
+static int write_train_rows ( FILE *fd, fann_type **rows, unsigned int count, unsigned int values, uint64_t end ) {
+
+	size_t size = values * sizeof ( fann_type );
+	fann_type *buf = NULL;
+	unsigned int i;
+	long pos;
+
+	if ( !little_endian ( ) && ( buf = malloc ( size ? size : 1 ) ) == NULL )
+		return FALSE;
+
+	for ( i = 0; i < count; i++ ) {
+
+		if ( buf ) {
+
+			memcpy ( buf, rows[i], size );
+			to_little_endian ( buf, sizeof ( fann_type ), values );
+		}
+		if ( fwrite ( buf ? buf : rows[i], 1, size, fd ) != size ) {
+
+			free ( buf );
+			return FALSE;
+		}
+	}
+
+	free ( buf );
+
+	if ( ( pos = ftell ( fd ) ) < 0 )
+		return FALSE;
+
+	for ( ; ( uint64_t ) pos < end; pos++ )
+		if ( fputc ( 0, fd ) == EOF )
+			return FALSE;
+
+	return TRUE;
+}
+
+
+foreign_t swi_fann_save_train_binary ( term_t data_pt, term_t file_pt ) {
+
+	struct fann_train_data *data;
+	train_file_header h;
+	uint64_t input_offset, output_offset, end;
+	char *file;
+	FILE *fd;
+	int ok;
+
+	if ( !get_train_data ( data_pt, &data ) )
+		PL_fail;
+	if ( !PL_get_file_name ( file_pt, &file, PL_FILE_ABSOLUTE ) )
+		return type_error ( file_pt, "file" );
+
+	input_offset = train_file_align ( sizeof ( h ) );
+	output_offset = train_file_align ( input_offset + ( uint64_t ) data->num_data * data->num_input * sizeof ( fann_type ) );
+	end = output_offset + ( uint64_t ) data->num_data * data->num_output * sizeof ( fann_type );
+
+	memset ( &h, 0, sizeof ( h ) );
+	memcpy ( h.magic, TRAIN_FILE_MAGIC, 8 );
+	h.version = TRAIN_FILE_VERSION;
+	h.type = TRAIN_FILE_TYPE;
+	h.type_size = sizeof ( fann_type );
+	h.num_data = data->num_data;
+	h.num_input = data->num_input;
+	h.num_output = data->num_output;
+	h.input_offset = input_offset;
+	h.output_offset = output_offset;
+	train_file_header_to_little_endian ( &h );
+
+	if ( ( fd = fopen ( file, "wb" ) ) == NULL )
+		return type_error ( data_pt, "fann_error" );
+
+	ok = fwrite ( &h, sizeof ( h ), 1, fd ) == 1 &&
+		write_train_rows ( fd, NULL, 0, 0, input_offset ) &&
+		write_train_rows ( fd, data->input, data->num_data, data->num_input, output_offset ) &&
+		write_train_rows ( fd, data->output, data->num_data, data->num_output, end );
+
+	if ( fclose ( fd ) || !ok )
+		return type_error ( data_pt, "fann_error" );
+
+	PL_succeed;
+}
+
+
+// Checks a header read from a file of size bytes against this engine.
+
+static int valid_train_file_header ( train_file_header *h, size_t size ) {
+
+	uint64_t inputs, outputs;
+
+	train_file_header_to_little_endian ( h );
+
+	if ( memcmp ( h->magic, TRAIN_FILE_MAGIC, 8 ) ||
+		h->version != TRAIN_FILE_VERSION ||
+		h->type != TRAIN_FILE_TYPE ||
+		h->type_size != sizeof ( fann_type ) ||
+		h->input_offset % TRAIN_FILE_ALIGN ||
+		h->output_offset % TRAIN_FILE_ALIGN )
+		return FALSE;
+
+	// A crafted header must not overflow the sizes checked against the file.
+	if ( ( h->num_input && h->num_data > UINT64_MAX / sizeof ( fann_type ) / h->num_input ) ||
+		( h->num_output && h->num_data > UINT64_MAX / sizeof ( fann_type ) / h->num_output ) )
+		return FALSE;
+
+	inputs = ( uint64_t ) h->num_data * h->num_input * sizeof ( fann_type );
+	outputs = ( uint64_t ) h->num_data * h->num_output * sizeof ( fann_type );
+
+	return h->input_offset >= sizeof ( *h ) &&
+		h->input_offset <= size && inputs <= size - h->input_offset &&
+		h->output_offset >= h->input_offset + inputs &&
+		h->output_offset <= size && outputs <= size - h->output_offset;
+}
+
+
+// Training data whose rows point into the blocks at base, not owning them.
+
+static struct fann_train_data *create_mapped_train_data ( train_file_header *h, char *base ) {
+
+	struct fann_train_data *data;
+	unsigned int i;
+
+	if ( ( data = calloc ( 1, sizeof ( struct fann_train_data ) ) ) == NULL )
+		return NULL;
+
+	fann_set_error_log ( ( struct fann_error* ) data, stderr );
+	data->num_data = h->num_data;
+	data->num_input = h->num_input;
+	data->num_output = h->num_output;
+	data->input = malloc ( ( h->num_data ? h->num_data : 1 ) * sizeof ( fann_type* ) );
+	data->output = malloc ( ( h->num_data ? h->num_data : 1 ) * sizeof ( fann_type* ) );
+
+	if ( !data->input || !data->output ) {
+
+		free_view ( data );
+		free ( data );
+		return NULL;
+	}
+
+	for ( i = 0; i < h->num_data; i++ ) {
+
+		data->input[i] = ( fann_type* ) ( base + h->input_offset ) + ( size_t ) i * h->num_input;
+		data->output[i] = ( fann_type* ) ( base + h->output_offset ) + ( size_t ) i * h->num_output;
+	}
+
+	return data;
+}
+
+
+foreign_t swi_fann_map_train ( term_t file_pt, term_t data_pt ) {
+
+	struct fann_train_data *data, *copy;
+	train_file_header h;
+	train_info *info;
+	struct stat st;
+	void *map;
+	char *file;
+	int fd;
+
+	if ( !PL_get_file_name ( file_pt, &file, PL_FILE_ABSOLUTE ) )
+		return type_error ( file_pt, "file" );
+	if ( !PL_is_variable ( data_pt ) )
+		return type_error ( data_pt, "var" );
+
+	if ( ( fd = open ( file, O_RDONLY ) ) < 0 )
+		return type_error ( file_pt, "file" );
+
+	if ( fstat ( fd, &st ) || ( size_t ) st.st_size < sizeof ( h ) ||
+		( map = mmap ( NULL, st.st_size, PROT_READ|PROT_WRITE, MAP_PRIVATE, fd, 0 ) ) == MAP_FAILED ) {
+
+		close ( fd );
+		return domain_error ( file_pt, "fann_train_binary" );
+	}
+
+	close ( fd );
+	memcpy ( &h, map, sizeof ( h ) );
+
+	if ( !valid_train_file_header ( &h, st.st_size ) ) {
+
+		munmap ( map, st.st_size );
+		return domain_error ( file_pt, "fann_train_binary" );
+	}
+
+	if ( ( data = create_mapped_train_data ( &h, map ) ) == NULL ) {
+
+		munmap ( map, st.st_size );
+		return type_error ( file_pt, "fann_error" );
+	}
+
+	// Big-endian machines get a converted copy instead of the mapping.
+	if ( !little_endian ( ) ) {
+
+		copy = copy_train_rows ( data, 0, data->num_data );
+		free_view ( data );
+		free ( data );
+		munmap ( map, st.st_size );
+
+		if ( copy == NULL )
+			return type_error ( file_pt, "fann_error" );
+
+		to_little_endian ( copy->input[0], sizeof ( fann_type ), ( size_t ) copy->num_data * copy->num_input );
+		to_little_endian ( copy->output[0], sizeof ( fann_type ), ( size_t ) copy->num_data * copy->num_output );
+
+		return unify_train_data ( data_pt, copy );
+	}
+
+	if ( ( info = register_train_data ( data, NULL ) ) == NULL ) {
+
+		free_view ( data );
+		free ( data );
+		munmap ( map, st.st_size );
+		return type_error ( file_pt, "fann_error" );
+	}
+
+	info->map = map;
+	info->map_size = st.st_size;
+
+	return unify_train_data ( data_pt, data );
+}
+
+                        /* Compact training data */
+
+
+#ifndef FIXEDFANN
+
+// fann_compact_train_data/3 stores the rows of training data as float16,
+// bfloat16 or as 8 or 16 bit integer codes scaled between the minimum and
+// the maximum of each column. The values are widened back to fann_type a
+// chunk at a time when the data is trained on or tested, so an epoch reads
+// a half or a quarter of the bytes of the data it came from.
 
-	if ( !PL_unify_nil ( input_pt ) )
-		return type_error ( input_pt, "list" );
+enum compact_format {
 
-	for ( i = 0; i < num_output; i++ ) {
+	COMPACT_FLOAT16 = 0,
+	COMPACT_BFLOAT16,
+	COMPACT_INT8,
+	COMPACT_INT16
+};
 
-		if ( !PL_unify_list ( output_pt, temp_pt, output_pt ) )
-			return type_error ( output_pt, "list" );
-	    if ( !PL_FANN_GET_FANNTYPE(temp_pt,output+i) )
-			return type_error ( temp_pt, PL_FANN_FANNTYPE );
-	}
+static const char *COMPACT_FORMAT_NAMES[] = { "float16", "bfloat16", "int8", "int16" };
 
-	if ( !PL_unify_nil ( output_pt ) )
-		return type_error ( output_pt, "list" );
+#define COMPACT_CHUNK_ROWS 4096
 
-	fann_train ( ann, input, output );
+typedef struct compact_train {
 
-	PL_free ( input );
-	PL_free ( output );
+	enum compact_format format;
+	unsigned int num_data, num_input, num_output;
+	void *values;			// Row after row, the inputs before the outputs.
+	double *offset, *step;		// Per column, of the integer formats.
+	double max_error, rms_error;	// Of the conversion.
+} compact_train;
 
-	PL_succeed;
 
-#else
+// Round to nearest even, as the conversions of the hardware.
 
-	return type_error ( ann_pt, "not available fixedfann" );
+static uint16_t float_to_half ( float f ) {
 
-#endif
+	uint32_t x, sign;
 
-}
+	memcpy ( &x, &f, sizeof ( x ) );
+	sign = ( x >> 16 ) & 0x8000;
+	x &= 0x7fffffff;
 
+	if ( x > 0x7f800000 )
+		return sign | 0x7e00;
+	if ( x >= 0x477ff000 )		// 65520 and up round to infinity.
+		return sign | 0x7c00;
+	if ( x < 0x38800000 )		// Subnormal, in steps of 2^-24.
+		return sign | ( uint16_t ) nearbyintf ( fabsf ( f ) * 16777216.0f );
 
-foreign_t swi_fann_test ( term_t ann_pt, term_t input_pt, term_t output_pt ) {
+	x += 0x0fff + ( ( x >> 13 ) & 1 );
 
-	unsigned int i, num_input, num_output;
-	fann_type *input, *output;
-	term_t temp_pt = PL_new_term_ref ();
-	void *ann;
+	return sign | ( uint16_t ) ( ( x - 0x38000000 ) >> 13 );
+}
 
-	if ( !PL_get_pointer ( ann_pt, &ann ) )
-		return type_error ( ann_pt, "pointer" );
 
-	num_input = fann_get_num_input( ann );
-	input = PL_malloc ( num_input * sizeof ( fann_type ) );
+static float half_to_float ( uint16_t h ) {
 
-	num_output = fann_get_num_output( ann );
-	output = PL_malloc ( num_output * sizeof ( fann_type ) );
+	uint32_t x = ( uint32_t ) ( h & 0x8000 ) << 16, e = ( h >> 10 ) & 0x1f, m = h & 0x3ff;
+	float f;
 
-	for ( i = 0; i < num_input; i++ ) {
+	if ( e == 0 ) {
 
-		if ( !PL_unify_list ( input_pt, temp_pt, input_pt ) )
-			return type_error ( input_pt, "list" );
-	    if ( !PL_FANN_GET_FANNTYPE(temp_pt,input+i) )
-			return type_error ( temp_pt, PL_FANN_FANNTYPE );
+		f = m * ( 1.0f / 16777216.0f );
+		return x ? -f : f;
 	}
 
-	if ( !PL_unify_nil ( input_pt ) )
-		return type_error ( input_pt, "list" );
+	x |= e == 31 ? 0x7f800000 | m << 13 : ( e + 112 ) << 23 | m << 13;
+	memcpy ( &f, &x, sizeof ( f ) );
+
+	return f;
+}
 
-	for ( i = 0; i < num_output; i++ ) {
 
-		if ( !PL_unify_list ( output_pt, temp_pt, output_pt ) )
-			return type_error ( output_pt, "list" );
-	    if ( !PL_FANN_GET_FANNTYPE(temp_pt,output+i) )
-			return type_error ( temp_pt, PL_FANN_FANNTYPE );
-	}
+static uint16_t float_to_bfloat ( float f ) {
 
-	if ( !PL_unify_nil ( output_pt ) )
-		return type_error ( output_pt, "list" );
+	uint32_t x;
 
-	fann_test ( ann, input, output );
+	memcpy ( &x, &f, sizeof ( x ) );
 
-	PL_free ( input );
-	PL_free ( output );
+	if ( ( x & 0x7fffffff ) > 0x7f800000 )
+		return ( x >> 16 ) | 0x40;
 
-	PL_succeed;
+	return ( x + 0x7fff + ( ( x >> 16 ) & 1 ) ) >> 16;
 }
 
 
-foreign_t swi_fann_get_MSE ( term_t ann_pt, term_t MSE_pt ) {
+static float bfloat_to_float ( uint16_t h ) {
 
-	void *ann;
+	uint32_t x = ( uint32_t ) h << 16;
+	float f;
 
-	if ( !PL_get_pointer ( ann_pt, &ann ) )
-		return type_error ( ann_pt, "pointer" );
-	if ( !PL_is_variable ( MSE_pt ) )
-		return type_error ( MSE_pt, "var" );
+	memcpy ( &f, &x, sizeof ( f ) );
 
-	return PL_unify_float ( MSE_pt, fann_get_MSE ( ann ) );
+	return f;
 }
 
 
-foreign_t swi_fann_get_bit_fail ( term_t ann_pt, term_t bf_pt ) {
-
-	void *ann;
-
-	if ( !PL_get_pointer ( ann_pt, &ann ) )
-		return type_error ( ann_pt, "pointer" );
+static size_t compact_value_size ( enum compact_format format ) {
 
-	return PL_unify_integer ( bf_pt, fann_get_bit_fail ( ann ) );
+	return format == COMPACT_INT8 ? 1 : 2;
 }
 
 
-foreign_t swi_fann_reset_MSE ( term_t ann_pt ) {
+// Widens count values of column col on from value k of c into dst.
 
-	void *ann;
+static void widen_compact ( const compact_train *c, size_t k, unsigned int col, unsigned int count, fann_type *dst ) {
 
-	if ( !PL_get_pointer ( ann_pt, &ann ) )
-		return type_error ( ann_pt, "pointer" );
+	const uint16_t *h = ( const uint16_t* ) c->values + k;
+	const uint8_t *b = ( const uint8_t* ) c->values + k;
+	const double *offset = c->offset + col, *step = c->step + col;
+	unsigned int j;
 
-	fann_reset_MSE ( ann );
+	switch ( c->format ) {
 
-	PL_succeed;
+	case COMPACT_FLOAT16:
+		for ( j = 0; j < count; j++ )
+			dst[j] = half_to_float ( h[j] );
+		break;
+	case COMPACT_BFLOAT16:
+		for ( j = 0; j < count; j++ )
+			dst[j] = bfloat_to_float ( h[j] );
+		break;
+	case COMPACT_INT8:
+		for ( j = 0; j < count; j++ )
+			dst[j] = ( fann_type ) ( offset[j] + step[j] * b[j] );
+		break;
+	case COMPACT_INT16:
+		for ( j = 0; j < count; j++ )
+			dst[j] = ( fann_type ) ( offset[j] + step[j] * h[j] );
+		break;
+	}
 }
 
 
-foreign_t swi_fann_train_on_data ( term_t ann_pt, term_t data_pt, term_t max_epochs_pt, term_t epochs_between_reports_pt, term_t desired_error_pt ) {
+// Widens chunk->num_data rows of c from row first on into chunk.
 
-#ifndef FIXEDFANN
+static void widen_compact_rows ( const compact_train *c, unsigned int first, struct fann_train_data *chunk ) {
 
-	void *ann, *data;
-	unsigned int max_epochs, epochs_between_reports;
-	double desired_error;
+	unsigned int i, width = c->num_input + c->num_output;
+	size_t k;
 
-	if ( !PL_get_pointer ( ann_pt, &ann ) )
-		return type_error ( ann_pt, "pointer" );
-	if ( !PL_get_pointer ( data_pt, &data ) )
-		return type_error ( data_pt, "pointer" );
+	for ( i = 0; i < chunk->num_data; i++ ) {
 
-	if ( !PL_get_integer ( max_epochs_pt, &max_epochs ) )
-		return type_error ( max_epochs_pt, "integer" );
-	if ( max_epochs < 1 )
-		return domain_error ( max_epochs_pt, "positive_integer" );
+		k = ( size_t ) ( first + i ) * width;
+		widen_compact ( c, k, 0, c->num_input, chunk->input[i] );
+		widen_compact ( c, k + c->num_input, c->num_input, c->num_output, chunk->output[i] );
+	}
+}
 
-	if ( !PL_get_integer ( epochs_between_reports_pt, &epochs_between_reports ) )
-		return type_error ( epochs_between_reports_pt, "integer" );
-	if ( epochs_between_reports < 0 )
-		return domain_error ( epochs_between_reports_pt, "nonneg" );
 
-	if ( !PL_get_float ( desired_error_pt, &desired_error ) )
-		return type_error ( desired_error_pt, "float" );
+static void destroy_compact_train ( compact_train *c ) {
 
-	fann_train_on_data(ann, data, max_epochs, epochs_between_reports, (float) desired_error );
+	free ( c->values );
+	free ( c->offset );
+	free ( c->step );
+	free ( c );
+}
 
-	PL_succeed;
 
-#else
+// Narrows the rows of data into a new compact_train and measures the error
+// of the round trip. Returns NULL if out of memory, and sets *finite to
+// FALSE if an integer format meets a value that is not finite.
 
-	return type_error ( ann_pt, "not available fixedfann" );
+static compact_train *create_compact_train ( struct fann_train_data *data, enum compact_format format, int *finite ) {
 
-#endif
-}
+	unsigned int i, j, width = data->num_input + data->num_output;
+	size_t k, size = compact_value_size ( format ), n = ( size_t ) data->num_data * width;
+	double x, y, d, lo, hi, levels = format == COMPACT_INT8 ? 255.0 : 65535.0, sum = 0.0;
+	fann_type v, w;
+	compact_train *c;
 
+	*finite = TRUE;
 
-foreign_t swi_fann_train_on_file ( term_t ann_pt, term_t file_pt, term_t max_epochs_pt, term_t epochs_between_reports_pt, term_t desired_error_pt ) {
+	if ( ( c = calloc ( 1, sizeof ( compact_train ) ) ) == NULL )
+		return NULL;
 
-#ifndef FIXEDFANN
+	c->format = format;
+	c->num_data = data->num_data;
+	c->num_input = data->num_input;
+	c->num_output = data->num_output;
+	c->values = malloc ( ( n ? n : 1 ) * size );
+	c->offset = calloc ( width ? width : 1, sizeof ( double ) );
+	c->step = calloc ( width ? width : 1, sizeof ( double ) );
 
-	void *ann;
-	char *file;
-	unsigned int max_epochs, epochs_between_reports;
-	double desired_error;
+	if ( !c->values || !c->offset || !c->step ) {
 
-	if ( !PL_get_pointer ( ann_pt, &ann ) )
-		return type_error ( ann_pt, "pointer" );
+		destroy_compact_train ( c );
+		return NULL;
+	}
 
-	if ( !PL_get_file_name ( file_pt, &file, PL_FILE_ABSOLUTE || PL_FILE_SEARCH || PL_FILE_EXIST ) )
-		return type_error ( file_pt, "file" );
+	if ( format == COMPACT_INT8 || format == COMPACT_INT16 )
+		for ( j = 0; j < width; j++ ) {
 
-    if ( !PL_get_integer ( max_epochs_pt, &max_epochs ) )
-		return type_error ( max_epochs_pt, "integer" );
-	if ( max_epochs < 1 )
-		return domain_error ( max_epochs_pt, "positive_integer" );
+			lo = HUGE_VAL;
+			hi = -HUGE_VAL;
 
-    if ( !PL_get_integer ( epochs_between_reports_pt, &epochs_between_reports ) )
-		return type_error ( epochs_between_reports_pt, "integer" );
-	if ( epochs_between_reports < 0 )
-		return domain_error ( epochs_between_reports_pt, "nonneg" );
+			for ( i = 0; i < data->num_data; i++ ) {
 
-    if ( !PL_get_float ( desired_error_pt, &desired_error ) )
-		return type_error ( desired_error_pt, "float" );
+				x = j < data->num_input ? data->input[i][j] : data->output[i][j - data->num_input];
+				if ( !isfinite ( x ) ) {
 
-    fann_train_on_file ( ann, file, max_epochs, epochs_between_reports, (float) desired_error );
+					*finite = FALSE;
+					destroy_compact_train ( c );
+					return NULL;
+				}
+				if ( x < lo )
+					lo = x;
+				if ( x > hi )
+					hi = x;
+			}
 
-	PL_succeed;
+			c->offset[j] = data->num_data ? lo : 0.0;
+			c->step[j] = data->num_data ? ( hi - lo ) / levels : 0.0;
+		}
 
-#else
+	for ( i = 0; i < data->num_data; i++ )
+		for ( j = 0; j < width; j++ ) {
+
+			k = ( size_t ) i * width + j;
+			v = j < data->num_input ? data->input[i][j] : data->output[i][j - data->num_input];
+
+			switch ( format ) {
+
+			case COMPACT_FLOAT16:
+				( ( uint16_t* ) c->values )[k] = float_to_half ( ( float ) v );
+				break;
+			case COMPACT_BFLOAT16:
+				( ( uint16_t* ) c->values )[k] = float_to_bfloat ( ( float ) v );
+				break;
+			case COMPACT_INT8:
+			case COMPACT_INT16:
+				y = c->step[j] > 0.0 ? nearbyint ( ( v - c->offset[j] ) / c->step[j] ) : 0.0;
+				if ( y > levels )
+					y = levels;
+				if ( format == COMPACT_INT8 )
+					( ( uint8_t* ) c->values )[k] = ( uint8_t ) y;
+				else
+					( ( uint16_t* ) c->values )[k] = ( uint16_t ) y;
+				break;
+			}
+
+			widen_compact ( c, k, j, 1, &w );
+			d = fabs ( ( double ) w - ( double ) v );
+
+			// A NaN in the data makes the error NaN.
+			if ( d > c->max_error || isnan ( d ) )
+				c->max_error = d;
+			sum += d * d;
+		}
 
-	return type_error ( ann_pt, "not available fixedfann" );
+	if ( n )
+		c->rms_error = sqrt ( sum / n );
+
+	return c;
+}
 
 #endif
 
-}
 
+                        /* Streaming training */
 
-foreign_t swi_fann_train_epoch ( term_t ann_pt, term_t data_pt ) {
 
 #ifndef FIXEDFANN
 
-	void *ann, *data;
-	double MSE;
-
-	if ( !PL_get_pointer ( ann_pt, &ann ) )
-		return type_error ( ann_pt, "pointer" );
-	if ( !PL_get_pointer ( data_pt, &data ) )
-		return type_error ( data_pt, "pointer" );
+// fann_train_on_file/6 keeps the training data on disk, in the text format
+// or the binary format of fann_save_train_binary/2, and streams it through
+// two buffers of chunk_rows rows each epoch. A reader thread fills one
+// buffer while the network trains on the other. Incremental training trains
+// on every chunk as it comes; batch, RPROP and quickprop sum the slopes over
+// all chunks and update the weights once per epoch, as on data in memory.
+// fann_train_on_compact/6 runs the same loop, with the reader thread
+// widening compact training data instead of reading a file.
 
-    fann_train_epoch ( ann, data );
+#define STREAM_CHUNK_ROWS 65536
 
-	PL_succeed;
+enum stream_state {
 
-#else
+	STREAM_FREE = 0,
+	STREAM_READY,
+	STREAM_FAILED
+};
 
-	return type_error ( ann_pt, "not available fixedfann" );
+typedef struct train_stream {
 
-#endif
+	int binary;
+	compact_train *compact;		// Instead of a file.
+	FILE *fd;
+	long body;			// Offset of the first row in a text file.
+	train_file_header h;		// Of a binary file.
+	unsigned int num_data, num_input, num_output;
+	unsigned int next;		// The next row to read.
+} train_stream;
 
-}
+typedef struct stream_reader {
 
+	train_stream src;
+	struct fann_train_data *chunk[2];
+	enum stream_state state[2];
+	int last[2];			// The chunk ends an epoch.
+	int stop;
+	locale_t c_locale;
+	pthread_t thread;
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+} stream_reader;
 
-foreign_t swi_fann_test_data  ( term_t ann_pt, term_t data_pt, term_t MSE_pt ) {
 
-	void *ann, *data;
+// Reads the next whitespace separated token of a text file into buf.
 
-	if ( !PL_get_pointer ( ann_pt, &ann ) )
-		return type_error ( ann_pt, "pointer" );
-	if ( !PL_get_pointer ( data_pt, &data ) )
-		return type_error ( data_pt, "pointer" );
-	if ( !PL_is_variable ( MSE_pt ) )
-		return type_error ( MSE_pt, "var" );
+static int stream_token ( FILE *fd, char *buf, size_t size ) {
 
-	return PL_unify_float ( MSE_pt, fann_test_data ( ann, data ) );
-}
+	size_t n = 0;
+	int c;
 
+	while ( ( c = getc_unlocked ( fd ) ) != EOF && is_text_space ( c ) )
+		;
 
-foreign_t swi_fann_read_train_from_file ( term_t file_pt, term_t data_pt ) {
+	for ( ; c != EOF && !is_text_space ( c ); c = getc_unlocked ( fd ) ) {
 
-	char *file;
+		if ( n + 1 >= size )
+			return FALSE;
+		buf[n++] = c;
+	}
 
-	if ( !PL_get_file_name ( file_pt, &file, PL_FILE_ABSOLUTE ) )
-		return type_error ( file_pt, "file" );
-	if ( !PL_is_variable ( data_pt ) )
-		return type_error ( data_pt, "var" );
+	buf[n] = '\0';
 
-	return PL_unify_pointer ( data_pt, fann_read_train_from_file ( file ) );
+	return n > 0;
 }
 
 
-#ifdef VERSION220
-foreign_t swi_fann_create_train ( term_t num_data_pt, term_t num_input_pt, term_t num_output_pt, term_t data_pt ) {
+static int open_train_stream ( const char *file, train_stream *src ) {
 
-	int num_data, num_input, num_output;
+	char buf[TEXT_TOKEN_MAX];
+	long long v[3];
+	struct stat st;
+	int i;
 
-	if ( !PL_get_integer ( num_data_pt, &num_data ) )
-		return type_error ( num_data_pt, "integer" );
-	if ( num_data < 1 )
-		return domain_error ( num_data_pt, "positive_integer" );
+	memset ( src, 0, sizeof ( *src ) );
 
-	if ( !PL_get_integer ( num_input_pt, &num_input ) )
-		return type_error ( num_input_pt, "integer" );
-	if ( num_input < 1 )
-		return domain_error ( num_input_pt, "positive_integer" );
+	if ( ( src->fd = fopen ( file, "rb" ) ) == NULL )
+		return FALSE;
 
-    if ( !PL_get_integer ( num_output_pt, &num_output ) )
-		return type_error ( num_output_pt, "integer" );
-	if ( num_output < 1 )
-		return domain_error ( num_output_pt, "positive_integer" );
+	if ( fread ( &src->h, sizeof ( src->h ), 1, src->fd ) == 1 && !memcmp ( src->h.magic, TRAIN_FILE_MAGIC, 8 ) ) {
 
-	if ( !PL_is_variable ( data_pt ) )
-		return type_error ( data_pt, "var" );
+		src->binary = TRUE;
+		if ( fstat ( fileno ( src->fd ), &st ) || !valid_train_file_header ( &src->h, st.st_size ) ) {
 
-    return PL_unify_pointer ( data_pt, fann_create_train ( num_data, num_input, num_output ) );
-}
-#endif
+			fclose ( src->fd );
+			return FALSE;
+		}
 
+		src->num_data = src->h.num_data;
+		src->num_input = src->h.num_input;
+		src->num_output = src->h.num_output;
 
-/* Not Finished: doesn't seem to make much sense from Prolog, advise me if you see any use for it
+		return TRUE;
+	}
 
-   swi_fann_create_train_from_callback
-*/
+	rewind ( src->fd );
 
+	for ( i = 0; i < 3; i++ )
+		if ( !stream_token ( src->fd, buf, sizeof ( buf ) ) || !parse_text_integer ( buf, buf + strlen ( buf ), UINT_MAX, v + i ) ) {
 
-foreign_t swi_fann_destroy_train ( term_t td_pt ) {
+			fclose ( src->fd );
+			return FALSE;
+		}
 
-	void *td;
+	src->num_data = ( unsigned int ) v[0];
+	src->num_input = ( unsigned int ) v[1];
+	src->num_output = ( unsigned int ) v[2];
+	src->body = ftell ( src->fd );
 
-	if ( !PL_get_pointer ( td_pt, &td ) )
-		return type_error ( td_pt, "pointer" );
+	if ( !src->num_input || !src->num_output || src->body < 0 ) {
 
-    fann_destroy_train ( td );
+		fclose ( src->fd );
+		return FALSE;
+	}
 
-	PL_succeed;
+	return TRUE;
 }
 
 
-foreign_t swi_fann_shuffle_train_data ( term_t td_pt ) {
-
-	void *td;
+// Reads the next chunk->num_data rows of src into chunk.
 
-	if ( !PL_get_pointer ( td_pt, &td ) )
-		return type_error ( td_pt, "pointer" );
+static int read_train_stream ( train_stream *src, struct fann_train_data *chunk ) {
 
-    fann_shuffle_train_data ( td );
+	char buf[TEXT_TOKEN_MAX];
+	unsigned int i, j;
+	size_t n;
 
-	PL_succeed;
-}
+	if ( src->compact )
+		widen_compact_rows ( src->compact, src->next, chunk );
+	else if ( src->binary ) {
 
+		n = ( size_t ) chunk->num_data * src->num_input;
+		if ( fseeko ( src->fd, src->h.input_offset + ( off_t ) src->next * src->num_input * sizeof ( fann_type ), SEEK_SET ) ||
+			fread ( chunk->input[0], sizeof ( fann_type ), n, src->fd ) != n )
+			return FALSE;
+		to_little_endian ( chunk->input[0], sizeof ( fann_type ), n );
 
-foreign_t swi_fann_scale_train ( term_t ann_pt, term_t data_pt ) {
+		n = ( size_t ) chunk->num_data * src->num_output;
+		if ( fseeko ( src->fd, src->h.output_offset + ( off_t ) src->next * src->num_output * sizeof ( fann_type ), SEEK_SET ) ||
+			fread ( chunk->output[0], sizeof ( fann_type ), n, src->fd ) != n )
+			return FALSE;
+		to_little_endian ( chunk->output[0], sizeof ( fann_type ), n );
+	}
+	else {
 
-#ifndef FIXEDFANN
+		if ( src->next == 0 && fseek ( src->fd, src->body, SEEK_SET ) )
+			return FALSE;
 
-	void *ann, *data;
+		for ( i = 0; i < chunk->num_data; i++ )
+			for ( j = 0; j < src->num_input + src->num_output; j++ )
+				if ( !stream_token ( src->fd, buf, sizeof ( buf ) ) ||
+					!parse_text_value ( buf, buf + strlen ( buf ), j < src->num_input ? chunk->input[i] + j : chunk->output[i] + j - src->num_input, ( locale_t ) 0 ) )
+					return FALSE;
+	}
 
-	if ( !PL_get_pointer ( ann_pt, &ann ) )
-		return type_error ( ann_pt, "pointer" );
-	if ( !PL_get_pointer ( data_pt, &data ) )
-		return type_error ( data_pt, "pointer" );
+	if ( ( src->next += chunk->num_data ) == src->num_data )
+		src->next = 0;
 
-	fann_scale_train ( ann, data );
+	return TRUE;
+}
 
-	PL_succeed;
 
-#else
+static void *stream_read_thread ( void *arg ) {
 
-	return type_error ( ann_pt, "not available fixedfann" );
+	stream_reader *reader = arg;
+	unsigned int b, rows, chunk_rows = reader->chunk[0]->num_data;
+	int ok;
 
-#endif
+	if ( reader->c_locale )
+		uselocale ( reader->c_locale );
 
-}
+	for ( b = 0; ; b ^= 1 ) {
 
+		pthread_mutex_lock ( &reader->lock );
+		while ( !reader->stop && reader->state[b] != STREAM_FREE )
+			pthread_cond_wait ( &reader->cond, &reader->lock );
+		pthread_mutex_unlock ( &reader->lock );
 
-foreign_t swi_fann_descale_train ( term_t ann_pt, term_t data_pt ) {
+		if ( reader->stop )
+			return NULL;
 
-#ifndef FIXEDFANN
+		rows = reader->src.num_data - reader->src.next;
+		reader->chunk[b]->num_data = rows < chunk_rows ? rows : chunk_rows;
+		ok = read_train_stream ( &reader->src, reader->chunk[b] );
 
-	void *ann, *data;
+		pthread_mutex_lock ( &reader->lock );
+		reader->state[b] = ok ? STREAM_READY : STREAM_FAILED;
+		reader->last[b] = reader->src.next == 0;
+		pthread_cond_broadcast ( &reader->cond );
+		pthread_mutex_unlock ( &reader->lock );
 
-	if ( !PL_get_pointer ( ann_pt, &ann ) )
-		return type_error ( ann_pt, "pointer" );
-	if ( !PL_get_pointer ( data_pt, &data ) )
-		return type_error ( data_pt, "pointer" );
+		if ( !ok )
+			return NULL;
+	}
+}
 
-	fann_descale_train ( ann, data );
 
-	PL_succeed;
+// Waits for buffer b, returns NULL if it could not be read.
 
-#else
+static struct fann_train_data *stream_chunk ( stream_reader *reader, unsigned int b ) {
 
-	return type_error ( ann_pt, "not available fixedfann" );
+	enum stream_state state;
 
-#endif
+	pthread_mutex_lock ( &reader->lock );
+	while ( ( state = reader->state[b] ) == STREAM_FREE )
+		pthread_cond_wait ( &reader->cond, &reader->lock );
+	pthread_mutex_unlock ( &reader->lock );
 
+	return state == STREAM_READY ? reader->chunk[b] : NULL;
 }
 
 
-foreign_t swi_fann_set_input_scaling_params ( term_t ann_pt, term_t data_pt, term_t new_input_min_pt, term_t new_input_max_pt ) {
+static void stream_release ( stream_reader *reader, unsigned int b ) {
 
-#ifndef FIXEDFANN
+	pthread_mutex_lock ( &reader->lock );
+	reader->state[b] = STREAM_FREE;
+	pthread_cond_broadcast ( &reader->cond );
+	pthread_mutex_unlock ( &reader->lock );
+}
 
-	void *ann, *data;
-	double new_input_min, new_input_max;
 
-	if ( !PL_get_pointer ( ann_pt, &ann ) )
-		return type_error ( ann_pt, "pointer" );
-	if ( !PL_get_pointer ( data_pt, &data ) )
-		return type_error ( data_pt, "pointer" );
-	if ( !PL_get_float ( new_input_min_pt, &new_input_min ) )
-		return type_error ( new_input_min_pt, "float" );
-    if ( !PL_get_float ( new_input_max_pt, &new_input_max ) )
-		return type_error ( new_input_max_pt, "float" );
+// One epoch over all chunks, starting at buffer *b. Returns FALSE if a
+// chunk could not be read, and stops early when ctl says so.
 
-	if ( fann_set_input_scaling_params ( ann, data, new_input_min, new_input_max ) )
-		return type_error ( ann_pt, "fann_error" );
+static int train_stream_epoch ( struct fann *ann, stream_reader *reader, unsigned int *b, struct fann_train_data *order, rng *r, train_ctl *ctl ) {
 
-	PL_succeed;
+	struct fann_train_data *chunk, *rows;
+	unsigned int i, num_data = 0, num_MSE = 0, num_bit_fail = 0;
+	float MSE_value = 0.0f;
+	int incremental = ann->training_algorithm == FANN_TRAIN_INCREMENTAL, last;
 
-#else
+	if ( !incremental && ann->training_algorithm != FANN_TRAIN_BATCH && ann->prev_train_slopes == NULL )
+		fann_clear_train_arrays ( ann );
 
-	return type_error ( ann_pt, "not available fixedfann" );
+	fann_reset_MSE ( ann );
 
-#endif
+	do {
 
-}
+		if ( ( chunk = stream_chunk ( reader, *b ) ) == NULL )
+			return FALSE;
 
+		rows = chunk;
+		if ( r ) {
 
-foreign_t swi_fann_set_output_scaling_params ( term_t ann_pt, term_t data_pt, term_t new_output_min_pt, term_t new_output_max_pt ) {
+			init_view ( order, chunk, chunk->num_data );
+			memcpy ( order->input, chunk->input, chunk->num_data * sizeof ( fann_type* ) );
+			memcpy ( order->output, chunk->output, chunk->num_data * sizeof ( fann_type* ) );
+			shuffle_rows ( order, r );
+			rows = order;
+		}
 
-#ifndef FIXEDFANN
+		if ( incremental ) {
 
-	void *ann, *data;
-	double new_output_min, new_output_max;
+			fann_train_epoch ( ann, rows );
+			MSE_value += ann->MSE_value;
+			num_MSE += ann->num_MSE;
+			num_bit_fail += ann->num_bit_fail;
+		}
+		else
+			for ( i = 0; i < rows->num_data; i++ ) {
 
-	if ( !PL_get_pointer ( ann_pt, &ann ) )
-		return type_error ( ann_pt, "pointer" );
-	if ( !PL_get_pointer ( data_pt, &data ) )
-		return type_error ( data_pt, "pointer" );
-	if ( !PL_get_float ( new_output_min_pt, &new_output_min ) )
-		return type_error ( new_output_min_pt, "float" );
-    if ( !PL_get_float ( new_output_max_pt, &new_output_max ) )
-		return type_error ( new_output_max_pt, "float" );
+				fann_run ( ann, rows->input[i] );
+				fann_compute_MSE ( ann, rows->output[i] );
+				fann_backpropagate_MSE ( ann );
+				fann_update_slopes_batch ( ann, ann->first_layer + 1, ann->last_layer - 1 );
+			}
 
-	if ( fann_set_output_scaling_params ( ann, data, new_output_min, new_output_max ) )
-		return type_error ( ann_pt, "fann_error" );
+		num_data += chunk->num_data;
+		last = reader->last[*b];
 
-	PL_succeed;
+		if ( r )
+			free_view ( order );
+		stream_release ( reader, *b );
+		*b ^= 1;
 
-#else
+		if ( !train_ctl_poll ( ctl ) ) {
 
-	return type_error ( ann_pt, "not available fixedfann" );
+			// The partial sums of an interrupted epoch are dropped.
+			if ( !incremental && ann->train_slopes )
+				memset ( ann->train_slopes, 0, ann->total_connections_allocated * sizeof ( fann_type ) );
+			return TRUE;
+		}
+	}
+	while ( !last );
 
+	if ( incremental ) {
+
+		ann->MSE_value = MSE_value;
+		ann->num_MSE = num_MSE;
+		ann->num_bit_fail = num_bit_fail;
+	}
+	else
+		switch ( ann->training_algorithm ) {
+
+			case FANN_TRAIN_BATCH:
+				fann_update_weights_batch ( ann, num_data, 0, ann->total_connections );
+				break;
+			case FANN_TRAIN_RPROP:
+				fann_update_weights_irpropm ( ann, 0, ann->total_connections );
+				break;
+			case FANN_TRAIN_QUICKPROP:
+				fann_update_weights_quickprop ( ann, num_data, 0, ann->total_connections );
+				break;
+#ifdef VERSION220
+			case FANN_TRAIN_SARPROP:
+				fann_update_weights_sarprop ( ann, ann->sarprop_epoch, 0, ann->total_connections );
+				ann->sarprop_epoch++;
+				break;
 #endif
+			default:
+				break; // Refused by check_stream_algorithm ().
+		}
 
+	return TRUE;
 }
 
 
-foreign_t swi_fann_set_scaling_params ( term_t ann_pt, term_t data_pt, term_t new_input_min_pt, term_t new_input_max_pt, term_t new_output_min_pt, term_t new_output_max_pt ) {
-
-#ifndef FIXEDFANN
+// The training algorithms train_stream_epoch () implements.
 
-	void *ann, *data;
-	double new_input_min, new_input_max, new_output_min, new_output_max;
+static int check_stream_algorithm ( term_t ann_pt, struct fann *ann ) {
 
-	if ( !PL_get_pointer ( ann_pt, &ann ) )
-		return type_error ( ann_pt, "pointer" );
-	if ( !PL_get_pointer ( data_pt, &data ) )
-		return type_error ( data_pt, "pointer" );
-	if ( !PL_get_float ( new_input_min_pt, &new_input_min ) )
-		return type_error ( new_input_min_pt, "float" );
-    if ( !PL_get_float ( new_input_max_pt, &new_input_max ) )
-		return type_error ( new_input_max_pt, "float" );
-	if ( !PL_get_float ( new_output_min_pt, &new_output_min ) )
-		return type_error ( new_output_min_pt, "float" );
-    if ( !PL_get_float ( new_output_max_pt, &new_output_max ) )
-		return type_error ( new_output_max_pt, "float" );
+	switch ( ann->training_algorithm ) {
 
-	if ( fann_set_scaling_params ( ann, data, new_input_min, new_input_max, new_output_min, new_output_max ) )
-		return type_error ( ann_pt, "fann_error" );
+		case FANN_TRAIN_INCREMENTAL:
+		case FANN_TRAIN_BATCH:
+		case FANN_TRAIN_RPROP:
+		case FANN_TRAIN_QUICKPROP:
+#ifdef VERSION220
+		case FANN_TRAIN_SARPROP:
+#endif
+			PL_succeed;
+		default:
+			return domain_error ( ann_pt, "stream_training_algorithm" );
+	}
+}
 
-	PL_succeed;
 
-#else
+// The loop and reports of train_on_data_ctl () over a streamed file.
 
-	return type_error ( ann_pt, "not available fixedfann" );
+static int train_on_stream_ctl ( struct fann *ann, stream_reader *reader, unsigned int max_epochs, unsigned int epochs_between_reports, float desired_error, train_ctl *ctl ) {
 
-#endif
+	unsigned int i, b = 0;
+	float error;
+	best_weights best;
+	struct fann_train_data order;
+	ann_info *info = ctl->shuffle ? get_ann_info ( ann ) : NULL, *scheduled;
+	rng *r = info ? &info->rng : NULL;
+	int reached, ok = TRUE;
 
-}
+	best_weights_init ( &best, ann, ctl );
 
+	if ( epochs_between_reports )
+		printf ( "Max epochs %8d. Desired error: %.10f.\n", max_epochs, desired_error );
 
-foreign_t swi_fann_clear_scaling_params ( term_t ann_pt ) {
+	for ( i = 1; i <= max_epochs; i++ ) {
 
-#ifndef FIXEDFANN
+		best_weights_before ( &best, ann );
 
-	void *ann;
+		scheduled = apply_schedules ( ann );
+		if ( !( ok = train_stream_epoch ( ann, reader, &b, &order, r, ctl ) ) || ctl->stop != TRAIN_RUNNING )
+			break;
 
-	if ( !PL_get_pointer ( ann_pt, &ann ) )
-		return type_error ( ann_pt, "pointer" );
+		error = fann_get_MSE ( ann );
+		apply_schedules_after ( scheduled, error );
+		reached = desired_error_reached ( ann, desired_error );
+		best_weights_after ( &best, error );
 
-	fann_clear_scaling_params ( ann );
+		if ( epochs_between_reports &&
+			( i % epochs_between_reports == 0 || i == max_epochs || i == 1 || reached ) )
+			printf ( "Epochs     %8d. Current error: %.10f. Bit fail %d.\n", i, error, fann_get_bit_fail ( ann ) );
 
-	PL_succeed;
+		if ( reached || !train_ctl_poll ( ctl ) )
+			break;
+	}
 
-#else
+	best_weights_finish ( &best, ann, ctl );
 
-	return type_error ( ann_pt, "not available fixedfann" );
+	return ok;
+}
 
-#endif
+// Starts the reader thread over reader->src and trains in chunks of
+// chunk_rows rows. Returns -1 if the buffers or the thread could not be set
+// up, and 0 if the source could not be read.
 
-}
+static int run_train_stream ( struct fann *ann, stream_reader *reader, unsigned int chunk_rows, unsigned int max_epochs, unsigned int epochs_between_reports, float desired_error, train_ctl *ctl ) {
 
+	unsigned int b;
+	int started, ok = FALSE;
 
-foreign_t swi_fann_scale_input ( term_t ann_pt, term_t input_pt ) {
+	if ( chunk_rows > reader->src.num_data )
+		chunk_rows = reader->src.num_data;
 
-#ifndef FIXEDFANN
+	for ( b = 0; b < 2; b++ )
+		reader->chunk[b] = create_owned_train_data ( chunk_rows, reader->src.num_input, reader->src.num_output );
 
-	unsigned int i, num_input;
-	fann_type *input;
-	term_t temp_pt = PL_new_term_ref ();
-	void *ann;
+	reader->c_locale = newlocale ( LC_NUMERIC_MASK, "C", ( locale_t ) 0 );
+	pthread_mutex_init ( &reader->lock, NULL );
+	pthread_cond_init ( &reader->cond, NULL );
 
-	if ( !PL_get_pointer ( ann_pt, &ann ) )
-		return type_error ( ann_pt, "pointer" );
+	started = reader->chunk[0] && reader->chunk[1] && !pthread_create ( &reader->thread, NULL, stream_read_thread, reader );
 
-	num_input = fann_get_num_input( ann );
-	input = PL_malloc ( num_input * sizeof ( fann_type ) );
+	if ( started ) {
 
-	for ( i = 0; i < num_input; i++ ) {
+		ok = train_on_stream_ctl ( ann, reader, max_epochs, epochs_between_reports, desired_error, ctl );
 
-		if ( !PL_unify_list ( input_pt, temp_pt, input_pt ) )
-			return type_error ( input_pt, "list" );
-	    if ( !PL_FANN_GET_FANNTYPE(temp_pt,input+i) )
-			return type_error ( temp_pt, PL_FANN_FANNTYPE );
+		pthread_mutex_lock ( &reader->lock );
+		reader->stop = TRUE;
+		pthread_cond_broadcast ( &reader->cond );
+		pthread_mutex_unlock ( &reader->lock );
+		pthread_join ( reader->thread, NULL );
 	}
 
-	if ( !PL_unify_nil ( input_pt ) )
-		return type_error ( input_pt, "list" );
+	pthread_cond_destroy ( &reader->cond );
+	pthread_mutex_destroy ( &reader->lock );
+	if ( reader->c_locale )
+		freelocale ( reader->c_locale );
+	for ( b = 0; b < 2; b++ )
+		if ( reader->chunk[b] )
+			fann_destroy_train ( reader->chunk[b] );
 
-	fann_scale_input ( ann, input );
+	if ( !started )
+		return -1;
+
+	return ok;
+}
 
-	PL_free ( input );
 
-	PL_succeed;
+// Reads the chunk_rows(N) option.
 
-#else
+static int get_chunk_rows_option ( term_t options_pt, unsigned int *chunk_rows ) {
 
-	return type_error ( ann_pt, "not available fixedfann" );
+	term_t head_pt = PL_new_term_ref ();
+	term_t arg_pt = PL_new_term_ref ();
+	term_t list_pt = PL_copy_term_ref ( options_pt );
+	atom_t name;
+	size_t arity;
+	int rows;
 
-#endif
+	while ( PL_get_list ( list_pt, head_pt, list_pt ) )
+		if ( PL_get_name_arity ( head_pt, &name, &arity ) && arity == 1 && !strcmp ( "chunk_rows", PL_atom_chars ( name ) ) ) {
+
+			PL_get_arg ( 1, head_pt, arg_pt );
+			if ( !PL_get_integer ( arg_pt, &rows ) )
+				return type_error ( arg_pt, "integer" );
+			if ( rows < 1 )
+				return domain_error ( arg_pt, "positive_integer" );
+			*chunk_rows = rows;
+		}
 
+	return TRUE;
 }
 
+#endif
+
+
+foreign_t swi_fann_train_on_file_6 ( term_t ann_pt, term_t file_pt, term_t max_epochs_pt, term_t epochs_between_reports_pt, term_t desired_error_pt, term_t options_pt ) {
+
+#ifndef FIXEDFANN
+
+	unsigned int chunk_rows = STREAM_CHUNK_ROWS;
+	int max_epochs, epochs_between_reports;
+	struct fann *ann;
+	stream_reader reader;
+	double desired_error;
+	handle_uses uses = { { NULL }, 0 };
+	train_ctl ctl;
+	char *file;
+	int rc;
+
+	if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
+	if ( !check_stream_algorithm ( ann_pt, ann ) )
+		PL_fail;
+	if ( !PL_get_file_name ( file_pt, &file, PL_FILE_ABSOLUTE | PL_FILE_OSPATH ) )
+		return type_error ( file_pt, "file" );
+
+	if ( !PL_get_integer ( max_epochs_pt, &max_epochs ) )
+		return type_error ( max_epochs_pt, "integer" );
+	if ( max_epochs < 1 )
+		return domain_error ( max_epochs_pt, "positive_integer" );
+
+	if ( !PL_get_integer ( epochs_between_reports_pt, &epochs_between_reports ) )
+		return type_error ( epochs_between_reports_pt, "integer" );
+	if ( epochs_between_reports < 0 )
+		return domain_error ( epochs_between_reports_pt, "nonneg" );
 
-foreign_t swi_fann_scale_output ( term_t ann_pt, term_t output_pt ) {
+	if ( !PL_get_float ( desired_error_pt, &desired_error ) )
+		return type_error ( desired_error_pt, "float" );
 
-#ifndef FIXEDFANN
+	if ( !get_train_options ( options_pt, &ctl ) )
+		PL_fail;
+	if ( ctl.checkpoint[0] )
+		return domain_error ( options_pt, "streaming_option" );
 
-	unsigned int i, num_output;
-	fann_type *output;
-	term_t temp_pt = PL_new_term_ref ();
-	void *ann;
+	if ( !get_chunk_rows_option ( options_pt, &chunk_rows ) )
+		PL_fail;
 
-	if ( !PL_get_pointer ( ann_pt, &ann ) )
-		return type_error ( ann_pt, "pointer" );
+	memset ( &reader, 0, sizeof ( reader ) );
 
-	num_output = fann_get_num_output( ann );
-	output = PL_malloc ( num_output * sizeof ( fann_type ) );
+	if ( !open_train_stream ( file, &reader.src ) )
+		return domain_error ( file_pt, "fann_train_file" );
 
-	for ( i = 0; i < num_output; i++ ) {
+	if ( reader.src.num_input != fann_get_num_input ( ann ) || reader.src.num_output != fann_get_num_output ( ann ) || !reader.src.num_data ) {
 
-		if ( !PL_unify_list ( output_pt, temp_pt, output_pt ) )
-			return type_error ( output_pt, "list" );
-	    if ( !PL_FANN_GET_FANNTYPE(temp_pt,output+i) )
-			return type_error ( temp_pt, PL_FANN_FANNTYPE );
+		fclose ( reader.src.fd );
+		return domain_error ( file_pt, "fann_train_file" );
 	}
 
-	if ( !PL_unify_nil ( output_pt ) )
-		return type_error ( output_pt, "list" );
+	if ( !use_handle ( &uses, ann_pt, &ann_blob ) ) {
 
-	fann_scale_output ( ann, output );
+		fclose ( reader.src.fd );
+		PL_fail;
+	}
 
-	PL_free ( output );
+	rc = run_train_stream ( ann, &reader, chunk_rows, max_epochs, epochs_between_reports, ( float ) desired_error, &ctl );
+	fclose ( reader.src.fd );
+	unuse_handles ( &uses );
 
-	PL_succeed;
+	if ( rc < 0 )
+		return type_error ( ann_pt, "fann_error" );
+	if ( !rc )
+		return domain_error ( file_pt, "fann_train_file" );
+
+	return train_ctl_result ( &ctl );
 
 #else
 
 	return type_error ( ann_pt, "not available fixedfann" );
 
 #endif
-
 }
 
 
-foreign_t swi_fann_descale_input ( term_t ann_pt, term_t input_pt ) {
+foreign_t swi_fann_compact_train_data ( term_t data_pt, term_t format_pt, term_t compact_pt ) {
 
 #ifndef FIXEDFANN
 
-	unsigned int i, num_input;
-	fann_type *input;
-	term_t temp_pt = PL_new_term_ref ();
-	void *ann;
-
-	if ( !PL_get_pointer ( ann_pt, &ann ) )
-		return type_error ( ann_pt, "pointer" );
-
-	num_input = fann_get_num_input( ann );
-	input = PL_malloc ( num_input * sizeof ( fann_type ) );
-
-	for ( i = 0; i < num_input; i++ ) {
+	struct fann_train_data *data;
+	compact_train *c;
+	char *format;
+	int f, finite;
 
-		if ( !PL_unify_list ( input_pt, temp_pt, input_pt ) )
-			return type_error ( input_pt, "list" );
-	    if ( !PL_FANN_GET_FANNTYPE(temp_pt,input+i) )
-			return type_error ( temp_pt, PL_FANN_FANNTYPE );
-	}
-
-	if ( !PL_unify_nil ( input_pt ) )
-		return type_error ( input_pt, "list" );
+	if ( !get_train_data ( data_pt, &data ) )
+		PL_fail;
+	if ( !PL_get_atom_chars ( format_pt, &format ) )
+		return type_error ( format_pt, "atom" );
+	if ( !PL_is_variable ( compact_pt ) )
+		return type_error ( compact_pt, "var" );
 
-	fann_descale_input ( ann, input );
+	for ( f = COMPACT_INT16; f >= 0 && strcmp ( COMPACT_FORMAT_NAMES[f], format ); f-- )
+		;
+	if ( f < 0 )
+		return domain_error ( format_pt, "compact_format" );
 
-	PL_free ( input );
+	if ( ( c = create_compact_train ( data, f, &finite ) ) == NULL )
+		return finite ? type_error ( data_pt, "fann_error" ) : domain_error ( data_pt, "finite_train_data" );
 
-	PL_succeed;
+	return unify_compact_train ( compact_pt, c );
 
 #else
 
-	return type_error ( ann_pt, "not available fixedfann" );
+	return type_error ( data_pt, "not available fixedfann" );
 
 #endif
-
 }
 
 
-foreign_t swi_fann_descale_output ( term_t ann_pt, term_t output_pt ) {
+foreign_t swi_fann_expand_train_data ( term_t compact_pt, term_t data_pt ) {
 
 #ifndef FIXEDFANN
 
-	unsigned int i, num_output;
-	fann_type *output;
-	term_t temp_pt = PL_new_term_ref ();
-	void *ann;
-
-	if ( !PL_get_pointer ( ann_pt, &ann ) )
-		return type_error ( ann_pt, "pointer" );
+	struct fann_train_data *data;
+	compact_train *c;
 
-	num_output = fann_get_num_output( ann );
-	output = PL_malloc ( num_output * sizeof ( fann_type ) );
-
-	for ( i = 0; i < num_output; i++ ) {
-
-		if ( !PL_unify_list ( output_pt, temp_pt, output_pt ) )
-			return type_error ( output_pt, "list" );
-	    if ( !PL_FANN_GET_FANNTYPE(temp_pt,output+i) )
-			return type_error ( temp_pt, PL_FANN_FANNTYPE );
-	}
-
-	if ( !PL_unify_nil ( output_pt ) )
-		return type_error ( output_pt, "list" );
+	if ( !get_compact_train ( compact_pt, &c ) )
+		PL_fail;
+	if ( !PL_is_variable ( data_pt ) )
+		return type_error ( data_pt, "var" );
 
-	fann_descale_output ( ann, output );
+	if ( ( data = create_owned_train_data ( c->num_data, c->num_input, c->num_output ) ) == NULL )
+		return type_error ( compact_pt, "fann_error" );
 
-	PL_free ( output );
+	widen_compact_rows ( c, 0, data );
 
-	PL_succeed;
+	return unify_train_data ( data_pt, data );
 
 #else
 
-	return type_error ( ann_pt, "not available fixedfann" );
+	return type_error ( compact_pt, "not available fixedfann" );
 
 #endif
-
 }
 
 
-foreign_t swi_fann_scale_input_train_data ( term_t data_pt, term_t new_min_pt, term_t new_max_pt ) {
-
-	void *data;
-	fann_type new_min, new_max;
-
-	if ( !PL_get_pointer ( data_pt, &data ) )
-		return type_error ( data_pt, "pointer" );
-	if ( !PL_FANN_GET_FANNTYPE(new_min_pt,&new_min) )
-		return type_error ( new_min_pt, PL_FANN_FANNTYPE );
-	if ( !PL_FANN_GET_FANNTYPE(new_max_pt,&new_max) )
-		return type_error ( new_max_pt, PL_FANN_FANNTYPE );
-
-	fann_scale_input_train_data ( data, new_min, new_max );
+foreign_t swi_fann_compact_train_error ( term_t compact_pt, term_t max_error_pt, term_t rms_error_pt ) {
 
-	PL_succeed;
-}
+#ifndef FIXEDFANN
 
+	compact_train *c;
 
-foreign_t swi_fann_scale_output_train_data ( term_t data_pt, term_t new_min_pt, term_t new_max_pt ) {
+	if ( !get_compact_train ( compact_pt, &c ) )
+		PL_fail;
 
-	void *data;
-	fann_type new_min, new_max;
+	return PL_unify_float ( max_error_pt, c->max_error ) && PL_unify_float ( rms_error_pt, c->rms_error );
 
-	if ( !PL_get_pointer ( data_pt, &data ) )
-		return type_error ( data_pt, "pointer" );
-	if ( !PL_FANN_GET_FANNTYPE(new_min_pt,&new_min) )
-		return type_error ( new_min_pt, PL_FANN_FANNTYPE );
-	if ( !PL_FANN_GET_FANNTYPE(new_max_pt,&new_max) )
-		return type_error ( new_max_pt, PL_FANN_FANNTYPE );
+#else
 
-	fann_scale_output_train_data ( data, new_min, new_max );
+	return type_error ( compact_pt, "not available fixedfann" );
 
-	PL_succeed;
+#endif
 }
 
 
-foreign_t swi_fann_scale_train_data ( term_t data_pt, term_t new_min_pt, term_t new_max_pt ) {
-
-	void *data;
-	fann_type new_min, new_max;
-
-	if ( !PL_get_pointer ( data_pt, &data ) )
-		return type_error ( data_pt, "pointer" );
-	if ( !PL_FANN_GET_FANNTYPE(new_min_pt,&new_min) )
-		return type_error ( new_min_pt, PL_FANN_FANNTYPE );
-	if ( !PL_FANN_GET_FANNTYPE(new_max_pt,&new_max) )
-		return type_error ( new_max_pt, PL_FANN_FANNTYPE );
-
-	fann_scale_train_data ( data, new_min, new_max );
-
-	PL_succeed;
-}
+foreign_t swi_fann_destroy_compact_train ( term_t compact_pt ) {
 
+#ifndef FIXEDFANN
 
-foreign_t swi_fann_merge_train_data ( term_t data1_pt, term_t data2_pt, term_t data3_pt ) {
+	return destroy_handle ( compact_pt, &compact_blob );
 
-	void *data1, *data2;
+#else
 
-	if ( !PL_get_pointer ( data1_pt, &data1 ) )
-		return type_error ( data1_pt, "pointer" );
-	if ( !PL_get_pointer ( data2_pt, &data2 ) )
-		return type_error ( data2_pt, "pointer" );
-	if ( !PL_is_variable ( data3_pt ) )
-		return type_error ( data3_pt, "var" );
+	return type_error ( compact_pt, "not available fixedfann" );
 
-	return PL_unify_pointer ( data3_pt, fann_merge_train_data ( data1, data2 ) );
+#endif
 }
 
 
-foreign_t swi_fann_duplicate_train_data ( term_t data1_pt, term_t data2_pt ) {
-
-	void *data1;
+foreign_t swi_fann_train_on_compact ( term_t ann_pt, term_t compact_pt, term_t max_epochs_pt, term_t epochs_between_reports_pt, term_t desired_error_pt, term_t options_pt ) {
 
-	if ( !PL_get_pointer ( data1_pt, &data1 ) )
-		return type_error ( data1_pt, "pointer" );
-	if ( !PL_is_variable ( data2_pt ) )
-		return type_error ( data2_pt, "var" );
+#ifndef FIXEDFANN
 
-	return PL_unify_pointer ( data2_pt, fann_duplicate_train_data ( data1 ) );
-}
+	unsigned int chunk_rows = COMPACT_CHUNK_ROWS;
+	int max_epochs, epochs_between_reports;
+	struct fann *ann;
+	compact_train *c;
+	stream_reader reader;
+	double desired_error;
+	handle_uses uses = { { NULL }, 0 };
+	train_ctl ctl;
+	int rc;
 
+	if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
+	if ( !check_stream_algorithm ( ann_pt, ann ) )
+		PL_fail;
+	if ( !get_compact_train ( compact_pt, &c ) )
+		PL_fail;
 
-foreign_t swi_fann_subset_train_data ( term_t data1_pt, term_t pos_pt, term_t len_pt, term_t data2_pt ) {
+	if ( !PL_get_integer ( max_epochs_pt, &max_epochs ) )
+		return type_error ( max_epochs_pt, "integer" );
+	if ( max_epochs < 1 )
+		return domain_error ( max_epochs_pt, "positive_integer" );
 
-	void *data1;
-	int pos, len;
+	if ( !PL_get_integer ( epochs_between_reports_pt, &epochs_between_reports ) )
+		return type_error ( epochs_between_reports_pt, "integer" );
+	if ( epochs_between_reports < 0 )
+		return domain_error ( epochs_between_reports_pt, "nonneg" );
 
-	if ( !PL_get_pointer ( data1_pt, &data1 ) )
-		return type_error ( data1_pt, "pointer" );
-	if ( !PL_get_integer ( pos_pt, &pos ) )
-		return type_error ( pos_pt, "integer" );
-	if ( pos < 0 )
-		return domain_error ( pos_pt, "nonneg" );
-    if ( !PL_get_integer ( len_pt, &len ) )
-		return type_error ( len_pt, "integer" );
-	if ( len < 1 )
-		return domain_error ( len_pt, "positive_integer" );
-	if ( !PL_is_variable ( data2_pt ) )
-		return type_error ( data2_pt, "var" );
+	if ( !PL_get_float ( desired_error_pt, &desired_error ) )
+		return type_error ( desired_error_pt, "float" );
 
-	return PL_unify_pointer ( data2_pt, fann_subset_train_data ( data1, pos, len ) );
-}
+	if ( !get_train_options ( options_pt, &ctl ) )
+		PL_fail;
+	if ( ctl.checkpoint[0] )
+		return domain_error ( options_pt, "streaming_option" );
 
+	if ( !get_chunk_rows_option ( options_pt, &chunk_rows ) )
+		PL_fail;
 
-foreign_t swi_fann_length_train_data ( term_t data_pt, term_t len_pt ) {
+	if ( c->num_input != fann_get_num_input ( ann ) || c->num_output != fann_get_num_output ( ann ) || !c->num_data )
+		return domain_error ( compact_pt, "fann_compact_train" );
 
-	void *data;
+	memset ( &reader, 0, sizeof ( reader ) );
+	reader.src.compact = c;
+	reader.src.num_data = c->num_data;
+	reader.src.num_input = c->num_input;
+	reader.src.num_output = c->num_output;
 
-	if ( !PL_get_pointer ( data_pt, &data ) )
-		return type_error ( data_pt, "pointer" );
+	if ( !use_handle ( &uses, ann_pt, &ann_blob ) || !use_handle ( &uses, compact_pt, &compact_blob ) )
+		PL_fail;
 
-	return PL_unify_integer ( len_pt, fann_length_train_data ( data ) );
-}
+	rc = run_train_stream ( ann, &reader, chunk_rows, max_epochs, epochs_between_reports, ( float ) desired_error, &ctl );
+	unuse_handles ( &uses );
 
+	if ( rc <= 0 )
+		return type_error ( ann_pt, "fann_error" );
 
-foreign_t swi_fann_num_input_train_data ( term_t data_pt, term_t len_pt ) {
+	return train_ctl_result ( &ctl );
 
-	void *data;
+#else
 
-	if ( !PL_get_pointer ( data_pt, &data ) )
-		return type_error ( data_pt, "pointer" );
+	return type_error ( ann_pt, "not available fixedfann" );
 
-	return PL_unify_integer ( len_pt, fann_num_input_train_data ( data ) );
+#endif
 }
 
 
-foreign_t swi_fann_num_output_train_data ( term_t data_pt, term_t len_pt ) {
+// As fann_test_data (), on rows widened a chunk at a time.
 
-	void *data;
+foreign_t swi_fann_test_compact ( term_t ann_pt, term_t compact_pt, term_t MSE_pt ) {
 
-	if ( !PL_get_pointer ( data_pt, &data ) )
-		return type_error ( data_pt, "pointer" );
+#ifndef FIXEDFANN
 
-	return PL_unify_integer ( len_pt, fann_num_output_train_data ( data ) );
-}
+	struct fann_train_data *chunk;
+	unsigned int i, first, rows;
+	struct fann *ann;
+	compact_train *c;
 
+	if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
+	if ( !get_compact_train ( compact_pt, &c ) )
+		PL_fail;
+	if ( !PL_is_variable ( MSE_pt ) )
+		return type_error ( MSE_pt, "var" );
 
-foreign_t swi_fann_save_train ( term_t data_pt, term_t file_pt ) {
+	if ( c->num_input != fann_get_num_input ( ann ) || c->num_output != fann_get_num_output ( ann ) )
+		return domain_error ( compact_pt, "fann_compact_train" );
 
-	void *data;
-	char *file;
+	rows = c->num_data < COMPACT_CHUNK_ROWS ? c->num_data : COMPACT_CHUNK_ROWS;
+	if ( ( chunk = create_owned_train_data ( rows, c->num_input, c->num_output ) ) == NULL )
+		return type_error ( ann_pt, "fann_error" );
 
-	if ( !PL_get_pointer ( data_pt, &data ) )
-		return type_error ( data_pt, "pointer" );
-	if ( !PL_get_file_name ( file_pt, &file, PL_FILE_ABSOLUTE ) )
-		return type_error ( file_pt, "file" );
+	fann_reset_MSE ( ann );
 
-	if ( fann_save_train ( data, file ) )
-		return type_error ( data_pt, "fann_error" );
+	for ( first = 0; first < c->num_data; first += chunk->num_data ) {
 
-	PL_succeed;
-}
+		chunk->num_data = c->num_data - first < rows ? c->num_data - first : rows;
+		widen_compact_rows ( c, first, chunk );
 
+		for ( i = 0; i < chunk->num_data; i++ )
+			fann_test ( ann, chunk->input[i], chunk->output[i] );
+	}
 
-foreign_t swi_fann_save_train_to_fixed ( term_t data_pt, term_t file_pt, term_t dec_pt ) {
+	fann_destroy_train ( chunk );
 
-	void *data;
-	char *file;
-	int dec;
+	return PL_unify_float ( MSE_pt, fann_get_MSE ( ann ) );
 
-	if ( !PL_get_pointer ( data_pt, &data ) )
-		return type_error ( data_pt, "pointer" );
-	if ( !PL_get_file_name ( file_pt, &file, PL_FILE_ABSOLUTE ) )
-		return type_error ( file_pt, "file" );
-	if ( !PL_get_integer ( dec_pt, &dec ) )
-		return type_error ( dec_pt, "integer" );
-	if ( dec < 0 )
-		return domain_error ( dec_pt, "nonneg" );
+#else
 
-	if ( fann_save_train_to_fixed ( data, file, dec ) )
-		return type_error ( data_pt, "fann_error" );
+	return type_error ( ann_pt, "not available fixedfann" );
 
-	PL_succeed;
+#endif
 }
 
 
+
 foreign_t swi_fann_get_training_algorithm ( term_t ann_pt, term_t type_pt ) {
 
-	void *ann;
+	struct fann *ann;
 
-	if ( !PL_get_pointer ( ann_pt, &ann ) )
-		return type_error ( ann_pt, "pointer" );
+	if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
 
     return PL_unify_atom_chars ( type_pt, FANN_TRAIN_NAMES[ fann_get_training_algorithm ( ann ) ] );
 }
@@ -1742,10 +8953,10 @@ foreign_t swi_fann_get_training_algorithm ( term_t ann_pt, term_t type_pt ) {
 foreign_t swi_fann_set_training_algorithm ( term_t ann_pt, term_t type_pt ) {
 
 	char *type;
-	void *ann;
+	struct fann *ann;
 
-	if ( !PL_get_pointer ( ann_pt, &ann ) )
-		return type_error ( ann_pt, "pointer" );
+	if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
 	if ( !PL_get_chars ( type_pt, &type, CVT_ATOM ) )
 		return type_error ( type_pt, "atom" );
 
@@ -1768,10 +8979,10 @@ foreign_t swi_fann_set_training_algorithm ( term_t ann_pt, term_t type_pt ) {
 
 foreign_t swi_fann_get_learning_rate ( term_t ann_pt, term_t out_pt ) {
 
-	void *ann;
+	struct fann *ann;
 
-	if ( !PL_get_pointer ( ann_pt, &ann ) )
-		return type_error ( ann_pt, "pointer" );
+	if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
 	if ( !PL_is_variable ( out_pt ) )
 		return type_error ( out_pt, "var" );
 
@@ -1782,10 +8993,10 @@ foreign_t swi_fann_get_learning_rate ( term_t ann_pt, term_t out_pt ) {
 foreign_t swi_fann_set_learning_rate ( term_t ann_pt, term_t in_pt ) {
 
 	double in;
-	void *ann;
+	struct fann *ann;
 
-	if ( !PL_get_pointer ( ann_pt, &ann ) )
-		return type_error ( ann_pt, "pointer" );
+	if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
 	if ( !PL_get_float ( in_pt, &in ) )
 		return type_error ( in_pt, "float" );
 
@@ -1797,10 +9008,10 @@ foreign_t swi_fann_set_learning_rate ( term_t ann_pt, term_t in_pt ) {
 
 foreign_t swi_fann_get_learning_momentum ( term_t ann_pt, term_t out_pt ) {
 
-	void *ann;
+	struct fann *ann;
 
-	if ( !PL_get_pointer ( ann_pt, &ann ) )
-		return type_error ( ann_pt, "pointer" );
+	if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
 	if ( !PL_is_variable ( out_pt ) )
 		return type_error ( out_pt, "var" );
 
@@ -1811,10 +9022,10 @@ foreign_t swi_fann_get_learning_momentum ( term_t ann_pt, term_t out_pt ) {
 foreign_t swi_fann_set_learning_momentum ( term_t ann_pt, term_t in_pt ) {
 
 	double in;
-	void *ann;
+	struct fann *ann;
 
-	if ( !PL_get_pointer ( ann_pt, &ann ) )
-		return type_error ( ann_pt, "pointer" );
+	if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
 	if ( !PL_get_float ( in_pt, &in ) )
 		return type_error ( in_pt, "float" );
 
@@ -1827,10 +9038,10 @@ foreign_t swi_fann_set_learning_momentum ( term_t ann_pt, term_t in_pt ) {
 foreign_t swi_fann_get_activation_function ( term_t ann_pt, term_t layer_pt, term_t neuron_pt, term_t type_pt ) {
 
 	int layer, neuron;
-	void *ann;
+	struct fann *ann;
 
-	if ( !PL_get_pointer ( ann_pt, &ann ) )
-		return type_error ( ann_pt, "pointer" );
+	if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
 	if ( !PL_get_integer ( layer_pt, &layer ) )
 		return type_error ( layer_pt, "integer" );
 	if ( layer < 0 )
@@ -1849,10 +9060,10 @@ foreign_t swi_fann_set_activation_function ( term_t ann_pt, term_t type_pt, term
 	int layer, neuron;
 	enum fann_activationfunc_enum activation_function;
 	char *type;
-	void *ann;
+	struct fann *ann;
 
-	if ( !PL_get_pointer ( ann_pt, &ann ) )
-		return type_error ( ann_pt, "pointer" );
+	if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
 	if ( !PL_get_chars ( type_pt, &type, CVT_ATOM ) )
 		return type_error ( type_pt, "atom" );
 	if ( !PL_get_integer ( layer_pt, &layer ) )
@@ -1880,10 +9091,10 @@ foreign_t swi_fann_set_activation_function_layer ( term_t ann_pt, term_t type_pt
 	int layer;
 	enum fann_activationfunc_enum activation_function;
 	char *type;
-	void *ann;
+	struct fann *ann;
 
-	if ( !PL_get_pointer ( ann_pt, &ann ) )
-		return type_error ( ann_pt, "pointer" );
+	if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
 	if ( !PL_get_chars ( type_pt, &type, CVT_ATOM ) )
 		return type_error ( type_pt, "atom" );
 	if ( !PL_get_integer ( layer_pt, &layer ) )
@@ -1906,10 +9117,10 @@ foreign_t swi_fann_set_activation_function_hidden ( term_t ann_pt, term_t type_p
 
 	enum fann_activationfunc_enum activation_function;
 	char *type;
-	void *ann;
+	struct fann *ann;
 
-	if ( !PL_get_pointer ( ann_pt, &ann ) )
-		return type_error ( ann_pt, "pointer" );
+	if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
 	if ( !PL_get_chars ( type_pt, &type, CVT_ATOM ) )
 		return type_error ( type_pt, "atom" );
 
@@ -1928,10 +9139,10 @@ foreign_t swi_fann_set_activation_function_output ( term_t ann_pt, term_t type_p
 
 	enum fann_activationfunc_enum activation_function;
 	char *type;
-	void *ann;
+	struct fann *ann;
 
-	if ( !PL_get_pointer ( ann_pt, &ann ) )
-		return type_error ( ann_pt, "pointer" );
+	if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
 	if ( !PL_get_chars ( type_pt, &type, CVT_ATOM ) )
 		return type_error ( type_pt, "atom" );
 
@@ -1949,10 +9160,10 @@ foreign_t swi_fann_set_activation_function_output ( term_t ann_pt, term_t type_p
 foreign_t swi_fann_get_activation_steepness ( term_t ann_pt, term_t layer_pt, term_t neuron_pt, term_t steepness_pt ) {
 
 	int layer, neuron;
-	void *ann;
+	struct fann *ann;
 
-	if ( !PL_get_pointer ( ann_pt, &ann ) )
-		return type_error ( ann_pt, "pointer" );
+	if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
 	if ( !PL_get_integer ( layer_pt, &layer ) )
 		return type_error ( layer_pt, "integer" );
 	if ( layer < 0 )
@@ -1970,10 +9181,10 @@ foreign_t swi_fann_set_activation_steepness ( term_t ann_pt, term_t steepness_pt
 
 	int layer, neuron;
 	fann_type steepness;
-	void *ann;
+	struct fann *ann;
 
-	if ( !PL_get_pointer ( ann_pt, &ann ) )
-		return type_error ( ann_pt, "pointer" );
+	if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
 	if ( !PL_FANN_GET_FANNTYPE( steepness_pt, &steepness ) )
 		return type_error ( steepness_pt, PL_FANN_FANNTYPE );
 	if ( !PL_get_integer ( layer_pt, &layer ) )
@@ -1994,11 +9205,11 @@ foreign_t swi_fann_set_activation_steepness ( term_t ann_pt, term_t steepness_pt
 foreign_t swi_fann_set_activation_steepness_layer( term_t ann_pt, term_t steepness_pt, term_t layer_pt ) {
 
 	int layer;
-	void *ann;
+	struct fann *ann;
 	fann_type steepness;
 
-	if ( !PL_get_pointer ( ann_pt, &ann ) )
-		return type_error ( ann_pt, "pointer" );
+	if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
 	if ( !PL_FANN_GET_FANNTYPE( steepness_pt, &steepness ) )
 		return type_error ( steepness_pt, PL_FANN_FANNTYPE );
 	if ( !PL_get_integer ( layer_pt, &layer ) )
@@ -2014,11 +9225,11 @@ foreign_t swi_fann_set_activation_steepness_layer( term_t ann_pt, term_t steepne
 
 foreign_t swi_fann_set_activation_steepness_hidden ( term_t ann_pt, term_t steepness_pt ) {
 
-	void *ann;
+	struct fann *ann;
 	fann_type steepness;
 
-	if ( !PL_get_pointer ( ann_pt, &ann ) )
-		return type_error ( ann_pt, "pointer" );
+	if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
 	if ( !PL_FANN_GET_FANNTYPE( steepness_pt, &steepness ) )
 		return type_error ( steepness_pt, PL_FANN_FANNTYPE );
 
@@ -2030,11 +9241,11 @@ foreign_t swi_fann_set_activation_steepness_hidden ( term_t ann_pt, term_t steep
 
 foreign_t swi_fann_set_activation_steepness_output ( term_t ann_pt, term_t steepness_pt ) {
 
-	void *ann;
+	struct fann *ann;
 	fann_type steepness;
 
-	if ( !PL_get_pointer ( ann_pt, &ann ) )
-		return type_error ( ann_pt, "pointer" );
+	if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
 	if ( !PL_FANN_GET_FANNTYPE( steepness_pt, &steepness ) )
 		return type_error ( steepness_pt, PL_FANN_FANNTYPE );
 
@@ -2046,10 +9257,10 @@ foreign_t swi_fann_set_activation_steepness_output ( term_t ann_pt, term_t steep
 
 foreign_t swi_fann_get_train_error_function ( term_t ann_pt, term_t type_pt ) {
 
-	void *ann;
+	struct fann *ann;
 
-	if ( !PL_get_pointer ( ann_pt, &ann ) )
-		return type_error ( ann_pt, "pointer" );
+	if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
 
 	return PL_unify_atom_chars ( type_pt, FANN_ERRORFUNC_NAMES[ fann_get_train_error_function ( ann ) ] );
 }
@@ -2058,10 +9269,10 @@ foreign_t swi_fann_get_train_error_function ( term_t ann_pt, term_t type_pt ) {
 foreign_t swi_fann_set_train_error_function ( term_t ann_pt, term_t type_pt ) {
 
 	char *type;
-	void *ann;
+	struct fann *ann;
 
-	if ( !PL_get_pointer ( ann_pt, &ann ) )
-		return type_error ( ann_pt, "pointer" );
+	if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
 	if ( !PL_get_chars ( type_pt, &type, CVT_ATOM ) )
 		return type_error ( type_pt, "atom" );
 
@@ -2078,10 +9289,10 @@ foreign_t swi_fann_set_train_error_function ( term_t ann_pt, term_t type_pt ) {
 
 foreign_t swi_fann_get_train_stop_function ( term_t ann_pt, term_t type_pt ) {
 
-	void *ann;
+	struct fann *ann;
 
-	if ( !PL_get_pointer ( ann_pt, &ann ) )
-		return type_error ( ann_pt, "pointer" );
+	if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
 
 	return PL_unify_atom_chars ( type_pt, FANN_STOPFUNC_NAMES[ fann_get_train_stop_function ( ann ) ] );
 }
@@ -2090,10 +9301,10 @@ foreign_t swi_fann_get_train_stop_function ( term_t ann_pt, term_t type_pt ) {
 foreign_t swi_fann_set_train_stop_function ( term_t ann_pt, term_t type_pt ) {
 
 	char *type;
-	void *ann;
+	struct fann *ann;
 
-	if ( !PL_get_pointer ( ann_pt, &ann ) )
-		return type_error ( ann_pt, "pointer" );
+	if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
 	if ( !PL_get_chars ( type_pt, &type, CVT_ATOM ) )
 		return type_error ( type_pt, "atom" );
 
@@ -2110,10 +9321,10 @@ foreign_t swi_fann_set_train_stop_function ( term_t ann_pt, term_t type_pt ) {
 
 foreign_t swi_fann_get_bit_fail_limit ( term_t ann_pt, term_t bit_fail_limit_pt ) {
 
-	void *ann;
+	struct fann *ann;
 
-	if ( !PL_get_pointer ( ann_pt, &ann ) )
-		return type_error ( ann_pt, "pointer" );
+	if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
 	if ( !PL_is_variable ( bit_fail_limit_pt ) )
 		return type_error ( bit_fail_limit_pt, "var" );
 
@@ -2123,11 +9334,11 @@ foreign_t swi_fann_get_bit_fail_limit ( term_t ann_pt, term_t bit_fail_limit_pt
 
 foreign_t swi_fann_set_bit_fail_limit ( term_t ann_pt, term_t bit_fail_limit_pt ) {
 
-	void *ann;
+	struct fann *ann;
 	fann_type bit_fail_limit;
 
-	if ( !PL_get_pointer ( ann_pt, &ann ) )
-		return type_error ( ann_pt, "pointer" );
+	if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
     if ( !PL_FANN_GET_FANNTYPE( bit_fail_limit_pt, &bit_fail_limit ) )
 		return type_error ( bit_fail_limit_pt, PL_FANN_FANNTYPE );
 
@@ -2145,10 +9356,10 @@ foreign_t swi_fann_set_bit_fail_limit ( term_t ann_pt, term_t bit_fail_limit_pt
 
 foreign_t swi_fann_get_quickprop_decay ( term_t ann_pt, term_t out_pt ) {
 
-	void *ann;
+	struct fann *ann;
 
-	if ( !PL_get_pointer ( ann_pt, &ann ) )
-		return type_error ( ann_pt, "pointer" );
+	if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
 	if ( !PL_is_variable ( out_pt ) )
 		return type_error ( out_pt, "var" );
 
@@ -2159,10 +9370,10 @@ foreign_t swi_fann_get_quickprop_decay ( term_t ann_pt, term_t out_pt ) {
 foreign_t swi_fann_set_quickprop_decay ( term_t ann_pt, term_t in_pt ) {
 
 	double in;
-	void *ann;
+	struct fann *ann;
 
-	if ( !PL_get_pointer ( ann_pt, &ann ) )
-		return type_error ( ann_pt, "pointer" );
+	if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
 	if ( !PL_get_float ( in_pt, &in ) )
 		return type_error ( in_pt, "float" );
 
@@ -2174,10 +9385,10 @@ foreign_t swi_fann_set_quickprop_decay ( term_t ann_pt, term_t in_pt ) {
 
 foreign_t swi_fann_get_quickprop_mu ( term_t ann_pt, term_t out_pt ) {
 
-	void *ann;
+	struct fann *ann;
 
-	if ( !PL_get_pointer ( ann_pt, &ann ) )
-		return type_error ( ann_pt, "pointer" );
+	if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
 	if ( !PL_is_variable ( out_pt ) )
 		return type_error ( out_pt, "var" );
 
@@ -2188,10 +9399,10 @@ foreign_t swi_fann_get_quickprop_mu ( term_t ann_pt, term_t out_pt ) {
 foreign_t swi_fann_set_quickprop_mu ( term_t ann_pt, term_t in_pt ) {
 
 	double in;
-	void *ann;
+	struct fann *ann;
 
-	if ( !PL_get_pointer ( ann_pt, &ann ) )
-		return type_error ( ann_pt, "pointer" );
+	if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
 	if ( !PL_get_float ( in_pt, &in ) )
 		return type_error ( in_pt, "float" );
 
@@ -2203,10 +9414,10 @@ foreign_t swi_fann_set_quickprop_mu ( term_t ann_pt, term_t in_pt ) {
 
 foreign_t swi_fann_get_rprop_increase_factor ( term_t ann_pt, term_t out_pt ) {
 
-	void *ann;
+	struct fann *ann;
 
-	if ( !PL_get_pointer ( ann_pt, &ann ) )
-		return type_error ( ann_pt, "pointer" );
+	if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
 	if ( !PL_is_variable ( out_pt ) )
 		return type_error ( out_pt, "var" );
 
@@ -2217,10 +9428,10 @@ foreign_t swi_fann_get_rprop_increase_factor ( term_t ann_pt, term_t out_pt ) {
 foreign_t swi_fann_set_rprop_increase_factor ( term_t ann_pt, term_t in_pt ) {
 
 	double in;
-	void *ann;
+	struct fann *ann;
 
-	if ( !PL_get_pointer ( ann_pt, &ann ) )
-		return type_error ( ann_pt, "pointer" );
+	if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
 	if ( !PL_get_float ( in_pt, &in ) )
 		return type_error ( in_pt, "float" );
 
@@ -2232,10 +9443,10 @@ foreign_t swi_fann_set_rprop_increase_factor ( term_t ann_pt, term_t in_pt ) {
 
 foreign_t swi_fann_get_rprop_decrease_factor ( term_t ann_pt, term_t out_pt ) {
 
-	void *ann;
+	struct fann *ann;
 
-	if ( !PL_get_pointer ( ann_pt, &ann ) )
-		return type_error ( ann_pt, "pointer" );
+	if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
 	if ( !PL_is_variable ( out_pt ) )
 		return type_error ( out_pt, "var" );
 
@@ -2246,10 +9457,10 @@ foreign_t swi_fann_get_rprop_decrease_factor ( term_t ann_pt, term_t out_pt ) {
 foreign_t swi_fann_set_rprop_decrease_factor ( term_t ann_pt, term_t in_pt ) {
 
 	double in;
-	void *ann;
+	struct fann *ann;
 
-	if ( !PL_get_pointer ( ann_pt, &ann ) )
-		return type_error ( ann_pt, "pointer" );
+	if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
 	if ( !PL_get_float ( in_pt, &in ) )
 		return type_error ( in_pt, "float" );
 
@@ -2261,10 +9472,10 @@ foreign_t swi_fann_set_rprop_decrease_factor ( term_t ann_pt, term_t in_pt ) {
 
 foreign_t swi_fann_get_rprop_delta_min ( term_t ann_pt, term_t out_pt ) {
 
-	void *ann;
+	struct fann *ann;
 
-	if ( !PL_get_pointer ( ann_pt, &ann ) )
-		return type_error ( ann_pt, "pointer" );
+	if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
 	if ( !PL_is_variable ( out_pt ) )
 		return type_error ( out_pt, "var" );
 
@@ -2275,10 +9486,10 @@ foreign_t swi_fann_get_rprop_delta_min ( term_t ann_pt, term_t out_pt ) {
 foreign_t swi_fann_set_rprop_delta_min ( term_t ann_pt, term_t in_pt ) {
 
 	double in;
-	void *ann;
+	struct fann *ann;
 
-	if ( !PL_get_pointer ( ann_pt, &ann ) )
-		return type_error ( ann_pt, "pointer" );
+	if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
 	if ( !PL_get_float ( in_pt, &in ) )
 		return type_error ( in_pt, "float" );
 
@@ -2290,10 +9501,10 @@ foreign_t swi_fann_set_rprop_delta_min ( term_t ann_pt, term_t in_pt ) {
 
 foreign_t swi_fann_get_rprop_delta_max ( term_t ann_pt, term_t out_pt ) {
 
-	void *ann;
+	struct fann *ann;
 
-	if ( !PL_get_pointer ( ann_pt, &ann ) )
-		return type_error ( ann_pt, "pointer" );
+	if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
 	if ( !PL_is_variable ( out_pt ) )
 		return type_error ( out_pt, "var" );
 
@@ -2304,10 +9515,10 @@ foreign_t swi_fann_get_rprop_delta_max ( term_t ann_pt, term_t out_pt ) {
 foreign_t swi_fann_set_rprop_delta_max ( term_t ann_pt, term_t in_pt ) {
 
 	double in;
-	void *ann;
+	struct fann *ann;
 
-	if ( !PL_get_pointer ( ann_pt, &ann ) )
-		return type_error ( ann_pt, "pointer" );
+	if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
 	if ( !PL_get_float ( in_pt, &in ) )
 		return type_error ( in_pt, "float" );
 
@@ -2319,10 +9530,10 @@ foreign_t swi_fann_set_rprop_delta_max ( term_t ann_pt, term_t in_pt ) {
 
 foreign_t swi_fann_get_rprop_delta_zero ( term_t ann_pt, term_t out_pt ) {
 
-	void *ann;
+	struct fann *ann;
 
-	if ( !PL_get_pointer ( ann_pt, &ann ) )
-		return type_error ( ann_pt, "pointer" );
+	if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
 	if ( !PL_is_variable ( out_pt ) )
 		return type_error ( out_pt, "var" );
 
@@ -2333,10 +9544,10 @@ foreign_t swi_fann_get_rprop_delta_zero ( term_t ann_pt, term_t out_pt ) {
 foreign_t swi_fann_set_rprop_delta_zero ( term_t ann_pt, term_t in_pt ) {
 
 	double in;
-	void *ann;
+	struct fann *ann;
 
-	if ( !PL_get_pointer ( ann_pt, &ann ) )
-		return type_error ( ann_pt, "pointer" );
+	if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
 	if ( !PL_get_float ( in_pt, &in ) )
 		return type_error ( in_pt, "float" );
 
@@ -2349,10 +9560,10 @@ foreign_t swi_fann_set_rprop_delta_zero ( term_t ann_pt, term_t in_pt ) {
 #ifdef VERSION220
 foreign_t swi_fann_get_sarprop_weight_decay_shift ( term_t ann_pt, term_t out_pt ) {
 
-	void *ann;
+	struct fann *ann;
 
-	if ( !PL_get_pointer ( ann_pt, &ann ) )
-		return type_error ( ann_pt, "pointer" );
+	if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
 	if ( !PL_is_variable ( out_pt ) )
 		return type_error ( out_pt, "var" );
 
@@ -2363,10 +9574,10 @@ foreign_t swi_fann_get_sarprop_weight_decay_shift ( term_t ann_pt, term_t out_pt
 foreign_t swi_fann_set_sarprop_weight_decay_shift ( term_t ann_pt, term_t in_pt ) {
 
 	double in;
-	void *ann;
+	struct fann *ann;
 
-	if ( !PL_get_pointer ( ann_pt, &ann ) )
-		return type_error ( ann_pt, "pointer" );
+	if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
 	if ( !PL_get_float ( in_pt, &in ) )
 		return type_error ( in_pt, "float" );
 
@@ -2378,10 +9589,10 @@ foreign_t swi_fann_set_sarprop_weight_decay_shift ( term_t ann_pt, term_t in_pt
 
 foreign_t swi_fann_get_sarprop_step_error_threshold_factor ( term_t ann_pt, term_t out_pt ) {
 
-	void *ann;
+	struct fann *ann;
 
-	if ( !PL_get_pointer ( ann_pt, &ann ) )
-		return type_error ( ann_pt, "pointer" );
+	if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
 	if ( !PL_is_variable ( out_pt ) )
 		return type_error ( out_pt, "var" );
 
@@ -2392,10 +9603,10 @@ foreign_t swi_fann_get_sarprop_step_error_threshold_factor ( term_t ann_pt, term
 foreign_t swi_fann_set_sarprop_step_error_threshold_factor ( term_t ann_pt, term_t in_pt ) {
 
 	double in;
-	void *ann;
+	struct fann *ann;
 
-	if ( !PL_get_pointer ( ann_pt, &ann ) )
-		return type_error ( ann_pt, "pointer" );
+	if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
 	if ( !PL_get_float ( in_pt, &in ) )
 		return type_error ( in_pt, "float" );
 
@@ -2407,10 +9618,10 @@ foreign_t swi_fann_set_sarprop_step_error_threshold_factor ( term_t ann_pt, term
 
 foreign_t swi_fann_get_sarprop_step_error_shift ( term_t ann_pt, term_t out_pt ) {
 
-	void *ann;
+	struct fann *ann;
 
-	if ( !PL_get_pointer ( ann_pt, &ann ) )
-		return type_error ( ann_pt, "pointer" );
+	if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
 	if ( !PL_is_variable ( out_pt ) )
 		return type_error ( out_pt, "var" );
 
@@ -2421,10 +9632,10 @@ foreign_t swi_fann_get_sarprop_step_error_shift ( term_t ann_pt, term_t out_pt )
 foreign_t swi_fann_set_sarprop_step_error_shift ( term_t ann_pt, term_t in_pt ) {
 
 	double in;
-	void *ann;
+	struct fann *ann;
 
-	if ( !PL_get_pointer ( ann_pt, &ann ) )
-		return type_error ( ann_pt, "pointer" );
+	if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
 	if ( !PL_get_float ( in_pt, &in ) )
 		return type_error ( in_pt, "float" );
 
@@ -2436,10 +9647,10 @@ foreign_t swi_fann_set_sarprop_step_error_shift ( term_t ann_pt, term_t in_pt )
 
 foreign_t swi_fann_get_sarprop_temperature ( term_t ann_pt, term_t out_pt ) {
 
-	void *ann;
+	struct fann *ann;
 
-	if ( !PL_get_pointer ( ann_pt, &ann ) )
-		return type_error ( ann_pt, "pointer" );
+	if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
 	if ( !PL_is_variable ( out_pt ) )
 		return type_error ( out_pt, "var" );
 
@@ -2450,10 +9661,10 @@ foreign_t swi_fann_get_sarprop_temperature ( term_t ann_pt, term_t out_pt ) {
 foreign_t swi_fann_set_sarprop_temperature ( term_t ann_pt, term_t in_pt ) {
 
 	double in;
-	void *ann;
+	struct fann *ann;
 
-	if ( !PL_get_pointer ( ann_pt, &ann ) )
-		return type_error ( ann_pt, "pointer" );
+	if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
 	if ( !PL_get_float ( in_pt, &in ) )
 		return type_error ( in_pt, "float" );
 
@@ -2464,18 +9675,26 @@ foreign_t swi_fann_set_sarprop_temperature ( term_t ann_pt, term_t in_pt ) {
 #endif
 
 
-foreign_t swi_fann_cascadetrain_on_data ( term_t ann_pt, term_t data_pt, term_t max_neurons_pt, term_t neurons_between_reports_pt, term_t desired_error_pt ) {
+static foreign_t cascadetrain_on_data_options ( term_t ann_pt, term_t data_pt, term_t max_neurons_pt, term_t neurons_between_reports_pt, term_t desired_error_pt, term_t options_pt ) {
 
 #ifndef FIXEDFANN
 
-	void *ann, *data;
+	term_t list_pt, head_pt = PL_new_term_ref ();
+	term_t arg_pt = PL_new_term_ref ();
+	struct fann *ann;
+	struct fann_train_data *data;
 	int max_neurons, neurons_between_reports;
+	unsigned int threads = default_threads ();
 	double desired_error;
+	handle_uses uses = { { NULL }, 0 };
+	train_ctl ctl;
+	atom_t name;
+	size_t arity;
 
-	if ( !PL_get_pointer ( ann_pt, &ann ) )
-		return type_error ( ann_pt, "pointer" );
-	if ( !PL_get_pointer ( data_pt, &data ) )
-		return type_error ( data_pt, "pointer" );
+	if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
+	if ( !get_train_data ( data_pt, &data ) )
+		PL_fail;
 	if ( !PL_get_integer ( max_neurons_pt, &max_neurons ) )
 		return type_error ( max_neurons_pt, "integer" );
 	if ( max_neurons < 0 )
@@ -2487,9 +9706,33 @@ foreign_t swi_fann_cascadetrain_on_data ( term_t ann_pt, term_t data_pt, term_t
     if ( !PL_get_float ( desired_error_pt, &desired_error ) )
 		return type_error ( desired_error_pt, "float" );
 
-	fann_cascadetrain_on_data ( ann, data, max_neurons, neurons_between_reports, (float) desired_error );
+	if ( !get_train_options ( options_pt, &ctl ) )
+		PL_fail;
+
+	list_pt = PL_copy_term_ref ( options_pt );
+	while ( PL_get_list ( list_pt, head_pt, list_pt ) ) {
 
-	PL_succeed;
+		PL_get_name_arity ( head_pt, &name, &arity );
+		PL_get_arg ( 1, head_pt, arg_pt );
+
+		if ( !strcmp ( "threads", PL_atom_chars ( name ) ) && !get_threads_option ( arg_pt, &threads ) )
+			PL_fail;
+	}
+
+	if ( !use_handle ( &uses, ann_pt, &ann_blob ) || !use_handle ( &uses, data_pt, &train_blob ) )
+		PL_fail;
+
+	if ( !unmap_ann ( ann ) ) {
+
+		unuse_handles ( &uses );
+		return type_error ( ann_pt, "fann_error" );
+	}
+
+	cascadetrain_on_data_ctl ( ann, data, max_neurons, neurons_between_reports, (float) desired_error, threads, &ctl );
+
+	unuse_handles ( &uses );
+
+	return train_ctl_result ( &ctl );
 
 #else
 
@@ -2500,17 +9743,36 @@ foreign_t swi_fann_cascadetrain_on_data ( term_t ann_pt, term_t data_pt, term_t
 }
 
 
+foreign_t swi_fann_cascadetrain_on_data ( term_t ann_pt, term_t data_pt, term_t max_neurons_pt, term_t neurons_between_reports_pt, term_t desired_error_pt ) {
+
+	term_t options_pt = PL_new_term_ref ();
+
+	PL_put_nil ( options_pt );
+
+	return cascadetrain_on_data_options ( ann_pt, data_pt, max_neurons_pt, neurons_between_reports_pt, desired_error_pt, options_pt );
+}
+
+
+foreign_t swi_fann_cascadetrain_on_data_6 ( term_t ann_pt, term_t data_pt, term_t max_neurons_pt, term_t neurons_between_reports_pt, term_t desired_error_pt, term_t options_pt ) {
+
+	return cascadetrain_on_data_options ( ann_pt, data_pt, max_neurons_pt, neurons_between_reports_pt, desired_error_pt, options_pt );
+}
+
+
 foreign_t swi_fann_cascadetrain_on_file ( term_t ann_pt, term_t file_pt, term_t max_neurons_pt, term_t neurons_between_reports_pt, term_t desired_error_pt ) {
 
 #ifndef FIXEDFANN
 
-	void *ann;
+	struct fann *ann;
 	char *file;
 	int max_neurons, neurons_between_reports;
 	double desired_error;
+	struct fann_train_data *data;
+	handle_uses uses = { { NULL }, 0 };
+	train_ctl ctl;
 
-	if ( !PL_get_pointer ( ann_pt, &ann ) )
-		return type_error ( ann_pt, "pointer" );
+	if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
     if ( !PL_get_file_name ( file_pt, &file, PL_FILE_ABSOLUTE ) )
 		return type_error ( file_pt, "file" );
 	if ( !PL_get_integer ( max_neurons_pt, &max_neurons ) )
@@ -2524,9 +9786,29 @@ foreign_t swi_fann_cascadetrain_on_file ( term_t ann_pt, term_t file_pt, term_t
     if ( !PL_get_float ( desired_error_pt, &desired_error ) )
 		return type_error ( desired_error_pt, "float" );
 
-   fann_cascadetrain_on_file ( ann, file, max_neurons, neurons_between_reports, (float) desired_error );
+	memset ( &ctl, 0, sizeof ( ctl ) );
+	ctl.restore_best = TRUE;
+
+	if ( !use_handle ( &uses, ann_pt, &ann_blob ) )
+		PL_fail;
+
+	if ( !unmap_ann ( ann ) ) {
+
+		unuse_handles ( &uses );
+		return type_error ( ann_pt, "fann_error" );
+	}
+	if ( ( data = fann_read_train_from_file ( file ) ) == NULL ) {
+
+		unuse_handles ( &uses );
+		PL_succeed; // As fann_cascadetrain_on_file (), the error is in the error log.
+	}
+
+	cascadetrain_on_data_ctl ( ann, data, max_neurons, neurons_between_reports, (float) desired_error, default_threads (), &ctl );
 
-   PL_succeed;
+	fann_destroy_train ( data );
+	unuse_handles ( &uses );
+
+	return train_ctl_result ( &ctl );
 
 #else
 
@@ -2539,10 +9821,10 @@ foreign_t swi_fann_cascadetrain_on_file ( term_t ann_pt, term_t file_pt, term_t
 
 foreign_t swi_fann_get_cascade_output_change_fraction ( term_t ann_pt, term_t out_pt ) {
 
-	void *ann;
+	struct fann *ann;
 
-	if ( !PL_get_pointer ( ann_pt, &ann ) )
-		return type_error ( ann_pt, "pointer" );
+	if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
 	if ( !PL_is_variable ( out_pt ) )
 		return type_error ( out_pt, "var" );
 
@@ -2553,10 +9835,10 @@ foreign_t swi_fann_get_cascade_output_change_fraction ( term_t ann_pt, term_t ou
 foreign_t swi_fann_set_cascade_output_change_fraction ( term_t ann_pt, term_t in_pt ) {
 
 	double in;
-	void *ann;
+	struct fann *ann;
 
-	if ( !PL_get_pointer ( ann_pt, &ann ) )
-		return type_error ( ann_pt, "pointer" );
+	if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
 	if ( !PL_get_float ( in_pt, &in ) )
 		return type_error ( in_pt, "float" );
 
@@ -2568,10 +9850,10 @@ foreign_t swi_fann_set_cascade_output_change_fraction ( term_t ann_pt, term_t in
 
 foreign_t swi_fann_get_cascade_output_stagnation_epochs ( term_t ann_pt, term_t out_pt ) {
 
-	void *ann;
+	struct fann *ann;
 
-	if ( !PL_get_pointer ( ann_pt, &ann ) )
-		return type_error ( ann_pt, "pointer" );
+	if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
 
 	return PL_unify_integer ( out_pt, fann_get_cascade_output_stagnation_epochs ( ann ) );
 }
@@ -2580,10 +9862,10 @@ foreign_t swi_fann_get_cascade_output_stagnation_epochs ( term_t ann_pt, term_t
 foreign_t swi_fann_set_cascade_output_stagnation_epochs ( term_t ann_pt, term_t in_pt ) {
 
 	int in;
-	void *ann;
+	struct fann *ann;
 
-	if ( !PL_get_pointer ( ann_pt, &ann ) )
-		return type_error ( ann_pt, "pointer" );
+	if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
 	if ( !PL_get_integer ( in_pt, &in ) )
 		return type_error ( in_pt, "integer" );
     if ( in < 0 )
@@ -2597,10 +9879,10 @@ foreign_t swi_fann_set_cascade_output_stagnation_epochs ( term_t ann_pt, term_t
 
 foreign_t swi_fann_get_cascade_candidate_change_fraction ( term_t ann_pt, term_t out_pt ) {
 
-	void *ann;
+	struct fann *ann;
 
-	if ( !PL_get_pointer ( ann_pt, &ann ) )
-		return type_error ( ann_pt, "pointer" );
+	if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
 	if ( !PL_is_variable ( out_pt ) )
 		return type_error ( out_pt, "var" );
 
@@ -2611,10 +9893,10 @@ foreign_t swi_fann_get_cascade_candidate_change_fraction ( term_t ann_pt, term_t
 foreign_t swi_fann_set_cascade_candidate_change_fraction ( term_t ann_pt, term_t in_pt ) {
 
 	double in;
-	void *ann;
+	struct fann *ann;
 
-	if ( !PL_get_pointer ( ann_pt, &ann ) )
-		return type_error ( ann_pt, "pointer" );
+	if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
 	if ( !PL_get_float ( in_pt, &in ) )
 		return type_error ( in_pt, "float" );
 
@@ -2626,10 +9908,10 @@ foreign_t swi_fann_set_cascade_candidate_change_fraction ( term_t ann_pt, term_t
 
 foreign_t swi_fann_get_cascade_candidate_stagnation_epochs ( term_t ann_pt, term_t out_pt ) {
 
-	void *ann;
+	struct fann *ann;
 
-	if ( !PL_get_pointer ( ann_pt, &ann ) )
-		return type_error ( ann_pt, "pointer" );
+	if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
 
 	return PL_unify_integer ( out_pt, fann_get_cascade_candidate_stagnation_epochs ( ann ) );
 }
@@ -2638,10 +9920,10 @@ foreign_t swi_fann_get_cascade_candidate_stagnation_epochs ( term_t ann_pt, term
 foreign_t swi_fann_set_cascade_candidate_stagnation_epochs ( term_t ann_pt, term_t in_pt ) {
 
 	int in;
-	void *ann;
+	struct fann *ann;
 
-	if ( !PL_get_pointer ( ann_pt, &ann ) )
-		return type_error ( ann_pt, "pointer" );
+	if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
 	if ( !PL_get_integer ( in_pt, &in ) )
 		return type_error ( in_pt, "integer" );
     if ( in < 0 )
@@ -2655,10 +9937,10 @@ foreign_t swi_fann_set_cascade_candidate_stagnation_epochs ( term_t ann_pt, term
 
 foreign_t swi_fann_get_cascade_weight_multiplier ( term_t ann_pt, term_t out_pt ) {
 
-	void *ann;
+	struct fann *ann;
 
-	if ( !PL_get_pointer ( ann_pt, &ann ) )
-		return type_error ( ann_pt, "pointer" );
+	if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
 	if ( !PL_is_variable ( out_pt ) )
 		return type_error ( out_pt, "var" );
 
@@ -2669,10 +9951,10 @@ foreign_t swi_fann_get_cascade_weight_multiplier ( term_t ann_pt, term_t out_pt
 foreign_t swi_fann_set_cascade_weight_multiplier ( term_t ann_pt, term_t in_pt ) {
 
 	fann_type in;
-	void *ann;
+	struct fann *ann;
 
-	if ( !PL_get_pointer ( ann_pt, &ann ) )
-		return type_error ( ann_pt, "pointer" );
+	if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
 	if ( !PL_FANN_GET_FANNTYPE(in_pt,&in) )
 		return type_error ( in_pt, PL_FANN_FANNTYPE );
 
@@ -2684,10 +9966,10 @@ foreign_t swi_fann_set_cascade_weight_multiplier ( term_t ann_pt, term_t in_pt )
 
 foreign_t swi_fann_get_cascade_candidate_limit ( term_t ann_pt, term_t out_pt ) {
 
-	void *ann;
+	struct fann *ann;
 
-	if ( !PL_get_pointer ( ann_pt, &ann ) )
-		return type_error ( ann_pt, "pointer" );
+	if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
 	if ( !PL_is_variable ( out_pt ) )
 		return type_error ( out_pt, "var" );
 
@@ -2698,10 +9980,10 @@ foreign_t swi_fann_get_cascade_candidate_limit ( term_t ann_pt, term_t out_pt )
 foreign_t swi_fann_set_cascade_candidate_limit ( term_t ann_pt, term_t in_pt ) {
 
 	fann_type in;
-	void *ann;
+	struct fann *ann;
 
-	if ( !PL_get_pointer ( ann_pt, &ann ) )
-		return type_error ( ann_pt, "pointer" );
+	if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
 	if ( !PL_FANN_GET_FANNTYPE(in_pt,&in) )
 		return type_error ( in_pt, PL_FANN_FANNTYPE );
 
@@ -2713,10 +9995,10 @@ foreign_t swi_fann_set_cascade_candidate_limit ( term_t ann_pt, term_t in_pt ) {
 
 foreign_t swi_fann_get_cascade_max_out_epochs ( term_t ann_pt, term_t out_pt ) {
 
-	void *ann;
+	struct fann *ann;
 
-	if ( !PL_get_pointer ( ann_pt, &ann ) )
-		return type_error ( ann_pt, "pointer" );
+	if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
 
 	return PL_unify_integer ( out_pt, fann_get_cascade_max_out_epochs ( ann ) );
 }
@@ -2725,10 +10007,10 @@ foreign_t swi_fann_get_cascade_max_out_epochs ( term_t ann_pt, term_t out_pt ) {
 foreign_t swi_fann_set_cascade_max_out_epochs ( term_t ann_pt, term_t in_pt ) {
 
 	unsigned int in;
-	void *ann;
+	struct fann *ann;
 
-	if ( !PL_get_pointer ( ann_pt, &ann ) )
-		return type_error ( ann_pt, "pointer" );
+	if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
 	if ( !PL_get_integer ( in_pt, &in ) )
 		return type_error ( in_pt, "integer" );
     if ( in < 1 )
@@ -2742,10 +10024,10 @@ foreign_t swi_fann_set_cascade_max_out_epochs ( term_t ann_pt, term_t in_pt ) {
 #ifdef VERSION220
 foreign_t swi_fann_get_cascade_min_out_epochs ( term_t ann_pt, term_t out_pt ) {
 
-	void *ann;
+	struct fann *ann;
 
-	if ( !PL_get_pointer ( ann_pt, &ann ) )
-		return type_error ( ann_pt, "pointer" );
+	if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
 
 	return PL_unify_integer ( out_pt, fann_get_cascade_min_out_epochs ( ann ) );
 }
@@ -2754,10 +10036,10 @@ foreign_t swi_fann_get_cascade_min_out_epochs ( term_t ann_pt, term_t out_pt ) {
 foreign_t swi_fann_set_cascade_min_out_epochs ( term_t ann_pt, term_t in_pt ) {
 
 	unsigned int in;
-	void *ann;
+	struct fann *ann;
 
-	if ( !PL_get_pointer ( ann_pt, &ann ) )
-		return type_error ( ann_pt, "pointer" );
+	if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
 	if ( !PL_get_integer ( in_pt, &in ) )
 		return type_error ( in_pt, "integer" );
 
@@ -2770,10 +10052,10 @@ foreign_t swi_fann_set_cascade_min_out_epochs ( term_t ann_pt, term_t in_pt ) {
 
 foreign_t swi_fann_get_cascade_max_cand_epochs ( term_t ann_pt, term_t out_pt ) {
 
-	void *ann;
+	struct fann *ann;
 
-	if ( !PL_get_pointer ( ann_pt, &ann ) )
-		return type_error ( ann_pt, "pointer" );
+	if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
 
 	return PL_unify_integer ( out_pt, fann_get_cascade_max_cand_epochs ( ann ) );
 }
@@ -2782,10 +10064,10 @@ foreign_t swi_fann_get_cascade_max_cand_epochs ( term_t ann_pt, term_t out_pt )
 foreign_t swi_fann_set_cascade_max_cand_epochs ( term_t ann_pt, term_t in_pt ) {
 
 	unsigned int in;
-	void *ann;
+	struct fann *ann;
 
-	if ( !PL_get_pointer ( ann_pt, &ann ) )
-		return type_error ( ann_pt, "pointer" );
+	if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
 	if ( !PL_get_integer ( in_pt, &in ) )
 		return type_error ( in_pt, "integer" );
 
@@ -2798,10 +10080,10 @@ foreign_t swi_fann_set_cascade_max_cand_epochs ( term_t ann_pt, term_t in_pt ) {
 #ifdef VERSION220
 foreign_t swi_fann_get_cascade_min_cand_epochs ( term_t ann_pt, term_t out_pt ) {
 
-	void *ann;
+	struct fann *ann;
 
-	if ( !PL_get_pointer ( ann_pt, &ann ) )
-		return type_error ( ann_pt, "pointer" );
+	if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
 
 	return PL_unify_integer ( out_pt, fann_get_cascade_min_cand_epochs ( ann ) );
 }
@@ -2810,10 +10092,10 @@ foreign_t swi_fann_get_cascade_min_cand_epochs ( term_t ann_pt, term_t out_pt )
 foreign_t swi_fann_set_cascade_min_cand_epochs ( term_t ann_pt, term_t in_pt ) {
 
 	unsigned int in;
-	void *ann;
+	struct fann *ann;
 
-	if ( !PL_get_pointer ( ann_pt, &ann ) )
-		return type_error ( ann_pt, "pointer" );
+	if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
 	if ( !PL_get_integer ( in_pt, &in ) )
 		return type_error ( in_pt, "integer" );
 
@@ -2826,10 +10108,10 @@ foreign_t swi_fann_set_cascade_min_cand_epochs ( term_t ann_pt, term_t in_pt ) {
 
 foreign_t swi_fann_get_cascade_num_candidates ( term_t ann_pt, term_t out_pt ) {
 
-	void *ann;
+	struct fann *ann;
 
-	if ( !PL_get_pointer ( ann_pt, &ann ) )
-		return type_error ( ann_pt, "pointer" );
+	if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
 
 	return PL_unify_integer ( out_pt, fann_get_cascade_num_candidates ( ann ) );
 }
@@ -2837,10 +10119,10 @@ foreign_t swi_fann_get_cascade_num_candidates ( term_t ann_pt, term_t out_pt ) {
 
 foreign_t swi_fann_get_cascade_activation_functions_count ( term_t ann_pt, term_t out_pt ) {
 
-	void *ann;
+	struct fann *ann;
 
-	if ( !PL_get_pointer ( ann_pt, &ann ) )
-		return type_error ( ann_pt, "pointer" );
+	if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
 
 	return PL_unify_integer ( out_pt, fann_get_cascade_activation_functions_count ( ann ) );
 }
@@ -2849,12 +10131,12 @@ foreign_t swi_fann_get_cascade_activation_functions_count ( term_t ann_pt, term_
 foreign_t swi_fann_get_cascade_activation_functions ( term_t ann_pt, term_t type_pt ) {
 
 	unsigned int i;
-	void *ann;
+	struct fann *ann;
 	enum fann_activationfunc_enum *functions;
 	term_t temp_pt = PL_new_term_ref ();
 
-	if ( !PL_get_pointer ( ann_pt, &ann ) )
-		return type_error ( ann_pt, "pointer" );
+	if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
 
 	functions = fann_get_cascade_activation_functions ( ann );
 
@@ -2877,10 +10159,10 @@ foreign_t swi_fann_set_cascade_activation_functions ( term_t ann_pt, term_t func
 	enum fann_activationfunc_enum *function_list;
 	term_t function_pt = PL_new_term_ref ();
 	char *function;
-	void *ann;
+	struct fann *ann;
 
-	if ( !PL_get_pointer ( ann_pt, &ann ) )
-		return type_error ( ann_pt, "pointer" );
+	if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
 
 	number_functions = fann_get_cascade_activation_functions_count ( ann );
 
@@ -2903,10 +10185,10 @@ foreign_t swi_fann_set_cascade_activation_functions ( term_t ann_pt, term_t func
 
 foreign_t swi_fann_get_cascade_activation_steepnesses_count ( term_t ann_pt, term_t out_pt ) {
 
-	void *ann;
+	struct fann *ann;
 
-	if ( !PL_get_pointer ( ann_pt, &ann ) )
-		return type_error ( ann_pt, "pointer" );
+	if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
 
 	return PL_unify_integer ( out_pt, fann_get_cascade_activation_steepnesses_count ( ann ) );
 }
@@ -2917,10 +10199,10 @@ foreign_t swi_fann_get_cascade_activation_steepnesses ( term_t ann_pt, term_t ty
 	unsigned int i;
 	term_t temp_pt = PL_new_term_ref ();
 	fann_type *type_list;
-	void *ann;
+	struct fann *ann;
 
-	if ( !PL_get_pointer ( ann_pt, &ann ) )
-		return type_error ( ann_pt, "pointer" );
+	if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
 
 	type_list = fann_get_cascade_activation_steepnesses ( ann );
 
@@ -2943,10 +10225,10 @@ foreign_t swi_fann_set_cascade_activation_steepnesses ( term_t ann_pt, term_t ty
 	unsigned int i, steepnesses_count;
 	term_t temp_pt = PL_new_term_ref ();
 	fann_type temp, *type_list;
-	void *ann;
+	struct fann *ann;
 
-	if ( !PL_get_pointer ( ann_pt, &ann ) )
-		return type_error ( ann_pt, "pointer" );
+	if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
 
 	steepnesses_count = fann_get_cascade_activation_steepnesses_count ( ann );
 
@@ -2968,10 +10250,10 @@ foreign_t swi_fann_set_cascade_activation_steepnesses ( term_t ann_pt, term_t ty
 
 foreign_t swi_fann_get_cascade_num_candidate_groups ( term_t ann_pt, term_t out_pt ) {
 
-	void *ann;
+	struct fann *ann;
 
-	if ( !PL_get_pointer ( ann_pt, &ann ) )
-		return type_error ( ann_pt, "pointer" );
+	if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
 
 	return PL_unify_integer ( out_pt, fann_get_cascade_num_candidate_groups ( ann ) );
 }
@@ -2980,10 +10262,10 @@ foreign_t swi_fann_get_cascade_num_candidate_groups ( term_t ann_pt, term_t out_
 foreign_t swi_fann_set_cascade_num_candidate_groups ( term_t ann_pt, term_t in_pt ) {
 
 	unsigned int in;
-	void *ann;
+	struct fann *ann;
 
-	if ( !PL_get_pointer ( ann_pt, &ann ) )
-		return type_error ( ann_pt, "pointer" );
+	if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
 	if ( !PL_get_integer ( in_pt, &in ) )
 		return type_error ( in_pt, "integer" );
 
@@ -2993,6 +10275,657 @@ foreign_t swi_fann_set_cascade_num_candidate_groups ( term_t ann_pt, term_t in_p
 }
 
 
+                        /* Serialization */
+
+
+// fann_serialize/2 writes a network to bytes that fann_deserialize/2 turns
+// back into an equal network, without a file or decimal text. The bytes
+// hold the layout, the weights, every training and cascade parameter and
+// the scaling parameters. They are the header below followed by the layer
+// sizes, per neuron its number of connections, activation function and
+// steepness, per connection its source neuron and weight, the cascade
+// activation functions and steepnesses and, if set, the scaling
+// parameters. Like checkpoints they are in the byte order and fann_type of
+// the engine that wrote them.
+//
+// The bytes may come from elsewhere, so every count and index is checked
+// before the network is built.
+
+#define NETWORK_MAGIC "PLFANNNT"
+#define NETWORK_VERSION 2
+
+// The last training algorithm of the library the engine is built on, so a
+// network serialized while training with SARPROP reads back under 2.2.
+
+#ifdef VERSION220
+#define LAST_TRAIN_ALGORITHM FANN_TRAIN_SARPROP
+#else
+#define LAST_TRAIN_ALGORITHM FANN_TRAIN_QUICKPROP
+#endif
+
+typedef struct network_header {
+
+	char magic[8];
+	double bit_fail_limit;
+	double cascade_candidate_limit;
+	double cascade_weight_multiplier;
+	uint32_t version;
+	uint32_t type_size;
+	uint32_t fixed;
+	uint32_t decimal_point;
+	uint32_t num_layers;
+	uint32_t total_neurons;
+	uint32_t total_connections;
+	uint32_t network_type;
+	uint32_t training_algorithm;
+	uint32_t train_error_function;
+	uint32_t train_stop_function;
+	uint32_t cascade_output_stagnation_epochs;
+	uint32_t cascade_candidate_stagnation_epochs;
+	uint32_t cascade_max_out_epochs;
+	uint32_t cascade_max_cand_epochs;
+	uint32_t cascade_num_candidate_groups;
+	uint32_t cascade_activation_functions_count;
+	uint32_t cascade_activation_steepnesses_count;
+	uint32_t scale;
+	float connection_rate;
+	float learning_rate;
+	float learning_momentum;
+	float cascade_output_change_fraction;
+	float cascade_candidate_change_fraction;
+	float quickprop_decay;
+	float quickprop_mu;
+	float rprop_increase_factor;
+	float rprop_decrease_factor;
+	float rprop_delta_min;
+	float rprop_delta_max;
+	float rprop_delta_zero;
+	uint32_t cascade_min_out_epochs;	// The fields below are zero unless
+	uint32_t cascade_min_cand_epochs;	// the library is 2.2.
+	float sarprop_weight_decay_shift;
+	float sarprop_step_error_threshold_factor;
+	float sarprop_step_error_shift;
+	float sarprop_temperature;
+} network_header;
+
+
+static unsigned char *put_bytes ( unsigned char *p, const void *src, size_t n ) {
+
+	memcpy ( p, src, n );
+
+	return p + n;
+}
+
+
+static unsigned char *put_uint32 ( unsigned char *p, uint32_t value ) {
+
+	return put_bytes ( p, &value, sizeof ( value ) );
+}
+
+
+static int take_bytes ( const unsigned char **p, const unsigned char *end, void *dst, size_t n ) {
+
+	if ( ( size_t ) ( end - *p ) < n )
+		return FALSE;
+
+	memcpy ( dst, *p, n );
+	*p += n;
+
+	return TRUE;
+}
+
+
+// The size of what follows the layer sizes, with or without the weights.
+
+static size_t network_body_size ( const network_header *h, unsigned int num_input, unsigned int num_output, int weights ) {
+
+	size_t n = ( size_t ) h->total_neurons * ( 2 * sizeof ( uint32_t ) + sizeof ( fann_type ) );
+
+	n += ( size_t ) h->total_connections * ( sizeof ( uint32_t ) + ( weights ? sizeof ( fann_type ) : 0 ) );
+	n += ( size_t ) h->cascade_activation_functions_count * sizeof ( uint32_t );
+	n += ( size_t ) h->cascade_activation_steepnesses_count * sizeof ( fann_type );
+	if ( h->scale )
+		n += ( size_t ) 4 * ( num_input + num_output ) * sizeof ( float );
+
+	return n;
+}
+
+
+// Returns the bytes of ann, *size of them. Without weights set the weights
+// are left out, for a model file to store apart.
+
+static unsigned char *network_to_bytes ( struct fann *ann, int weights, size_t *size ) {
+
+	network_header h;
+	struct fann_layer *layer;
+	struct fann_neuron *neuron;
+	unsigned char *buf, *p;
+	unsigned int i;
+	int scale = FALSE;
+
+#ifndef FIXEDFANN
+	float *scale_arrays[8];
+
+	scale_arrays[0] = ann->scale_mean_in;
+	scale_arrays[1] = ann->scale_deviation_in;
+	scale_arrays[2] = ann->scale_new_min_in;
+	scale_arrays[3] = ann->scale_factor_in;
+	scale_arrays[4] = ann->scale_mean_out;
+	scale_arrays[5] = ann->scale_deviation_out;
+	scale_arrays[6] = ann->scale_new_min_out;
+	scale_arrays[7] = ann->scale_factor_out;
+	scale = ann->scale_mean_in != NULL;
+#endif
+
+	memset ( &h, 0, sizeof ( h ) );
+	memcpy ( h.magic, NETWORK_MAGIC, 8 );
+	h.version = NETWORK_VERSION;
+	h.type_size = sizeof ( fann_type );
+#ifdef FIXEDFANN
+	h.fixed = TRUE;
+	h.decimal_point = ann->decimal_point;
+#endif
+	h.num_layers = ann->last_layer - ann->first_layer;
+	h.total_neurons = ann->total_neurons;
+	h.total_connections = ann->total_connections;
+	h.network_type = ann->network_type;
+	h.training_algorithm = ann->training_algorithm;
+	h.train_error_function = ann->train_error_function;
+	h.train_stop_function = ann->train_stop_function;
+	h.bit_fail_limit = ann->bit_fail_limit;
+	h.cascade_output_change_fraction = ann->cascade_output_change_fraction;
+	h.cascade_output_stagnation_epochs = ann->cascade_output_stagnation_epochs;
+	h.cascade_candidate_change_fraction = ann->cascade_candidate_change_fraction;
+	h.cascade_candidate_stagnation_epochs = ann->cascade_candidate_stagnation_epochs;
+	h.cascade_candidate_limit = ann->cascade_candidate_limit;
+	h.cascade_weight_multiplier = ann->cascade_weight_multiplier;
+	h.cascade_max_out_epochs = ann->cascade_max_out_epochs;
+	h.cascade_max_cand_epochs = ann->cascade_max_cand_epochs;
+	h.cascade_num_candidate_groups = ann->cascade_num_candidate_groups;
+	h.cascade_activation_functions_count = ann->cascade_activation_functions_count;
+	h.cascade_activation_steepnesses_count = ann->cascade_activation_steepnesses_count;
+	h.scale = scale;
+	h.connection_rate = ann->connection_rate;
+	h.learning_rate = ann->learning_rate;
+	h.learning_momentum = ann->learning_momentum;
+	h.quickprop_decay = ann->quickprop_decay;
+	h.quickprop_mu = ann->quickprop_mu;
+	h.rprop_increase_factor = ann->rprop_increase_factor;
+	h.rprop_decrease_factor = ann->rprop_decrease_factor;
+	h.rprop_delta_min = ann->rprop_delta_min;
+	h.rprop_delta_max = ann->rprop_delta_max;
+	h.rprop_delta_zero = ann->rprop_delta_zero;
+#ifdef VERSION220
+	h.cascade_min_out_epochs = ann->cascade_min_out_epochs;
+	h.cascade_min_cand_epochs = ann->cascade_min_cand_epochs;
+	h.sarprop_weight_decay_shift = ann->sarprop_weight_decay_shift;
+	h.sarprop_step_error_threshold_factor = ann->sarprop_step_error_threshold_factor;
+	h.sarprop_step_error_shift = ann->sarprop_step_error_shift;
+	h.sarprop_temperature = ann->sarprop_temperature;
+#endif
+
+	*size = sizeof ( h ) + h.num_layers * sizeof ( uint32_t ) + network_body_size ( &h, ann->num_input, ann->num_output, weights );
+
+	if ( ( buf = malloc ( *size ) ) == NULL )
+		return NULL;
+
+	p = put_bytes ( buf, &h, sizeof ( h ) );
+
+	for ( layer = ann->first_layer; layer != ann->last_layer; layer++ )
+		p = put_uint32 ( p, layer->last_neuron - layer->first_neuron );
+
+	neuron = ann->first_layer->first_neuron;
+	for ( i = 0; i < ann->total_neurons; i++ )
+		p = put_uint32 ( p, neuron[i].last_con - neuron[i].first_con );
+	for ( i = 0; i < ann->total_neurons; i++ )
+		p = put_uint32 ( p, neuron[i].activation_function );
+	for ( i = 0; i < ann->total_neurons; i++ )
+		p = put_bytes ( p, &neuron[i].activation_steepness, sizeof ( fann_type ) );
+
+	for ( i = 0; i < ann->total_connections; i++ )
+		p = put_uint32 ( p, ann->connections[i] - neuron );
+	if ( weights )
+		p = put_bytes ( p, ann->weights, ann->total_connections * sizeof ( fann_type ) );
+
+	for ( i = 0; i < ann->cascade_activation_functions_count; i++ )
+		p = put_uint32 ( p, ann->cascade_activation_functions[i] );
+	p = put_bytes ( p, ann->cascade_activation_steepnesses, ann->cascade_activation_steepnesses_count * sizeof ( fann_type ) );
+
+#ifndef FIXEDFANN
+	if ( scale )
+		for ( i = 0; i < 8; i++ )
+			p = put_bytes ( p, scale_arrays[i], ( i < 4 ? ann->num_input : ann->num_output ) * sizeof ( float ) );
+#endif
+
+	return buf;
+}
+
+
+// Checks the layout of the network in the bytes at p: each neuron only
+// connects to neurons of earlier layers, those of the previous layer
+// unless the network has shortcut connections, and a fully connected
+// layer to no more of them than there are.
+
+static int check_network_layout ( const network_header *h, const uint32_t *layer_sizes, const unsigned char *p ) {
+
+	const unsigned char *counts = p, *functions = p + h->total_neurons * sizeof ( uint32_t );
+	const unsigned char *sources = p + h->total_neurons * ( 2 * sizeof ( uint32_t ) + sizeof ( fann_type ) );
+	uint32_t count, source, function, start = 0, base = 0, i, n = 0;
+	size_t con = 0;
+
+	for ( i = 0; i < h->num_layers; i++ ) {
+
+		for ( ; n < start + layer_sizes[i]; n++ ) {
+
+			memcpy ( &count, counts + n * sizeof ( uint32_t ), sizeof ( count ) );
+			memcpy ( &function, functions + n * sizeof ( uint32_t ), sizeof ( function ) );
+			if ( function > FANN_COS || ( i == 0 && count ) || count > start - base ||
+				 con + count > h->total_connections )
+				return FALSE;
+
+			for ( ; count; count--, con++ ) {
+
+				memcpy ( &source, sources + con * sizeof ( uint32_t ), sizeof ( source ) );
+				if ( source < base || source >= start )
+					return FALSE;
+			}
+		}
+
+		if ( h->network_type == FANN_NETTYPE_LAYER )
+			base = start;
+		start += layer_sizes[i];
+	}
+
+	return con == h->total_connections;
+}
+
+
+// Builds a network from len bytes at p, which hold its weights if weights
+// is set and leave them zero otherwise. On failure *valid tells whether the
+// bytes were valid, and only memory was lacking.
+
+static struct fann *network_from_bytes ( const unsigned char *p, size_t len, int weights, int *valid ) {
+
+	const unsigned char *end = p + len;
+	network_header h;
+	uint32_t *layer_sizes = NULL, value;
+	unsigned int i, num_input, num_output;
+	size_t total_neurons = 0;
+	struct fann *ann = NULL;
+	struct fann_layer *layer;
+	struct fann_neuron *neuron;
+
+	*valid = FALSE;
+
+	if ( !take_bytes ( &p, end, &h, sizeof ( h ) ) || memcmp ( h.magic, NETWORK_MAGIC, 8 ) ||
+		 h.version != NETWORK_VERSION || h.type_size != sizeof ( fann_type ) ||
+#ifdef FIXEDFANN
+		 !h.fixed || h.decimal_point >= 8 * sizeof ( fann_type ) || h.scale ||
+#else
+		 h.fixed ||
+#endif
+		 h.num_layers < 2 || ( size_t ) ( end - p ) / sizeof ( uint32_t ) < h.num_layers ||
+		 h.network_type > FANN_NETTYPE_SHORTCUT || h.training_algorithm > LAST_TRAIN_ALGORITHM ||
+		 h.train_error_function > FANN_ERRORFUNC_TANH || h.train_stop_function > FANN_STOPFUNC_BIT )
+		return NULL;
+
+	if ( ( layer_sizes = malloc ( h.num_layers * sizeof ( uint32_t ) ) ) == NULL ) {
+
+		*valid = TRUE;
+		return NULL;
+	}
+
+	take_bytes ( &p, end, layer_sizes, h.num_layers * sizeof ( uint32_t ) );
+
+	for ( i = 0; i < h.num_layers; i++ ) {
+
+		if ( !layer_sizes[i] )
+			goto invalid;
+		total_neurons += layer_sizes[i];
+	}
+
+	// The input layer has a bias neuron, so has the output layer unless the
+	// network has shortcut connections.
+	num_input = layer_sizes[0] - 1;
+	num_output = layer_sizes[h.num_layers - 1] - ( h.network_type == FANN_NETTYPE_LAYER );
+
+	if ( total_neurons != h.total_neurons || !num_input || !num_output ||
+		 ( size_t ) ( end - p ) != network_body_size ( &h, num_input, num_output, weights ) ||
+		 !check_network_layout ( &h, layer_sizes, p ) )
+		goto invalid;
+
+	*valid = TRUE;
+
+	if ( ( ann = fann_allocate_structure ( h.num_layers ) ) == NULL )
+		goto done;
+
+	ann->connection_rate = h.connection_rate;
+	ann->network_type = h.network_type;
+	ann->learning_rate = h.learning_rate;
+	ann->learning_momentum = h.learning_momentum;
+	ann->training_algorithm = h.training_algorithm;
+	ann->train_error_function = h.train_error_function;
+	ann->train_stop_function = h.train_stop_function;
+	ann->bit_fail_limit = ( fann_type ) h.bit_fail_limit;
+	ann->cascade_output_change_fraction = h.cascade_output_change_fraction;
+	ann->cascade_output_stagnation_epochs = h.cascade_output_stagnation_epochs;
+	ann->cascade_candidate_change_fraction = h.cascade_candidate_change_fraction;
+	ann->cascade_candidate_stagnation_epochs = h.cascade_candidate_stagnation_epochs;
+	ann->cascade_candidate_limit = ( fann_type ) h.cascade_candidate_limit;
+	ann->cascade_weight_multiplier = ( fann_type ) h.cascade_weight_multiplier;
+	ann->cascade_max_out_epochs = h.cascade_max_out_epochs;
+	ann->cascade_max_cand_epochs = h.cascade_max_cand_epochs;
+	ann->cascade_num_candidate_groups = h.cascade_num_candidate_groups;
+	ann->quickprop_decay = h.quickprop_decay;
+	ann->quickprop_mu = h.quickprop_mu;
+	ann->rprop_increase_factor = h.rprop_increase_factor;
+	ann->rprop_decrease_factor = h.rprop_decrease_factor;
+	ann->rprop_delta_min = h.rprop_delta_min;
+	ann->rprop_delta_max = h.rprop_delta_max;
+	ann->rprop_delta_zero = h.rprop_delta_zero;
+#ifdef VERSION220
+	ann->cascade_min_out_epochs = h.cascade_min_out_epochs;
+	ann->cascade_min_cand_epochs = h.cascade_min_cand_epochs;
+	ann->sarprop_weight_decay_shift = h.sarprop_weight_decay_shift;
+	ann->sarprop_step_error_threshold_factor = h.sarprop_step_error_threshold_factor;
+	ann->sarprop_step_error_shift = h.sarprop_step_error_shift;
+	ann->sarprop_temperature = h.sarprop_temperature;
+#endif
+#ifdef FIXEDFANN
+	ann->decimal_point = h.decimal_point;
+	ann->multiplier = 1 << h.decimal_point;
+	fann_update_stepwise ( ann );
+#endif
+
+	// As fann_create_from_file (), the layers are laid out from NULL and
+	// placed by fann_allocate_neurons ().
+	for ( i = 0, layer = ann->first_layer; layer != ann->last_layer; i++, layer++ ) {
+
+		layer->first_neuron = NULL;
+		layer->last_neuron = layer->first_neuron + layer_sizes[i];
+		ann->total_neurons += layer_sizes[i];
+	}
+
+	ann->num_input = num_input;
+	ann->num_output = num_output;
+
+	fann_allocate_neurons ( ann );
+	if ( ann->errno_f == FANN_E_CANT_ALLOCATE_MEM )
+		goto failed;
+
+	neuron = ann->first_layer->first_neuron;
+	for ( i = 0; i < ann->total_neurons; i++ ) {
+
+		take_bytes ( &p, end, &value, sizeof ( value ) );
+		neuron[i].first_con = ann->total_connections;
+		ann->total_connections += value;
+		neuron[i].last_con = ann->total_connections;
+	}
+	for ( i = 0; i < ann->total_neurons; i++ ) {
+
+		take_bytes ( &p, end, &value, sizeof ( value ) );
+		neuron[i].activation_function = value;
+	}
+	for ( i = 0; i < ann->total_neurons; i++ )
+		take_bytes ( &p, end, &neuron[i].activation_steepness, sizeof ( fann_type ) );
+
+	fann_allocate_connections ( ann );
+	if ( ann->errno_f == FANN_E_CANT_ALLOCATE_MEM )
+		goto failed;
+
+	for ( i = 0; i < ann->total_connections; i++ ) {
+
+		take_bytes ( &p, end, &value, sizeof ( value ) );
+		ann->connections[i] = neuron + value;
+	}
+	if ( weights )
+		take_bytes ( &p, end, ann->weights, ann->total_connections * sizeof ( fann_type ) );
+
+	// The defaults set by fann_allocate_structure () are replaced.
+	free ( ann->cascade_activation_functions );
+	free ( ann->cascade_activation_steepnesses );
+	ann->cascade_activation_functions_count = h.cascade_activation_functions_count;
+	ann->cascade_activation_steepnesses_count = h.cascade_activation_steepnesses_count;
+	ann->cascade_activation_functions = malloc ( h.cascade_activation_functions_count * sizeof ( enum fann_activationfunc_enum ) );
+	ann->cascade_activation_steepnesses = malloc ( h.cascade_activation_steepnesses_count * sizeof ( fann_type ) );
+	if ( ( !ann->cascade_activation_functions && h.cascade_activation_functions_count ) ||
+	     ( !ann->cascade_activation_steepnesses && h.cascade_activation_steepnesses_count ) )
+		goto failed;
+
+	for ( i = 0; i < h.cascade_activation_functions_count; i++ ) {
+
+		take_bytes ( &p, end, &value, sizeof ( value ) );
+		if ( value > FANN_COS ) {
+
+			*valid = FALSE;
+			goto failed;
+		}
+		ann->cascade_activation_functions[i] = value;
+	}
+	take_bytes ( &p, end, ann->cascade_activation_steepnesses, h.cascade_activation_steepnesses_count * sizeof ( fann_type ) );
+
+#ifndef FIXEDFANN
+	if ( h.scale ) {
+
+		float *scale_arrays[8];
+
+		if ( fann_allocate_scale ( ann ) == -1 )
+			goto failed;
+
+		scale_arrays[0] = ann->scale_mean_in;
+		scale_arrays[1] = ann->scale_deviation_in;
+		scale_arrays[2] = ann->scale_new_min_in;
+		scale_arrays[3] = ann->scale_factor_in;
+		scale_arrays[4] = ann->scale_mean_out;
+		scale_arrays[5] = ann->scale_deviation_out;
+		scale_arrays[6] = ann->scale_new_min_out;
+		scale_arrays[7] = ann->scale_factor_out;
+
+		for ( i = 0; i < 8; i++ )
+			take_bytes ( &p, end, scale_arrays[i], ( i < 4 ? num_input : num_output ) * sizeof ( float ) );
+	}
+#endif
+
+	goto done;
+
+failed:
+	fann_destroy ( ann );
+	ann = NULL;
+	goto done;
+
+invalid:
+	*valid = FALSE;
+
+done:
+	free ( layer_sizes );
+
+	return ann;
+}
+
+
+foreign_t swi_fann_serialize ( term_t ann_pt, term_t bytes_pt ) {
+
+	struct fann *ann;
+	unsigned char *buf;
+	size_t size;
+	int rc;
+
+	if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
+	if ( !PL_is_variable ( bytes_pt ) )
+		return type_error ( bytes_pt, "var" );
+
+	if ( ( buf = network_to_bytes ( ann, TRUE, &size ) ) == NULL )
+		return type_error ( ann_pt, "fann_error" );
+
+	rc = PL_unify_chars ( bytes_pt, PL_STRING|REP_ISO_LATIN_1, size, ( char* ) buf );
+	free ( buf );
+
+	return rc;
+}
+
+
+foreign_t swi_fann_deserialize ( term_t bytes_pt, term_t ann_pt ) {
+
+	struct fann *ann;
+	size_t len;
+	char *bytes;
+	int valid;
+
+	if ( !PL_get_nchars ( bytes_pt, &len, &bytes, CVT_ATOM|CVT_STRING|REP_ISO_LATIN_1 ) )
+		return type_error ( bytes_pt, "bytes" );
+	if ( !PL_is_variable ( ann_pt ) )
+		return type_error ( ann_pt, "var" );
+
+	if ( ( ann = network_from_bytes ( ( unsigned char* ) bytes, len, TRUE, &valid ) ) == NULL )
+		return valid ? type_error ( bytes_pt, "fann_error" ) : domain_error ( bytes_pt, "fann_network_bytes" );
+
+	return unify_ann ( ann_pt, ann );
+}
+
+
+// A model file is the header below, the bytes of fann_serialize/2 without
+// the weights and then the weights, starting at a multiple of
+// MODEL_FILE_ALIGN, a multiple of the page sizes in use. fann_map/2 maps
+// the file privately and points the weights of the network into the
+// mapping, so every process mapping the same file shares their pages
+// until it trains, which copies the pages written to. fann_save_binary/2
+// writes File.tmp and renames it to File, so processes that have the old
+// file mapped keep it unchanged.
+
+#define MODEL_FILE_MAGIC "PLFANNMF"
+#define MODEL_FILE_VERSION 1
+#define MODEL_FILE_ALIGN 65536
+
+typedef struct model_file_header {
+
+	char magic[8];
+	uint32_t version;
+	uint32_t reserved;
+	uint64_t image_size;
+	uint64_t weights_offset;
+	uint64_t weights_size;
+} model_file_header;
+
+
+foreign_t swi_fann_save_binary ( term_t ann_pt, term_t file_pt ) {
+
+	static const char zeros[4096];
+	struct fann *ann;
+	model_file_header h;
+	unsigned char *image;
+	char *file, tmp[PATH_MAX];
+	uint64_t pad;
+	size_t size, n;
+	FILE *fd;
+	int ok;
+
+	if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
+	if ( !PL_get_file_name ( file_pt, &file, PL_FILE_ABSOLUTE ) )
+		return type_error ( file_pt, "file" );
+	if ( snprintf ( tmp, sizeof ( tmp ), "%s.tmp", file ) >= ( int ) sizeof ( tmp ) )
+		return representation_error ( "max_path_length" );
+
+	if ( ( image = network_to_bytes ( ann, FALSE, &size ) ) == NULL )
+		return type_error ( ann_pt, "fann_error" );
+
+	memset ( &h, 0, sizeof ( h ) );
+	memcpy ( h.magic, MODEL_FILE_MAGIC, 8 );
+	h.version = MODEL_FILE_VERSION;
+	h.image_size = size;
+	h.weights_offset = ( sizeof ( h ) + size + MODEL_FILE_ALIGN - 1 ) & ~( uint64_t ) ( MODEL_FILE_ALIGN - 1 );
+	h.weights_size = ( uint64_t ) ann->total_connections * sizeof ( fann_type );
+
+	if ( ( fd = fopen ( tmp, "wb" ) ) == NULL ) {
+
+		free ( image );
+		return type_error ( ann_pt, "fann_error" );
+	}
+
+	ok = fwrite ( &h, sizeof ( h ), 1, fd ) == 1 && fwrite ( image, 1, size, fd ) == size;
+	for ( pad = h.weights_offset - sizeof ( h ) - size; ok && pad; pad -= n ) {
+
+		n = pad < sizeof ( zeros ) ? pad : sizeof ( zeros );
+		ok = fwrite ( zeros, 1, n, fd ) == n;
+	}
+	ok = ok && fwrite ( ann->weights, 1, h.weights_size, fd ) == h.weights_size;
+	ok = fclose ( fd ) == 0 && ok && rename ( tmp, file ) == 0;
+
+	free ( image );
+
+	if ( !ok ) {
+
+		unlink ( tmp );
+		return type_error ( ann_pt, "fann_error" );
+	}
+
+	PL_succeed;
+}
+
+
+foreign_t swi_fann_map ( term_t file_pt, term_t ann_pt ) {
+
+	model_file_header h;
+	struct fann *ann;
+	ann_info *info;
+	struct stat st;
+	unsigned char *map;
+	char *file;
+	int fd, valid;
+
+	if ( !PL_get_file_name ( file_pt, &file, PL_FILE_ABSOLUTE ) )
+		return type_error ( file_pt, "file" );
+	if ( !PL_is_variable ( ann_pt ) )
+		return type_error ( ann_pt, "var" );
+
+	if ( ( fd = open ( file, O_RDONLY ) ) < 0 )
+		return type_error ( file_pt, "file" );
+
+	if ( fstat ( fd, &st ) || ( size_t ) st.st_size < sizeof ( h ) ||
+		( map = mmap ( NULL, st.st_size, PROT_READ|PROT_WRITE, MAP_PRIVATE, fd, 0 ) ) == MAP_FAILED ) {
+
+		close ( fd );
+		return domain_error ( file_pt, "fann_model_file" );
+	}
+
+	close ( fd );
+	memcpy ( &h, map, sizeof ( h ) );
+
+	if ( memcmp ( h.magic, MODEL_FILE_MAGIC, 8 ) || h.version != MODEL_FILE_VERSION ||
+		 h.weights_offset < sizeof ( h ) || h.image_size > h.weights_offset - sizeof ( h ) ||
+		 h.weights_offset % sizeof ( fann_type ) || h.weights_offset > ( uint64_t ) st.st_size ||
+		 h.weights_size != ( uint64_t ) st.st_size - h.weights_offset ) {
+
+		munmap ( map, st.st_size );
+		return domain_error ( file_pt, "fann_model_file" );
+	}
+
+	if ( ( ann = network_from_bytes ( map + sizeof ( h ), h.image_size, FALSE, &valid ) ) == NULL ||
+		 h.weights_size != ( uint64_t ) ann->total_connections * sizeof ( fann_type ) ) {
+
+		if ( ann )
+			fann_destroy ( ann );
+		munmap ( map, st.st_size );
+		return ann || !valid ? domain_error ( file_pt, "fann_model_file" ) : type_error ( file_pt, "fann_error" );
+	}
+
+	if ( ( info = get_ann_info ( ann ) ) == NULL ) {
+
+		destroy_ann ( ann );
+		munmap ( map, st.st_size );
+		return type_error ( file_pt, "fann_error" );
+	}
+
+	free ( ann->weights );
+	ann->weights = ( fann_type* ) ( map + h.weights_offset );
+	info->map = map;
+	info->map_size = st.st_size;
+
+	return unify_ann ( ann_pt, ann );
+}
+
+
 foreign_t swi_fann_create_from_file ( term_t file_pt, term_t ann_pt ) {
 
 	char *file;
@@ -3002,17 +10935,17 @@ foreign_t swi_fann_create_from_file ( term_t file_pt, term_t ann_pt ) {
 	if ( !PL_is_variable ( ann_pt ) )
 		return type_error ( ann_pt, "var" );
 
-	return PL_unify_pointer ( ann_pt, fann_create_from_file ( file ) );
+	return unify_ann ( ann_pt, fann_create_from_file ( file ) );
 }
 
 
 foreign_t swi_fann_save ( term_t ann_pt, term_t file_pt ) {
 
-	void *ann;
+	struct fann *ann;
 	char *file;
 
-	if ( !PL_get_pointer ( ann_pt, &ann ) )
-		return type_error ( ann_pt, "pointer" );
+	if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
 	if ( !PL_get_file_name ( file_pt, &file, PL_FILE_ABSOLUTE ) )
 		return type_error ( file_pt, "file" );
 
@@ -3025,11 +10958,11 @@ foreign_t swi_fann_save ( term_t ann_pt, term_t file_pt ) {
 
 foreign_t swi_fann_save_to_fixed ( term_t ann_pt, term_t file_pt ) {
 
-	void *ann;
+	struct fann *ann;
 	char *file;
 
-	if ( !PL_get_pointer ( ann_pt, &ann ) )
-		return type_error ( ann_pt, "pointer" );
+	if ( !get_ann ( ann_pt, &ann ) )
+		PL_fail;
 	if ( !PL_get_file_name ( file_pt, &file, PL_FILE_ABSOLUTE ) )
 		return type_error ( file_pt, "file" );
 
@@ -3042,14 +10975,14 @@ foreign_t swi_fann_save_to_fixed ( term_t ann_pt, term_t file_pt ) {
 
 foreign_t swi_fann_set_error_log ( term_t error_data_pt, term_t file_pt ) {
 
-	void *error_data;
+	struct fann_error *error_data;
 	char *file, *null;
 
 
 	if ( PL_get_chars ( file_pt, &null, CVT_ATOM ) && !strcmp ( "NULL", null ) ) {
 
-		if ( !PL_get_pointer ( error_data_pt, &error_data ) )
-			return type_error ( error_data_pt, "pointer" );
+		if ( !get_error_data ( error_data_pt, &error_data ) )
+			PL_fail;
 		fann_set_error_log ( error_data, NULL );
 		PL_succeed;
 	}
@@ -3062,8 +10995,8 @@ foreign_t swi_fann_set_error_log ( term_t error_data_pt, term_t file_pt ) {
 		PL_succeed;
 	}
 
-	if ( !PL_get_pointer ( error_data_pt, &error_data ) )
-		return type_error ( error_data_pt, "pointer" );
+	if ( !get_error_data ( error_data_pt, &error_data ) )
+		PL_fail;
     if ( !PL_get_file_name ( file_pt, &file, PL_FILE_ABSOLUTE ) )
 		return type_error ( file_pt, "file" );
 
@@ -3075,10 +11008,10 @@ foreign_t swi_fann_set_error_log ( term_t error_data_pt, term_t file_pt ) {
 
 foreign_t swi_fann_get_errno ( term_t error_data_pt, term_t last_error_pt ) {
 
-	void *error_data;
+	struct fann_error *error_data;
 
-	if ( !PL_get_pointer ( error_data_pt, &error_data ) )
-		return type_error ( error_data_pt, "pointer" );
+	if ( !get_error_data ( error_data_pt, &error_data ) )
+		PL_fail;
 
 	return PL_unify_atom_chars ( last_error_pt, FANN_ERROR_CODES[ fann_get_errno ( error_data ) ] );
 }
@@ -3086,10 +11019,10 @@ foreign_t swi_fann_get_errno ( term_t error_data_pt, term_t last_error_pt ) {
 
 foreign_t swi_fann_reset_errno ( term_t error_data_pt ) {
 
-	void *error_data;
+	struct fann_error *error_data;
 
-	if ( !PL_get_pointer ( error_data_pt, &error_data ) )
-		return type_error ( error_data_pt, "pointer" );
+	if ( !get_error_data ( error_data_pt, &error_data ) )
+		PL_fail;
 
 	fann_reset_errno ( error_data );
 
@@ -3099,10 +11032,10 @@ foreign_t swi_fann_reset_errno ( term_t error_data_pt ) {
 
 foreign_t swi_fann_reset_errstr ( term_t error_data_pt ) {
 
-	void *error_data;
+	struct fann_error *error_data;
 
-	if ( !PL_get_pointer ( error_data_pt, &error_data ) )
-		return type_error ( error_data_pt, "pointer" );
+	if ( !get_error_data ( error_data_pt, &error_data ) )
+		PL_fail;
 
 	fann_reset_errstr ( error_data );
 
@@ -3112,11 +11045,11 @@ foreign_t swi_fann_reset_errstr ( term_t error_data_pt ) {
 
 foreign_t swi_fann_get_errstr ( term_t error_data_pt, term_t last_error_pt ) {
 
-	void *error_data;
+	struct fann_error *error_data;
 	char *log_file;
 
-	if ( !PL_get_pointer ( error_data_pt, &error_data ) )
-		return type_error ( error_data_pt, "pointer" );
+	if ( !get_error_data ( error_data_pt, &error_data ) )
+		PL_fail;
 
 	return PL_unify_atom_chars ( last_error_pt, FANN_ERROR_STRING[ fann_get_errno ( error_data ) ] );
 }
@@ -3124,11 +11057,11 @@ foreign_t swi_fann_get_errstr ( term_t error_data_pt, term_t last_error_pt ) {
 
 foreign_t swi_fann_error ( term_t error_data_pt ) {
 
-	void *error_data;
+	struct fann_error *error_data;
 	struct fann_error *errdat;
 
-	if ( !PL_get_pointer ( error_data_pt, &error_data ) )
-		return type_error ( error_data_pt, "pointer" );
+	if ( !get_error_data ( error_data_pt, &error_data ) )
+		PL_fail;
 
 	errdat = error_data;
 
@@ -3143,10 +11076,10 @@ foreign_t swi_fann_error ( term_t error_data_pt ) {
 
 foreign_t swi_fann_print_error ( term_t error_data_pt ) {
 
-	void *error_data;
+	struct fann_error *error_data;
 
-	if ( !PL_get_pointer ( error_data_pt, &error_data ) )
-		return type_error ( error_data_pt, "pointer" );
+	if ( !get_error_data ( error_data_pt, &error_data ) )
+		PL_fail;
 
 	fann_print_error ( error_data );
 
@@ -3212,201 +11145,273 @@ foreign_t swi_fann_print_mode ( term_t mode_pt ) {
 }
 
 
-install_t install() {
+install_t PL_FANN_INSTALL () {
 
 	// Specific to plfann
 
-	PL_register_foreign ( "fann_type", 1, swi_fann_type, 0); // Gets the type of the compilation fixed, float or double
-	PL_register_foreign ( "fann_error", 1, swi_fann_error, 0); // Succeeds if error has occurred.
-	PL_register_foreign ( "fann_print_mode", 1, swi_fann_print_mode, 0); // Sets or Gets swi_mode FANN_NATIVE or FANN_SWI parameter.
+	PL_FANN_REGISTER ( "fann_type", 1, swi_fann_type, 0); // Gets the type of the compilation fixed, float or double
+	PL_FANN_REGISTER ( "fann_error", 1, swi_fann_error, 0); // Succeeds if error has occurred.
+	PL_FANN_REGISTER ( "fann_print_mode", 1, swi_fann_print_mode, 0); // Sets or Gets swi_mode FANN_NATIVE or FANN_SWI parameter.
 
-	// Creation, Destruction & Execution (12)
+	// Creation, Destruction & Execution (13)
 
 	// fann_create_standard: Implemented in plfann.pl, Creates a standard fully connected backpropagation neural network.
-	PL_register_foreign ( "fann_create_standard_array", 2, swi_fann_create_standard_array, 0); // Just like fann_create_standard, but with an array of layer sizes instead of individual parameters.
+	PL_FANN_REGISTER ( "fann_create_standard_array", 2, swi_fann_create_standard_array, 0); // Just like fann_create_standard, but with an array of layer sizes instead of individual parameters.
 	// fann_create_spares: Implemented in plfann.pl, Creates a standard backpropagation neural network, which is not fully connected.
-	PL_register_foreign ( "fann_create_sparse_array", 3, swi_fann_create_sparse_array, 0); // Just like fann_create_sparse, but with an array of layer sizes instead of individual parameters.
+	PL_FANN_REGISTER ( "fann_create_sparse_array", 3, swi_fann_create_sparse_array, 0); // Just like fann_create_sparse, but with an array of layer sizes instead of individual parameters.
 	// fann_create_shortcut: Implemented in plfann.pl, Creates a standard backpropagation neural network, which is not fully connected and which also has shortcut connections.
-	PL_register_foreign ( "fann_create_shortcut_array", 2, swi_fann_create_shortcut_array, 0); // Just like fann_create_shortcut, but with an array of layer sizes instead of individual parameters.
-	PL_register_foreign ( "fann_destroy", 1, swi_fann_destroy, 0); // Destroys the entire network and properly freeing all the associated memmory.
+	PL_FANN_REGISTER ( "fann_create_shortcut_array", 2, swi_fann_create_shortcut_array, 0); // Just like fann_create_shortcut, but with an array of layer sizes instead of individual parameters.
+	PL_FANN_REGISTER ( "fann_destroy", 1, swi_fann_destroy, 0); // Destroys the entire network and properly freeing all the associated memmory.
 #ifdef VERSION220
-	PL_register_foreign ( "fann_copy", 2, swi_fann_copy, 0); // Creates a copy of a fann structure.
-#endif
-	PL_register_foreign ( "fann_run", 3, swi_fann_run, 0); // Will run input through the neural network, returning an array of outputs, the number of which being equal to the number of neurons in the output layer.
-	PL_register_foreign ( "fann_run_unsafe", 3, swi_fann_run_unsafe, 0); // Will run input through the neural network, returning an array of outputs, the number of which being equal to the number of neurons in the output layer, no runtime checks.
-	PL_register_foreign ( "fann_randomize_weights", 3, swi_fann_randomize_weights, 0); // Give each connection a random weight between min_weight and max_weight
-	PL_register_foreign ( "fann_init_weights", 2, swi_fann_init_weights, 0); // Initialize the weights using Widrow + Nguyen’s algorithm.
-	PL_register_foreign ( "fann_print_connections", 1, swi_fann_print_connections, 0); // Will print the connections of the ann in a compact matrix, for easy viewing of the internals of the ann.
-
-	// Parameters (16)
-
-	PL_register_foreign ( "fann_print_parameters", 1, swi_fann_print_parameters, 0); // Prints all of the parameters and options of the ANN
-	PL_register_foreign ( "fann_get_num_input", 2, swi_fann_get_num_input, 0); // Get the number of input neurons.
-	PL_register_foreign ( "fann_get_num_output", 2, swi_fann_get_num_output, 0); // Get the number of output neurons.
-	PL_register_foreign ( "fann_get_total_neurons", 2, swi_fann_get_total_neurons, 0); // Get the total number of neurons in the entire network.
-	PL_register_foreign ( "fann_get_total_connections", 2, swi_fann_get_total_connections, 0); // Get the total number of connections in the entire network.
-	PL_register_foreign ( "fann_get_network_type", 2, swi_fann_get_network_type, 0); // Get the type of neural network it was created as.
-	PL_register_foreign ( "fann_get_connection_rate", 2, swi_fann_get_connection_rate, 0); // Get the connection rate used when the network was created
-	PL_register_foreign ( "fann_get_num_layers", 2, swi_fann_get_num_layers, 0); // Get the number of layers in the network
-	PL_register_foreign ( "fann_get_layer_array", 2, swi_fann_get_layer_array, 0); // Get the number of neurons in each layer in the network.
-	PL_register_foreign ( "fann_get_bias_array", 2, swi_fann_get_bias_array, 0); // Get the number of bias in each layer in the network.
-	PL_register_foreign ( "fann_get_connection_array", 2, swi_fann_get_connection_array, 0); // Get the connections (a pointer to) in the network.
-	PL_register_foreign ( "fann_set_weight_array", 2, swi_fann_set_weight_array, 0); // Set connections in the network.
-	PL_register_foreign ( "fann_set_weight", 4, swi_fann_set_weight, 0); // Set a connection in the network.
-	PL_register_foreign ( "fann_set_user_data", 2, swi_fann_set_user_data, 0); // Store a pointer to user defined data.
-	PL_register_foreign ( "fann_get_user_data", 2, swi_fann_get_user_data, 0); // Get a pointer to user defined data that was previously set with fann_set_user_data.
-	PL_register_foreign ( "fann_get_decimal_point", 2, swi_fann_get_decimal_point, 0); // Returns the position of the decimal point in the ann.
-	PL_register_foreign ( "fann_get_multiplier", 2, swi_fann_get_multiplier, 0); // Returns the multiplier that fix point data is multiplied with.
+	PL_FANN_REGISTER ( "fann_copy", 2, swi_fann_copy, 0); // Creates a copy of a fann structure.
+#endif
+	PL_FANN_REGISTER ( "fann_run", 3, swi_fann_run, 0); // Will run input through the neural network, returning an array of outputs, the number of which being equal to the number of neurons in the output layer.
+	PL_FANN_REGISTER ( "fann_run_unsafe", 3, swi_fann_run_unsafe, 0); // Will run input through the neural network, returning an array of outputs, the number of which being equal to the number of neurons in the output layer, no runtime checks.
+	PL_FANN_REGISTER ( "fann_randomize_weights", 3, swi_fann_randomize_weights, 0); // Give each connection a random weight between min_weight and max_weight
+	PL_FANN_REGISTER ( "fann_set_random_seed", 2, swi_fann_set_random_seed, 0); // Seeds the random number generator of the network.
+	PL_FANN_REGISTER ( "fann_init_weights", 2, swi_fann_init_weights, 0); // Initialize the weights using Widrow + Nguyen’s algorithm.
+	PL_FANN_REGISTER ( "fann_print_connections", 1, swi_fann_print_connections, 0); // Will print the connections of the ann in a compact matrix, for easy viewing of the internals of the ann.
+
+	// Parameters (20)
+
+	PL_FANN_REGISTER ( "fann_print_parameters", 1, swi_fann_print_parameters, 0); // Prints all of the parameters and options of the ANN
+	PL_FANN_REGISTER ( "fann_get_num_input", 2, swi_fann_get_num_input, 0); // Get the number of input neurons.
+	PL_FANN_REGISTER ( "fann_get_num_output", 2, swi_fann_get_num_output, 0); // Get the number of output neurons.
+	PL_FANN_REGISTER ( "fann_get_total_neurons", 2, swi_fann_get_total_neurons, 0); // Get the total number of neurons in the entire network.
+	PL_FANN_REGISTER ( "fann_get_total_connections", 2, swi_fann_get_total_connections, 0); // Get the total number of connections in the entire network.
+	PL_FANN_REGISTER ( "fann_get_network_type", 2, swi_fann_get_network_type, 0); // Get the type of neural network it was created as.
+	PL_FANN_REGISTER ( "fann_get_connection_rate", 2, swi_fann_get_connection_rate, 0); // Get the connection rate used when the network was created
+	PL_FANN_REGISTER ( "fann_get_num_layers", 2, swi_fann_get_num_layers, 0); // Get the number of layers in the network
+	PL_FANN_REGISTER ( "fann_get_layer_array", 2, swi_fann_get_layer_array, 0); // Get the number of neurons in each layer in the network.
+	PL_FANN_REGISTER ( "fann_get_bias_array", 2, swi_fann_get_bias_array, 0); // Get the number of bias in each layer in the network.
+	PL_FANN_REGISTER ( "fann_get_connection_array", 2, swi_fann_get_connection_array, 0); // Get the connections (a pointer to) in the network.
+	PL_FANN_REGISTER ( "fann_set_weight_array", 2, swi_fann_set_weight_array, 0); // Set connections in the network.
+	PL_FANN_REGISTER ( "fann_set_weight", 4, swi_fann_set_weight, 0); // Set a connection in the network.
+	PL_FANN_REGISTER ( "fann_get_weights_packed", 2, swi_fann_get_weights_packed, 0); // Copies all weights to a string of native numbers.
+	PL_FANN_REGISTER ( "fann_get_weights_packed", 4, swi_fann_get_weights_packed_4, 0); // Copies a range of weights to a string of native numbers.
+	PL_FANN_REGISTER ( "fann_set_weights_packed", 2, swi_fann_set_weights_packed, 0); // Sets all weights from a string of native numbers.
+	PL_FANN_REGISTER ( "fann_set_weights_packed", 3, swi_fann_set_weights_packed_3, 0); // Sets a range of weights from a string of native numbers.
+	PL_FANN_REGISTER ( "fann_set_user_data", 2, swi_fann_set_user_data, 0); // Store a pointer to user defined data.
+	PL_FANN_REGISTER ( "fann_get_user_data", 2, swi_fann_get_user_data, 0); // Get a pointer to user defined data that was previously set with fann_set_user_data.
+	PL_FANN_REGISTER ( "fann_get_decimal_point", 2, swi_fann_get_decimal_point, 0); // Returns the position of the decimal point in the ann.
+	PL_FANN_REGISTER ( "fann_get_multiplier", 2, swi_fann_get_multiplier, 0); // Returns the multiplier that fix point data is multiplied with.
 
 	// Training (5)
 
-	PL_register_foreign ( "fann_train", 3, swi_fann_train, 0); // Train one iteration with a set of inputs, and a set of desired outputs.
-	PL_register_foreign ( "fann_test", 3, swi_fann_test, 0); // Test with a set of inputs, and a set of desired outputs.
-	PL_register_foreign ( "fann_get_MSE", 2, swi_fann_get_MSE, 0); // Reads the mean square error from the network.
-	PL_register_foreign ( "fann_get_bit_fail", 2, swi_fann_get_bit_fail, 0); // The number of fail bits; means the number of output neurons which differ more than the bit fail limit (see fann_get_bit_fail_limit, fann_set_bit_fail_limit).
-	PL_register_foreign ( "fann_reset_MSE", 1, swi_fann_reset_MSE, 0); // Resets the mean square error from the network.
-
-	// Training Data Training (4)
-
-	PL_register_foreign ( "fann_train_on_data", 5, swi_fann_train_on_data, 0); // Trains on an entire dataset, for a period of time.
-	PL_register_foreign ( "fann_train_on_file", 5, swi_fann_train_on_file, 0); // Does the same as fann_train_on_data, but reads the training data directly from a file.
-	PL_register_foreign ( "fann_train_epoch", 2, swi_fann_train_epoch, 0); // Train one epoch with a set of training data.
-	PL_register_foreign ( "fann_test_data", 3, swi_fann_test_data, 0); // Test a set of training data and calculates the MSE for the training data.
-
-	// Training Data Manipulation (25)
-
-	PL_register_foreign ( "fann_read_train_from_file", 2, swi_fann_read_train_from_file, 0); // Reads a file that stores training data.
+	PL_FANN_REGISTER ( "fann_train", 3, swi_fann_train, 0); // Train one iteration with a set of inputs, and a set of desired outputs.
+	PL_FANN_REGISTER ( "fann_test", 3, swi_fann_test, 0); // Test with a set of inputs, and a set of desired outputs.
+	PL_FANN_REGISTER ( "fann_get_MSE", 2, swi_fann_get_MSE, 0); // Reads the mean square error from the network.
+	PL_FANN_REGISTER ( "fann_get_bit_fail", 2, swi_fann_get_bit_fail, 0); // The number of fail bits; means the number of output neurons which differ more than the bit fail limit (see fann_get_bit_fail_limit, fann_set_bit_fail_limit).
+	PL_FANN_REGISTER ( "fann_reset_MSE", 1, swi_fann_reset_MSE, 0); // Resets the mean square error from the network.
+
+	// Vectors and Matrices (10)
+
+	PL_FANN_REGISTER ( "fann_create_vector", 2, swi_fann_create_vector, 0); // Keeps a list or compound term of values in C.
+	PL_FANN_REGISTER ( "fann_create_matrix", 2, swi_fann_create_matrix, 0); // Keeps a list of rows of values in C.
+	PL_FANN_REGISTER ( "fann_create_matrix_from_packed", 3, swi_fann_create_matrix_from_packed, 0); // Creates a matrix from packed native rows.
+	PL_FANN_REGISTER ( "fann_get_matrix_packed", 2, swi_fann_get_matrix_packed, 0); // Packs a matrix into native rows.
+	PL_FANN_REGISTER ( "fann_matrix_size", 3, swi_fann_matrix_size, 0); // The number of rows and columns of a matrix.
+	PL_FANN_REGISTER ( "fann_vector_values", 2, swi_fann_vector_values, 0); // All values of a matrix as one list.
+	PL_FANN_REGISTER ( "fann_matrix_values", 2, swi_fann_matrix_values, 0); // The rows of a matrix as lists.
+	PL_FANN_REGISTER ( "fann_matrix_op", 4, swi_fann_matrix_op, 0); // Adds, subtracts, multiplies, divides or takes the minimum or maximum elementwise.
+	PL_FANN_REGISTER ( "fann_slice_matrix", 6, swi_fann_slice_matrix, 0); // Copies a block of rows and columns of a matrix.
+	PL_FANN_REGISTER ( "fann_destroy_matrix", 1, swi_fann_destroy_matrix, 0); // Frees a matrix.
+
+	// Training Data Training (10)
+
+	PL_FANN_REGISTER ( "fann_train_on_data", 5, swi_fann_train_on_data, 0); // Trains on an entire dataset, for a period of time.
+	PL_FANN_REGISTER ( "fann_train_on_data", 6, swi_fann_train_on_data_6, 0); // Same as fann_train_on_data/5, with a time budget.
+	PL_FANN_REGISTER ( "fann_train_on_data_resume", 4, swi_fann_train_on_data_resume, 0); // Continues training from a checkpoint.
+	PL_FANN_REGISTER ( "fann_train_on_data_validated", 4, swi_fann_train_on_data_validated, 0); // Trains with early stopping against a validation set.
+	PL_FANN_REGISTER ( "fann_hyper_search", 5, swi_fann_hyper_search, 0); // Trains a set of networks in parallel and ranks them on a validation set.
+	PL_FANN_REGISTER ( "fann_cross_validate", 5, swi_fann_cross_validate, 0); // Trains and tests one network per fold of a dataset in parallel.
+	PL_FANN_REGISTER ( "fann_train_on_file", 5, swi_fann_train_on_file, 0); // Does the same as fann_train_on_data, but reads the training data directly from a file.
+	PL_FANN_REGISTER ( "fann_train_on_file", 6, swi_fann_train_on_file_6, 0); // Trains on a file streamed from disk in chunks.
+	PL_FANN_REGISTER ( "fann_train_on_compact", 6, swi_fann_train_on_compact, 0); // Trains on compact training data, widened in chunks.
+	PL_FANN_REGISTER ( "fann_train_epoch", 2, swi_fann_train_epoch, 0); // Train one epoch with a set of training data.
+	PL_FANN_REGISTER ( "fann_set_schedule", 3, swi_fann_set_schedule, 0); // Attaches a learning rate or momentum schedule to the network.
+	PL_FANN_REGISTER ( "fann_test_data", 3, swi_fann_test_data, 0); // Test a set of training data and calculates the MSE for the training data.
+	PL_FANN_REGISTER ( "fann_test_compact", 3, swi_fann_test_compact, 0); // Tests compact training data and calculates the MSE.
+
+	// Training Data Manipulation (30)
+
+	PL_FANN_REGISTER ( "fann_read_train_from_file", 2, swi_fann_read_train_from_file, 0); // Reads a file that stores training data.
+	PL_FANN_REGISTER ( "fann_read_train_from_file", 3, swi_fann_read_train_from_file_3, 0); // Reads a file that stores training data, with options.
+	PL_FANN_REGISTER ( "fann_read_train_csv", 3, swi_fann_read_train_csv, 0); // Reads training data from CSV or TSV columns of a file or stream.
+	PL_FANN_REGISTER ( "fann_create_train_from_lists", 3, swi_fann_create_train_from_lists, 0); // Creates training data from lists of input and output rows.
+	PL_FANN_REGISTER ( "fann_create_train_from_packed", 4, swi_fann_create_train_from_packed, 0); // Creates training data from packed native rows.
+	PL_FANN_REGISTER ( "fann_get_train_packed", 2, swi_fann_get_train_packed, 0); // Packs training data into native rows.
+	PL_FANN_REGISTER ( "fann_append_train", 3, swi_fann_append_train, 0); // Appends a row to training data in place.
+	PL_FANN_REGISTER ( "fann_append_train_rows", 3, swi_fann_append_train_rows, 0); // Appends lists of rows to training data in place.
+	PL_FANN_REGISTER ( "fann_append_train_data", 2, swi_fann_append_train_data, 0); // Appends the rows of other training data in place.
 #ifdef VERSION220
-	PL_register_foreign ( "fann_create_train", 4, swi_fann_create_train, 0); // Creates an empty training data struct.
-#endif
-	// PL_register_foreign ( "fann_create_train_from_callback", na, swi_fann_create_train_from_callback, 0); // Creates the training data struct from a user supplied function.
-	PL_register_foreign ( "fann_destroy_train", 1, swi_fann_destroy_train, 0); // Destructs the training data and properly deallocates all of the associated data.
-	PL_register_foreign ( "fann_shuffle_train_data", 1, swi_fann_shuffle_train_data, 0); // Shuffles training data, randomizing the order.
-	PL_register_foreign ( "fann_scale_train", 2, swi_fann_scale_train, 0); // Scale input and output data based on previously calculated parameters.
-	PL_register_foreign ( "fann_descale_train", 2, swi_fann_descale_train, 0); // Descale input and output data based on previously calculated parameters.
-	PL_register_foreign ( "fann_set_input_scaling_params", 4, swi_fann_set_input_scaling_params, 0); // Calculate input scaling parameters for future use based on training data.
-	PL_register_foreign ( "fann_set_output_scaling_params", 4, swi_fann_set_output_scaling_params, 0); // Calculate output scaling parameters for future use based on training data.
-	PL_register_foreign ( "fann_set_scaling_params", 6, swi_fann_set_scaling_params, 0); // Calculate input and output scaling parameters for future use based on training data.
-	PL_register_foreign ( "fann_clear_scaling_params", 1, swi_fann_clear_scaling_params, 0); // Clears scaling parameters.
-	PL_register_foreign ( "fann_scale_input", 2, swi_fann_scale_input, 0); // Scale data in input vector before feed it to ann based on previously calculated parameters.
-	PL_register_foreign ( "fann_scale_output", 2, swi_fann_scale_output, 0); // Scale data in output vector before feed it to ann based on previously calculated parameters.
-	PL_register_foreign ( "fann_descale_input", 2, swi_fann_descale_input, 0); // Scale data in input vector after get it from ann based on previously calculated parameters.
-	PL_register_foreign ( "fann_descale_output", 2, swi_fann_descale_output, 0); // Scale data in output vector after get it from ann based on previously calculated parameters.
-	PL_register_foreign ( "fann_scale_input_train_data", 3, swi_fann_scale_input_train_data, 0); // Scales the inputs in the training data to the specified range.
-	PL_register_foreign ( "fann_scale_output_train_data", 3, swi_fann_scale_output_train_data, 0); // Scales the outputs in the training data to the specified range.
-	PL_register_foreign ( "fann_scale_train_data", 3, swi_fann_scale_train_data, 0); // Scales the inputs and outputs in the training data to the specified range.
-	PL_register_foreign ( "fann_merge_train_data", 3, swi_fann_merge_train_data, 0); // Merges the data from data1 and data2 into a new struct fann_train_data.
-	PL_register_foreign ( "fann_duplicate_train_data", 2, swi_fann_duplicate_train_data, 0); // Returns an exact copy of a struct fann_train_data.
-	PL_register_foreign ( "fann_subset_train_data", 4, swi_fann_subset_train_data, 0); // Returns an copy of a subset of the struct fann_train_data, starting at position pos and length elements forward.
-	PL_register_foreign ( "fann_length_train_data", 2, swi_fann_length_train_data, 0); // Returns the number of training patterns in the struct fann_train_data.
-	PL_register_foreign ( "fann_num_input_train_data", 2, swi_fann_num_input_train_data, 0); // Returns the number of inputs in each of the training patterns in the struct fann_train_data.
-	PL_register_foreign ( "fann_num_output_train_data", 2, swi_fann_num_output_train_data, 0); // Returns the number of outputs in each of the training patterns in the struct fann_train_data.
-	PL_register_foreign ( "fann_save_train", 2, swi_fann_save_train, 0); // Save the training structure to a file, with the format as specified in fann_read_train_from_file
-	PL_register_foreign ( "fann_save_train_to_fixed", 3, swi_fann_save_train_to_fixed, 0); // Saves the training structure to a fixed point data file.
+	PL_FANN_REGISTER ( "fann_create_train", 4, swi_fann_create_train, 0); // Creates an empty training data struct.
+#endif
+	// PL_FANN_REGISTER ( "fann_create_train_from_callback", na, swi_fann_create_train_from_callback, 0); // Creates the training data struct from a user supplied function.
+	PL_FANN_REGISTER ( "fann_destroy_train", 1, swi_fann_destroy_train, 0); // Destructs the training data and properly deallocates all of the associated data.
+	PL_FANN_REGISTER ( "fann_shuffle_train_data", 1, swi_fann_shuffle_train_data, 0); // Shuffles training data, randomizing the order.
+	PL_FANN_REGISTER ( "fann_scale_train", 2, swi_fann_scale_train, 0); // Scale input and output data based on previously calculated parameters.
+	PL_FANN_REGISTER ( "fann_descale_train", 2, swi_fann_descale_train, 0); // Descale input and output data based on previously calculated parameters.
+	PL_FANN_REGISTER ( "fann_set_input_scaling_params", 4, swi_fann_set_input_scaling_params, 0); // Calculate input scaling parameters for future use based on training data.
+	PL_FANN_REGISTER ( "fann_set_output_scaling_params", 4, swi_fann_set_output_scaling_params, 0); // Calculate output scaling parameters for future use based on training data.
+	PL_FANN_REGISTER ( "fann_set_scaling_params", 6, swi_fann_set_scaling_params, 0); // Calculate input and output scaling parameters for future use based on training data.
+	PL_FANN_REGISTER ( "fann_clear_scaling_params", 1, swi_fann_clear_scaling_params, 0); // Clears scaling parameters.
+	PL_FANN_REGISTER ( "fann_scale_input", 2, swi_fann_scale_input, 0); // Scale data in input vector before feed it to ann based on previously calculated parameters.
+	PL_FANN_REGISTER ( "fann_scale_output", 2, swi_fann_scale_output, 0); // Scale data in output vector before feed it to ann based on previously calculated parameters.
+	PL_FANN_REGISTER ( "fann_descale_input", 2, swi_fann_descale_input, 0); // Scale data in input vector after get it from ann based on previously calculated parameters.
+	PL_FANN_REGISTER ( "fann_descale_output", 2, swi_fann_descale_output, 0); // Scale data in output vector after get it from ann based on previously calculated parameters.
+	PL_FANN_REGISTER ( "fann_scale_input_train_data", 3, swi_fann_scale_input_train_data, 0); // Scales the inputs in the training data to the specified range.
+	PL_FANN_REGISTER ( "fann_scale_output_train_data", 3, swi_fann_scale_output_train_data, 0); // Scales the outputs in the training data to the specified range.
+	PL_FANN_REGISTER ( "fann_scale_train_data", 3, swi_fann_scale_train_data, 0); // Scales the inputs and outputs in the training data to the specified range.
+	PL_FANN_REGISTER ( "fann_train_stats", 2, swi_fann_train_stats, 0); // Minimum, maximum, mean, variance and NaN count of every column.
+	PL_FANN_REGISTER ( "fann_zscore_input_train_data", 1, swi_fann_zscore_input_train_data, 0); // Scales the inputs in the training data to mean 0 and variance 1.
+	PL_FANN_REGISTER ( "fann_zscore_output_train_data", 1, swi_fann_zscore_output_train_data, 0); // Scales the outputs in the training data to mean 0 and variance 1.
+	PL_FANN_REGISTER ( "fann_zscore_train_data", 1, swi_fann_zscore_train_data, 0); // Scales the inputs and outputs in the training data to mean 0 and variance 1.
+	PL_FANN_REGISTER ( "fann_merge_train_data", 3, swi_fann_merge_train_data, 0); // Merges the data from data1 and data2 into a new struct fann_train_data.
+	PL_FANN_REGISTER ( "fann_duplicate_train_data", 2, swi_fann_duplicate_train_data, 0); // Returns an exact copy of a struct fann_train_data.
+	PL_FANN_REGISTER ( "fann_subset_train_data", 4, swi_fann_subset_train_data, 0); // Returns an copy of a subset of the struct fann_train_data, starting at position pos and length elements forward.
+	PL_FANN_REGISTER ( "fann_subset_train_data_view", 4, swi_fann_subset_train_data_view, 0); // Same as fann_subset_train_data, without copying the rows.
+	PL_FANN_REGISTER ( "fann_index_train_data_view", 3, swi_fann_index_train_data_view, 0); // Returns a view on the rows at a list of indices.
+	PL_FANN_REGISTER ( "fann_bootstrap_train_data_view", 3, swi_fann_bootstrap_train_data_view, 0); // Returns a view on rows drawn with replacement.
+	PL_FANN_REGISTER ( "fann_is_train_data_view", 1, swi_fann_is_train_data_view, 0); // True if the training data is a view.
+	PL_FANN_REGISTER ( "fann_set_train_data_random_seed", 2, swi_fann_set_train_data_random_seed, 0); // Seeds the random number generator of the training data.
+	PL_FANN_REGISTER ( "fann_length_train_data", 2, swi_fann_length_train_data, 0); // Returns the number of training patterns in the struct fann_train_data.
+	PL_FANN_REGISTER ( "fann_num_input_train_data", 2, swi_fann_num_input_train_data, 0); // Returns the number of inputs in each of the training patterns in the struct fann_train_data.
+	PL_FANN_REGISTER ( "fann_num_output_train_data", 2, swi_fann_num_output_train_data, 0); // Returns the number of outputs in each of the training patterns in the struct fann_train_data.
+	PL_FANN_REGISTER ( "fann_save_train", 2, swi_fann_save_train, 0); // Save the training structure to a file, with the format as specified in fann_read_train_from_file
+	PL_FANN_REGISTER ( "fann_save_train_to_fixed", 3, swi_fann_save_train_to_fixed, 0); // Saves the training structure to a fixed point data file.
+	PL_FANN_REGISTER ( "fann_save_train_binary", 2, swi_fann_save_train_binary, 0); // Saves the training structure to a binary file for fann_map_train.
+	PL_FANN_REGISTER ( "fann_map_train", 2, swi_fann_map_train, 0); // Maps a binary training data file into memory.
+	PL_FANN_REGISTER ( "fann_compact_train_data", 3, swi_fann_compact_train_data, 0); // Stores training data as float16, bfloat16, int8 or int16.
+	PL_FANN_REGISTER ( "fann_expand_train_data", 2, swi_fann_expand_train_data, 0); // Widens compact training data back to training data.
+	PL_FANN_REGISTER ( "fann_compact_train_error", 3, swi_fann_compact_train_error, 0); // The maximum and RMS error of the compaction.
+	PL_FANN_REGISTER ( "fann_destroy_compact_train", 1, swi_fann_destroy_compact_train, 0); // Frees compact training data.
 
 	// Parameters (44)
 
-	PL_register_foreign ( "fann_get_training_algorithm", 2, swi_fann_get_training_algorithm, 0); // Return the training algorithm as described by fann_train_enum.
-	PL_register_foreign ( "fann_set_training_algorithm", 2, swi_fann_set_training_algorithm, 0); // Set the training algorithm.
-	PL_register_foreign ( "fann_get_learning_rate", 2, swi_fann_get_learning_rate, 0); // Return the learning rate.
-	PL_register_foreign ( "fann_set_learning_rate", 2, swi_fann_set_learning_rate, 0); // Set the learning rate.
-	PL_register_foreign ( "fann_get_learning_momentum", 2, swi_fann_get_learning_momentum, 0); // Get the learning momentum.
-	PL_register_foreign ( "fann_set_learning_momentum", 2, swi_fann_set_learning_momentum, 0); // Set the learning momentum.
-	PL_register_foreign ( "fann_get_activation_function", 4, swi_fann_get_activation_function, 0); // Get the activation function for neuron number neuron in layer number layer, counting the input layer as layer 0.
-	PL_register_foreign ( "fann_set_activation_function", 4, swi_fann_set_activation_function, 0); // Set the activation function for neuron number neuron in layer number layer, counting the input layer as layer 0.
-	PL_register_foreign ( "fann_set_activation_function_layer", 3, swi_fann_set_activation_function_layer, 0); // Set the activation function for all the neurons in the layer number layer, counting the input layer as layer 0.
-	PL_register_foreign ( "fann_set_activation_function_hidden", 2, swi_fann_set_activation_function_hidden, 0); // Set the activation function for all of the hidden layers.
-	PL_register_foreign ( "fann_set_activation_function_output", 2, swi_fann_set_activation_function_output, 0); // Set the activation function for the output layer.
-	PL_register_foreign ( "fann_get_activation_steepness", 4, swi_fann_get_activation_steepness, 0); // Get the activation steepness for neuron number neuron in layer number layer, counting the input layer as layer 0.
-	PL_register_foreign ( "fann_set_activation_steepness", 4, swi_fann_set_activation_steepness, 0); // Set the activation steepness for neuron number neuron in layer number layer, counting the input layer as layer 0.
-	PL_register_foreign ( "fann_set_activation_steepness_layer", 3, swi_fann_set_activation_steepness_layer, 0); // Set the activation steepness all of the neurons in layer number layer, counting the input layer as layer 0.
-	PL_register_foreign ( "fann_set_activation_steepness_hidden", 2, swi_fann_set_activation_steepness_hidden, 0); // Set the steepness of the activation steepness in all of the hidden layers.
-	PL_register_foreign ( "fann_set_activation_steepness_output", 2, swi_fann_set_activation_steepness_output, 0); // Set the steepness of the activation steepness in the output layer.
-	PL_register_foreign ( "fann_get_train_error_function", 2, swi_fann_get_train_error_function, 0); // Returns the error function used during training.
-	PL_register_foreign ( "fann_set_train_error_function", 2, swi_fann_set_train_error_function, 0); // Set the error function used during training.
-	PL_register_foreign ( "fann_get_train_stop_function", 2, swi_fann_get_train_stop_function, 0); // Returns the the stop function used during training.
-	PL_register_foreign ( "fann_set_train_stop_function", 2, swi_fann_set_train_stop_function, 0); // Set the stop function used during training.
-	PL_register_foreign ( "fann_get_bit_fail_limit", 2, swi_fann_get_bit_fail_limit, 0); // Returns the bit fail limit used during training.
-	PL_register_foreign ( "fann_set_bit_fail_limit", 2, swi_fann_set_bit_fail_limit, 0); // Set the bit fail limit used during training.
-	// PL_register_foreign ( "fann_set_callback", na, swi_fann_set_callback, 0); // Sets the callback function for use during training.
-	PL_register_foreign ( "fann_get_quickprop_decay", 2, swi_fann_get_quickprop_decay, 0); // The decay is a small negative valued number which is the factor that the weights should become smaller in each iteration during quickprop training.
-	PL_register_foreign ( "fann_set_quickprop_decay", 2, swi_fann_set_quickprop_decay, 0); // Sets the quickprop decay factor.
-	PL_register_foreign ( "fann_get_quickprop_mu", 2, swi_fann_get_quickprop_mu, 0); // The mu factor is used to increase and decrease the step-size during quickprop training.
-	PL_register_foreign ( "fann_set_quickprop_mu", 2, swi_fann_set_quickprop_mu, 0); // Sets the quickprop mu factor.
-	PL_register_foreign ( "fann_get_rprop_increase_factor", 2, swi_fann_get_rprop_increase_factor, 0); // The increase factor is a value larger than 1, which is used to increase the step-size during RPROP training.
-	PL_register_foreign ( "fann_set_rprop_increase_factor", 2, swi_fann_set_rprop_increase_factor, 0); // The increase factor used during RPROP training.
-	PL_register_foreign ( "fann_get_rprop_decrease_factor", 2, swi_fann_get_rprop_decrease_factor, 0); // The decrease factor is a value smaller than 1, which is used to decrease the step-size during RPROP training.
-	PL_register_foreign ( "fann_set_rprop_decrease_factor", 2, swi_fann_set_rprop_decrease_factor, 0); // The decrease factor is a value smaller than 1, which is used to decrease the step-size during RPROP training.
-	PL_register_foreign ( "fann_get_rprop_delta_min", 2, swi_fann_get_rprop_delta_min, 0); // The minimum step-size is a small positive number determining how small the minimum step-size may be.
-	PL_register_foreign ( "fann_set_rprop_delta_min", 2, swi_fann_set_rprop_delta_min, 0); // The minimum step-size is a small positive number determining how small the minimum step-size may be.
-	PL_register_foreign ( "fann_get_rprop_delta_max", 2, swi_fann_get_rprop_delta_max, 0); // The maximum step-size is a positive number determining how large the maximum step-size may be.
-	PL_register_foreign ( "fann_set_rprop_delta_max", 2, swi_fann_set_rprop_delta_max, 0); // The maximum step-size is a positive number determining how large the maximum step-size may be.
-	PL_register_foreign ( "fann_get_rprop_delta_zero", 2, swi_fann_get_rprop_delta_zero, 0); // The initial step-size is a positive number determining the initial step size.
-	PL_register_foreign ( "fann_set_rprop_delta_zero", 2, swi_fann_set_rprop_delta_zero, 0); // The initial step-size is a positive number determining the initial step size.
+	PL_FANN_REGISTER ( "fann_get_training_algorithm", 2, swi_fann_get_training_algorithm, 0); // Return the training algorithm as described by fann_train_enum.
+	PL_FANN_REGISTER ( "fann_set_training_algorithm", 2, swi_fann_set_training_algorithm, 0); // Set the training algorithm.
+	PL_FANN_REGISTER ( "fann_get_learning_rate", 2, swi_fann_get_learning_rate, 0); // Return the learning rate.
+	PL_FANN_REGISTER ( "fann_set_learning_rate", 2, swi_fann_set_learning_rate, 0); // Set the learning rate.
+	PL_FANN_REGISTER ( "fann_get_learning_momentum", 2, swi_fann_get_learning_momentum, 0); // Get the learning momentum.
+	PL_FANN_REGISTER ( "fann_set_learning_momentum", 2, swi_fann_set_learning_momentum, 0); // Set the learning momentum.
+	PL_FANN_REGISTER ( "fann_get_activation_function", 4, swi_fann_get_activation_function, 0); // Get the activation function for neuron number neuron in layer number layer, counting the input layer as layer 0.
+	PL_FANN_REGISTER ( "fann_set_activation_function", 4, swi_fann_set_activation_function, 0); // Set the activation function for neuron number neuron in layer number layer, counting the input layer as layer 0.
+	PL_FANN_REGISTER ( "fann_set_activation_function_layer", 3, swi_fann_set_activation_function_layer, 0); // Set the activation function for all the neurons in the layer number layer, counting the input layer as layer 0.
+	PL_FANN_REGISTER ( "fann_set_activation_function_hidden", 2, swi_fann_set_activation_function_hidden, 0); // Set the activation function for all of the hidden layers.
+	PL_FANN_REGISTER ( "fann_set_activation_function_output", 2, swi_fann_set_activation_function_output, 0); // Set the activation function for the output layer.
+	PL_FANN_REGISTER ( "fann_get_activation_steepness", 4, swi_fann_get_activation_steepness, 0); // Get the activation steepness for neuron number neuron in layer number layer, counting the input layer as layer 0.
+	PL_FANN_REGISTER ( "fann_set_activation_steepness", 4, swi_fann_set_activation_steepness, 0); // Set the activation steepness for neuron number neuron in layer number layer, counting the input layer as layer 0.
+	PL_FANN_REGISTER ( "fann_set_activation_steepness_layer", 3, swi_fann_set_activation_steepness_layer, 0); // Set the activation steepness all of the neurons in layer number layer, counting the input layer as layer 0.
+	PL_FANN_REGISTER ( "fann_set_activation_steepness_hidden", 2, swi_fann_set_activation_steepness_hidden, 0); // Set the steepness of the activation steepness in all of the hidden layers.
+	PL_FANN_REGISTER ( "fann_set_activation_steepness_output", 2, swi_fann_set_activation_steepness_output, 0); // Set the steepness of the activation steepness in the output layer.
+	PL_FANN_REGISTER ( "fann_get_train_error_function", 2, swi_fann_get_train_error_function, 0); // Returns the error function used during training.
+	PL_FANN_REGISTER ( "fann_set_train_error_function", 2, swi_fann_set_train_error_function, 0); // Set the error function used during training.
+	PL_FANN_REGISTER ( "fann_get_train_stop_function", 2, swi_fann_get_train_stop_function, 0); // Returns the the stop function used during training.
+	PL_FANN_REGISTER ( "fann_set_train_stop_function", 2, swi_fann_set_train_stop_function, 0); // Set the stop function used during training.
+	PL_FANN_REGISTER ( "fann_get_bit_fail_limit", 2, swi_fann_get_bit_fail_limit, 0); // Returns the bit fail limit used during training.
+	PL_FANN_REGISTER ( "fann_set_bit_fail_limit", 2, swi_fann_set_bit_fail_limit, 0); // Set the bit fail limit used during training.
+	// PL_FANN_REGISTER ( "fann_set_callback", na, swi_fann_set_callback, 0); // Sets the callback function for use during training.
+	PL_FANN_REGISTER ( "fann_get_quickprop_decay", 2, swi_fann_get_quickprop_decay, 0); // The decay is a small negative valued number which is the factor that the weights should become smaller in each iteration during quickprop training.
+	PL_FANN_REGISTER ( "fann_set_quickprop_decay", 2, swi_fann_set_quickprop_decay, 0); // Sets the quickprop decay factor.
+	PL_FANN_REGISTER ( "fann_get_quickprop_mu", 2, swi_fann_get_quickprop_mu, 0); // The mu factor is used to increase and decrease the step-size during quickprop training.
+	PL_FANN_REGISTER ( "fann_set_quickprop_mu", 2, swi_fann_set_quickprop_mu, 0); // Sets the quickprop mu factor.
+	PL_FANN_REGISTER ( "fann_get_rprop_increase_factor", 2, swi_fann_get_rprop_increase_factor, 0); // The increase factor is a value larger than 1, which is used to increase the step-size during RPROP training.
+	PL_FANN_REGISTER ( "fann_set_rprop_increase_factor", 2, swi_fann_set_rprop_increase_factor, 0); // The increase factor used during RPROP training.
+	PL_FANN_REGISTER ( "fann_get_rprop_decrease_factor", 2, swi_fann_get_rprop_decrease_factor, 0); // The decrease factor is a value smaller than 1, which is used to decrease the step-size during RPROP training.
+	PL_FANN_REGISTER ( "fann_set_rprop_decrease_factor", 2, swi_fann_set_rprop_decrease_factor, 0); // The decrease factor is a value smaller than 1, which is used to decrease the step-size during RPROP training.
+	PL_FANN_REGISTER ( "fann_get_rprop_delta_min", 2, swi_fann_get_rprop_delta_min, 0); // The minimum step-size is a small positive number determining how small the minimum step-size may be.
+	PL_FANN_REGISTER ( "fann_set_rprop_delta_min", 2, swi_fann_set_rprop_delta_min, 0); // The minimum step-size is a small positive number determining how small the minimum step-size may be.
+	PL_FANN_REGISTER ( "fann_get_rprop_delta_max", 2, swi_fann_get_rprop_delta_max, 0); // The maximum step-size is a positive number determining how large the maximum step-size may be.
+	PL_FANN_REGISTER ( "fann_set_rprop_delta_max", 2, swi_fann_set_rprop_delta_max, 0); // The maximum step-size is a positive number determining how large the maximum step-size may be.
+	PL_FANN_REGISTER ( "fann_get_rprop_delta_zero", 2, swi_fann_get_rprop_delta_zero, 0); // The initial step-size is a positive number determining the initial step size.
+	PL_FANN_REGISTER ( "fann_set_rprop_delta_zero", 2, swi_fann_set_rprop_delta_zero, 0); // The initial step-size is a positive number determining the initial step size.
 #ifdef VERSION220
-	PL_register_foreign ( "fann_get_sarprop_weight_decay_shift", 2, swi_fann_get_sarprop_weight_decay_shift, 0); // The sarprop weight decay shift.
-	PL_register_foreign ( "fann_set_sarprop_weight_decay_shift", 2, swi_fann_set_sarprop_weight_decay_shift, 0); // Set the sarprop weight decay shift.
-	PL_register_foreign ( "fann_get_sarprop_step_error_threshold_factor", 2, swi_fann_get_sarprop_step_error_threshold_factor, 0); // The sarprop step error threshold factor.
-	PL_register_foreign ( "fann_set_sarprop_step_error_threshold_factor", 2, swi_fann_set_sarprop_step_error_threshold_factor, 0); // Set the sarprop step error threshold factor.
-	PL_register_foreign ( "fann_get_sarprop_step_error_shift", 2, swi_fann_get_sarprop_step_error_shift, 0); // The get sarprop step error shift.
-	PL_register_foreign ( "fann_set_sarprop_step_error_shift", 2, swi_fann_set_sarprop_step_error_shift, 0); // Set the sarprop step error shift.
-	PL_register_foreign ( "fann_get_sarprop_temperature", 2, swi_fann_get_sarprop_temperature, 0); // The sarprop weight decay shift.
-	PL_register_foreign ( "fann_set_sarprop_temperature", 2, swi_fann_set_sarprop_temperature, 0); // Set the sarprop_temperature.
+	PL_FANN_REGISTER ( "fann_get_sarprop_weight_decay_shift", 2, swi_fann_get_sarprop_weight_decay_shift, 0); // The sarprop weight decay shift.
+	PL_FANN_REGISTER ( "fann_set_sarprop_weight_decay_shift", 2, swi_fann_set_sarprop_weight_decay_shift, 0); // Set the sarprop weight decay shift.
+	PL_FANN_REGISTER ( "fann_get_sarprop_step_error_threshold_factor", 2, swi_fann_get_sarprop_step_error_threshold_factor, 0); // The sarprop step error threshold factor.
+	PL_FANN_REGISTER ( "fann_set_sarprop_step_error_threshold_factor", 2, swi_fann_set_sarprop_step_error_threshold_factor, 0); // Set the sarprop step error threshold factor.
+	PL_FANN_REGISTER ( "fann_get_sarprop_step_error_shift", 2, swi_fann_get_sarprop_step_error_shift, 0); // The get sarprop step error shift.
+	PL_FANN_REGISTER ( "fann_set_sarprop_step_error_shift", 2, swi_fann_set_sarprop_step_error_shift, 0); // Set the sarprop step error shift.
+	PL_FANN_REGISTER ( "fann_get_sarprop_temperature", 2, swi_fann_get_sarprop_temperature, 0); // The sarprop weight decay shift.
+	PL_FANN_REGISTER ( "fann_set_sarprop_temperature", 2, swi_fann_set_sarprop_temperature, 0); // Set the sarprop_temperature.
 #endif
 
-	// Cascade Training (2)
+	// Cascade Training (3)
 
-	PL_register_foreign ( "fann_cascadetrain_on_data", 5, swi_fann_cascadetrain_on_data, 0); // Trains on an entire dataset, for a period of time using the Cascade2 training algorithm.
-	PL_register_foreign ( "fann_cascadetrain_on_file", 5, swi_fann_cascadetrain_on_file, 0); // Does the same as fann_cascadetrain_on_data, but reads the training data directly from a file.
+	PL_FANN_REGISTER ( "fann_cascadetrain_on_data", 5, swi_fann_cascadetrain_on_data, 0); // Trains on an entire dataset, for a period of time using the Cascade2 training algorithm.
+	PL_FANN_REGISTER ( "fann_cascadetrain_on_data", 6, swi_fann_cascadetrain_on_data_6, 0); // Same as fann_cascadetrain_on_data/5, with a time budget.
+	PL_FANN_REGISTER ( "fann_cascadetrain_on_file", 5, swi_fann_cascadetrain_on_file, 0); // Does the same as fann_cascadetrain_on_data, but reads the training data directly from a file.
 
 	// Parameters (28)
 
-	PL_register_foreign ( "fann_get_cascade_output_change_fraction", 2, swi_fann_get_cascade_output_change_fraction, 0); // The cascade output change fraction is a number between 0 and 1 determining how large a fraction the fann_get_MSE value should change within fann_get_cascade_output_stagnation_epochs during training of the output connections, in order for the training not to stagnate.
-	PL_register_foreign ( "fann_set_cascade_output_change_fraction", 2, swi_fann_set_cascade_output_change_fraction, 0); // Sets the cascade output change fraction.
-	PL_register_foreign ( "fann_get_cascade_output_stagnation_epochs", 2, swi_fann_get_cascade_output_stagnation_epochs, 0); // The number of cascade output stagnation epochs determines the number of epochs training is allowed to continue without changing the MSE by a fraction of fann_get_cascade_output_change_fraction.
-	PL_register_foreign ( "fann_set_cascade_output_stagnation_epochs", 2, swi_fann_set_cascade_output_stagnation_epochs, 0); // Sets the number of cascade output stagnation epochs.
-	PL_register_foreign ( "fann_get_cascade_candidate_change_fraction", 2, swi_fann_get_cascade_candidate_change_fraction, 0); // The cascade candidate change fraction is a number between 0 and 1 determining how large a fraction the fann_get_MSE value should change within fann_get_cascade_candidate_stagnation_epochs during training of the candidate neurons, in order for the training not to stagnate.
-	PL_register_foreign ( "fann_set_cascade_candidate_change_fraction", 2, swi_fann_set_cascade_candidate_change_fraction, 0); // Sets the cascade candidate change fraction.
-	PL_register_foreign ( "fann_get_cascade_candidate_stagnation_epochs", 2, swi_fann_get_cascade_candidate_stagnation_epochs, 0); // The number of cascade candidate stagnation epochs determines the number of epochs training is allowed to continue without changing the MSE by a fraction of fann_get_cascade_candidate_change_fraction.
-	PL_register_foreign ( "fann_set_cascade_candidate_stagnation_epochs", 2, swi_fann_set_cascade_candidate_stagnation_epochs, 0); // Sets the number of cascade candidate stagnation epochs.
-	PL_register_foreign ( "fann_get_cascade_weight_multiplier", 2, swi_fann_get_cascade_weight_multiplier, 0); // The weight multiplier is a parameter which is used to multiply the weights from the candidate neuron before adding the neuron to the neural network.
-	PL_register_foreign ( "fann_set_cascade_weight_multiplier", 2, swi_fann_set_cascade_weight_multiplier, 0); // Sets the weight multiplier.
-	PL_register_foreign ( "fann_get_cascade_candidate_limit", 2, swi_fann_get_cascade_candidate_limit, 0); // The candidate limit is a limit for how much the candidate neuron may be trained.
-	PL_register_foreign ( "fann_set_cascade_candidate_limit", 2, swi_fann_set_cascade_candidate_limit, 0); // Sets the candidate limit.
-	PL_register_foreign ( "fann_get_cascade_max_out_epochs", 2, swi_fann_get_cascade_max_out_epochs, 0); // The maximum out epochs determines the maximum number of epochs the output connections may be trained after adding a new candidate neuron.
-	PL_register_foreign ( "fann_set_cascade_max_out_epochs", 2, swi_fann_set_cascade_max_out_epochs, 0); // Sets the maximum out epochs.
+	PL_FANN_REGISTER ( "fann_get_cascade_output_change_fraction", 2, swi_fann_get_cascade_output_change_fraction, 0); // The cascade output change fraction is a number between 0 and 1 determining how large a fraction the fann_get_MSE value should change within fann_get_cascade_output_stagnation_epochs during training of the output connections, in order for the training not to stagnate.
+	PL_FANN_REGISTER ( "fann_set_cascade_output_change_fraction", 2, swi_fann_set_cascade_output_change_fraction, 0); // Sets the cascade output change fraction.
+	PL_FANN_REGISTER ( "fann_get_cascade_output_stagnation_epochs", 2, swi_fann_get_cascade_output_stagnation_epochs, 0); // The number of cascade output stagnation epochs determines the number of epochs training is allowed to continue without changing the MSE by a fraction of fann_get_cascade_output_change_fraction.
+	PL_FANN_REGISTER ( "fann_set_cascade_output_stagnation_epochs", 2, swi_fann_set_cascade_output_stagnation_epochs, 0); // Sets the number of cascade output stagnation epochs.
+	PL_FANN_REGISTER ( "fann_get_cascade_candidate_change_fraction", 2, swi_fann_get_cascade_candidate_change_fraction, 0); // The cascade candidate change fraction is a number between 0 and 1 determining how large a fraction the fann_get_MSE value should change within fann_get_cascade_candidate_stagnation_epochs during training of the candidate neurons, in order for the training not to stagnate.
+	PL_FANN_REGISTER ( "fann_set_cascade_candidate_change_fraction", 2, swi_fann_set_cascade_candidate_change_fraction, 0); // Sets the cascade candidate change fraction.
+	PL_FANN_REGISTER ( "fann_get_cascade_candidate_stagnation_epochs", 2, swi_fann_get_cascade_candidate_stagnation_epochs, 0); // The number of cascade candidate stagnation epochs determines the number of epochs training is allowed to continue without changing the MSE by a fraction of fann_get_cascade_candidate_change_fraction.
+	PL_FANN_REGISTER ( "fann_set_cascade_candidate_stagnation_epochs", 2, swi_fann_set_cascade_candidate_stagnation_epochs, 0); // Sets the number of cascade candidate stagnation epochs.
+	PL_FANN_REGISTER ( "fann_get_cascade_weight_multiplier", 2, swi_fann_get_cascade_weight_multiplier, 0); // The weight multiplier is a parameter which is used to multiply the weights from the candidate neuron before adding the neuron to the neural network.
+	PL_FANN_REGISTER ( "fann_set_cascade_weight_multiplier", 2, swi_fann_set_cascade_weight_multiplier, 0); // Sets the weight multiplier.
+	PL_FANN_REGISTER ( "fann_get_cascade_candidate_limit", 2, swi_fann_get_cascade_candidate_limit, 0); // The candidate limit is a limit for how much the candidate neuron may be trained.
+	PL_FANN_REGISTER ( "fann_set_cascade_candidate_limit", 2, swi_fann_set_cascade_candidate_limit, 0); // Sets the candidate limit.
+	PL_FANN_REGISTER ( "fann_get_cascade_max_out_epochs", 2, swi_fann_get_cascade_max_out_epochs, 0); // The maximum out epochs determines the maximum number of epochs the output connections may be trained after adding a new candidate neuron.
+	PL_FANN_REGISTER ( "fann_set_cascade_max_out_epochs", 2, swi_fann_set_cascade_max_out_epochs, 0); // Sets the maximum out epochs.
 #ifdef VERSION220
-	PL_register_foreign ( "fann_get_cascade_min_out_epochs", 2, swi_fann_get_cascade_min_out_epochs, 0); // The minimum out epochs determines the minimum number of epochs the output connections must be trained after adding a new candidate neuron.
-	PL_register_foreign ( "fann_set_cascade_min_out_epochs", 2, swi_fann_set_cascade_min_out_epochs, 0); // Sets the minimum out epochs.
+	PL_FANN_REGISTER ( "fann_get_cascade_min_out_epochs", 2, swi_fann_get_cascade_min_out_epochs, 0); // The minimum out epochs determines the minimum number of epochs the output connections must be trained after adding a new candidate neuron.
+	PL_FANN_REGISTER ( "fann_set_cascade_min_out_epochs", 2, swi_fann_set_cascade_min_out_epochs, 0); // Sets the minimum out epochs.
 #endif
-	PL_register_foreign ( "fann_get_cascade_max_cand_epochs", 2, swi_fann_get_cascade_max_cand_epochs, 0); // The maximum candidate epochs determines the maximum number of epochs the input connections to the candidates may be trained before adding a new candidate neuron.
-	PL_register_foreign ( "fann_set_cascade_max_cand_epochs", 2, swi_fann_set_cascade_max_cand_epochs, 0); // Sets the max candidate epochs.
+	PL_FANN_REGISTER ( "fann_get_cascade_max_cand_epochs", 2, swi_fann_get_cascade_max_cand_epochs, 0); // The maximum candidate epochs determines the maximum number of epochs the input connections to the candidates may be trained before adding a new candidate neuron.
+	PL_FANN_REGISTER ( "fann_set_cascade_max_cand_epochs", 2, swi_fann_set_cascade_max_cand_epochs, 0); // Sets the max candidate epochs.
 #ifdef VERSION220
-	PL_register_foreign ( "fann_get_cascade_min_cand_epochs", 2, swi_fann_get_cascade_min_cand_epochs, 0); // The minimum candidate epochs determines the minimum number of epochs the input connections to the candidates may be trained before adding a new candidate neuron.
-	PL_register_foreign ( "fann_set_cascade_min_cand_epochs", 2, swi_fann_set_cascade_min_cand_epochs, 0); // Sets the min candidate epochs.
+	PL_FANN_REGISTER ( "fann_get_cascade_min_cand_epochs", 2, swi_fann_get_cascade_min_cand_epochs, 0); // The minimum candidate epochs determines the minimum number of epochs the input connections to the candidates may be trained before adding a new candidate neuron.
+	PL_FANN_REGISTER ( "fann_set_cascade_min_cand_epochs", 2, swi_fann_set_cascade_min_cand_epochs, 0); // Sets the min candidate epochs.
 #endif
-	PL_register_foreign ( "fann_get_cascade_num_candidates", 2, swi_fann_get_cascade_num_candidates, 0); // The number of candidates used during training (calculated by multiplying fann_get_cascade_activation_functions_count, fann_get_cascade_activation_steepnesses_count and fann_get_cascade_num_candidate_groups).
-	PL_register_foreign ( "fann_get_cascade_activation_functions_count", 2, swi_fann_get_cascade_activation_functions_count, 0); // The number of activation functions in the fann_get_cascade_activation_functions array.
-	PL_register_foreign ( "fann_get_cascade_activation_functions", 2, swi_fann_get_cascade_activation_functions, 0); // The cascade activation functions array is an array of the different activation functions used by the candidates.
-	PL_register_foreign ( "fann_set_cascade_activation_functions", 2, swi_fann_set_cascade_activation_functions, 0); // Sets the array of cascade candidate activation functions.
-	PL_register_foreign ( "fann_get_cascade_activation_steepnesses_count", 2, swi_fann_get_cascade_activation_steepnesses_count, 0); // The number of activation steepnesses in the fann_get_cascade_activation_functions array.
-	PL_register_foreign ( "fann_get_cascade_activation_steepnesses", 2, swi_fann_get_cascade_activation_steepnesses, 0); // The cascade activation steepnesses array is an array of the different activation functions used by the candidates.
-	PL_register_foreign ( "fann_set_cascade_activation_steepnesses", 2, swi_fann_set_cascade_activation_steepnesses, 0); // Sets the array of cascade candidate activation steepnesses.
-	PL_register_foreign ( "fann_get_cascade_num_candidate_groups", 2, swi_fann_get_cascade_num_candidate_groups, 0); // The number of candidate groups is the number of groups of identical candidates which will be used during training.
-	PL_register_foreign ( "fann_set_cascade_num_candidate_groups", 2, swi_fann_set_cascade_num_candidate_groups, 0); // Sets the number of candidate groups.
+	PL_FANN_REGISTER ( "fann_get_cascade_num_candidates", 2, swi_fann_get_cascade_num_candidates, 0); // The number of candidates used during training (calculated by multiplying fann_get_cascade_activation_functions_count, fann_get_cascade_activation_steepnesses_count and fann_get_cascade_num_candidate_groups).
+	PL_FANN_REGISTER ( "fann_get_cascade_activation_functions_count", 2, swi_fann_get_cascade_activation_functions_count, 0); // The number of activation functions in the fann_get_cascade_activation_functions array.
+	PL_FANN_REGISTER ( "fann_get_cascade_activation_functions", 2, swi_fann_get_cascade_activation_functions, 0); // The cascade activation functions array is an array of the different activation functions used by the candidates.
+	PL_FANN_REGISTER ( "fann_set_cascade_activation_functions", 2, swi_fann_set_cascade_activation_functions, 0); // Sets the array of cascade candidate activation functions.
+	PL_FANN_REGISTER ( "fann_get_cascade_activation_steepnesses_count", 2, swi_fann_get_cascade_activation_steepnesses_count, 0); // The number of activation steepnesses in the fann_get_cascade_activation_functions array.
+	PL_FANN_REGISTER ( "fann_get_cascade_activation_steepnesses", 2, swi_fann_get_cascade_activation_steepnesses, 0); // The cascade activation steepnesses array is an array of the different activation functions used by the candidates.
+	PL_FANN_REGISTER ( "fann_set_cascade_activation_steepnesses", 2, swi_fann_set_cascade_activation_steepnesses, 0); // Sets the array of cascade candidate activation steepnesses.
+	PL_FANN_REGISTER ( "fann_get_cascade_num_candidate_groups", 2, swi_fann_get_cascade_num_candidate_groups, 0); // The number of candidate groups is the number of groups of identical candidates which will be used during training.
+	PL_FANN_REGISTER ( "fann_set_cascade_num_candidate_groups", 2, swi_fann_set_cascade_num_candidate_groups, 0); // Sets the number of candidate groups.
+
+	// File Input and Output (7)
+
+	PL_FANN_REGISTER ( "fann_create_from_file", 2, swi_fann_create_from_file, 0); // Constructs a backpropagation neural network from a configuration file, which have been saved by fann_save.
+	PL_FANN_REGISTER ( "fann_save", 2, swi_fann_save, 0); // Save the entire network to a configuration file.
+	PL_FANN_REGISTER ( "fann_save_to_fixed", 2, swi_fann_save_to_fixed, 0); // Saves the entire network to a configuration file.
+	PL_FANN_REGISTER ( "fann_serialize", 2, swi_fann_serialize, 0); // Writes the entire network to a binary string.
+	PL_FANN_REGISTER ( "fann_deserialize", 2, swi_fann_deserialize, 0); // Constructs a network from a string written by fann_serialize.
+	PL_FANN_REGISTER ( "fann_save_binary", 2, swi_fann_save_binary, 0); // Saves the network to a model file for fann_map.
+	PL_FANN_REGISTER ( "fann_map", 2, swi_fann_map, 0); // Maps the weights of a model file into memory, shared between processes.
 
-	// File Input and Output (3)
+	// Error Handling (6)
+
+	PL_FANN_REGISTER ( "fann_set_error_log", 2, swi_fann_set_error_log, 0); // Change where errors are logged to.
+	PL_FANN_REGISTER ( "fann_get_errno", 2, swi_fann_get_errno, 0); // Returns the last error number.
+	PL_FANN_REGISTER ( "fann_reset_errno", 1, swi_fann_reset_errno, 0); // Resets the last error number.
+	PL_FANN_REGISTER ( "fann_reset_errstr", 1, swi_fann_reset_errstr, 0); // Resets the last error string.
+    PL_FANN_REGISTER ( "fann_get_errstr", 2, swi_fann_get_errstr, 0); // Returns the last errstr.
+	PL_FANN_REGISTER ( "fann_print_error_core", 1, swi_fann_print_error, 0); // Prints the last error to stderr.
+}
 
-	PL_register_foreign ( "fann_create_from_file", 2, swi_fann_create_from_file, 0); // Constructs a backpropagation neural network from a configuration file, which have been saved by fann_save.
-	PL_register_foreign ( "fann_save", 2, swi_fann_save, 0); // Save the entire network to a configuration file.
-	PL_register_foreign ( "fann_save_to_fixed", 2, swi_fann_save_to_fixed, 0); // Saves the entire network to a configuration file.
+#if !defined DOUBLEFANN && !defined FIXEDFANN && !defined PLFANN_SEPARATE_ENGINES
 
-	// Error Handling (6)
+install_t install_plfann_double ( void );
+install_t install_plfann_fixed ( void );
 
-	PL_register_foreign ( "fann_set_error_log", 2, swi_fann_set_error_log, 0); // Change where errors are logged to.
-	PL_register_foreign ( "fann_get_errno", 2, swi_fann_get_errno, 0); // Returns the last error number.
-	PL_register_foreign ( "fann_reset_errno", 1, swi_fann_reset_errno, 0); // Resets the last error number.
-	PL_register_foreign ( "fann_reset_errstr", 1, swi_fann_reset_errstr, 0); // Resets the last error string.
-    PL_register_foreign ( "fann_get_errstr", 2, swi_fann_get_errstr, 0); // Returns the last errstr.
-	PL_register_foreign ( "fann_print_error_core", 1, swi_fann_print_error, 0); // Prints the last error to stderr.
+// Installs the float, double and fixed predicates in the modules plfann_float,
+// plfann_double and plfann_fixed.
+
+install_t install_plfann () {
+
+	install_plfann_float ( );
+	install_plfann_double ( );
+	install_plfann_fixed ( );
 }
+
+#endif
@@ -52,12 +52,18 @@ applet Configuration Manager and select Advanced and Environment Variables). */
 #define PL_FANN_C_FANNTYPE double
 #define PL_FANN_GET_FANNTYPE(X,Y) PL_get_float(X,Y)
 #define PL_FANN_UNIFY_FANNTYPE(X,Y) PL_unify_float(X,Y)
+#define PL_FANN_PUT_FANNTYPE(X,Y) PL_put_float(X,Y)
+#define PL_FANN_MODULE "plfann_double"
+#define PL_FANN_INSTALL install_plfann_double
 #elif defined FIXEDFANN
 #include <fixedfann.h>
 #define PL_FANN_FANNTYPE "integer"
 #define PL_FANN_C_FANNTYPE int
 #define PL_FANN_GET_FANNTYPE(X,Y) PL_get_integer(X,Y)
 #define PL_FANN_UNIFY_FANNTYPE(X,Y) PL_unify_integer(X,Y)
+#define PL_FANN_PUT_FANNTYPE(X,Y) PL_put_integer(X,Y)
+#define PL_FANN_MODULE "plfann_fixed"
+#define PL_FANN_INSTALL install_plfann_fixed
 #else
 #include <floatfann.h>
 __inline int PL_get_float32 ( term_t in, float* out );
@@ -65,10 +71,46 @@ __inline int PL_get_float32 ( term_t in, float* out );
 #define PL_FANN_C_FANNTYPE double
 #define PL_FANN_GET_FANNTYPE(X,Y) PL_get_float32(X,Y)
 #define PL_FANN_UNIFY_FANNTYPE(X,Y) PL_unify_float(X,Y)
+#define PL_FANN_PUT_FANNTYPE(X,Y) PL_put_float(X,Y)
+#define PL_FANN_MODULE "plfann_float"
+#define PL_FANN_INSTALL install_plfann_float
 #endif
 
+/* The three builds are linked into one library, each registering its
+predicates in its own module, see the Makefile */
+
+#define PL_FANN_REGISTER(N,A,F,FL) PL_register_foreign_in_module(PL_FANN_MODULE,N,A,F,FL)
+
 #define FANN_UNDEFINED -1
 
+/* Internal functions of the library, exported but not declared by fann.h */
+
+void fann_clear_train_arrays ( struct fann *ann );
+float fann_train_outputs_epoch ( struct fann *ann, struct fann_train_data *data );
+int fann_initialize_candidates ( struct fann *ann );
+void fann_update_candidate_weights ( struct fann *ann, unsigned int num_data );
+void fann_install_candidate ( struct fann *ann );
+void fann_set_shortcut_connections ( struct fann *ann );
+fann_type fann_activation ( struct fann *ann, unsigned int activation_function, fann_type steepness, fann_type value );
+fann_type fann_activation_derived ( unsigned int activation_function, fann_type steepness, fann_type value, fann_type sum );
+void fann_compute_MSE ( struct fann *ann, fann_type *desired_output );
+void fann_backpropagate_MSE ( struct fann *ann );
+void fann_update_slopes_batch ( struct fann *ann, struct fann_layer *layer_begin, struct fann_layer *layer_end );
+void fann_update_weights_batch ( struct fann *ann, unsigned int num_data, unsigned int first_weight, unsigned int past_end );
+void fann_update_weights_irpropm ( struct fann *ann, unsigned int first_weight, unsigned int past_end );
+void fann_update_weights_quickprop ( struct fann *ann, unsigned int num_data, unsigned int first_weight, unsigned int past_end );
+#ifdef VERSION220
+void fann_update_weights_sarprop ( struct fann *ann, unsigned int epoch, unsigned int first_weight, unsigned int past_end );
+#endif
+struct fann *fann_allocate_structure ( unsigned int num_layers );
+void fann_allocate_neurons ( struct fann *ann );
+void fann_allocate_connections ( struct fann *ann );
+#ifndef FIXEDFANN
+int fann_allocate_scale ( struct fann *ann );
+#else
+void fann_update_stepwise ( struct fann *ann );
+#endif
+
 #ifndef __fann_swi_h__
 enum enum_fann_mode {
 
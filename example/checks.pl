@@ -0,0 +1,458 @@
+:- use_module(library(plfann)).
+
+% Checks of the foreign predicates.
+% ---------------------------------
+%
+% Each check/2 is a round trip or an error that must be raised.  The first
+% that does not hold stops the run with exit status 1.
+
+main:-
+	forall( check( Name, Goal ), run_check( Name, Goal ) ).
+
+run_check( Name, Goal ):-
+	(   catch( Goal, E, ( print_message( error, E ), fail ) )
+	->  format( '~w: ok~n', [Name] )
+	;   format( '~w: FAILED~n', [Name] ),
+	    halt( 1 )
+	).
+
+% Goal raises error(Error, _).
+
+raises( Goal, Error ):-
+	catch( ( Goal, fail ), error( Error, _ ), true ).
+
+xor_network( Ann ):-
+	fann_create_standard( 3, 2, 3, 1, Ann ).
+
+xor_data( Data ):-
+	fann_read_train_from_file( 'xor.data', Data ).
+
+% Outputs must be unbound, so the results are read and then compared.
+
+same_network( Ann1, Ann2 ):-
+	fann_get_weights_packed( Ann1, Weights1 ),
+	fann_get_weights_packed( Ann2, Weights2 ),
+	Weights1 == Weights2,
+	fann_run( Ann1, [-1,1], Out1 ),
+	fann_run( Ann2, [-1,1], Out2 ),
+	Out1 == Out2.
+
+same_rows( Data1, Data2 ):-
+	fann_get_train_packed( Data1, Packed1 ),
+	fann_get_train_packed( Data2, Packed2 ),
+	Packed1 == Packed2.
+
+% Handles.
+
+check( handle_destroyed, (
+	xor_network( Ann ),
+	fann_run( Ann, [-1,1], _ ),
+	fann_destroy( Ann ),
+	raises( fann_run( Ann, [-1,1], _ ), existence_error( fann, _ ) ),
+	raises( fann_destroy( Ann ), existence_error( fann, _ ) ) ) ).
+check( handle_wrong_type, (
+	xor_network( Ann ),
+	raises( fann_destroy_matrix( Ann ), type_error( fann_matrix, _ ) ),
+	fann_destroy( Ann ) ) ).
+
+% Matrices.
+
+check( matrix_round_trip, (
+	fann_create_matrix( [[1.0,2.0],[3.0,4.0]], M ),
+	fann_get_matrix_packed( M, Packed ),
+	fann_create_matrix_from_packed( 2, Packed, M2 ),
+	fann_get_matrix_packed( M2, Packed2 ),
+	Packed == Packed2,
+	fann_matrix_values( M2, Rows ),
+	Rows == [[1.0,2.0],[3.0,4.0]],
+	fann_destroy_matrix( M ),
+	fann_destroy_matrix( M2 ),
+	raises( fann_destroy_matrix( M ), existence_error( fann_matrix, _ ) ) ) ).
+check( matrix_bad_rows, (
+	raises( fann_create_matrix( [], _ ), domain_error( non_empty_list, _ ) ),
+	raises( fann_create_matrix( rows, _ ), type_error( list, _ ) ) ) ).
+
+% Serialization.
+
+check( serialize_round_trip, (
+	xor_network( Ann ),
+	fann_set_training_algorithm( Ann, 'FANN_TRAIN_QUICKPROP' ),
+	fann_serialize( Ann, Bytes ),
+	fann_deserialize( Bytes, Copy ),
+	same_network( Ann, Copy ),
+	fann_get_training_algorithm( Copy, Algorithm ),
+	Algorithm == 'FANN_TRAIN_QUICKPROP',
+	fann_destroy( Ann ),
+	fann_destroy( Copy ) ) ).
+check( deserialize_bad_bytes, (
+	raises( fann_deserialize( "not a network", _ ), domain_error( fann_network_bytes, _ ) ) ) ).
+
+% Mapped models.
+
+check( map_round_trip, (
+	xor_network( Ann ),
+	tmp_file( plfann, File ),
+	fann_save_binary( Ann, File ),
+	fann_map( File, Mapped ),
+	same_network( Ann, Mapped ),
+	fann_train( Mapped, [-1,1], [1] ),
+	fann_map( File, Again ),
+	same_network( Ann, Again ),
+	fann_destroy( Mapped ),
+	fann_destroy( Again ),
+	fann_destroy( Ann ),
+	delete_file( File ) ) ).
+check( map_bad_file, (
+	raises( fann_map( 'xor.data', _ ), domain_error( fann_model_file, _ ) ) ) ).
+% A path that fits in 4096 bytes, the usual PATH_MAX, until .tmp is added.
+
+check( save_binary_long_path, (
+	xor_network( Ann ),
+	working_directory( Dir, Dir ),
+	atom_length( Dir, Length ),
+	N is 4093 - Length,
+	length( Chars, N ),
+	maplist( =(a), Chars ),
+	atom_chars( Name, Chars ),
+	atom_concat( Dir, Name, Long ),
+	raises( fann_save_binary( Ann, Long ), representation_error( max_path_length ) ),
+	fann_destroy( Ann ) ) ).
+
+% Streamed training.
+
+check( train_on_file_stream, (
+	xor_network( Ann ),
+	fann_get_weights_packed( Ann, Before ),
+	fann_train_on_file( Ann, 'xor.data', 100, 0, 0.0, [chunk_rows(2)] ),
+	fann_get_weights_packed( Ann, After ),
+	Before \== After,
+	fann_destroy( Ann ) ) ).
+check( train_on_file_incremental, (
+	xor_network( Ann ),
+	fann_set_training_algorithm( Ann, 'FANN_TRAIN_INCREMENTAL' ),
+	fann_get_weights_packed( Ann, Before ),
+	fann_train_on_file( Ann, 'xor.data', 10, 0, 0.0, [chunk_rows(3)] ),
+	fann_get_weights_packed( Ann, After ),
+	Before \== After,
+	fann_destroy( Ann ) ) ).
+check( train_on_file_bad_arguments, (
+	xor_network( Ann ),
+	raises( fann_train_on_file( Ann, 'xor.data', 0, 0, 0.0, [] ), domain_error( positive_integer, _ ) ),
+	raises( fann_train_on_file( Ann, 'xor.data', 10, 0, 0.0, [chunk_rows(0)] ), domain_error( positive_integer, _ ) ),
+	raises( fann_train_on_file( Ann, 'xor.data', 10, 0, 0.0, [checkpoint('xor.ckpt')] ), domain_error( streaming_option, _ ) ),
+	raises( fann_train_on_file( Ann, 'no_such_file.data', 10, 0, 0.0, [] ), domain_error( fann_train_file, _ ) ),
+	fann_destroy( Ann ) ) ).
+
+% Time-budgeted training.  With max_time(0.0) one epoch is trained, so the
+% best weights restored are those it started from.
+
+check( train_on_data_restore_best, (
+	xor_network( Ann ),
+	xor_data( Data ),
+	fann_get_weights_packed( Ann, Before ),
+	catch( ( fann_train_on_data( Ann, Data, 100000, 0, 0.0, [max_time(0.0)] ), fail ), time_limit_exceeded, true ),
+	fann_get_weights_packed( Ann, Restored ),
+	Restored == Before,
+	catch( ( fann_train_on_data( Ann, Data, 100000, 0, 0.0, [max_time(0.0), restore_best(false)] ), fail ), time_limit_exceeded, true ),
+	fann_get_weights_packed( Ann, Last ),
+	Last \== Before,
+	raises( fann_train_on_data( Ann, Data, 10, 0, 0.0, [max_time(-1.0)] ), domain_error( nonneg, _ ) ),
+	fann_destroy_train( Data ),
+	fann_destroy( Ann ) ) ).
+
+% Early stopping.  The weights kept are never worse on the validation set
+% than those training started from.
+
+check( train_on_data_validated, (
+	xor_network( Ann ),
+	xor_data( Data ),
+	fann_test_data( Ann, Data, Before ),
+	fann_train_on_data_validated( Ann, Data, Data, [max_epochs(200), patience(5)] ),
+	fann_test_data( Ann, Data, After ),
+	After =< Before,
+	raises( fann_train_on_data_validated( Ann, Data, Data, [patience(0)] ), domain_error( positive_integer, _ ) ),
+	fann_destroy_train( Data ),
+	fann_destroy( Ann ) ) ).
+
+% Hyperparameter search.
+
+check( hyper_search, (
+	xor_data( Data ),
+	fann_hyper_search( Data, Data,
+		[ [layers([2,3,1]), max_epochs(100), seed(1)],
+		  [layers([2,1]), max_epochs(1), seed(2)] ], [keep(1)], Results ),
+	Results = [ result( Best, _, Ann ), result( Other, _, none ) ],
+	Best =< Other,
+	fann_get_num_input( Ann, Inputs ),
+	Inputs == 2,
+	fann_destroy( Ann ),
+	raises( fann_hyper_search( Data, Data, [[layers([2,1]), colour(red)]], [], _ ), domain_error( option, _ ) ),
+	fann_destroy_train( Data ) ) ).
+
+% Cross-validation.  With seed/1 the scores do not depend on the threads.
+
+check( cross_validate, (
+	xor_data( Data ),
+	fann_cross_validate( [2,3,1], Data, 2, [max_epochs(20), seed(3), threads(1)], Scores1 ),
+	fann_cross_validate( [2,3,1], Data, 2, [max_epochs(20), seed(3), threads(2)], Scores2 ),
+	length( Scores1, 2 ),
+	Scores1 == Scores2,
+	raises( fann_cross_validate( [2,3,1], Data, 5, [], _ ), domain_error( fold_count, _ ) ),
+	raises( fann_cross_validate( [2,3,1], Data, 2, [keep(1)], _ ), domain_error( option, _ ) ),
+	fann_destroy_train( Data ) ) ).
+
+% Training data views.
+
+check( train_data_views, (
+	xor_data( Data ),
+	fann_subset_train_data_view( Data, 1, 2, View ),
+	fann_subset_train_data( Data, 1, 2, Copy ),
+	same_rows( View, Copy ),
+	fann_is_train_data_view( View ),
+	\+ fann_is_train_data_view( Copy ),
+	fann_index_train_data_view( Data, [3,0], Indexed ),
+	fann_create_train_from_lists( [[1,1],[-1,-1]], [[-1],[-1]], Rows ),
+	same_rows( Indexed, Rows ),
+	raises( fann_index_train_data_view( Data, [0|_], _ ), type_error( list, _ ) ),
+	raises( fann_index_train_data_view( Data, [], _ ), domain_error( non_empty_list, _ ) ),
+	fann_destroy_train( View ),
+	fann_destroy_train( Indexed ),
+	fann_destroy_train( Copy ),
+	fann_destroy_train( Rows ),
+	fann_destroy_train( Data ) ) ).
+
+% Seeded random numbers.
+
+check( random_seed, (
+	xor_network( Ann ),
+	fann_set_random_seed( Ann, 42 ),
+	fann_randomize_weights( Ann, -0.5, 0.5 ),
+	fann_get_weights_packed( Ann, Weights1 ),
+	fann_set_random_seed( Ann, 42 ),
+	fann_randomize_weights( Ann, -0.5, 0.5 ),
+	fann_get_weights_packed( Ann, Weights2 ),
+	Weights1 == Weights2,
+	fann_destroy( Ann ),
+	xor_data( Data1 ),
+	xor_data( Data2 ),
+	fann_set_train_data_random_seed( Data1, 7 ),
+	fann_set_train_data_random_seed( Data2, 7 ),
+	fann_shuffle_train_data( Data1 ),
+	fann_shuffle_train_data( Data2 ),
+	same_rows( Data1, Data2 ),
+	fann_destroy_train( Data1 ),
+	fann_destroy_train( Data2 ) ) ).
+
+% Cascade training.
+
+check( cascadetrain_on_data, (
+	fann_create_shortcut( 2, 2, 1, Ann ),
+	xor_data( Data ),
+	fann_get_total_neurons( Ann, Before ),
+	fann_cascadetrain_on_data( Ann, Data, 2, 0, 0.0, [threads(2)] ),
+	fann_get_total_neurons( Ann, After ),
+	After > Before,
+	fann_run( Ann, [-1,1], _ ),
+	raises( fann_cascadetrain_on_data( Ann, Data, 1, 0, 0.0, [threads(0)] ), domain_error( positive_integer, _ ) ),
+	fann_destroy_train( Data ),
+	fann_destroy( Ann ) ) ).
+
+% Checkpoints.  A copy of the network resumed from the last checkpoint
+% ends with the weights of the uninterrupted run.
+
+check( checkpoint_resume, (
+	xor_network( Ann ),
+	xor_data( Data ),
+	fann_serialize( Ann, Bytes ),
+	tmp_file( plfann, File ),
+	fann_train_on_data( Ann, Data, 20, 0, 0.0, [checkpoint(File), checkpoint_every(5)] ),
+	fann_deserialize( Bytes, Copy ),
+	fann_train_on_data_resume( Copy, Data, File, [] ),
+	same_network( Ann, Copy ),
+	raises( fann_train_on_data_resume( Copy, Data, 'xor.data', [] ), domain_error( checkpoint, _ ) ),
+	delete_file( File ),
+	fann_destroy_train( Data ),
+	fann_destroy( Copy ),
+	fann_destroy( Ann ) ) ).
+
+% Schedules.  step(1, 0.5) halves the rate before every epoch but the
+% first, so the third epoch trains with a quarter of it.
+
+check( learning_rate_schedule, (
+	xor_network( Ann ),
+	xor_data( Data ),
+	fann_set_learning_rate( Ann, 0.8 ),
+	fann_set_schedule( Ann, learning_rate, step(1, 0.5) ),
+	fann_train_epoch( Ann, Data ),
+	fann_train_epoch( Ann, Data ),
+	fann_train_epoch( Ann, Data ),
+	fann_get_learning_rate( Ann, Rate ),
+	abs( Rate - 0.2 ) < 1.0e-6,
+	raises( fann_set_schedule( Ann, learning_rate, step(0, 0.5) ), domain_error( schedule, _ ) ),
+	raises( fann_set_schedule( Ann, steepness, none ), domain_error( schedule_parameter, _ ) ),
+	fann_destroy_train( Data ),
+	fann_destroy( Ann ) ) ).
+
+% Engines.  A network belongs to the engine that created it.
+
+check( engines_side_by_side, (
+	fann_with_type( 'FANN_DOUBLE', ( fann_type( Type ), xor_network( Ann ) ) ),
+	Type == 'FANN_DOUBLE',
+	fann_type( Current ),
+	Current == 'FANN_FLOAT',
+	raises( fann_run( Ann, [-1,1], _ ), type_error( fann, _ ) ),
+	plfann_double:fann_run( Ann, [-1,1], Out ),
+	Out = [_],
+	plfann_double:fann_destroy( Ann ) ) ).
+
+% Training data from lists.
+
+check( create_train_from_lists, (
+	fann_create_train_from_lists( [[-1,-1],[-1,1],[1,-1],[1,1]], [[-1],[1],[1],[-1]], Data ),
+	xor_data( File ),
+	same_rows( Data, File ),
+	raises( fann_create_train_from_lists( [[-1,-1],[1]], [[-1],[1]], _ ), domain_error( row_length, _ ) ),
+	raises( fann_create_train_from_lists( [[-1,-1]], [[-1],[1]], _ ), domain_error( same_length_as_inputs, _ ) ),
+	fann_destroy_train( Data ),
+	fann_destroy_train( File ) ) ).
+
+% Binary training data.
+
+check( map_train_round_trip, (
+	xor_data( Data ),
+	tmp_file( plfann, File ),
+	fann_save_train_binary( Data, File ),
+	fann_map_train( File, Mapped ),
+	same_rows( Data, Mapped ),
+	raises( fann_map_train( 'xor.data', _ ), domain_error( fann_train_binary, _ ) ),
+	fann_destroy_train( Mapped ),
+	fann_destroy_train( Data ),
+	delete_file( File ) ) ).
+
+% Parallel text reader.
+
+check( read_train_threads, (
+	xor_data( Data ),
+	fann_read_train_from_file( 'xor.data', Threaded, [threads(3)] ),
+	same_rows( Data, Threaded ),
+	raises( fann_read_train_from_file( 'xor.data', _, [threads(0)] ), domain_error( positive_integer, _ ) ),
+	raises( fann_read_train_from_file( 'checks.pl', _, [] ), domain_error( fann_train_file, _ ) ),
+	fann_destroy_train( Threaded ),
+	fann_destroy_train( Data ) ) ).
+
+% CSV records.
+
+check( read_train_csv, (
+	open_string( "a,b,y\n-1,-1,-1\n-1,1,1\n1,-1,1\n1,1,-1\n", In ),
+	fann_read_train_csv( In, [header(true), inputs([a,b]), outputs([y])], Data ),
+	close( In ),
+	xor_data( File ),
+	same_rows( Data, File ),
+	open_string( "-1,-1,-1\n-1,,1\n", Missing ),
+	raises( fann_read_train_csv( Missing, [], _ ), domain_error( csv_missing_value, _ ) ),
+	close( Missing ),
+	open_string( "-1,-1,-1\n-1,,1\n", Skipped ),
+	fann_read_train_csv( Skipped, [missing(skip)], One ),
+	close( Skipped ),
+	fann_length_train_data( One, Length ),
+	Length == 1,
+	fann_destroy_train( One ),
+	fann_destroy_train( Data ),
+	fann_destroy_train( File ) ) ).
+
+% Appending rows.
+
+check( append_train, (
+	fann_create_train_from_lists( [[-1,-1]], [[-1]], Data ),
+	fann_append_train( Data, [-1,1], [1] ),
+	fann_append_train_rows( Data, [[1,-1],[1,1]], [[1],[-1]] ),
+	xor_data( File ),
+	same_rows( Data, File ),
+	raises( fann_append_train_rows( Data, [[1,1],[1]], [[1],[1]] ), domain_error( row_length, _ ) ),
+	fann_length_train_data( Data, Length ),
+	Length == 4,
+	fann_subset_train_data_view( Data, 0, 2, View ),
+	raises( fann_append_train( Data, [1,1], [-1] ), domain_error( train_data_without_views, _ ) ),
+	fann_destroy_train( View ),
+	fann_destroy_train( File ),
+	fann_destroy_train( Data ) ) ).
+
+% Compact training data.  The values of xor.data are exact in float16.
+
+check( compact_train_data, (
+	xor_data( Data ),
+	fann_compact_train_data( Data, float16, Compact ),
+	fann_compact_train_error( Compact, Max, _ ),
+	Max =:= 0,
+	fann_expand_train_data( Compact, Expanded ),
+	same_rows( Data, Expanded ),
+	xor_network( Ann ),
+	fann_test_data( Ann, Data, MSE ),
+	fann_test_compact( Ann, Compact, CompactMSE ),
+	abs( MSE - CompactMSE ) < 1.0e-6,
+	raises( fann_compact_train_data( Data, float8, _ ), domain_error( compact_format, _ ) ),
+	fann_destroy( Ann ),
+	fann_destroy_compact_train( Compact ),
+	fann_destroy_train( Expanded ),
+	fann_destroy_train( Data ) ) ).
+
+% Statistics and z-scores.
+
+check( train_stats, (
+	fann_create_train_from_lists( [[0],[2]], [[1],[3]], Data ),
+	fann_train_stats( Data, Stats ),
+	Stats = stats( [column( Min, Max, Mean, Variance, NaNs )], [_] ),
+	Min =:= 0, Max =:= 2, Mean =:= 1, Variance =:= 1, NaNs =:= 0,
+	fann_zscore_input_train_data( Data ),
+	fann_create_train_from_lists( [[-1],[1]], [[1],[3]], Scaled ),
+	same_rows( Data, Scaled ),
+	fann_destroy_train( Scaled ),
+	fann_destroy_train( Data ) ) ).
+
+% List marshalling.  Bad inputs raise errors and leave the scratch buffers
+% fit for the next call, also after a larger network has grown them.
+
+check( run_marshalling, (
+	xor_network( Ann ),
+	fann_run( Ann, [-1,1], Out1 ),
+	raises( fann_run( Ann, [-1], _ ), type_error( list, _ ) ),
+	raises( fann_run( Ann, [-1,1,1], _ ), type_error( list, _ ) ),
+	raises( fann_run( Ann, [-1,one], _ ), type_error( float, _ ) ),
+	fann_create_standard( 3, 1000, 3, 1, Big ),
+	length( Input, 1000 ),
+	maplist( =(0.5), Input ),
+	fann_run( Big, Input, Out ),
+	Out = [_],
+	fann_destroy( Big ),
+	fann_run( Ann, [-1,1], Out2 ),
+	Out1 == Out2,
+	fann_destroy( Ann ) ) ).
+
+% Compound terms as arrays.
+
+check( run_compound, (
+	xor_network( Ann ),
+	fann_run( Ann, v(-1,1), Term ),
+	fann_run( Ann, [-1,1], List ),
+	Term =.. [v|List],
+	raises( fann_run( Ann, v(-1), _ ), domain_error( array_length, _ ) ),
+	fann_train( Ann, v(-1,1), v(1) ),
+	fann_test( Ann, v(-1,1), v(1) ),
+	fann_destroy( Ann ) ) ).
+
+% Packed weights.
+
+check( weights_packed, (
+	xor_network( Ann1 ),
+	xor_network( Ann2 ),
+	fann_get_weights_packed( Ann1, Weights ),
+	fann_set_weights_packed( Ann2, Weights ),
+	same_network( Ann1, Ann2 ),
+	fann_get_weights_packed( Ann1, 2, 3, Part ),
+	fann_set_weights_packed( Ann2, 0, Part ),
+	fann_get_weights_packed( Ann2, 0, 3, Copied ),
+	Part == Copied,
+	raises( fann_set_weights_packed( Ann2, Part ), domain_error( packed_weights, _ ) ),
+	raises( fann_get_weights_packed( Ann1, 0, 100, _ ), domain_error( weight_count, _ ) ),
+	fann_destroy( Ann1 ),
+	fann_destroy( Ann2 ) ) ).
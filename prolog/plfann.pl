@@ -79,7 +79,19 @@ possible to override this behaviour, both from c and from prolog, see fann_swi.h
 for details.
 
 fann can use floats,  doubles or fixed point  (not for training)  representation
-internally, uncomment the appropriate macro definition in plfann.h.
+internally. The  library  contains all three, in  the  modules  plfann_float,
+plfann_double and plfann_fixed, and  the predicates of  this module call  the
+one selected by fann_set_type/1 or fann_with_type/2.
+
+Networks, training data, compact training data and matrices are blob
+handles, such as <fann>(0x...), of the engine that created them.
+fann_destroy/1, fann_destroy_train/1, fann_destroy_compact_train/1 and
+fann_destroy_matrix/1 free them at once, after which the handle raises an
+existence error.  If a training predicate on another thread is still using
+the object it is freed when that predicate returns.  What a handle still holds when it is garbage collected
+is freed then, so networks and data lost to exceptions or backtracking do
+not leak.  Passing a handle to the wrong predicate, or to another engine,
+raises a type error.
 
 There  are some issues  with saving networks  to file. See post "Patch to ensure
 locale independancy", http://leenissen.dk/fann/forum/viewtopic.php?f=2&t=595 . A
@@ -101,11 +113,12 @@ dated: 18.12.2009
 
         fann_type/1,
         fann_set_type/1,
+        fann_with_type/2,
         fann_error/1,
         fann_swi_mode/0,
         fann_print_mode/1,
 
-        % Creation, Destruction & Execution (24[25])
+        % Creation, Destruction & Execution (25[26])
 
         fann_create_standard/4,
         fann_create_standard/5,
@@ -130,10 +143,11 @@ dated: 18.12.2009
         fann_run/3,
         fann_run_unsafe/3,
         fann_randomize_weights/3,
+        fann_set_random_seed/2,
         fann_init_weights/2,
         fann_print_connections/1,
 
-        % Parameters (16)
+        % Parameters (20)
 
         fann_print_parameters/1,
         fann_get_num_input/2,
@@ -148,6 +162,10 @@ dated: 18.12.2009
         fann_get_connection_array/2,
         fann_set_weight_array/2,
         fann_set_weight/4,
+        fann_get_weights_packed/2,
+        fann_get_weights_packed/4,
+        fann_set_weights_packed/2,
+        fann_set_weights_packed/3,
         fann_set_user_data/2,
         fann_get_user_data/2,
         fann_get_decimal_point/2,
@@ -161,16 +179,52 @@ dated: 18.12.2009
         fann_get_bit_fail/2,
         fann_reset_MSE/1,
 
-        % Training Data Training (4)
+        % Vectors and Matrices (10)
+
+        fann_create_vector/2,
+        fann_create_matrix/2,
+        fann_create_matrix_from_packed/3,
+        fann_get_matrix_packed/2,
+        fann_matrix_size/3,
+        fann_vector_values/2,
+        fann_matrix_values/2,
+        fann_matrix_op/4,
+        fann_slice_matrix/6,
+        fann_destroy_matrix/1,
+
+        % Training Data Training (13)
 
         fann_train_on_data/5,
+        fann_train_on_data/6,
+        fann_train_on_data_resume/4,
+        fann_train_on_data_validated/4,
+        fann_hyper_search/5,
+        fann_cross_validate/5,
         fann_train_on_file/5,
+        fann_train_on_file/6,
+        fann_train_on_compact/6,
         fann_train_epoch/2,
+        fann_set_schedule/3,
         fann_test_data/3,
+        fann_test_compact/3,
 
-        % Training Data Manipulation (24[26])
+        % Training Data Manipulation (47[49])
 
         fann_read_train_from_file/2,
+        fann_read_train_from_file/3,
+        fann_read_train_csv/3,
+        fann_create_train_from_lists/3,
+        fann_create_train_from_packed/4,
+        fann_get_train_packed/2,
+        fann_append_train/3,
+        fann_append_train_rows/3,
+        fann_append_train_data/2,
+        fann_save_train_binary/2,
+        fann_map_train/2,
+        fann_compact_train_data/3,
+        fann_expand_train_data/2,
+        fann_compact_train_error/3,
+        fann_destroy_compact_train/1,
         % fann_create_train/4,
         % fann_create_train_from_callback/na,
         fann_destroy_train/1,
@@ -188,9 +242,18 @@ dated: 18.12.2009
         fann_scale_input_train_data/3,
         fann_scale_output_train_data/3,
         fann_scale_train_data/3,
+        fann_train_stats/2,
+        fann_zscore_input_train_data/1,
+        fann_zscore_output_train_data/1,
+        fann_zscore_train_data/1,
         fann_merge_train_data/3,
         fann_duplicate_train_data/2,
         fann_subset_train_data/4,
+        fann_subset_train_data_view/4,
+        fann_index_train_data_view/3,
+        fann_bootstrap_train_data_view/3,
+        fann_is_train_data_view/1,
+        fann_set_train_data_random_seed/2,
         fann_length_train_data/2,
         fann_num_input_train_data/2,
         fann_num_output_train_data/2,
@@ -245,9 +308,10 @@ dated: 18.12.2009
         % fann_get_sarprop_temperature/2,
         % fann_set_sarprop_temperature/2,
 
-        %  Cascade Training (2)
+        %  Cascade Training (3)
 
         fann_cascadetrain_on_data/5,
+        fann_cascadetrain_on_data/6,
         fann_cascadetrain_on_file/5,
 
         % Parameters (25[29])
@@ -282,11 +346,15 @@ dated: 18.12.2009
         fann_get_cascade_num_candidate_groups/2,
         fann_set_cascade_num_candidate_groups/2,
 
-        % File Input and Output (3)
+        % File Input and Output (7)
 
         fann_create_from_file/2,
         fann_save/2,
         fann_save_to_fixed/2,
+        fann_serialize/2,
+        fann_deserialize/2,
+        fann_save_binary/2,
+        fann_map/2,
 
         % Error Handling (8)
 
@@ -301,16 +369,68 @@ dated: 18.12.2009
     ]).
 
 
-:- load_foreign_library( foreign( plfann ) ).
+:- meta_predicate
+	fann_with_type(+, 0).
+
+:- create_prolog_flag( plfann_engine, plfann_float, [ type( atom ), keep( true ) ] ).
+
+engine_type( plfann_float, 'FANN_FLOAT' ).
+engine_type( plfann_double, 'FANN_DOUBLE' ).
+engine_type( plfann_fixed, 'FANN_FIXED' ).
+
+% The three engines are linked into one library or, when fann was only
+% installed as shared libraries, built as a library each (see the Makefile).
+
+load_engines :-
+	absolute_file_name( foreign( plfann ), _,
+			    [ file_type( executable ), access( read ), file_errors( fail ) ] ), !,
+	load_foreign_library( foreign( plfann ) ).
+load_engines :-
+	forall( engine_type( Engine, _ ), load_foreign_library( foreign( Engine ) ) ).
+
+:- load_engines.
+
+% Every foreign predicate is defined here to call the one in the module of the
+% selected engine. Networks and training data belong to the engine that created
+% them and must only be passed to predicates of that same engine.
+%
+% The call into the engine is not a meta-call: fann_run(A, B, C) reads the flag
+% and calls '$plfann_fann_run'(Engine, A, B, C), which has a clause per engine,
+% indexed on Engine, calling Engine:fann_run(A, B, C) as resolved at load time.
+
+term_expansion( engine_predicates, Clauses ) :-
+	findall( Clause,
+		 ( current_predicate( plfann_float:Name/Arity ),
+		   functor( Head, Name, Arity ),
+		   predicate_property( plfann_float:Head, foreign ),
+		   engine_clause( Head, Clause ) ),
+		 Clauses ).
+
+engine_clause( Head, ( Head :- current_prolog_flag( plfann_engine, Engine ), Call ) ) :-
+	engine_call( Head, Engine, Call ).
+engine_clause( Head, ( Call :- Engine:Head ) ) :-
+	engine_type( Engine, _ ),
+	engine_call( Head, Engine, Call ).
+
+engine_call( Head, Engine, Call ) :-
+	Head =.. [ Name | Args ],
+	atom_concat( '$plfann_', Name, CallName ),
+	Call =.. [ CallName, Engine | Args ].
+
+engine_predicates.
 
 %!	fann_type(-Type) is det
 %
 %	Unifies Type with 'FANN_FLOAT', 'FANN_DOUBLE' or 'FANN_FIXED', depending
-%	on the compilation of the library.
+%	on the engine selected in the calling thread.
 
 %!	fann_set_type(+Type) is det
 %
-%	Sets the library depending type of compilation.
+%	Selects the engine used by the calling thread, and by the threads it
+%	creates afterwards.  All three engines are loaded together, so switching
+%	costs nothing and handles stay valid, for the engine that created them.
+%	The predicates of an engine can
+%	also be called directly, as in plfann_fixed:fann_run/3.
 %
 %	You can choose 'FANN_FLOAT', 'FANN_DOUBLE' or 'FANN_FIXED'
 %
@@ -318,24 +438,30 @@ dated: 18.12.2009
 
 fann_set_type(X):-
 	var(X),!,fail.
-fann_set_type('FANN_FLOAT'):-
-	ignore(unload_foreign_library(foreign(plfann_double))),
-	ignore(unload_foreign_library(foreign(plfann_fixed))),
-	load_foreign_library(foreign(plfann)).
-fann_set_type('FANN_DOUBLE'):-
-	ignore(unload_foreign_library(foreign(plfann))),
-	ignore(unload_foreign_library(foreign(plfann_fixed))),
-	load_foreign_library(foreign(plfann_double)).
-fann_set_type('FANN_FIXED'):-
-	ignore(unload_foreign_library(foreign(plfann_double))),
-	ignore(unload_foreign_library(foreign(plfann))),
-	load_foreign_library(foreign(plfann_fixed)).
+fann_set_type(Type):-
+	engine_type(Engine, Type),
+	set_prolog_flag(plfann_engine, Engine).
+
+%!	fann_with_type(+Type, :Goal) is semidet
+%
+%	Calls Goal once with the engine Type selected, as fann_set_type/1, and
+%	restores the previous engine afterwards.  This allows mixed precision,
+%	e.g. training a network with 'FANN_DOUBLE', saving it with
+%	fann_save_to_fixed/2 and running it with 'FANN_FIXED'.
+
+fann_with_type(Type, Goal):-
+	engine_type(Engine, Type),
+	current_prolog_flag(plfann_engine, Old),
+	setup_call_cleanup(set_prolog_flag(plfann_engine, Engine),
+			   once(Goal),
+			   set_prolog_flag(plfann_engine, Old)).
 
 %!	fann_swi_mode is det
 %
-%	Sets the printing of the library to the SWI-Prolog console.
+%	Sets the printing of the three engines to the SWI-Prolog console.
 
-fann_swi_mode :- fann_print_mode( 'FANN_SWI' ).
+fann_swi_mode :-
+	forall( engine_type( Engine, _ ), Engine:fann_print_mode( 'FANN_SWI' ) ).
 
 %!	fann_print_mode(?Mode) is det
 %
@@ -427,6 +553,516 @@ fann_create_shortcut_array(_, X, Y) :-
         fann_create_shortcut_array( X, Y), !.
 fann_create_shortcut_array(_, _, _) :- !, fail.
 
+% Running and single pattern training.
+% ------------------------------------
+
+%!	fann_run(+Ann, +Input, -Output) is det
+%
+%	Runs Ann on Input.  Input is either a list of values or a compound term
+%	such as v(X1,...,Xn), whose arity is the number of inputs.  Output is
+%	returned in the same form, a list for a list and a term with the same
+%	name, e.g. v(Y1,...,Ym), for a compound.  Compound arguments are read
+%	directly and the output term is built at once, without a cons cell per
+%	value.  fann_run_unsafe/3 accepts the same forms without checking them.
+
+%!	fann_train(+Ann, +Input, +Desired_output) is det
+%!	fann_test(+Ann, +Input, +Desired_output) is det
+%
+%	Trains or tests Ann on one pattern.  Input and Desired_output may each be
+%	a list or a compound term, as for fann_run/3.  So may the arguments of
+%	fann_scale_input/2, fann_scale_output/2, fann_descale_input/2 and
+%	fann_descale_output/2.
+
+% Serialization.
+% ---------------
+
+%!	fann_serialize(+Ann, -Bytes) is det
+%
+%	Bytes is a string holding Ann in a binary form: its layout, weights,
+%	training and cascade parameters and scaling parameters.  Unlike
+%	fann_save/2 it needs no file and writes no decimal text, so networks
+%	can be cloned, kept in the database or sent between processes cheaply.
+%	The random seed and schedules of Ann are not included.
+
+%!	fann_deserialize(+Bytes, -Ann) is det
+%
+%	Ann is a new network built from Bytes, as written by fann_serialize/2
+%	with the same engine on a machine of the same byte order.  Bytes that
+%	are not such a network raise a domain error.
+
+%!	fann_save_binary(+Ann, +File) is det
+%
+%	Saves Ann to File in the binary form of fann_serialize/2, with the
+%	weights moved to a page aligned offset at the end so fann_map/2 can map
+%	them.  The file is written to File.tmp and renamed, so networks already
+%	mapped from File keep their weights.  A File too long to add .tmp to
+%	raises representation_error(max_path_length).
+
+%!	fann_map(+File, -Ann) is det
+%
+%	Ann is a new network whose weights are mapped copy-on-write from File,
+%	as written by fann_save_binary/2 with the same engine on a machine of
+%	the same byte order.  Processes mapping the same file share the pages
+%	of its weights until they train.  A file that is not such a model
+%	raises a domain error.  fann_destroy/1 unmaps the file.
+
+% Packed weights.
+% ---------------
+
+%!	fann_get_weights_packed(+Ann, -Packed) is det
+%!	fann_get_weights_packed(+Ann, +First, +Count, -Packed) is det
+%
+%	Packed is a string holding the weights of Ann, or Count of them from
+%	weight First on (counted from 0), in the native representation of the
+%	engine's numbers.  The order is that of fann_get_connection_array/2.
+%	The weights are copied at once, without a list per connection, which
+%	makes this the form to snapshot a network or sync it between processes
+%	using the same engine.
+
+%!	fann_set_weights_packed(+Ann, +Packed) is det
+%!	fann_set_weights_packed(+Ann, +First, +Packed) is det
+%
+%	Sets the weights of Ann from Packed, as given by
+%	fann_get_weights_packed/2,4.  Packed holds either all weights or, with
+%	First, those from weight First on.
+
+% Vectors and matrices.
+% ---------------------
+
+%!	fann_create_vector(+Values, -Vector) is det
+%!	fann_create_matrix(+Rows, -Matrix) is det
+%
+%	Copies Values, a list or compound term of numbers, or Rows, a list of
+%	such rows of equal length, to a matrix kept in C.  A vector is a matrix
+%	of one row.  Matrices are handles, so the same values can be passed to
+%	several networks, and the outputs of one network to the next, without
+%	converting them to Prolog numbers and back.  Rows that is not a list
+%	raises a type error, and an empty Rows a domain error.
+%
+%	fann_run/3 given a matrix runs the network on each row and returns the
+%	outputs as a new matrix, one row per input row.  fann_train/3 and
+%	fann_test/3 given two matrices train or test on each pair of rows in
+%	turn.  A matrix holding as many values as a single pattern also stands
+%	for a list wherever one is expected.
+
+%!	fann_create_matrix_from_packed(+Cols, +Packed, -Matrix) is det
+%!	fann_get_matrix_packed(+Matrix, -Packed) is det
+%
+%	Creates a matrix of Cols columns from, or packs one into, a string of
+%	rows in the native representation of the engine's numbers, as for
+%	fann_create_train_from_packed/4.
+
+%!	fann_matrix_size(+Matrix, -Rows, -Cols) is det
+%!	fann_vector_values(+Matrix, -Values) is det
+%!	fann_matrix_values(+Matrix, -Rows) is det
+%
+%	Give the shape of Matrix, all of its values row after row as one list,
+%	or its rows as a list of lists.
+
+%!	fann_matrix_op(+Op, +A, +B, -C) is det
+%
+%	C is a new matrix holding Op applied to each element of A and the
+%	matching element of B.  Op is one of add, subtract, multiply, divide,
+%	min or max.  B is a matrix of the same shape as A, a matrix of one row
+%	applied to every row of A, or a number.  On the fixed engine the values
+%	are the raw fixed point integers, which multiply and divide do not
+%	rescale.
+
+%!	fann_slice_matrix(+Matrix, +Row, +Rows, +Col, +Cols, -Slice) is det
+%
+%	Slice is a copy of the Rows rows and Cols columns of Matrix starting at
+%	row Row and column Col, both counted from 0.
+
+%!	fann_destroy_matrix(+Matrix) is det
+%
+%	Frees Matrix.
+
+% Native training.
+% ----------------
+
+%!	fann_train_on_data(+Ann, +Data, +Max_epochs, +Epochs_between_reports, +Desired_error, +Options) is det
+%
+%	As fann_train_on_data/5, which  is the same with Options = [].  Training
+%	checks for signals after every epoch,  so call_with_time_limit/2, thread
+%	signals and Ctrl-C interrupt  it.  On interrupt or timeout Ann gets back
+%	the weights of the epoch with the lowest error seen.  The Options are:
+%
+%	  * restore_best(+Bool)
+%	    If true, the default, the weights every epoch starts from are
+%	    copied, and on interrupt or timeout those of the epoch with the
+%	    lowest error are restored before the exception is raised.  If
+%	    false nothing is copied and Ann keeps the weights of the last
+%	    epoch completed.
+%	  * max_time(+Seconds)
+%	    Raise time_limit_exceeded after Seconds of wall-clock time.
+%	  * deadline(+Stamp)
+%	    Raise time_limit_exceeded when get_time/1 passes Stamp.
+%	  * shuffle(+Bool)
+%	    If true, every epoch visits the rows in a new random order drawn
+%	    from the generator of Data.  The rows themselves are not moved.
+%	  * checkpoint(+File)
+%	    Save the training state to File, see fann_train_on_data_resume/4.
+%	    Checkpoints are written by a background thread;  one due while the
+%	    previous is still being written is skipped.  A checkpoint is also
+%	    written when training is interrupted or runs out of time.
+%	  * checkpoint_every(+N)
+%	    Save a checkpoint every N epochs, default 100 if no
+%	    checkpoint_interval/1 is given.
+%	  * checkpoint_interval(+Seconds)
+%	    Save a checkpoint when Seconds have passed since the last one.
+
+%!	fann_train_on_data_resume(+Ann, +Data, +File, +Options) is det
+%
+%	Continues fann_train_on_data/6 from the checkpoint in File, for the
+%	remaining epochs and with the reports and desired error of the original
+%	call.  Ann must have the layout of the network that was trained and Data
+%	the same rows.  The weights, the RPROP/quickprop/SARPROP slopes and
+%	steps, the learning and SARPROP parameters and the shuffle generator are
+%	restored, so training continues as if it had not stopped.  Options are those of
+%	fann_train_on_data/6, except that shuffle/1 is taken from File.
+
+%!	fann_train_on_data_validated(+Ann, +Train, +Validation, +Options) is det
+%
+%	Trains on Train with early stopping against Validation. The validation
+%	MSE is  computed natively  and the  best weights  are kept  in C.  When
+%	training stops the best weights  are restored. Besides the  Options  of
+%	fann_train_on_data/6:
+%
+%	  * max_epochs(+N)
+%	    Default 1000.
+%	  * validate_every(+N)
+%	    Test the validation set every N epochs, default 1.
+%	  * patience(+N)
+%	    Stop after N validations without improvement, default 10.
+%	  * min_delta(+Float)
+%	    Smallest decrease of the validation MSE that is an improvement.
+%	  * desired_error(+Float)
+%	    Stop when the validation MSE is at most Float, default 0.0.
+%	  * epochs_between_reports(+N)
+%	    Default 0, no reports.
+
+%!	fann_train_on_file(+Ann, +File, +Max_epochs, +Epochs_between_reports, +Desired_error, +Options) is det
+%
+%	As fann_train_on_file/5, but File is streamed from disk every epoch
+%	instead of being loaded, so it may be larger than memory.  File is in
+%	the text format of fann_read_train_from_file/2 or the binary format of
+%	fann_save_train_binary/2.  A reader thread fills one buffer of rows
+%	while Ann trains on the other.  Batch, RPROP, quickprop and, with FANN
+%	2.2, SARPROP training update the weights once per epoch and incremental
+%	training once per row, as on data in memory.  Options are
+%	those of fann_train_on_data/6 except the checkpoint options, and:
+%
+%	  * chunk_rows(+N)
+%	    Rows per buffer, default 65536.  With shuffle(true) the rows are
+%	    shuffled within each buffer, using the generator of Ann.
+
+%!	fann_train_on_compact(+Ann, +Compact, +Max_epochs, +Epochs_between_reports, +Desired_error, +Options) is det
+%
+%	As fann_train_on_file/6, on Compact made by fann_compact_train_data/3.
+%	The reader thread widens the rows into the buffers, of chunk_rows(N)
+%	rows, default 4096.
+
+%!	fann_test_compact(+Ann, +Compact, -MSE) is det
+%
+%	As fann_test_data/3, on Compact made by fann_compact_train_data/3.
+
+%!	fann_set_schedule(+Ann, +Parameter, +Schedule) is det
+%
+%	Makes Parameter, learning_rate or learning_momentum, of Ann follow
+%	Schedule in the epochs trained by fann_train_epoch/2,
+%	fann_train_on_data/5,6, fann_train_on_data_validated/4 and
+%	fann_train_on_data_resume/4.  The value of Parameter when the schedule
+%	is attached is its base value B, and E counts the epochs trained since.
+%	The learning rate is not used by RPROP and the momentum only by
+%	incremental training.  Schedule is one of:
+%
+%	  * none
+%	    Leave Parameter alone.
+%	  * step(Every, Factor)
+%	    B * Factor^floor(E / Every).
+%	  * exponential(Gamma)
+%	    B * Gamma^E.
+%	  * cosine(Period, Min)
+%	    Cosine annealing from B down to Min in Period epochs.
+%	  * warm_restarts(Period, Mult, Min)
+%	    Cosine annealing restarting at B, each period Mult times longer.
+%	  * plateau(Factor, Patience, Min)
+%	    Multiply by Factor when the training MSE did not improve for
+%	    Patience epochs, not going below Min.
+
+%!	fann_cascadetrain_on_data(+Ann, +Data, +Max_neurons, +Neurons_between_reports, +Desired_error, +Options) is det
+%
+%	As fann_cascadetrain_on_data/5, with the max_time/1, deadline/1 and
+%	restore_best/1 options of fann_train_on_data/6. Signals and the time
+%	budget are checked after every output and candidate epoch.  When stopped
+%	the candidates are dropped;  unless restore_best(false) is given a
+%	stop while the outputs are trained puts back the output weights of
+%	their best epoch, as fann_train_on_data/6 does.  The candidates are
+%	trained in
+%	parallel by a set of threads kept for the whole call; the scores and
+%	the candidate installed do not depend on the number of threads.  Unlike
+%	FANN 2.1, whose candidate loop skips the last candidate, all candidates
+%	are trained, so the network grown here differs from the one the C
+%	library's fann_cascadetrain_on_data() grows for the same seed.
+%	fann_cascadetrain_on_data/5 and
+%	fann_cascadetrain_on_file/5 use all CPUs.
+%
+%	  * threads(+N)
+%	    Number of threads training candidates, default the number of CPUs.
+%	  * checkpoint(+File), checkpoint_every(+N), checkpoint_interval(+Seconds)
+%	    As for fann_train_on_data/6, but N counts neurons and File is a
+%	    network saved by fann_save/2, taken between neurons and written by
+%	    a background thread.  fann_train_on_data_resume/4 does not resume
+%	    cascade training:  the state of the candidates is not saved.  The
+%	    network can be loaded with fann_create_from_file/2 and cascade
+%	    training started again with the remaining neurons, which is not
+%	    the same as an uninterrupted run.
+
+%!	fann_hyper_search(+Train, +Validation, +Configs, +Options, -Results) is det
+%
+%	Creates one network per element of Configs and trains them in parallel
+%	on Train, sharing the data read-only.  Each network is scored by its MSE
+%	on Validation.  Results is a list  of result(MSE, Config, Ann), sorted on
+%	MSE ascending.  Only the best networks keep their Ann,  the others are
+%	destroyed and Ann is the atom none.  Each Config is an option list:
+%
+%	  * layers(+List)
+%	    Required, the number of neurons of each layer.
+%	  * connection_rate(+Float)
+%	    Create a sparse network if Float < 1.0.
+%	  * max_epochs(+N)
+%	    Default 1000.
+%	  * desired_error(+Float)
+%	    Default 0.0.
+%	  * shuffle(+Bool)
+%	    Train every epoch in a new random order, default false.
+%	  * seed(+Int)
+%	    Redraw the initial weights and seed the epoch order from Int, so
+%	    the result does not depend on the other networks or on rand/0.
+%	    Without it the epoch order is seeded from the generator of Train.
+%	  * algorithm(+Atom), learning_rate(+Float), learning_momentum(+Float),
+%	    activation_hidden(+Atom), activation_output(+Atom),
+%	    steepness_hidden(+Float), steepness_output(+Float),
+%	    rprop_increase_factor(+Float), rprop_decrease_factor(+Float),
+%	    rprop_delta_min(+Float), rprop_delta_max(+Float),
+%	    rprop_delta_zero(+Float), quickprop_decay(+Float), quickprop_mu(+Float)
+%	    Set the parameter of the same name, e.g. algorithm('FANN_TRAIN_RPROP').
+%
+%	Other options in a Config raise a domain error.
+%
+%	Besides the max_time/1 and deadline/1 options of fann_train_on_data/6:
+%
+%	  * threads(+N)
+%	    Number of worker threads, default the number of CPUs.
+%	  * keep(+K)
+%	    Number of networks returned, default 1.
+
+%!	fann_cross_validate(+Layers, +Data, +K, +Options, -Scores) is det
+%
+%	K-fold cross-validation of a network with Layers neurons per layer on
+%	Data.  Fold I is tested on the  I-th  block of consecutive rows and the
+%	network of each fold is trained on the other rows.  The folds are views
+%	on the rows of Data,  nothing is copied.  The K networks are trained in
+%	parallel and destroyed afterwards.  Scores is the list of the K test
+%	MSEs in fold order.  Shuffle Data first if its rows are ordered.
+%	Options are those of a configuration of fann_hyper_search/5 (except
+%	layers/1) together with threads/1 and the training options of
+%	fann_train_on_data/6.  Other options raise a domain error.
+
+% Reading training data.
+% ----------------------
+
+%!	fann_read_train_from_file(+File, -Data) is det
+%!	fann_read_train_from_file(+File, -Data, +Options) is det
+%
+%	Reads File in the text format of the library: a line holding the
+%	number of rows, inputs and outputs, followed by the values of the rows.
+%	The file is mapped into memory and parsed in parallel, '.' being the
+%	decimal separator whatever the locale.  The result is the same as that
+%	of the library, whose reader this replaces.  Options:
+%
+%	  * threads(+N)
+%	    Parse with up to N threads, default the number of cores.
+
+%!	fann_read_train_csv(+Source, +Options, -Data) is det
+%
+%	Reads training data from the CSV or TSV records of Source, a file name
+%	or an input stream, which is read to its end.  Every non-empty record
+%	becomes a row, fields may be quoted.  The values are parsed in C
+%	directly into Data, with '.' as the decimal point whatever the locale.
+%	The fixed engine reads integers, values already in fixed point as in
+%	the data files of fann_read_train_from_file/2;  a decimal value raises
+%	a domain error.  Options:
+%
+%	  * inputs(+Columns)
+%	    The input columns, in order, default all but the last column.
+%	  * outputs(+Columns)
+%	    The output columns, in order, default the last column.
+%	  * header(+Bool)
+%	    If true, the first record holds the column names and is not
+%	    read as a row.  Default false.
+%	  * separator(+Char)
+%	    The field separator, a one character atom or a code.  Default
+%	    ','; use '\t' for TSV.
+%	  * missing(+Policy)
+%	    What to do with empty fields: error (default), skip the row,
+%	    mean to use the mean of the column or a number to use.
+%
+%	Columns are 1-based column numbers or, with header(true), column
+%	names.
+
+% Training data from Prolog.
+% --------------------------
+
+%!	fann_create_train_from_lists(+Inputs, +Outputs, -Data) is det
+%
+%	Creates training data from the lists of rows Inputs and Outputs, each
+%	row being a list of numbers.  The first rows give the number of inputs
+%	and outputs, all other rows must have the same lengths.  The rows are
+%	stored in one block, as by fann_read_train_from_file/2.
+
+%!	fann_create_train_from_packed(+NumInput, +NumOutput, +Packed, -Data) is det
+%
+%	Creates training data from the string or atom Packed, holding rows of
+%	NumInput and then NumOutput values in the native representation of
+%	fann_type of the engine (4 byte floats, 8 byte doubles or ints).  Each
+%	character of Packed is one byte, as read from a binary stream.
+
+%!	fann_get_train_packed(+Data, -Packed) is det
+%
+%	Packed is a string holding the rows of Data as read by
+%	fann_create_train_from_packed/4.
+
+%!	fann_append_train(+Data, +Inputs, +Outputs) is det
+%
+%	Appends the row Inputs, Outputs (lists of numbers) to Data in place.
+%	The rows of Data are kept in one block, whose room doubles when full,
+%	so appending n rows one by one takes O(n) time.  Views, and data that
+%	has views, cannot grow.
+
+%!	fann_append_train_rows(+Data, +InputRows, +OutputRows) is det
+%
+%	As fann_append_train/3 for lists of rows.  No row is appended unless
+%	all are valid.
+
+%!	fann_append_train_data(+Data, +Other) is det
+%
+%	Appends the rows of Other, which may be a view, to Data in place.
+%	Other is left alone.
+
+% Binary training data.
+% ---------------------
+
+%!	fann_save_train_binary(+Data, +File) is det
+%
+%	Saves Data to File in the binary format read by fann_map_train/2: a
+%	fixed header followed by the inputs and then the outputs of all rows,
+%	each block aligned to 64 bytes and holding little-endian values of
+%	the fann_type of the engine.  The decimal point of fixed point data is
+%	not saved.
+
+%!	fann_map_train(+File, -Data) is det
+%
+%	Data holds the rows of File, saved by fann_save_train_binary/2 with the
+%	same engine, without reading them: File is mapped into memory and the
+%	rows are paged in when used.  The mapping is private, so File is never
+%	written and processes mapping the same File share its pages.  Scaling
+%	or shuffling Data copies the pages changed.  The mapping is released by
+%	fann_destroy_train/1, once all views on Data are destroyed.
+
+% Compact training data.
+% ----------------------
+
+%!	fann_compact_train_data(+Data, +Format, -Compact) is det
+%
+%	Compact holds the rows of Data, which may be a view, in Format, one of
+%	float16 and bfloat16, or int8 and int16: codes scaled between the
+%	minimum and the maximum of each column.  Compact takes a half or, with
+%	int8, a quarter of the memory of float Data.  Its rows are widened when
+%	used by fann_train_on_compact/6 and fann_test_compact/3.  Data is left
+%	alone.  The integer formats need finite values.
+
+%!	fann_expand_train_data(+Compact, -Data) is det
+%
+%	Data holds the rows of Compact widened to the fann_type of the engine.
+
+%!	fann_compact_train_error(+Compact, -Max_error, -RMS_error) is det
+%
+%	The largest and the root mean square absolute difference between the
+%	values of Compact and those of the data it was made from.
+
+%!	fann_destroy_compact_train(+Compact) is det
+%
+%	Frees Compact.
+
+% Training data statistics.
+% -------------------------
+
+%!	fann_train_stats(+Data, -Stats) is det
+%
+%	Stats is stats(Inputs, Outputs), a list of column(Min, Max, Mean,
+%	Variance, NaNs) for each input and output column of Data, computed in
+%	one pass over the rows by as many threads as there are cores.  NaN
+%	values are counted and left out; a column of only NaN values has all
+%	other statistics 0.0.  Variance is that of the population.  Stats are
+%	cached on Data until its rows change, and are also used by
+%	fann_set_input_scaling_params/4, fann_set_output_scaling_params/4 and
+%	fann_set_scaling_params/6 instead of scanning Data.
+
+%!	fann_zscore_input_train_data(+Data) is det
+%!	fann_zscore_output_train_data(+Data) is det
+%!	fann_zscore_train_data(+Data) is det
+%
+%	Scales each input column, output column or both of Data to mean 0 and
+%	variance 1, from the statistics of fann_train_stats/2.  A constant
+%	column becomes 0.  As fann_scale_train_data/3, scaling a view scales
+%	the rows of its parent.
+
+% Training data views.
+% --------------------
+
+%!	fann_subset_train_data_view(+Data, +Pos, +Length, -View) is det
+%
+%	As fann_subset_train_data/4, but View refers to the rows of Data instead
+%	of copying them.  A view is accepted wherever training data is, and can
+%	itself be viewed.  Data stays alive until all its views are destroyed
+%	with fann_destroy_train/1,  even if Data is destroyed first.  The rows
+%	are shared, not copied:  scaling a view scales the rows of Data, and
+%	scaling Data changes the rows its views see.
+%	fann_shuffle_train_data/1 on a view only reorders the view;  on Data
+%	that has views it raises a domain error, as it would move their rows.
+
+%!	fann_index_train_data_view(+Data, +Indices, -View) is det
+%
+%	View holds the rows of Data at the 0-based Indices, in that order.
+%	Indices that is not a proper list raises a type error, and an empty
+%	one a domain error.
+
+%!	fann_bootstrap_train_data_view(+Data, +Length, -View) is det
+%
+%	View holds Length rows of Data drawn at random with replacement.  Views
+%	holding a row more than once cannot be scaled.
+
+%!	fann_is_train_data_view(+Data) is semidet
+%
+%	True if Data is a view on other training data.
+
+% Random numbers.
+% ---------------
+
+%!	fann_set_random_seed(+Ann, +Seed) is det
+%
+%	Every network has its own random number generator, used by
+%	fann_randomize_weights/3 instead of the C library rand().  This seeds
+%	the generator of Ann.  Unseeded generators start from a different state
+%	each time.
+
+%!	fann_set_train_data_random_seed(+Data, +Seed) is det
+%
+%	Seeds the generator of Data, used by fann_shuffle_train_data/1,
+%	fann_bootstrap_train_data_view/3 and the shuffle(true) option of the
+%	training predicates.
+
 % Error Printing through the SWI-Prolog Message system.
 % -----------------------------------------------------
 